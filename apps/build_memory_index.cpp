@@ -5,6 +5,7 @@
 #include <cstring>
 #include <boost/program_options.hpp>
 
+#include "filter_utils.h"
 #include "index.h"
 #include "utils.h"
 #include "program_options_utils.hpp"
@@ -25,9 +26,9 @@ namespace po = boost::program_options;
 int main(int argc, char **argv)
 {
     std::string data_type, dist_fn, data_path, index_path_prefix, label_file, universal_label, label_type;
-    uint32_t num_threads, R, L, Lf, build_PQ_bytes;
+    uint32_t num_threads, R, L, Lf, build_PQ_bytes, sq_bits;
     float alpha;
-    bool use_pq_build, use_opq;
+    bool use_pq_build, use_opq, packed;
 
     po::options_description desc{
         program_options_utils::make_program_description("build_memory_index", "Build a memory-based DiskANN index.")};
@@ -61,6 +62,10 @@ int main(int argc, char **argv)
                                        program_options_utils::BUIlD_GRAPH_PQ_BYTES);
         optional_configs.add_options()("use_opq", po::bool_switch()->default_value(false),
                                        program_options_utils::USE_OPQ);
+        optional_configs.add_options()("sq_bits", po::value<uint32_t>(&sq_bits)->default_value(0),
+                                       program_options_utils::SQ_BITS);
+        optional_configs.add_options()("packed", po::bool_switch(&packed)->default_value(false),
+                                       program_options_utils::PACKED_LAYOUT);
         optional_configs.add_options()("label_file", po::value<std::string>(&label_file)->default_value(""),
                                        program_options_utils::LABEL_FILE);
         optional_configs.add_options()("universal_label", po::value<std::string>(&universal_label)->default_value(""),
@@ -146,13 +151,24 @@ int main(int argc, char **argv)
                           .is_use_opq(use_opq)
                           .is_pq_dist_build(use_pq_build)
                           .with_num_pq_chunks(build_PQ_bytes)
+                          .with_num_sq_bits(sq_bits)
                           .build();
 
         auto index_factory = diskann::IndexFactory(config);
         auto index = index_factory.create_instance();
         index->build(data_path, data_num, filter_params);
+        if (packed)
+            index->optimize_index_layout();
         index->save(index_path_prefix.c_str());
         index.reset();
+        // loading maps the binary labels instead of parsing the text files
+        if (!label_file.empty())
+        {
+            if (label_type == std::string("ushort") || label_type == std::string("uint16"))
+                diskann::convert_label_files_to_bin<uint16_t>(index_path_prefix);
+            else
+                diskann::convert_label_files_to_bin<uint32_t>(index_path_prefix);
+        }
         return 0;
     }
     catch (const std::exception &e)
@@ -0,0 +1,508 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "common_includes.h"
+#include <boost/program_options.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include "disk_utils.h"
+#include "embedding_provider.h"
+#include "percentile_stats.h"
+#include "pq_flash_index.h"
+#include "timer.h"
+#include "program_options_utils.hpp"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#else
+#ifdef USE_BING_INFRA
+#include "bing_aligned_file_reader.h"
+#else
+#include "windows_aligned_file_reader.h"
+#endif
+#endif
+
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock Clock;
+
+// Latency histogram in the style of HdrHistogram: values below 2^SUB_BUCKET_BITS
+// micros have a bucket each, larger ones share buckets of 2^(SUB_BUCKET_BITS - 1)
+// per power of two, so every value is kept to within 1/64 of itself.
+class LatencyHistogram
+{
+  public:
+    static const uint32_t SUB_BUCKET_BITS = 7;
+    static const uint64_t HALF_COUNT = 1ULL << (SUB_BUCKET_BITS - 1);
+
+    void record(uint64_t value_us)
+    {
+        size_t b = bucket(value_us);
+        if (b >= _counts.size())
+            _counts.resize(b + 1, 0);
+        _counts[b]++;
+        _total++;
+        _sum += value_us;
+        _max = (std::max)(_max, value_us);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        if (other._counts.size() > _counts.size())
+            _counts.resize(other._counts.size(), 0);
+        for (size_t b = 0; b < other._counts.size(); b++)
+            _counts[b] += other._counts[b];
+        _total += other._total;
+        _sum += other._sum;
+        _max = (std::max)(_max, other._max);
+    }
+
+    // highest value equivalent to the value at percentile (0 to 100)
+    uint64_t value_at_percentile(double percentile) const
+    {
+        uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * (double)_total);
+        rank = (std::max)(rank, (uint64_t)1);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < _counts.size(); b++)
+        {
+            seen += _counts[b];
+            if (seen >= rank)
+                return (std::min)(highest_value(b), _max);
+        }
+        return _max;
+    }
+
+    uint64_t total() const
+    {
+        return _total;
+    }
+    uint64_t max() const
+    {
+        return _max;
+    }
+    double mean() const
+    {
+        return _total == 0 ? 0 : (double)_sum / (double)_total;
+    }
+
+    // one line per non-empty bucket: highest value, count, cumulative fraction
+    void save_csv(const std::string &filename) const
+    {
+        std::ofstream out(filename);
+        out << "value_us,count,percentile" << std::endl;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < _counts.size(); b++)
+        {
+            if (_counts[b] == 0)
+                continue;
+            seen += _counts[b];
+            out << highest_value(b) << "," << _counts[b] << "," << 100.0 * (double)seen / (double)_total << std::endl;
+        }
+    }
+
+  private:
+    static size_t bucket(uint64_t value)
+    {
+        if (value < 2 * HALF_COUNT)
+            return (size_t)value;
+        uint32_t msb = 0;
+        while ((value >> msb) > 1)
+            msb++;
+        uint32_t shift = msb - (SUB_BUCKET_BITS - 1);
+        return (size_t)(shift * HALF_COUNT + (value >> shift));
+    }
+
+    static uint64_t highest_value(size_t b)
+    {
+        if (b < 2 * HALF_COUNT)
+            return b;
+        uint64_t shift = b / HALF_COUNT - 1;
+        return ((b - shift * HALF_COUNT + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> _counts;
+    uint64_t _total = 0;
+    uint64_t _sum = 0;
+    uint64_t _max = 0;
+};
+
+// Stands in for the embedding server of a recompute run: serves the vectors
+// of a .bin file after a fixed delay per request, the round trip of the
+// server being modelled.
+class StubEmbeddingServer : public diskann::EmbeddingProvider
+{
+  public:
+    StubEmbeddingServer(const std::string &embedding_file, uint32_t latency_us)
+        : _embeddings(embedding_file), _latency_us(latency_us)
+    {
+    }
+
+    bool get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim) override
+    {
+        if (_latency_us > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(_latency_us));
+        return _embeddings.get_embeddings(node_ids, embeddings, dim);
+    }
+
+  private:
+    diskann::BinFileEmbeddingProvider _embeddings;
+    uint32_t _latency_us;
+};
+
+struct LoadParameters
+{
+    double qps = 0;
+    bool poisson = true;
+    uint64_t num_requests = 0;
+    uint32_t num_threads = 1;
+    uint32_t K = 10;
+    uint32_t L = 100;
+    uint32_t beamwidth = 2;
+    bool recompute = false;
+    uint32_t recompute_budget = 0;
+    uint32_t seed = 0;
+};
+
+// Offsets from the start of the run at which requests arrive: i / qps for a
+// fixed rate, or the arrivals of a Poisson process of rate qps.
+std::vector<double> schedule_arrivals(const LoadParameters &params)
+{
+    std::vector<double> arrivals(params.num_requests);
+    std::mt19937_64 gen(params.seed);
+    std::exponential_distribution<double> gap(params.qps);
+    double t = 0;
+    for (uint64_t i = 0; i < params.num_requests; i++)
+    {
+        arrivals[i] = params.poisson ? t : (double)i / params.qps;
+        t += gap(gen);
+    }
+    return arrivals;
+}
+
+template <typename T, typename LabelT = uint32_t>
+int load_test_disk_index(diskann::Metric &metric, const std::string &index_path_prefix,
+                         const std::string &partition_prefix, const std::string &query_file, LoadParameters params,
+                         const uint32_t num_nodes_to_cache, const bool warm, const std::string &embedding_file,
+                         const std::string &embedding_endpoint, const uint32_t stub_latency_us,
+                         const std::string &histogram_file)
+{
+    T *query = nullptr;
+    size_t query_num, query_dim, query_aligned_dim;
+    diskann::load_aligned_bin<T>(query_file, query, query_num, query_dim, query_aligned_dim);
+    if (params.num_requests == 0)
+        params.num_requests = query_num;
+
+    // partition mode reads the graph file through its own reader
+    std::shared_ptr<AlignedFileReader> reader = nullptr, graph_reader = nullptr;
+#ifdef _WINDOWS
+#ifndef USE_BING_INFRA
+    reader.reset(new WindowsAlignedFileReader());
+    graph_reader.reset(new WindowsAlignedFileReader());
+#else
+    reader.reset(new diskann::BingAlignedFileReader());
+    graph_reader.reset(new diskann::BingAlignedFileReader());
+#endif
+#else
+    reader.reset(new LinuxAlignedFileReader());
+    graph_reader.reset(new LinuxAlignedFileReader());
+#endif
+
+    std::unique_ptr<diskann::PQFlashIndex<T, LabelT>> _pFlashIndex(
+        new diskann::PQFlashIndex<T, LabelT>(reader, graph_reader, metric));
+    int res = _pFlashIndex->load(params.num_threads, index_path_prefix.c_str(), _pFlashIndex->_zmq_port, "",
+                                 partition_prefix.c_str());
+    if (res != 0)
+        return res;
+
+    if (params.recompute)
+    {
+        if (!embedding_file.empty())
+        {
+            diskann::cout << "Serving embeddings from " << embedding_file << " with " << stub_latency_us
+                          << " us per request" << std::endl;
+            _pFlashIndex->set_embedding_provider(
+                std::make_shared<StubEmbeddingServer>(embedding_file, stub_latency_us));
+        }
+        else
+        {
+            _pFlashIndex->_embedding_endpoint = embedding_endpoint;
+        }
+    }
+
+    // a warm run caches nodes and runs every query once before measuring. The
+    // reader bypasses the page cache, so a cold run reads every node from disk.
+    if (warm)
+    {
+        std::vector<uint32_t> node_list;
+        diskann::cout << "Caching " << num_nodes_to_cache << " nodes around medoid(s)" << std::endl;
+        _pFlashIndex->cache_bfs_levels(num_nodes_to_cache, node_list);
+        _pFlashIndex->load_cache_list(node_list);
+
+        diskann::cout << "Warming up index... " << std::flush;
+        omp_set_num_threads(params.num_threads);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t i = 0; i < (int64_t)query_num; i++)
+        {
+            std::vector<uint64_t> ids(params.K);
+            std::vector<float> dists(params.K);
+            _pFlashIndex->cached_beam_search(query + i * query_aligned_dim, params.K, params.L, ids.data(),
+                                             dists.data(), params.beamwidth, false, nullptr, false, false,
+                                             params.recompute, false, 0, false, false, params.recompute_budget);
+        }
+        diskann::cout << "..done" << std::endl;
+    }
+
+    // Open loop: request i is due at arrivals[i] whether or not earlier ones
+    // are done, and its latency counts from then, so time spent waiting for a
+    // free worker is included.
+    std::vector<double> arrivals = schedule_arrivals(params);
+    std::vector<diskann::QueryStats> stats(params.num_requests);
+    std::vector<LatencyHistogram> latencies(params.num_threads), service_times(params.num_threads);
+    std::atomic<uint64_t> next_request(0);
+    std::atomic<uint64_t> num_late(0);
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < params.num_threads; w++)
+    {
+        workers.emplace_back([&, w]() {
+            std::vector<uint64_t> ids(params.K);
+            std::vector<float> dists(params.K);
+            for (uint64_t i = next_request++; i < params.num_requests; i = next_request++)
+            {
+                Clock::time_point due =
+                    start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(arrivals[i]));
+                if (Clock::now() < due)
+                    std::this_thread::sleep_until(due);
+                else
+                    num_late++;
+
+                Clock::time_point begin = Clock::now();
+                _pFlashIndex->cached_beam_search(query + (i % query_num) * query_aligned_dim, params.K, params.L,
+                                                 ids.data(), dists.data(), params.beamwidth, false, &stats[i], false,
+                                                 false, params.recompute, false, 0, false, false,
+                                                 params.recompute_budget);
+                Clock::time_point end = Clock::now();
+                latencies[w].record(
+                    (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - due).count());
+                service_times[w].record(
+                    (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram latency, service_time;
+    for (uint32_t w = 0; w < params.num_threads; w++)
+    {
+        latency.merge(latencies[w]);
+        service_time.merge(service_times[w]);
+    }
+
+    double achieved_qps = (double)params.num_requests / elapsed_s;
+    diskann::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    diskann::cout.precision(2);
+    diskann::cout << "Target QPS: " << params.qps << " (" << (params.poisson ? "Poisson" : "fixed")
+                  << " arrivals), achieved QPS: " << achieved_qps << ", requests: " << params.num_requests
+                  << ", started late: " << num_late << std::endl;
+    if (achieved_qps < 0.95 * params.qps)
+        diskann::cout << "Warning: the index did not keep up with the target rate, latencies are dominated by "
+                         "queueing"
+                      << std::endl;
+
+    const std::vector<double> percentiles = {50, 90, 95, 99, 99.9, 99.99};
+    diskann::cout << std::setw(16) << "(us)" << std::setw(12) << "mean";
+    for (double p : percentiles)
+        diskann::cout << std::setw(10) << p << "%";
+    diskann::cout << std::setw(12) << "max" << std::endl;
+    for (auto row : {std::make_pair("latency", &latency), std::make_pair("service time", &service_time)})
+    {
+        diskann::cout << std::setw(16) << row.first << std::setw(12) << row.second->mean();
+        for (double p : percentiles)
+            diskann::cout << std::setw(11) << row.second->value_at_percentile(p);
+        diskann::cout << std::setw(12) << row.second->max() << std::endl;
+    }
+
+    diskann::cout << "Mean per query: "
+                  << diskann::get_mean_stats<uint32_t>(stats.data(), params.num_requests,
+                                                       [](const diskann::QueryStats &s) { return s.n_ios; })
+                  << " IOs, "
+                  << diskann::get_mean_stats<float>(stats.data(), params.num_requests,
+                                                    [](const diskann::QueryStats &s) { return s.io_us; })
+                  << " us IO, "
+                  << diskann::get_mean_stats<uint32_t>(stats.data(), params.num_requests,
+                                                       [](const diskann::QueryStats &s) { return s.n_recompute_rpcs; })
+                  << " recompute RPCs, "
+                  << diskann::get_mean_stats<float>(stats.data(), params.num_requests,
+                                                    [](const diskann::QueryStats &s) { return s.recompute_rpc_us; })
+                  << " us in RPCs" << std::endl;
+
+    if (!histogram_file.empty())
+    {
+        latency.save_csv(histogram_file);
+        diskann::cout << "Latency histogram written to " << histogram_file << std::endl;
+    }
+
+    diskann::aligned_free(query);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string data_type, dist_fn, index_path_prefix, partition_prefix, query_file, arrival, cache_mode,
+        embedding_file, embedding_endpoint, histogram_file;
+    uint32_t num_nodes_to_cache, stub_latency_us;
+    LoadParameters params;
+
+    po::options_description desc{program_options_utils::make_program_description(
+        "load_test_disk_index", "Issues queries to an on-disk DiskANN index at a target rate and reports the latency "
+                                "distribution")};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+
+        // Required parameters
+        po::options_description required_configs("Required");
+        required_configs.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                                       program_options_utils::DATA_TYPE_DESCRIPTION);
+        required_configs.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(),
+                                       program_options_utils::DISTANCE_FUNCTION_DESCRIPTION);
+        required_configs.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                                       program_options_utils::INDEX_PATH_PREFIX_DESCRIPTION);
+        required_configs.add_options()("query_file", po::value<std::string>(&query_file)->required(),
+                                       program_options_utils::QUERY_FILE_DESCRIPTION);
+        required_configs.add_options()("qps", po::value<double>(&params.qps)->required(),
+                                       "Target rate of queries per second");
+
+        // Optional parameters
+        po::options_description optional_configs("Optional");
+        optional_configs.add_options()("recall_at,K", po::value<uint32_t>(&params.K)->default_value(10),
+                                       program_options_utils::NUMBER_OF_RESULTS_DESCRIPTION);
+        optional_configs.add_options()("search_list,L", po::value<uint32_t>(&params.L)->default_value(100),
+                                       "Size of the search list.  Default value: 100");
+        optional_configs.add_options()("beamwidth,W", po::value<uint32_t>(&params.beamwidth)->default_value(2),
+                                       "Beamwidth for search.  Default value: 2");
+        optional_configs.add_options()("num_threads,T",
+                                       po::value<uint32_t>(&params.num_threads)->default_value(omp_get_num_procs()),
+                                       "Number of worker threads serving queries");
+        optional_configs.add_options()("arrival", po::value<std::string>(&arrival)->default_value("poisson"),
+                                       "Arrival process, poisson or fixed.  Default value: poisson");
+        optional_configs.add_options()("num_requests", po::value<uint64_t>(&params.num_requests)->default_value(0),
+                                       "Number of queries to issue, cycling through the query file; 0 for one "
+                                       "pass");
+        optional_configs.add_options()("seed", po::value<uint32_t>(&params.seed)->default_value(0),
+                                       "Seed of the Poisson arrivals");
+        optional_configs.add_options()("cache", po::value<std::string>(&cache_mode)->default_value("warm"),
+                                       "warm caches nodes and runs the queries once before measuring, cold "
+                                       "measures from a fresh load.  Default value: warm");
+        optional_configs.add_options()("num_nodes_to_cache", po::value<uint32_t>(&num_nodes_to_cache)->default_value(0),
+                                       program_options_utils::NUMBER_OF_NODES_TO_CACHE);
+        optional_configs.add_options()("recompute", po::bool_switch(&params.recompute)->default_value(false),
+                                       "Recompute neighbor distances from embeddings");
+        optional_configs.add_options()("recompute_budget",
+                                       po::value<uint32_t>(&params.recompute_budget)->default_value(0),
+                                       "Maximum embeddings recomputed per query; 0 for no limit");
+        optional_configs.add_options()("embedding_file", po::value<std::string>(&embedding_file)->default_value(""),
+                                       "With --recompute, serve embeddings from this float .bin file through a stub "
+                                       "server in process instead of an embedding server");
+        optional_configs.add_options()("stub_latency_us", po::value<uint32_t>(&stub_latency_us)->default_value(0),
+                                       "Delay of the stub server per request, in micros");
+        optional_configs.add_options()("embedding_endpoint",
+                                       po::value<std::string>(&embedding_endpoint)->default_value(""),
+                                       "With --recompute and no --embedding_file, the embedding server; empty for "
+                                       "the ZMQ server on localhost");
+        optional_configs.add_options()("partition_prefix", po::value<std::string>(&partition_prefix)->default_value(""),
+                                       "Prefix of the _partition.bin and _disk_graph.index files of a partitioned "
+                                       "index; empty to read the graph from the disk index");
+        optional_configs.add_options()("histogram_file", po::value<std::string>(&histogram_file)->default_value(""),
+                                       "Write the latency histogram to this CSV file");
+
+        // Merge required and optional parameters
+        desc.add(required_configs).add(optional_configs);
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    diskann::Metric metric;
+    if (dist_fn == std::string("mips"))
+    {
+        metric = diskann::Metric::INNER_PRODUCT;
+    }
+    else if (dist_fn == std::string("l2"))
+    {
+        metric = diskann::Metric::L2;
+    }
+    else if (dist_fn == std::string("cosine"))
+    {
+        metric = diskann::Metric::COSINE;
+    }
+    else
+    {
+        std::cout << "Unsupported distance function. Currently only L2/ Inner "
+                     "Product/Cosine are supported."
+                  << std::endl;
+        return -1;
+    }
+
+    if (params.qps <= 0 || params.num_threads == 0)
+    {
+        std::cerr << "qps and num_threads must be positive" << std::endl;
+        return -1;
+    }
+    if (arrival != "poisson" && arrival != "fixed")
+    {
+        std::cerr << "Unsupported arrival process " << arrival << ", use poisson or fixed" << std::endl;
+        return -1;
+    }
+    params.poisson = arrival == "poisson";
+    if (cache_mode != "warm" && cache_mode != "cold")
+    {
+        std::cerr << "Unsupported cache mode " << cache_mode << ", use warm or cold" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        if (data_type == std::string("float"))
+            return load_test_disk_index<float>(metric, index_path_prefix, partition_prefix, query_file, params,
+                                               num_nodes_to_cache, cache_mode == "warm", embedding_file,
+                                               embedding_endpoint, stub_latency_us, histogram_file);
+        else if (data_type == std::string("int8"))
+            return load_test_disk_index<int8_t>(metric, index_path_prefix, partition_prefix, query_file, params,
+                                                num_nodes_to_cache, cache_mode == "warm", embedding_file,
+                                                embedding_endpoint, stub_latency_us, histogram_file);
+        else if (data_type == std::string("uint8"))
+            return load_test_disk_index<uint8_t>(metric, index_path_prefix, partition_prefix, query_file, params,
+                                                 num_nodes_to_cache, cache_mode == "warm", embedding_file,
+                                                 embedding_endpoint, stub_latency_us, histogram_file);
+        else
+        {
+            std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
+            return -1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        diskann::cerr << "Load test failed." << std::endl;
+        return -1;
+    }
+}
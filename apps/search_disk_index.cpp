@@ -273,6 +273,22 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         auto mean_io_us = diskann::get_mean_stats<float>(stats, query_num,
                                                          [](const diskann::QueryStats &stats) { return stats.io_us; });
 
+        // per-stage breakdown, the recompute stages are 0 without an embedding server
+        auto mean_rpcs = diskann::get_mean_stats<uint32_t>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_recompute_rpcs; });
+        auto mean_requested = diskann::get_mean_stats<uint32_t>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_recompute_requested; });
+        auto mean_deduped = diskann::get_mean_stats<uint32_t>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_recompute_cache_hits; });
+        auto mean_rpc_us = diskann::get_mean_stats<float>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.recompute_rpc_us; });
+        auto mean_preprocess_us = diskann::get_mean_stats<float>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.preprocess_us; });
+        auto mean_pq_us = diskann::get_mean_stats<float>(stats, query_num,
+                                                         [](const diskann::QueryStats &stats) { return stats.pq_us; });
+        auto mean_rerank_us = diskann::get_mean_stats<float>(
+            stats, query_num, [](const diskann::QueryStats &stats) { return stats.rerank_us; });
+
         double recall = 0;
         if (calc_recall_flag)
         {
@@ -290,6 +306,10 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         }
         else
             diskann::cout << std::endl;
+        diskann::cout << std::setw(18) << "" << "per query: " << mean_rpcs << " recompute RPCs, " << mean_requested
+                      << " nodes requested, " << mean_deduped << " deduplicated, RPC " << mean_rpc_us
+                      << " us, preprocess " << mean_preprocess_us << " us, PQ " << mean_pq_us << " us, rerank "
+                      << mean_rerank_us << " us" << std::endl;
         delete[] stats;
     }
 
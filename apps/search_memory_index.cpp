@@ -69,6 +69,8 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
     }
 
     const size_t num_frozen_pts = diskann::get_graph_num_frozen_points(index_path);
+    // indices built with --sq_bits store scalar quantized vectors
+    const uint32_t num_sq_bits = diskann::SQDataStore<T>::get_num_bits_from_file(index_path + ".data");
 
     auto config = diskann::IndexConfigBuilder()
                       .with_metric(metric)
@@ -86,6 +88,7 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                       .is_use_opq(false)
                       .with_num_pq_chunks(0)
                       .with_num_frozen_pts(num_frozen_pts)
+                      .with_num_sq_bits(num_sq_bits)
                       .build();
 
     auto index_factory = diskann::IndexFactory(config);
@@ -8,14 +8,11 @@
 
 #include <vector>
 #include <algorithm>
-#include <cassert>
 #include <cstddef>
 #include <random>
 #include <limits>
 #include <cstring>
-#include <queue>
 #include <omp.h>
-#include <mkl.h>
 #include <boost/program_options.hpp>
 #include <unordered_map>
 #include <tsl/robin_map.h>
@@ -26,6 +23,7 @@
 #else
 #include <stdlib.h>
 #endif
+#include "exact_search.h"
 #include "filter_utils.h"
 #include "utils.h"
 
@@ -34,6 +32,10 @@
 #define PARTSIZE 10000000
 #define ALIGNMENT 512
 
+// The base file is streamed through diskann::exact_search in blocks of
+// base_block_size points.
+#define DEFAULT_BASE_BLOCK_SIZE 262144
+
 // custom types (for readability)
 typedef tsl::robin_set<std::string> label_set;
 typedef std::string path;
@@ -45,17 +47,6 @@ template <class T> T div_round_up(const T numerator, const T denominator)
     return (numerator % denominator == 0) ? (numerator / denominator) : 1 + (numerator / denominator);
 }
 
-using pairIF = std::pair<size_t, float>;
-struct cmpmaxstruct
-{
-    bool operator()(const pairIF &l, const pairIF &r)
-    {
-        return l.second < r.second;
-    };
-};
-
-using maxPQIFCS = std::priority_queue<pairIF, std::vector<pairIF>, cmpmaxstruct>;
-
 template <class T> T *aligned_malloc(const size_t n, const size_t alignment)
 {
 #ifdef _WINDOWS
@@ -70,199 +61,6 @@ inline bool custom_dist(const std::pair<uint32_t, float> &a, const std::pair<uin
     return a.second < b.second;
 }
 
-void compute_l2sq(float *const points_l2sq, const float *const matrix, const int64_t num_points, const uint64_t dim)
-{
-    assert(points_l2sq != NULL);
-#pragma omp parallel for schedule(static, 65536)
-    for (int64_t d = 0; d < num_points; ++d)
-        points_l2sq[d] = cblas_sdot((int64_t)dim, matrix + (ptrdiff_t)d * (ptrdiff_t)dim, 1,
-                                    matrix + (ptrdiff_t)d * (ptrdiff_t)dim, 1);
-}
-
-void distsq_to_points(const size_t dim,
-                      float *dist_matrix, // Col Major, cols are queries, rows are points
-                      size_t npoints, const float *const points,
-                      const float *const points_l2sq, // points in Col major
-                      size_t nqueries, const float *const queries,
-                      const float *const queries_l2sq, // queries in Col major
-                      float *ones_vec = NULL)          // Scratchspace of num_data size and init to 1.0
-{
-    bool ones_vec_alloc = false;
-    if (ones_vec == NULL)
-    {
-        ones_vec = new float[nqueries > npoints ? nqueries : npoints];
-        std::fill_n(ones_vec, nqueries > npoints ? nqueries : npoints, (float)1.0);
-        ones_vec_alloc = true;
-    }
-    cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, npoints, nqueries, dim, (float)-2.0, points, dim, queries, dim,
-                (float)0.0, dist_matrix, npoints);
-    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, npoints, nqueries, 1, (float)1.0, points_l2sq, npoints,
-                ones_vec, nqueries, (float)1.0, dist_matrix, npoints);
-    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, npoints, nqueries, 1, (float)1.0, ones_vec, npoints,
-                queries_l2sq, nqueries, (float)1.0, dist_matrix, npoints);
-    if (ones_vec_alloc)
-        delete[] ones_vec;
-}
-
-void inner_prod_to_points(const size_t dim,
-                          float *dist_matrix, // Col Major, cols are queries, rows are points
-                          size_t npoints, const float *const points, size_t nqueries, const float *const queries,
-                          float *ones_vec = NULL) // Scratchspace of num_data size and init to 1.0
-{
-    bool ones_vec_alloc = false;
-    if (ones_vec == NULL)
-    {
-        ones_vec = new float[nqueries > npoints ? nqueries : npoints];
-        std::fill_n(ones_vec, nqueries > npoints ? nqueries : npoints, (float)1.0);
-        ones_vec_alloc = true;
-    }
-    cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, npoints, nqueries, dim, (float)-1.0, points, dim, queries, dim,
-                (float)0.0, dist_matrix, npoints);
-
-    if (ones_vec_alloc)
-        delete[] ones_vec;
-}
-
-void exact_knn(const size_t dim, const size_t k,
-               size_t *const closest_points,     // k * num_queries preallocated, col
-                                                 // major, queries columns
-               float *const dist_closest_points, // k * num_queries
-                                                 // preallocated, Dist to
-                                                 // corresponding closes_points
-               size_t npoints,
-               float *points_in, // points in Col major
-               size_t nqueries, float *queries_in,
-               diskann::Metric metric = diskann::Metric::L2) // queries in Col major
-{
-    float *points_l2sq = new float[npoints];
-    float *queries_l2sq = new float[nqueries];
-    compute_l2sq(points_l2sq, points_in, npoints, dim);
-    compute_l2sq(queries_l2sq, queries_in, nqueries, dim);
-
-    float *points = points_in;
-    float *queries = queries_in;
-
-    if (metric == diskann::Metric::COSINE)
-    { // we convert cosine distance as
-      // normalized L2 distnace
-        points = new float[npoints * dim];
-        queries = new float[nqueries * dim];
-#pragma omp parallel for schedule(static, 4096)
-        for (int64_t i = 0; i < (int64_t)npoints; i++)
-        {
-            float norm = std::sqrt(points_l2sq[i]);
-            if (norm == 0)
-            {
-                norm = std::numeric_limits<float>::epsilon();
-            }
-            for (uint32_t j = 0; j < dim; j++)
-            {
-                points[i * dim + j] = points_in[i * dim + j] / norm;
-            }
-        }
-
-#pragma omp parallel for schedule(static, 4096)
-        for (int64_t i = 0; i < (int64_t)nqueries; i++)
-        {
-            float norm = std::sqrt(queries_l2sq[i]);
-            if (norm == 0)
-            {
-                norm = std::numeric_limits<float>::epsilon();
-            }
-            for (uint32_t j = 0; j < dim; j++)
-            {
-                queries[i * dim + j] = queries_in[i * dim + j] / norm;
-            }
-        }
-        // recalculate norms after normalizing, they should all be one.
-        compute_l2sq(points_l2sq, points, npoints, dim);
-        compute_l2sq(queries_l2sq, queries, nqueries, dim);
-    }
-
-    std::cout << "Going to compute " << k << " NNs for " << nqueries << " queries over " << npoints << " points in "
-              << dim << " dimensions using";
-    if (metric == diskann::Metric::INNER_PRODUCT)
-        std::cout << " MIPS ";
-    else if (metric == diskann::Metric::COSINE)
-        std::cout << " Cosine ";
-    else
-        std::cout << " L2 ";
-    std::cout << "distance fn. " << std::endl;
-
-    size_t q_batch_size = (1 << 9);
-    float *dist_matrix = new float[(size_t)q_batch_size * (size_t)npoints];
-
-    for (size_t b = 0; b < div_round_up(nqueries, q_batch_size); ++b)
-    {
-        int64_t q_b = b * q_batch_size;
-        int64_t q_e = ((b + 1) * q_batch_size > nqueries) ? nqueries : (b + 1) * q_batch_size;
-
-        if (metric == diskann::Metric::L2 || metric == diskann::Metric::COSINE)
-        {
-            distsq_to_points(dim, dist_matrix, npoints, points, points_l2sq, q_e - q_b,
-                             queries + (ptrdiff_t)q_b * (ptrdiff_t)dim, queries_l2sq + q_b);
-        }
-        else
-        {
-            inner_prod_to_points(dim, dist_matrix, npoints, points, q_e - q_b,
-                                 queries + (ptrdiff_t)q_b * (ptrdiff_t)dim);
-        }
-        std::cout << "Computed distances for queries: [" << q_b << "," << q_e << ")" << std::endl;
-
-#pragma omp parallel for schedule(dynamic, 16)
-        for (long long q = q_b; q < q_e; q++)
-        {
-            maxPQIFCS point_dist;
-            for (size_t p = 0; p < k; p++)
-                point_dist.emplace(p, dist_matrix[(ptrdiff_t)p + (ptrdiff_t)(q - q_b) * (ptrdiff_t)npoints]);
-            for (size_t p = k; p < npoints; p++)
-            {
-                if (point_dist.top().second > dist_matrix[(ptrdiff_t)p + (ptrdiff_t)(q - q_b) * (ptrdiff_t)npoints])
-                    point_dist.emplace(p, dist_matrix[(ptrdiff_t)p + (ptrdiff_t)(q - q_b) * (ptrdiff_t)npoints]);
-                if (point_dist.size() > k)
-                    point_dist.pop();
-            }
-            for (ptrdiff_t l = 0; l < (ptrdiff_t)k; ++l)
-            {
-                closest_points[(ptrdiff_t)(k - 1 - l) + (ptrdiff_t)q * (ptrdiff_t)k] = point_dist.top().first;
-                dist_closest_points[(ptrdiff_t)(k - 1 - l) + (ptrdiff_t)q * (ptrdiff_t)k] = point_dist.top().second;
-                point_dist.pop();
-            }
-            assert(std::is_sorted(dist_closest_points + (ptrdiff_t)q * (ptrdiff_t)k,
-                                  dist_closest_points + (ptrdiff_t)(q + 1) * (ptrdiff_t)k));
-        }
-        std::cout << "Computed exact k-NN for queries: [" << q_b << "," << q_e << ")" << std::endl;
-    }
-
-    delete[] dist_matrix;
-
-    delete[] points_l2sq;
-    delete[] queries_l2sq;
-
-    if (metric == diskann::Metric::COSINE)
-    {
-        delete[] points;
-        delete[] queries;
-    }
-}
-
-template <typename T> inline int get_num_parts(const char *filename)
-{
-    std::ifstream reader;
-    reader.exceptions(std::ios::failbit | std::ios::badbit);
-    reader.open(filename, std::ios::binary);
-    std::cout << "Reading bin file " << filename << " ...\n";
-    int npts_i32, ndims_i32;
-    reader.read((char *)&npts_i32, sizeof(int));
-    reader.read((char *)&ndims_i32, sizeof(int));
-    std::cout << "#pts = " << npts_i32 << ", #dims = " << ndims_i32 << std::endl;
-    reader.close();
-    uint32_t num_parts =
-        (npts_i32 % PARTSIZE) == 0 ? npts_i32 / PARTSIZE : (uint32_t)std::floor(npts_i32 / PARTSIZE) + 1;
-    std::cout << "Number of parts: " << num_parts << std::endl;
-    return num_parts;
-}
-
 template <typename T>
 inline void load_bin_as_float(const char *filename, float *&data, size_t &npts, size_t &ndims, int part_num)
 {
@@ -334,54 +132,109 @@ inline void save_groundtruth_as_one_file(const std::string filename, int32_t *da
     std::cout << "Finished writing truthset" << std::endl;
 }
 
-template <typename T>
-std::vector<std::vector<std::pair<uint32_t, float>>> processUnfilteredParts(const std::string &base_file,
-                                                                            size_t &nqueries, size_t &npoints,
-                                                                            size_t &dim, size_t &k, float *query_data,
-                                                                            const diskann::Metric &metric,
-                                                                            std::vector<uint32_t> &location_to_tag)
+// Range truthset layout read by diskann::load_range_truthset: npts, total
+// number of results, npts result counts, then the ids of every query.
+inline void save_range_groundtruth(const std::string filename,
+                                   const std::vector<std::vector<std::pair<uint32_t, float>>> &results,
+                                   const std::vector<uint32_t> &location_to_tag)
 {
-    float *base_data = nullptr;
-    int num_parts = get_num_parts<T>(base_file.c_str());
-    std::vector<std::vector<std::pair<uint32_t, float>>> res(nqueries);
-    for (int p = 0; p < num_parts; p++)
+    std::ofstream writer;
+    writer.exceptions(std::ios::failbit | std::ios::badbit);
+    writer.open(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+    size_t total_res = 0;
+    std::vector<uint32_t> counts(results.size());
+    for (size_t i = 0; i < results.size(); i++)
     {
-        size_t start_id = p * PARTSIZE;
-        load_bin_as_float<T>(base_file.c_str(), base_data, npoints, dim, p);
+        counts[i] = (uint32_t)results[i].size();
+        total_res += results[i].size();
+    }
+    int npts_i32 = (int)results.size(), total_i32 = (int)total_res;
+    writer.write((char *)&npts_i32, sizeof(int));
+    writer.write((char *)&total_i32, sizeof(int));
+    writer.write((char *)counts.data(), counts.size() * sizeof(uint32_t));
+    std::cout << "Saving range truthset with npts = " << results.size() << ", total results = " << total_res
+              << ", size = " << (2 + results.size() + total_res) * sizeof(uint32_t) << "B" << std::endl;
 
-        size_t *closest_points_part = new size_t[nqueries * k];
-        float *dist_closest_points_part = new float[nqueries * k];
+    std::vector<uint32_t> ids;
+    for (auto &cur_res : results)
+    {
+        ids.clear();
+        for (auto &iter : cur_res)
+            ids.push_back(location_to_tag.empty() ? iter.first : location_to_tag[iter.first]);
+        if (!ids.empty())
+            writer.write((char *)ids.data(), ids.size() * sizeof(uint32_t));
+    }
+    writer.close();
+    std::cout << "Finished writing range truthset" << std::endl;
+}
 
-        auto part_k = k < npoints ? k : npoints;
-        exact_knn(dim, part_k, closest_points_part, dist_closest_points_part, npoints, base_data, nqueries, query_data,
-                  metric);
+// Builds a bitset of the base points that may be returned: points whose tag is
+// 0 are excluded if tags are given, and if filter_label is given only points
+// labelled with filter_label or universal_label are kept. The label file is
+// read line by line, so the labels of all points are never held in memory.
+// Returns an empty vector if every point is eligible.
+inline std::vector<uint64_t> get_eligible_points(size_t npoints, const std::vector<uint32_t> &location_to_tag,
+                                                 const std::string &label_file, const std::string &filter_label,
+                                                 const std::string &universal_label)
+{
+    std::vector<uint64_t> eligible;
+    if (location_to_tag.empty() && filter_label.empty())
+        return eligible;
 
-        for (size_t i = 0; i < nqueries; i++)
+    eligible.assign(div_round_up(npoints, (size_t)64), 0);
+    if (filter_label.empty())
+    {
+        for (size_t i = 0; i < npoints; i++)
+            eligible[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+    else
+    {
+        std::ifstream infile(label_file);
+        if (!infile.is_open())
+        {
+            throw diskann::ANNException("Could not open label file " + label_file, -1, __FUNCSIG__, __FILE__,
+                                        __LINE__);
+        }
+        std::string line, token;
+        size_t line_cnt = 0, num_matches = 0;
+        while (std::getline(infile, line) && line_cnt < npoints)
         {
-            for (size_t j = 0; j < part_k; j++)
+            std::istringstream iss(line);
+            getline(iss, token, '\t');
+            std::istringstream new_iss(token);
+            while (getline(new_iss, token, ','))
             {
-                if (!location_to_tag.empty())
-                    if (location_to_tag[closest_points_part[i * k + j] + start_id] == 0)
-                        continue;
-
-                res[i].push_back(std::make_pair((uint32_t)(closest_points_part[i * part_k + j] + start_id),
-                                                dist_closest_points_part[i * part_k + j]));
+                token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
+                token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
+                if (token == filter_label || (!universal_label.empty() && token == universal_label))
+                {
+                    eligible[line_cnt >> 6] |= (uint64_t)1 << (line_cnt & 63);
+                    num_matches++;
+                    break;
+                }
             }
+            line_cnt++;
         }
-
-        delete[] closest_points_part;
-        delete[] dist_closest_points_part;
-
-        diskann::aligned_free(base_data);
+        if (line_cnt < npoints)
+            std::cerr << "WARNING: label file has labels for " << line_cnt << " of " << npoints
+                      << " points, the remaining points are skipped" << std::endl;
+        std::cout << num_matches << " of " << npoints << " points match filter label " << filter_label << std::endl;
     }
-    return res;
-};
+
+    for (size_t i = 0; i < location_to_tag.size() && i < npoints; i++)
+        if (location_to_tag[i] == 0)
+            eligible[i >> 6] &= ~((uint64_t)1 << (i & 63));
+    return eligible;
+}
 
 template <typename T>
 int aux_main(const std::string &base_file, const std::string &query_file, const std::string &gt_file, size_t k,
-             const diskann::Metric &metric, const std::string &tags_file = std::string(""))
+             const diskann::Metric &metric, const std::string &tags_file = std::string(""),
+             const std::string &label_file = std::string(""), const std::string &filter_label = std::string(""),
+             const std::string &universal_label = std::string(""), float range_threshold = 0,
+             size_t base_block_size = DEFAULT_BASE_BLOCK_SIZE)
 {
-    size_t npoints, nqueries, dim;
+    size_t npoints, nqueries, dim, base_dim;
 
     float *query_data;
 
@@ -390,50 +243,70 @@ int aux_main(const std::string &base_file, const std::string &query_file, const
         std::cerr << "WARNING: #Queries provided (" << nqueries << ") is greater than " << PARTSIZE
                   << ". Computing GT only for the first " << PARTSIZE << " queries." << std::endl;
 
+    std::vector<float> queries_l2sq(nqueries);
+    diskann::compute_l2sq(queries_l2sq.data(), query_data, nqueries, dim);
+    if (metric == diskann::Metric::COSINE)
+        diskann::normalize_points(query_data, queries_l2sq.data(), nqueries, dim);
+
     // load tags
     const bool tags_enabled = tags_file.empty() ? false : true;
     std::vector<uint32_t> location_to_tag = diskann::loadTags(tags_file, base_file);
 
+    diskann::get_bin_metadata(base_file, npoints, base_dim);
+    std::vector<uint64_t> eligible =
+        get_eligible_points(npoints, location_to_tag, label_file, filter_label, universal_label);
+
+    const bool range_search = range_threshold > 0;
+    std::vector<uint32_t> knn_ids, knn_sizes;
+    std::vector<float> knn_dists;
+    std::vector<std::vector<std::pair<uint32_t, float>>> range_results;
+
+    // for MIPS the internal distance is the negated inner product, and range
+    // ground truth holds the points with inner product >= range_threshold
+    float radius = metric == diskann::Metric::INNER_PRODUCT ? -range_threshold : range_threshold;
+    diskann::exact_search<T>(base_file, base_block_size, dim, nqueries, query_data, queries_l2sq.data(), metric,
+                             eligible, k, knn_ids, knn_dists, knn_sizes, radius,
+                             range_search ? &range_results : nullptr);
+    diskann::aligned_free(query_data);
+
+    if (range_search)
+    {
+        for (auto &cur_res : range_results)
+            std::sort(cur_res.begin(), cur_res.end(), custom_dist);
+        save_range_groundtruth(gt_file, range_results, tags_enabled ? location_to_tag : std::vector<uint32_t>());
+        return 0;
+    }
+
     int *closest_points = new int[nqueries * k];
     float *dist_closest_points = new float[nqueries * k];
 
-    std::vector<std::vector<std::pair<uint32_t, float>>> results =
-        processUnfilteredParts<T>(base_file, nqueries, npoints, dim, k, query_data, metric, location_to_tag);
-
     for (size_t i = 0; i < nqueries; i++)
     {
-        std::vector<std::pair<uint32_t, float>> &cur_res = results[i];
-        std::sort(cur_res.begin(), cur_res.end(), custom_dist);
         size_t j = 0;
-        for (auto iter : cur_res)
+        for (; j < knn_sizes[i]; j++)
         {
-            if (j == k)
-                break;
-            if (tags_enabled)
-            {
-                std::uint32_t index_with_tag = location_to_tag[iter.first];
-                closest_points[i * k + j] = (int32_t)index_with_tag;
-            }
-            else
-            {
-                closest_points[i * k + j] = (int32_t)iter.first;
-            }
+            uint32_t id = knn_ids[i * k + j];
+            closest_points[i * k + j] = tags_enabled ? (int32_t)location_to_tag[id] : (int32_t)id;
 
             if (metric == diskann::Metric::INNER_PRODUCT)
-                dist_closest_points[i * k + j] = -iter.second;
+                dist_closest_points[i * k + j] = -knn_dists[i * k + j];
             else
-                dist_closest_points[i * k + j] = iter.second;
-
-            ++j;
+                dist_closest_points[i * k + j] = knn_dists[i * k + j];
         }
         if (j < k)
+        {
             std::cout << "WARNING: found less than k GT entries for query " << i << std::endl;
+            for (; j < k; j++)
+            {
+                closest_points[i * k + j] = -1;
+                dist_closest_points[i * k + j] = std::numeric_limits<float>::max();
+            }
+        }
     }
 
     save_groundtruth_as_one_file(gt_file, closest_points, dist_closest_points, nqueries, k);
     delete[] closest_points;
     delete[] dist_closest_points;
-    diskann::aligned_free(query_data);
 
     return 0;
 }
@@ -489,8 +362,10 @@ void load_truthset(const std::string &bin_file, uint32_t *&ids, float *&dists, s
 
 int main(int argc, char **argv)
 {
-    std::string data_type, dist_fn, base_file, query_file, gt_file, tags_file;
-    uint64_t K;
+    std::string data_type, dist_fn, base_file, query_file, gt_file, tags_file, label_file, filter_label,
+        universal_label;
+    uint64_t K, base_block_size;
+    float range_threshold;
 
     try
     {
@@ -511,10 +386,22 @@ int main(int argc, char **argv)
                            "no filter_label or filter_label_file is provided it "
                            "will save the file with '.bin' at end."
                            "else it will save the file as filename_label.bin");
-        desc.add_options()("K", po::value<uint64_t>(&K)->required(),
+        desc.add_options()("K", po::value<uint64_t>(&K)->default_value(0),
                            "Number of ground truth nearest neighbors to compute");
+        desc.add_options()("range_threshold", po::value<float>(&range_threshold)->default_value(0),
+                           "If > 0, compute range ground truth (all points within this distance, or with inner "
+                           "product at least this value for mips) instead of K nearest neighbors");
         desc.add_options()("tags_file", po::value<std::string>(&tags_file)->default_value(std::string()),
                            "File containing the tags in binary format");
+        desc.add_options()("label_file", po::value<std::string>(&label_file)->default_value(""),
+                           "Input label file in txt format for filtered ground truth");
+        desc.add_options()("filter_label", po::value<std::string>(&filter_label)->default_value(""),
+                           "Only points with this label (or the universal label) are considered");
+        desc.add_options()("universal_label", po::value<std::string>(&universal_label)->default_value(""),
+                           "Universal label, if using it, only in conjunction with label_file");
+        desc.add_options()("base_block_size",
+                           po::value<uint64_t>(&base_block_size)->default_value(DEFAULT_BASE_BLOCK_SIZE),
+                           "Number of base points read from disk at a time, two blocks are held in memory");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -537,6 +424,24 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if ((K == 0) == (range_threshold <= 0))
+    {
+        std::cerr << "Exactly one of K and range_threshold should be provided." << std::endl;
+        return -1;
+    }
+
+    if (!filter_label.empty() && label_file.empty())
+    {
+        std::cerr << "filter_label requires label_file." << std::endl;
+        return -1;
+    }
+
+    if (base_block_size == 0)
+    {
+        std::cerr << "base_block_size should be positive." << std::endl;
+        return -1;
+    }
+
     diskann::Metric metric;
     if (dist_fn == std::string("l2"))
     {
@@ -559,11 +464,14 @@ int main(int argc, char **argv)
     try
     {
         if (data_type == std::string("float"))
-            aux_main<float>(base_file, query_file, gt_file, K, metric, tags_file);
+            aux_main<float>(base_file, query_file, gt_file, K, metric, tags_file, label_file, filter_label,
+                            universal_label, range_threshold, base_block_size);
         if (data_type == std::string("int8"))
-            aux_main<int8_t>(base_file, query_file, gt_file, K, metric, tags_file);
+            aux_main<int8_t>(base_file, query_file, gt_file, K, metric, tags_file, label_file, filter_label,
+                             universal_label, range_threshold, base_block_size);
         if (data_type == std::string("uint8"))
-            aux_main<uint8_t>(base_file, query_file, gt_file, K, metric, tags_file);
+            aux_main<uint8_t>(base_file, query_file, gt_file, K, metric, tags_file, label_file, filter_label,
+                              universal_label, range_threshold, base_block_size);
     }
     catch (const std::exception &e)
     {
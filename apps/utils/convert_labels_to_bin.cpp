@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <string>
+#include <boost/program_options.hpp>
+
+#include "filter_utils.h"
+#include "program_options_utils.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char **argv)
+{
+    std::string index_type, index_path_prefix, label_type;
+
+    po::options_description desc{"Arguments"};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+        desc.add_options()("index_type", po::value<std::string>(&index_type)->default_value("disk"),
+                           "disk: index built by build_disk_index, memory: index built by build_memory_index");
+        desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                           "Path prefix of the disk index, or path of the memory index");
+        desc.add_options()("label_type", po::value<std::string>(&label_type)->default_value("uint"),
+                           program_options_utils::LABEL_TYPE_DESCRIPTION);
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+        if (index_type != std::string("disk") && index_type != std::string("memory"))
+            throw std::invalid_argument("index_type must be disk or memory");
+        if (label_type != std::string("uint") && label_type != std::string("uint32") &&
+            label_type != std::string("ushort") && label_type != std::string("uint16"))
+            throw std::invalid_argument("label_type must be uint or ushort");
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    // label files are named after the file the index is loaded from
+    std::string prefix = index_type == std::string("disk") ? index_path_prefix + "_disk.index" : index_path_prefix;
+    try
+    {
+        bool ushort_labels = label_type == std::string("ushort") || label_type == std::string("uint16");
+        bool converted = ushort_labels ? diskann::convert_label_files_to_bin<uint16_t>(prefix)
+                                       : diskann::convert_label_files_to_bin<uint32_t>(prefix);
+        if (!converted)
+        {
+            diskann::cerr << "No labels file " << prefix << "_labels.txt" << std::endl;
+            return -1;
+        }
+    }
+    catch (std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        diskann::cerr << "Label conversion failed." << std::endl;
+        return -1;
+    }
+    return 0;
+}
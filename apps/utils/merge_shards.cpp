@@ -16,14 +16,18 @@
 
 int main(int argc, char **argv)
 {
-    if (argc != 9)
+    if (argc != 9 && argc != 11)
     {
         std::cout << argv[0]
                   << " vamana_index_prefix[1] vamana_index_suffix[2] "
                      "idmaps_prefix[3] "
                      "idmaps_suffix[4] n_shards[5] max_degree[6] "
                      "output_vamana_path[7] "
-                     "output_medoids_path[8]"
+                     "output_medoids_path[8] "
+                     "[pq_pivots_path[9] pq_compressed_vectors_path[10]]"
+                  << std::endl
+                  << "If the PQ files of the base data are given, merged neighborhoods are pruned with RobustPrune "
+                     "instead of being randomly truncated."
                   << std::endl;
         exit(-1);
     }
@@ -36,7 +40,9 @@ int main(int argc, char **argv)
     uint32_t max_degree = (uint64_t)std::atoi(argv[6]);
     std::string output_index(argv[7]);
     std::string output_medoids(argv[8]);
+    std::string pq_pivots(argc == 11 ? argv[9] : "");
+    std::string pq_compressed(argc == 11 ? argv[10] : "");
 
     return diskann::merge_shards(vamana_prefix, vamana_suffix, idmaps_prefix, idmaps_suffix, nshards, max_degree,
-                                 output_index, output_medoids);
+                                 output_index, output_medoids, false, std::string(""), pq_pivots, pq_compressed);
 }
@@ -0,0 +1,116 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "graph_reorder.h"
+#include "utils.h"
+
+namespace po = boost::program_options;
+
+template <typename T>
+void reorder(const std::string &index_type, const std::string &index_path_prefix, const std::string &output_path_prefix,
+             const std::string &order, const std::string &partition_file, const std::string &partition_prefix)
+{
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t start;
+    if (index_type == std::string("disk"))
+        diskann::load_disk_index_graph<T>(index_path_prefix + "_disk.index", graph, start);
+    else
+        diskann::load_memory_index_graph(index_path_prefix, graph, start);
+
+    std::vector<uint32_t> new_to_old;
+    if (order == std::string("partition"))
+        new_to_old = diskann::load_partition_order(partition_file, graph.size());
+    else
+        new_to_old = diskann::compute_bfs_order(graph, start, order == std::string("rcm"));
+    graph.clear();
+
+    if (index_type == std::string("memory"))
+    {
+        diskann::reorder_memory_index<T>(index_path_prefix, output_path_prefix, new_to_old);
+        return;
+    }
+    diskann::reorder_disk_index<T>(index_path_prefix, output_path_prefix, new_to_old);
+
+    // graph partition files of the original ids would route the reordered
+    // index to the wrong nodes
+    const std::string &prefix = partition_prefix.empty() ? index_path_prefix : partition_prefix;
+    if (file_exists(prefix + "_partition.bin") || file_exists(prefix + "_disk_graph.index"))
+        diskann::reorder_partition_files(prefix, output_path_prefix, new_to_old);
+    else if (!partition_prefix.empty())
+        throw diskann::ANNException("No graph partition files with prefix " + partition_prefix, -1);
+}
+
+int main(int argc, char **argv)
+{
+    std::string data_type, index_type, index_path_prefix, output_path_prefix, order, partition_file,
+        partition_prefix;
+
+    po::options_description desc{"Arguments"};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("index_type", po::value<std::string>(&index_type)->default_value("disk"),
+                           "disk: index built by build_disk_index, memory: index built by build_memory_index");
+        desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                           "Path prefix of the disk index, or path of the memory index");
+        desc.add_options()("output_path_prefix", po::value<std::string>(&output_path_prefix)->required(),
+                           "Path prefix (disk) or path (memory) of the reordered index");
+        desc.add_options()("order", po::value<std::string>(&order)->default_value("bfs"),
+                           "bfs: Cuthill-McKee from the medoid, rcm: reverse Cuthill-McKee, partition: partition "
+                           "order of a graph_partition partition file");
+        desc.add_options()("partition_file", po::value<std::string>(&partition_file)->default_value(std::string("")),
+                           "Partition file for --order partition");
+        desc.add_options()("partition_prefix",
+                           po::value<std::string>(&partition_prefix)->default_value(std::string("")),
+                           "Prefix of the graph partition files (_partition.bin, _disk_graph.index) of a disk index, "
+                           "rewritten under output_path_prefix; defaults to index_path_prefix if they exist there");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+        if (index_type != std::string("disk") && index_type != std::string("memory"))
+            throw std::invalid_argument("index_type must be disk or memory");
+        if (order != std::string("bfs") && order != std::string("rcm") && order != std::string("partition"))
+            throw std::invalid_argument("order must be bfs, rcm or partition");
+        if (order == std::string("partition") && partition_file.empty())
+            throw std::invalid_argument("--order partition needs --partition_file");
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    try
+    {
+        if (data_type == std::string("int8"))
+            reorder<int8_t>(index_type, index_path_prefix, output_path_prefix, order, partition_file, partition_prefix);
+        else if (data_type == std::string("uint8"))
+            reorder<uint8_t>(index_type, index_path_prefix, output_path_prefix, order, partition_file,
+                             partition_prefix);
+        else if (data_type == std::string("float"))
+            reorder<float>(index_type, index_path_prefix, output_path_prefix, order, partition_file, partition_prefix);
+        else
+        {
+            std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
+            return -1;
+        }
+    }
+    catch (std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        diskann::cerr << "Index reordering failed." << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "distance.h"
+#include "utils.h"
+
+namespace
+{
+// one query against NUM_BASE_POINTS vectors, so that the base vectors are not
+// all in L1 as they would be for a single pair
+const size_t NUM_BASE_POINTS = 1024;
+
+template <typename T> T random_value(std::mt19937 &gen)
+{
+    return (T)std::uniform_int_distribution<int>(-100, 100)(gen);
+}
+template <> uint8_t random_value<uint8_t>(std::mt19937 &gen)
+{
+    return (uint8_t)std::uniform_int_distribution<int>(0, 255)(gen);
+}
+template <> float random_value<float>(std::mt19937 &gen)
+{
+    return std::uniform_real_distribution<float>(-1.0f, 1.0f)(gen);
+}
+
+template <typename T, diskann::Metric metric> void BM_DistanceCompare(benchmark::State &state)
+{
+    const uint32_t dim = (uint32_t)state.range(0);
+    std::unique_ptr<diskann::Distance<T>> dist(diskann::get_distance_function<T>(metric));
+    const size_t aligned_dim = ROUND_UP(dim, 8);
+
+    T *base = nullptr, *query = nullptr;
+    diskann::alloc_aligned((void **)&base, NUM_BASE_POINTS * aligned_dim * sizeof(T), 32);
+    diskann::alloc_aligned((void **)&query, aligned_dim * sizeof(T), 32);
+    std::mt19937 gen(dim);
+    for (size_t i = 0; i < NUM_BASE_POINTS * aligned_dim; i++)
+        base[i] = random_value<T>(gen);
+    for (size_t d = 0; d < aligned_dim; d++)
+        query[d] = random_value<T>(gen);
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < NUM_BASE_POINTS; i++)
+            benchmark::DoNotOptimize(dist->compare(query, base + i * aligned_dim, dim));
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_BASE_POINTS);
+
+    diskann::aligned_free(base);
+    diskann::aligned_free(query);
+}
+} // namespace
+
+#define DISKANN_DISTANCE_BENCHMARK(T, metric)                                                                          \
+    BENCHMARK_TEMPLATE(BM_DistanceCompare, T, diskann::Metric::metric)->Arg(96)->Arg(128)->Arg(768)
+
+DISKANN_DISTANCE_BENCHMARK(float, L2);
+DISKANN_DISTANCE_BENCHMARK(float, INNER_PRODUCT);
+DISKANN_DISTANCE_BENCHMARK(float, COSINE);
+DISKANN_DISTANCE_BENCHMARK(int8_t, L2);
+DISKANN_DISTANCE_BENCHMARK(int8_t, COSINE);
+DISKANN_DISTANCE_BENCHMARK(uint8_t, L2);
+DISKANN_DISTANCE_BENCHMARK(uint8_t, COSINE);
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "aligned_file_reader.h"
+#include "defaults.h"
+#include "utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#else
+#ifdef USE_BING_INFRA
+#include "bing_aligned_file_reader.h"
+#else
+#include "windows_aligned_file_reader.h"
+#endif
+#endif
+
+namespace
+{
+const size_t NUM_FILE_SECTORS = 64 * 1024;
+const size_t SECTOR_LEN = diskann::defaults::SECTOR_LEN;
+
+// A file of NUM_FILE_SECTORS sectors, created once for all the benchmarks. It
+// is placed in DISKANN_BENCHMARK_DIR if set, else in the temp directory: the
+// readers open files with O_DIRECT, so it should be on the SSD to measure.
+struct SectorFile
+{
+    std::string path;
+
+    SectorFile()
+    {
+        const char *dir = std::getenv("DISKANN_BENCHMARK_DIR");
+        std::filesystem::path parent = dir != nullptr ? std::filesystem::path(dir)
+                                                      : std::filesystem::temp_directory_path();
+        path = (parent / "diskann_io_benchmark_sectors.bin").string();
+
+        std::vector<char> sector(SECTOR_LEN);
+        std::mt19937 gen(0);
+        std::ofstream writer(path, std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < NUM_FILE_SECTORS; i++)
+        {
+            for (auto &c : sector)
+                c = (char)gen();
+            writer.write(sector.data(), SECTOR_LEN);
+        }
+    }
+
+    ~SectorFile()
+    {
+        std::filesystem::remove(path);
+    }
+};
+
+const std::string &sector_file()
+{
+    static SectorFile file;
+    return file.path;
+}
+
+std::shared_ptr<AlignedFileReader> make_reader()
+{
+    std::shared_ptr<AlignedFileReader> reader = nullptr;
+#ifdef _WINDOWS
+#ifndef USE_BING_INFRA
+    reader.reset(new WindowsAlignedFileReader());
+#else
+    reader.reset(new diskann::BingAlignedFileReader());
+#endif
+#else
+    reader.reset(new LinuxAlignedFileReader());
+#endif
+    return reader;
+}
+
+// One batch of state.range(0) random single-sector reads per iteration, as a
+// beam search issues for its beam width.
+void BM_AlignedFileReaderRead(benchmark::State &state)
+{
+    const size_t queue_depth = state.range(0);
+    std::shared_ptr<AlignedFileReader> reader = make_reader();
+    reader->open(sector_file());
+    reader->register_thread();
+    IOContext &ctx = reader->get_ctx();
+
+    char *buf = nullptr;
+    diskann::alloc_aligned((void **)&buf, queue_depth * SECTOR_LEN, SECTOR_LEN);
+    std::vector<AlignedRead> reads(queue_depth);
+    std::mt19937 gen((uint32_t)queue_depth);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < queue_depth; i++)
+            reads[i] = AlignedRead((gen() % NUM_FILE_SECTORS) * SECTOR_LEN, SECTOR_LEN, buf + i * SECTOR_LEN);
+        reader->read(reads, ctx);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * queue_depth);
+    state.SetBytesProcessed(state.iterations() * queue_depth * SECTOR_LEN);
+
+    diskann::aligned_free(buf);
+    reader->deregister_all_threads();
+    reader->close();
+}
+BENCHMARK(BM_AlignedFileReaderRead)->RangeMultiplier(4)->Range(1, 256)->UseRealTime();
+} // namespace
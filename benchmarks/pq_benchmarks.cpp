@@ -0,0 +1,149 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "pq.h"
+#include "utils.h"
+
+namespace
+{
+const uint64_t PQ_DIM = 128;
+const size_t NUM_PQ_POINTS = 100000;
+// neighbors of a node whose PQ distances are computed in one expansion
+const size_t NUM_NEIGHBORS = 64;
+
+// Writes random pivots for n_chunks equal chunks of PQ_DIM dimensions in the
+// layout of generate_pq_pivots() and loads them into table.
+void load_random_pq_table(diskann::FixedChunkPQTable &table, const uint64_t n_chunks)
+{
+    std::mt19937 gen((uint32_t)n_chunks);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::vector<float> pivots(NUM_PQ_CENTROIDS * PQ_DIM), centroid(PQ_DIM, 0);
+    for (auto &v : pivots)
+        v = dis(gen);
+    std::vector<uint32_t> chunk_offsets;
+    for (uint64_t c = 0; c <= n_chunks; c++)
+        chunk_offsets.push_back((uint32_t)(c * PQ_DIM / n_chunks));
+
+    std::string pivots_file = (std::filesystem::temp_directory_path() /
+                               ("diskann_pq_benchmark_" + std::to_string(n_chunks) + "_pivots.bin"))
+                                  .string();
+    std::vector<size_t> cumul_bytes(4, 0);
+    cumul_bytes[0] = METADATA_SIZE;
+    cumul_bytes[1] = cumul_bytes[0] + diskann::save_bin<float>(pivots_file, pivots.data(), (size_t)NUM_PQ_CENTROIDS,
+                                                               PQ_DIM, cumul_bytes[0]);
+    cumul_bytes[2] = cumul_bytes[1] + diskann::save_bin<float>(pivots_file, centroid.data(), PQ_DIM, 1, cumul_bytes[1]);
+    cumul_bytes[3] = cumul_bytes[2] + diskann::save_bin<uint32_t>(pivots_file, chunk_offsets.data(),
+                                                                  chunk_offsets.size(), 1, cumul_bytes[2]);
+    diskann::save_bin<size_t>(pivots_file, cumul_bytes.data(), cumul_bytes.size(), 1, 0);
+
+    table.load_pq_centroid_bin(pivots_file.c_str(), n_chunks);
+    std::filesystem::remove(pivots_file);
+}
+
+std::vector<float> random_query(std::mt19937 &gen)
+{
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::vector<float> query(PQ_DIM);
+    for (auto &v : query)
+        v = dis(gen);
+    return query;
+}
+
+void BM_PopulateChunkDistances(benchmark::State &state)
+{
+    const uint64_t n_chunks = state.range(0);
+    diskann::FixedChunkPQTable table;
+    load_random_pq_table(table, n_chunks);
+    std::mt19937 gen(1);
+    std::vector<float> query = random_query(gen);
+    std::vector<float> dists(NUM_PQ_CENTROIDS * n_chunks);
+
+    for (auto _ : state)
+    {
+        table.populate_chunk_distances(query.data(), dists.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PopulateChunkDistances)->Arg(16)->Arg(32)->Arg(64);
+
+void BM_PopulateChunkInnerProducts(benchmark::State &state)
+{
+    const uint64_t n_chunks = state.range(0);
+    diskann::FixedChunkPQTable table;
+    load_random_pq_table(table, n_chunks);
+    std::mt19937 gen(1);
+    std::vector<float> query = random_query(gen);
+    std::vector<float> dists(NUM_PQ_CENTROIDS * n_chunks);
+
+    for (auto _ : state)
+    {
+        table.populate_chunk_inner_products(query.data(), dists.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PopulateChunkInnerProducts)->Arg(16)->Arg(32)->Arg(64);
+
+// the PQ distances of the neighbors of one node, as computed for each
+// expanded node during a search: gather their codes, then look them up
+void BM_PQNeighborDistances(benchmark::State &state)
+{
+    const uint64_t n_chunks = state.range(0);
+    std::mt19937 gen((uint32_t)n_chunks);
+    std::vector<uint8_t> codes(NUM_PQ_POINTS * n_chunks);
+    for (auto &c : codes)
+        c = (uint8_t)(gen() % NUM_PQ_CENTROIDS);
+    std::vector<float> pq_dists(NUM_PQ_CENTROIDS * n_chunks);
+    for (auto &d : pq_dists)
+        d = std::uniform_real_distribution<float>(0.0f, 1.0f)(gen);
+
+    // random neighbors, so that the gather misses the cache as in a search
+    const size_t num_batches = 1024;
+    std::vector<unsigned> ids(num_batches * NUM_NEIGHBORS);
+    for (auto &id : ids)
+        id = (unsigned)(gen() % NUM_PQ_POINTS);
+    std::vector<uint8_t> coord_scratch(NUM_NEIGHBORS * n_chunks);
+    std::vector<float> dists_out(NUM_NEIGHBORS);
+
+    size_t batch = 0;
+    for (auto _ : state)
+    {
+        diskann::aggregate_coords(ids.data() + batch * NUM_NEIGHBORS, NUM_NEIGHBORS, codes.data(), n_chunks,
+                                  coord_scratch.data());
+        diskann::pq_dist_lookup(coord_scratch.data(), NUM_NEIGHBORS, n_chunks, pq_dists.data(), dists_out.data());
+        benchmark::ClobberMemory();
+        batch = (batch + 1) % num_batches;
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_NEIGHBORS);
+}
+BENCHMARK(BM_PQNeighborDistances)->Arg(16)->Arg(32)->Arg(64);
+
+// pq_dist_lookup alone, on codes already gathered
+void BM_PQDistLookup(benchmark::State &state)
+{
+    const uint64_t n_chunks = state.range(0);
+    std::mt19937 gen((uint32_t)n_chunks);
+    std::vector<uint8_t> codes(NUM_NEIGHBORS * n_chunks);
+    for (auto &c : codes)
+        c = (uint8_t)(gen() % NUM_PQ_CENTROIDS);
+    std::vector<float> pq_dists(NUM_PQ_CENTROIDS * n_chunks);
+    for (auto &d : pq_dists)
+        d = std::uniform_real_distribution<float>(0.0f, 1.0f)(gen);
+    std::vector<float> dists_out(NUM_NEIGHBORS);
+
+    for (auto _ : state)
+    {
+        diskann::pq_dist_lookup(codes.data(), NUM_NEIGHBORS, n_chunks, pq_dists.data(), dists_out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_NEIGHBORS);
+}
+BENCHMARK(BM_PQDistLookup)->Arg(16)->Arg(32)->Arg(64);
+} // namespace
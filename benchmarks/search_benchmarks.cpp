@@ -0,0 +1,140 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/dynamic_bitset.hpp>
+
+#include "neighbor.h"
+#include "tsl/robin_set.h"
+
+namespace
+{
+// candidates offered to the queue per unit of its capacity
+const size_t CANDIDATES_PER_SLOT = 8;
+// candidates inserted per expanded node, the degree of the graph
+const size_t CANDIDATES_PER_EXPANSION = 32;
+
+// Offers the queue candidates the way a search does: the neighbors of each
+// expanded node, at distances that shrink as the search converges.
+void BM_NeighborPriorityQueueInsert(benchmark::State &state)
+{
+    const size_t L = state.range(0);
+    const size_t num_candidates = CANDIDATES_PER_SLOT * L;
+    std::mt19937 gen((uint32_t)L);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<diskann::Neighbor> candidates;
+    for (size_t i = 0; i < num_candidates; i++)
+    {
+        float scale = 1.0f - 0.5f * (float)i / num_candidates;
+        candidates.emplace_back((unsigned)gen(), scale * dis(gen));
+    }
+
+    diskann::NeighborPriorityQueue queue(L);
+    for (auto _ : state)
+    {
+        queue.clear();
+        for (size_t i = 0; i < num_candidates; i++)
+        {
+            queue.insert(candidates[i]);
+            if ((i + 1) % CANDIDATES_PER_EXPANSION == 0 && queue.has_unexpanded_node())
+                benchmark::DoNotOptimize(queue.closest_unexpanded());
+        }
+        benchmark::DoNotOptimize(queue[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * num_candidates);
+}
+BENCHMARK(BM_NeighborPriorityQueueInsert)->RangeMultiplier(4)->Range(64, 4096);
+
+// The visited sets used by the searches, over an index of NUM_POINTS points.
+// Each iteration is one query: test and insert state.range(0) node ids, some
+// of them repeated, then reset the set for the next query.
+const size_t NUM_POINTS = 1000000;
+
+std::vector<uint32_t> visited_ids(const size_t num_visits)
+{
+    std::mt19937 gen((uint32_t)num_visits);
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < num_visits; i++)
+    {
+        // about a quarter of the neighbors seen were already visited
+        if (i > 0 && gen() % 4 == 0)
+            ids.push_back(ids[gen() % ids.size()]);
+        else
+            ids.push_back((uint32_t)(gen() % NUM_POINTS));
+    }
+    return ids;
+}
+
+template <typename SetT> void BM_VisitedRobinSet(benchmark::State &state)
+{
+    std::vector<uint32_t> ids = visited_ids(state.range(0));
+    SetT visited;
+    for (auto _ : state)
+    {
+        size_t new_ids = 0;
+        for (uint32_t id : ids)
+        {
+            if (visited.find(id) == visited.end())
+            {
+                visited.insert(id);
+                new_ids++;
+            }
+        }
+        benchmark::DoNotOptimize(new_ids);
+        visited.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK_TEMPLATE(BM_VisitedRobinSet, tsl::robin_set<size_t>)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK_TEMPLATE(BM_VisitedRobinSet, tsl::robin_set<uint32_t>)->RangeMultiplier(10)->Range(1000, 100000);
+
+void BM_VisitedDynamicBitset(benchmark::State &state)
+{
+    std::vector<uint32_t> ids = visited_ids(state.range(0));
+    boost::dynamic_bitset<> visited(NUM_POINTS);
+    for (auto _ : state)
+    {
+        size_t new_ids = 0;
+        for (uint32_t id : ids)
+        {
+            if (!visited.test(id))
+            {
+                visited.set(id);
+                new_ids++;
+            }
+        }
+        benchmark::DoNotOptimize(new_ids);
+        visited.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_VisitedDynamicBitset)->RangeMultiplier(10)->Range(1000, 100000);
+
+// a bitset that is reset by clearing only the ids set, as for sparse visits
+void BM_VisitedVectorBoolSparseReset(benchmark::State &state)
+{
+    std::vector<uint32_t> ids = visited_ids(state.range(0));
+    std::vector<bool> visited(NUM_POINTS, false);
+    std::vector<uint32_t> set_ids;
+    for (auto _ : state)
+    {
+        for (uint32_t id : ids)
+        {
+            if (!visited[id])
+            {
+                visited[id] = true;
+                set_ids.push_back(id);
+            }
+        }
+        benchmark::DoNotOptimize(set_ids.size());
+        for (uint32_t id : set_ids)
+            visited[id] = false;
+        set_ids.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_VisitedVectorBoolSparseReset)->RangeMultiplier(10)->Range(1000, 100000);
+} // namespace
@@ -30,6 +30,8 @@ GP_CUT=100
 GP_SCALE_F=1
 DATA_TYPE=float
 GP_T=10
+# 1: compressed adjacency, partitions merged into denser sectors
+GP_COMPRESS=0
 
 # 路径配置
 PREFIX=""
@@ -116,6 +118,9 @@ case $ACTION in
       if [ -f "${GRAPH_GP_PATH}_part_tmp.index" ]; then
         echo "copy ${GRAPH_GP_PATH}_part_tmp.index to ${OUTPUT_DIR}/_disk_graph.index."
         GP_FILE_PATH=${GRAPH_GP_PATH}_part.bin
+        if [ -f "${GRAPH_GP_PATH}_part_tmp_partition.bin" ]; then
+          GP_FILE_PATH=${GRAPH_GP_PATH}_part_tmp_partition.bin
+        fi
         cp ${GRAPH_GP_PATH}_part_tmp.index ${OUTPUT_DIR}/_disk_graph.index
         cp ${GP_FILE_PATH} ${OUTPUT_DIR}/_partition.bin
         exit 0
@@ -146,7 +151,12 @@ case $ACTION in
              fi
 
       echo "Running relayout... ${GRAPH_GP_PATH}relayout.log"
-      time ${EXE_PATH}/graph_partition/index_relayout ${OLD_INDEX_FILE} ${GP_FILE_PATH} $GP_DATA_TYPE 1 > ${GRAPH_GP_PATH}relayout.log
+      if [ ${GP_COMPRESS} -eq 1 ]; then
+        time ${EXE_PATH}/graph_partition/index_relayout ${OLD_INDEX_FILE} ${GP_FILE_PATH} $GP_DATA_TYPE 3 > ${GRAPH_GP_PATH}relayout.log
+        GP_FILE_PATH=${GRAPH_GP_PATH}_part_tmp_partition.bin
+      else
+        time ${EXE_PATH}/graph_partition/index_relayout ${OLD_INDEX_FILE} ${GP_FILE_PATH} $GP_DATA_TYPE 1 > ${GRAPH_GP_PATH}relayout.log
+      fi
       
       echo "Copying results to ${OUTPUT_DIR}/"
       cp ${GRAPH_GP_PATH}_part_tmp.index ${OUTPUT_DIR}/_disk_graph.index
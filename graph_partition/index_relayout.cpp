@@ -26,6 +26,8 @@
 #include <sys/stat.h>
 #include <errno.h>
 
+#include "compressed_graph.h"
+
 // 定义必要的类型和常量
 typedef uint64_t _u64;
 typedef uint32_t _u32;
@@ -39,8 +41,10 @@ typedef uint32_t _u32;
 #define DEFAULT_MODE 0
 #define GRAPH_ONLY 1
 #define EMB_ONLY 2
+#define GRAPH_ONLY_COMPRESSED 3
 
 const std::string partition_index_filename = "_tmp.index";
+const std::string packed_partition_filename = "_tmp_partition.bin";
 
 #define GRAPH_LAYOUT_IN_DISK false
 #define EMB_LAYOUT_IN_DISK false
@@ -148,6 +152,116 @@ public:
   }
 };
 
+// Write the graph of the index in the compressed format of compressed_graph.h.
+// Compressed records are smaller than the fixed graph slots the partitions
+// were sized for, so consecutive partitions are merged into one sector while
+// they fit. The sectors become the partitions of the graph file and are
+// written to partition_path.
+void write_compressed_graph(char* mem_index, _u64 _nd, _u64 max_node_len, unsigned nnodes_per_sector,
+                            _u64 emb_node_len, const std::vector<std::vector<unsigned> >& layout,
+                            cached_ofstream& diskann_writer, const std::string& partition_path) {
+  std::vector<std::vector<unsigned> > sectors;
+  std::vector<std::vector<uint8_t> > sector_records;
+  std::vector<std::vector<uint16_t> > sector_offsets;
+  std::vector<uint8_t> record;
+  _u64 raw_bytes = 0, compressed_bytes = 0;
+
+  // sector header: uint16 num_nodes, uint16 offsets[num_nodes + 1]
+  auto fits = [](_u64 num_nodes, _u64 record_bytes) {
+    return 2 * (num_nodes + 2) + record_bytes <= SECTOR_LEN;
+  };
+  auto new_sector = [&]() {
+    sectors.emplace_back();
+    sector_records.emplace_back();
+    sector_offsets.emplace_back();
+  };
+
+  new_sector();
+  std::vector<std::vector<uint8_t> > part_records;
+  for (unsigned i = 0; i < layout.size(); i++) {
+    part_records.assign(layout[i].size(), std::vector<uint8_t>());
+    _u64 part_bytes = 0;
+    for (unsigned j = 0; j < layout[i].size(); j++) {
+      char* node_buf = mem_index + READ_SECTOR_OFFSET(layout[i][j]) + emb_node_len;
+      unsigned nnbrs = *(reinterpret_cast<unsigned*>(node_buf));
+      diskann::encode_adjacency(reinterpret_cast<unsigned*>(node_buf) + 1, nnbrs, part_records[j]);
+      part_bytes += part_records[j].size();
+      raw_bytes += sizeof(unsigned) * (nnbrs + 1);
+    }
+    compressed_bytes += part_bytes;
+
+    // keep a partition in one sector unless it is larger than a sector
+    if (!sectors.back().empty() &&
+        !fits(sectors.back().size() + layout[i].size(), sector_records.back().size() + part_bytes)) {
+      new_sector();
+    }
+    for (unsigned j = 0; j < layout[i].size(); j++) {
+      if (!fits(sectors.back().size() + 1, sector_records.back().size() + part_records[j].size())) {
+        if (sectors.back().empty()) {
+          std::cout << "node " << layout[i][j] << " does not fit in a sector" << std::endl;
+          exit(-1);
+        }
+        new_sector();
+      }
+      sectors.back().push_back(layout[i][j]);
+      sector_offsets.back().push_back(sector_records.back().size());
+      sector_records.back().insert(sector_records.back().end(), part_records[j].begin(),
+                                   part_records[j].end());
+    }
+  }
+  if (sectors.back().empty()) {
+    sectors.pop_back();
+  }
+
+  _u64 C = 0;
+  for (auto& s : sectors) {
+    C = std::max<_u64>(C, s.size());
+  }
+  const _u64 disk_file_size = sectors.size() * SECTOR_LEN + SECTOR_LEN;
+  std::cout << "compressed adjacency " << compressed_bytes << " bytes (raw " << raw_bytes << "), "
+            << sectors.size() << " sectors (was " << layout.size() << "), max nodes per sector " << C
+            << std::endl;
+
+  // metadata of the graph file, new version layout only
+  char* meta_buf = mem_index + 2 * sizeof(int);
+  int meta_n = *(reinterpret_cast<int*>(mem_index));
+  *(reinterpret_cast<_u64*>(meta_buf + 4 * sizeof(_u64))) = C;
+  *(reinterpret_cast<_u64*>(meta_buf + (meta_n - 1) * sizeof(_u64))) = disk_file_size;
+  diskann::write_compressed_graph_header(mem_index);
+
+  diskann_writer.write(mem_index, SECTOR_LEN);
+  std::unique_ptr<char[]> sector_buf = std::unique_ptr<char[]>(new char[SECTOR_LEN]);
+  for (unsigned i = 0; i < sectors.size(); i++) {
+    memset(sector_buf.get(), 0, SECTOR_LEN);
+    uint16_t num_nodes = sectors[i].size();
+    uint16_t header_len = 2 * (num_nodes + 2);
+    memcpy(sector_buf.get(), &num_nodes, sizeof(uint16_t));
+    for (unsigned j = 0; j <= num_nodes; j++) {
+      uint16_t offset = header_len + (j < num_nodes ? sector_offsets[i][j] : sector_records[i].size());
+      memcpy(sector_buf.get() + 2 * (j + 1), &offset, sizeof(uint16_t));
+    }
+    memcpy(sector_buf.get() + header_len, sector_records[i].data(), sector_records[i].size());
+    diskann_writer.write(sector_buf.get(), SECTOR_LEN);
+  }
+
+  std::vector<unsigned> id2pid(_nd);
+  std::ofstream writer(partition_path, std::ios::binary | std::ios::out);
+  _u64 sector_nums = sectors.size();
+  writer.write((char*) &C, sizeof(_u64));
+  writer.write((char*) &sector_nums, sizeof(_u64));
+  writer.write((char*) &_nd, sizeof(_u64));
+  for (unsigned i = 0; i < sectors.size(); i++) {
+    unsigned s = sectors[i].size();
+    writer.write((char*) &s, sizeof(unsigned));
+    writer.write((char*) sectors[i].data(), sizeof(unsigned) * s);
+    for (auto id : sectors[i]) {
+      id2pid[id] = i;
+    }
+  }
+  writer.write((char*) id2pid.data(), sizeof(unsigned) * _nd);
+  std::cout << "wrote partitions of the compressed graph to " << partition_path << std::endl;
+}
+
 // Write DiskANN sector data according to graph-partition layout 
 // The new index data
 template <typename T>
@@ -229,6 +343,21 @@ void relayout(const char* indexname, const char* partition_name, const int mode)
   std::cout << "C: " << C << " partition_nums:" << _partition_nums
             << " _nd:" << _nd << std::endl;
 
+  auto graph_node_len = max_node_len - sizeof(T) * _dim;
+  auto emb_node_len = sizeof(T) * _dim;
+  if (mode == GRAPH_ONLY_COMPRESSED) {
+    if (!meta_pair.first) {
+      std::cout << "compressed graph needs the new index metadata" << std::endl;
+      exit(-1);
+    }
+    std::string packed_path(partition_name);
+    packed_path = packed_path.substr(0, packed_path.find_last_of('.')) + packed_partition_filename;
+    write_compressed_graph(mem_index.get(), _nd, max_node_len, nnodes_per_sector, emb_node_len, layout,
+                           diskann_writer, packed_path);
+    std::cout << "Relayout index." << std::endl;
+    return;
+  }
+
   const _u64 disk_file_size = _partition_nums * SECTOR_LEN + SECTOR_LEN;
   if (meta_pair.first) {
     char* meta_buf = mem_index.get() + 2 * sizeof(int);
@@ -244,8 +373,6 @@ void relayout(const char* indexname, const char* partition_name, const int mode)
 
   diskann_writer.write((char*) mem_index.get(), SECTOR_LEN);  // copy meta data;
 
-  auto graph_node_len = max_node_len - sizeof(T) * _dim;
-  auto emb_node_len = sizeof(T) * _dim;
   std::cout << "max_node_len: " << max_node_len << "graph_node_len: " \
             << graph_node_len << ", emb_node_len: " << emb_node_len << std::endl;
   for (unsigned i = 0; i < _partition_nums; i++) {
@@ -306,6 +433,8 @@ int main(int argc, char** argv) {
     std::cout << "relayout Graph." << std::endl;
   } else if (mode == EMB_ONLY) {
     std::cout << "relayout Emb." << std::endl;
+  } else if (mode == GRAPH_ONLY_COMPRESSED) {
+    std::cout << "relayout compressed Graph." << std::endl;
   } else {
     std::cout << "mode not support" << std::endl;
     exit(-1);
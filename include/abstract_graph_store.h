@@ -10,6 +10,49 @@
 namespace diskann
 {
 
+// Read-only view of the out-neighbours of one node. It stays valid until the
+// neighbours of the node are modified or the graph is resized.
+class NeighbourList
+{
+  public:
+    NeighbourList() = default;
+    NeighbourList(const location_t *data, const size_t size) : _data(data), _size(size)
+    {
+    }
+    NeighbourList(const std::vector<location_t> &neighbours) : _data(neighbours.data()), _size(neighbours.size())
+    {
+    }
+
+    const location_t *begin() const
+    {
+        return _data;
+    }
+    const location_t *end() const
+    {
+        return _data + _size;
+    }
+    const location_t *data() const
+    {
+        return _data;
+    }
+    size_t size() const
+    {
+        return _size;
+    }
+    bool empty() const
+    {
+        return _size == 0;
+    }
+    location_t operator[](const size_t j) const
+    {
+        return _data[j];
+    }
+
+  private:
+    const location_t *_data = nullptr;
+    size_t _size = 0;
+};
+
 class AbstractGraphStore
 {
   public:
@@ -27,13 +70,26 @@ class AbstractGraphStore
                       const uint32_t start) = 0;
 
     // not synchronised, user should use lock when necvessary.
-    virtual const std::vector<location_t> &get_neighbours(const location_t i) const = 0;
+    virtual NeighbourList get_neighbours(const location_t i) const = 0;
     virtual void add_neighbour(const location_t i, location_t neighbour_id) = 0;
     virtual void clear_neighbours(const location_t i) = 0;
     virtual void swap_neighbours(const location_t a, location_t b) = 0;
 
     virtual void set_neighbours(const location_t i, std::vector<location_t> &neighbours) = 0;
 
+    // Copies the neighbours of i into out. Needs the lock of i unless
+    // lock_free_reads() is true, in which case the copy is a consistent
+    // snapshot even while another thread modifies the neighbours of i.
+    virtual void get_neighbours_snapshot(const location_t i, std::vector<location_t> &out) const
+    {
+        NeighbourList neighbours = get_neighbours(i);
+        out.assign(neighbours.begin(), neighbours.end());
+    }
+    virtual bool lock_free_reads() const
+    {
+        return false;
+    }
+
     virtual size_t resize_graph(const size_t new_size) = 0;
     virtual void clear_graph() = 0;
 
@@ -43,7 +99,7 @@ class AbstractGraphStore
     virtual size_t get_max_range_of_graph() = 0;
 
     // Total internal points _max_points + _num_frozen_points
-    size_t get_total_points()
+    size_t get_total_points() const
     {
         return _capacity;
     }
@@ -99,6 +99,11 @@ class AbstractIndex
 
     virtual consolidation_report consolidate_deletes(const IndexWriteParameters &parameters) = 0;
 
+    virtual void start_background_consolidation(const IndexWriteParameters &parameters, size_t min_deletes,
+                                                uint32_t check_interval_ms = 1000, size_t max_nodes_per_sec = 0) = 0;
+
+    virtual void stop_background_consolidation() = 0;
+
     virtual void optimize_index_layout() = 0;
 
     // memory should be allocated for vec before calling this function
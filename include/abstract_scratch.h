@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+
 namespace diskann
 {
 
@@ -12,7 +14,8 @@ template <typename data_t> class AbstractScratch
   public:
     AbstractScratch() = default;
     // This class does not take any responsibilty for memory management of
-    // its members. It is the responsibility of the derived classes to do so.
+    // its members, apart from the prepared query which manages itself. It is
+    // the responsibility of the derived classes to do so.
     virtual ~AbstractScratch() = default;
 
     // Scratch objects should not be copied
@@ -27,9 +30,21 @@ template <typename data_t> class AbstractScratch
     {
         return _pq_scratch;
     }
+    // Query as a data store prepares it in preprocess_query for the
+    // get_distance calls that follow, with the constant term of its distances.
+    std::vector<float> &prepared_query()
+    {
+        return _prepared_query;
+    }
+    float &prepared_query_bias()
+    {
+        return _prepared_query_bias;
+    }
 
   protected:
     data_t *_aligned_query_T = nullptr;
     PQScratch<data_t> *_pq_scratch = nullptr;
+    std::vector<float> _prepared_query;
+    float _prepared_query_bias = 0.0f;
 };
 } // namespace diskann
@@ -2,54 +2,114 @@
 // Licensed under the MIT license.
 
 #pragma once
+#include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <sstream>
 
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "logger.h"
 #include "ann_exception.h"
 
+// O_DIRECT reads need buffers, offsets and lengths aligned to the logical
+// block size of the device, 4KB covers all common devices.
+#define CACHED_IO_DIRECT_ALIGNMENT 4096
+
 // sequential cached reads
+//
+// The cache is split into two buffers. While the caller consumes one, the
+// next part of the file is read into the other on a background thread, so
+// the caller only waits for the disk if it consumes data faster than it can
+// be read. If direct_io is set (Linux only), the file is read with O_DIRECT
+// to bypass the page cache; if the file system does not support it, regular
+// buffered reads are used instead.
 class cached_ifstream
 {
   public:
     cached_ifstream()
     {
     }
-    cached_ifstream(const std::string &filename, uint64_t cacheSize) : cache_size(cacheSize), cur_off(0)
+    cached_ifstream(const std::string &filename, uint64_t cacheSize, bool direct_io = false)
+        : cache_size(cacheSize), cur_off(0)
     {
         reader.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        this->open(filename, cache_size);
+        this->open(filename, cache_size, direct_io);
     }
     ~cached_ifstream()
     {
-        delete[] cache_buf;
-        reader.close();
+        wait_for_prefetch(false);
+        free_buffers();
+        if (reader.is_open())
+            reader.close();
+#ifndef _WINDOWS
+        if (direct_fd != -1)
+            ::close(direct_fd);
+#endif
     }
 
-    void open(const std::string &filename, uint64_t cacheSize)
+    void open(const std::string &filename, uint64_t cacheSize, bool direct_io = false)
     {
+        wait_for_prefetch(false);
+        free_buffers();
+#ifndef _WINDOWS
+        if (direct_fd != -1)
+        {
+            ::close(direct_fd);
+            direct_fd = -1;
+        }
+#endif
         this->cur_off = 0;
+        this->cur_len = 0;
+        this->file_off = 0;
+        this->consumed = 0;
 
         try
         {
+            reader.exceptions(std::ifstream::failbit | std::ifstream::badbit);
             reader.open(filename, std::ios::binary | std::ios::ate);
             fsize = reader.tellg();
             reader.seekg(0, std::ios::beg);
             assert(reader.is_open());
             assert(cacheSize > 0);
-            cacheSize = (std::min)(cacheSize, fsize);
-            this->cache_size = cacheSize;
-            cache_buf = new char[cacheSize];
-            reader.read(cache_buf, cacheSize);
-            diskann::cout << "Opened: " << filename.c_str() << ", size: " << fsize << ", cache_size: " << cacheSize
-                          << std::endl;
         }
         catch (std::system_error &e)
         {
             throw diskann::FileException(filename, e, __FUNCSIG__, __FILE__, __LINE__);
         }
+
+#if !defined(_WINDOWS) && defined(O_DIRECT)
+        if (direct_io)
+        {
+            direct_fd = ::open(filename.c_str(), O_RDONLY | O_DIRECT);
+            if (direct_fd != -1)
+                reader.close();
+            else
+                diskann::cout << "O_DIRECT is not supported for " << filename.c_str() << ", using buffered reads"
+                              << std::endl;
+        }
+#endif
+
+        // each of the two buffers gets half of the cache
+        cacheSize = (std::min)(cacheSize, fsize);
+        buf_size = (std::max)(cacheSize / 2, (uint64_t)1);
+        if (direct_fd != -1)
+            buf_size = round_up_to_direct(buf_size);
+        this->cache_size = 2 * buf_size;
+        allocate_buffers();
+
+        // fill the first buffer now and start reading the second
+        cur_buf = 0;
+        cur_len = fill(bufs[cur_buf]);
+        start_prefetch();
+        diskann::cout << "Opened: " << filename.c_str() << ", size: " << fsize << ", cache_size: " << cache_size
+                      << (direct_fd != -1 ? " (O_DIRECT)" : "") << std::endl;
     }
 
     size_t get_file_size()
@@ -59,61 +119,167 @@ class cached_ifstream
 
     void read(char *read_buf, uint64_t n_bytes)
     {
-        assert(cache_buf != nullptr);
+        assert(bufs[0] != nullptr);
         assert(read_buf != nullptr);
 
-        if (n_bytes <= (cache_size - cur_off))
+        if (n_bytes > fsize - consumed)
         {
-            // case 1: cache contains all data
-            memcpy(read_buf, cache_buf + cur_off, n_bytes);
-            cur_off += n_bytes;
+            std::stringstream stream;
+            stream << "Reading beyond end of file" << std::endl;
+            stream << "n_bytes: " << n_bytes << " fsize: " << fsize << " current pos:" << consumed << std::endl;
+            diskann::cout << stream.str() << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
         }
-        else
+
+        while (n_bytes > 0)
         {
-            // case 2: cache contains some data
-            uint64_t cached_bytes = cache_size - cur_off;
-            if (n_bytes - cached_bytes > fsize - reader.tellg())
+            if (cur_off == cur_len)
             {
-                std::stringstream stream;
-                stream << "Reading beyond end of file" << std::endl;
-                stream << "n_bytes: " << n_bytes << " cached_bytes: " << cached_bytes << " fsize: " << fsize
-                       << " current pos:" << reader.tellg() << std::endl;
-                diskann::cout << stream.str() << std::endl;
-                throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+                // switch to the buffer being prefetched and start on the next
+                wait_for_prefetch(true);
+                cur_buf = 1 - cur_buf;
+                cur_len = next_len;
+                cur_off = 0;
+                start_prefetch();
             }
-            memcpy(read_buf, cache_buf + cur_off, cached_bytes);
+            uint64_t to_copy = (std::min)(n_bytes, cur_len - cur_off);
+            memcpy(read_buf, bufs[cur_buf] + cur_off, to_copy);
+            read_buf += to_copy;
+            n_bytes -= to_copy;
+            cur_off += to_copy;
+            consumed += to_copy;
+        }
+    }
+
+  private:
+    static uint64_t round_up_to_direct(uint64_t n)
+    {
+        return ((n + CACHED_IO_DIRECT_ALIGNMENT - 1) / CACHED_IO_DIRECT_ALIGNMENT) * CACHED_IO_DIRECT_ALIGNMENT;
+    }
 
-            // go to disk and fetch more data
-            reader.read(read_buf + cached_bytes, n_bytes - cached_bytes);
-            // reset cur off
-            cur_off = cache_size;
+    void allocate_buffers()
+    {
+        free_buffers();
+        for (int i = 0; i < 2; i++)
+        {
+#ifndef _WINDOWS
+            if (direct_fd != -1)
+            {
+                void *ptr = nullptr;
+                if (posix_memalign(&ptr, CACHED_IO_DIRECT_ALIGNMENT, buf_size) != 0)
+                    throw diskann::ANNException("Failed to allocate read buffer", -1, __FUNCSIG__, __FILE__,
+                                                __LINE__);
+                bufs[i] = (char *)ptr;
+                continue;
+            }
+#endif
+            bufs[i] = new char[buf_size];
+        }
+    }
 
-            uint64_t size_left = fsize - reader.tellg();
+    void free_buffers()
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            if (bufs[i] == nullptr)
+                continue;
+#ifndef _WINDOWS
+            if (direct_fd != -1)
+                free(bufs[i]);
+            else
+#endif
+                delete[] bufs[i];
+            bufs[i] = nullptr;
+        }
+    }
 
-            if (size_left >= cache_size)
+    // reads the next buf_size bytes of the file (less at the end) into buf
+    uint64_t fill(char *buf)
+    {
+        uint64_t len = (std::min)(buf_size, fsize - file_off);
+        if (len == 0)
+            return 0;
+#ifndef _WINDOWS
+        if (direct_fd != -1)
+        {
+            // O_DIRECT needs an aligned length, the read stops at end of file
+            uint64_t done = 0;
+            while (done < len)
             {
-                reader.read(cache_buf, cache_size);
-                cur_off = 0;
+                ssize_t ret = pread(direct_fd, buf + done, round_up_to_direct(len - done), file_off + done);
+                if (ret <= 0)
+                {
+                    std::stringstream stream;
+                    stream << "O_DIRECT read failed at offset " << file_off + done << ", errno: " << errno;
+                    throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+                }
+                done += (uint64_t)ret;
             }
-            // note that if size_left < cache_size, then cur_off = cache_size,
-            // so subsequent reads will all be directly from file
+            file_off += len;
+            return len;
+        }
+#endif
+        reader.read(buf, len);
+        file_off += len;
+        return len;
+    }
+
+    void start_prefetch()
+    {
+        if (file_off == fsize)
+        {
+            next_len = 0;
+            return;
+        }
+        char *buf = bufs[1 - cur_buf];
+        prefetch = std::async(std::launch::async, [this, buf]() { next_len = fill(buf); });
+    }
+
+    // waits for the background read, rethrowing its error if rethrow is set
+    void wait_for_prefetch(bool rethrow)
+    {
+        if (!prefetch.valid())
+            return;
+        try
+        {
+            prefetch.get();
+        }
+        catch (...)
+        {
+            if (rethrow)
+                throw;
         }
     }
 
-  private:
     // underlying ifstream
     std::ifstream reader;
-    // # bytes to cache in one shot read
+    // O_DIRECT file descriptor, -1 if the ifstream is used
+    int direct_fd = -1;
+    // # bytes to cache, split into two buffers of buf_size
     uint64_t cache_size = 0;
-    // underlying buf for cache
-    char *cache_buf = nullptr;
-    // offset into cache_buf for cur_pos
+    uint64_t buf_size = 0;
+    // buffer being consumed and buffer being prefetched
+    char *bufs[2] = {nullptr, nullptr};
+    int cur_buf = 0;
+    // offset into and valid bytes of the current buffer
     uint64_t cur_off = 0;
+    uint64_t cur_len = 0;
+    // valid bytes of the prefetched buffer, set by the background read
+    uint64_t next_len = 0;
+    std::future<void> prefetch;
+    // file offset of the next read from disk
+    uint64_t file_off = 0;
+    // bytes returned to the caller so far
+    uint64_t consumed = 0;
     // file size
     uint64_t fsize = 0;
 };
 
 // sequential cached writes
+//
+// Write-behind counterpart of cached_ifstream: once a buffer is full it is
+// written on a background thread while the caller fills the other buffer.
+// flush_cache(), reset() and close() wait until everything is on disk.
 class cached_ofstream
 {
   public:
@@ -125,7 +291,9 @@ class cached_ofstream
             writer.open(filename, std::ios::binary);
             assert(writer.is_open());
             assert(cache_size > 0);
-            cache_buf = new char[cache_size];
+            buf_size = (std::max)(cache_size / 2, (uint64_t)1);
+            bufs[0] = new char[buf_size];
+            bufs[1] = new char[buf_size];
             diskann::cout << "Opened: " << filename.c_str() << ", cache_size: " << cache_size << std::endl;
         }
         catch (std::system_error &e)
@@ -142,15 +310,12 @@ class cached_ofstream
     void close()
     {
         // dump any remaining data in memory
-        if (cur_off > 0)
+        if (bufs[0] != nullptr)
         {
             this->flush_cache();
-        }
-
-        if (cache_buf != nullptr)
-        {
-            delete[] cache_buf;
-            cache_buf = nullptr;
+            delete[] bufs[0];
+            delete[] bufs[1];
+            bufs[0] = bufs[1] = nullptr;
         }
 
         if (writer.is_open())
@@ -165,35 +330,25 @@ class cached_ofstream
     // writes n_bytes from write_buf to the underlying ofstream/cache
     void write(char *write_buf, uint64_t n_bytes)
     {
-        assert(cache_buf != nullptr);
-        if (n_bytes <= (cache_size - cur_off))
+        assert(bufs[0] != nullptr);
+        while (n_bytes > 0)
         {
-            // case 1: cache can take all data
-            memcpy(cache_buf + cur_off, write_buf, n_bytes);
-            cur_off += n_bytes;
-        }
-        else
-        {
-            // case 2: cache cant take all data
-            // go to disk and write existing cache data
-            writer.write(cache_buf, cur_off);
-            fsize += cur_off;
-            // write the new data to disk
-            writer.write(write_buf, n_bytes);
-            fsize += n_bytes;
-            // memset all cache data and reset cur_off
-            memset(cache_buf, 0, cache_size);
-            cur_off = 0;
+            uint64_t to_copy = (std::min)(n_bytes, buf_size - cur_off);
+            memcpy(bufs[cur_buf] + cur_off, write_buf, to_copy);
+            write_buf += to_copy;
+            n_bytes -= to_copy;
+            cur_off += to_copy;
+            if (cur_off == buf_size)
+                write_behind();
         }
     }
 
     void flush_cache()
     {
-        assert(cache_buf != nullptr);
-        writer.write(cache_buf, cur_off);
-        fsize += cur_off;
-        memset(cache_buf, 0, cache_size);
-        cur_off = 0;
+        assert(bufs[0] != nullptr);
+        if (cur_off > 0)
+            write_behind();
+        wait_for_write();
     }
 
     void reset()
@@ -203,14 +358,35 @@ class cached_ofstream
     }
 
   private:
+    // hands the current buffer to a background write and switches buffers
+    void write_behind()
+    {
+        wait_for_write();
+        char *buf = bufs[cur_buf];
+        uint64_t len = cur_off;
+        pending_write = std::async(std::launch::async, [this, buf, len]() { writer.write(buf, len); });
+        fsize += len;
+        cur_buf = 1 - cur_buf;
+        cur_off = 0;
+    }
+
+    void wait_for_write()
+    {
+        if (pending_write.valid())
+            pending_write.get();
+    }
+
     // underlying ofstream
     std::ofstream writer;
-    // # bytes to cache for one shot write
+    // # bytes to cache, split into two buffers of buf_size
     uint64_t cache_size = 0;
-    // underlying buf for cache
-    char *cache_buf = nullptr;
-    // offset into cache_buf for cur_pos
+    uint64_t buf_size = 0;
+    // buffer being filled and buffer being written
+    char *bufs[2] = {nullptr, nullptr};
+    int cur_buf = 0;
+    // offset into the current buffer
     uint64_t cur_off = 0;
+    std::future<void> pending_write;
 
     // file size
     uint64_t fsize = 0;
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace diskann
+{
+
+// Compressed adjacency format of the graph-only disk index written by
+// graph_partition/index_relayout in mode 3 and read in partition mode.
+//
+//   sector 0:      disk index metadata as in the uncompressed graph file, and
+//                  at byte COMPRESSED_GRAPH_HEADER_OFFSET: uint64 magic,
+//                  uint32 version
+//   sector s > 0:  uint16 num_nodes, uint16 offsets[num_nodes + 1], records
+//
+// Sector s holds the nodes of partition s - 1 in partition order, node j being
+// the record in bytes [offsets[j], offsets[j + 1]) of the sector. A record is
+// the neighbor count followed by the neighbor ids sorted ascending, the first
+// id as is and every further id as the gap to the previous one, all LEB128
+// varints (7 bits per byte, high bit set on all but the last byte).
+const uint64_t COMPRESSED_GRAPH_MAGIC = 0x3148504152474344ULL; // "DCGRAPH1"
+const uint32_t COMPRESSED_GRAPH_VERSION = 1;
+const size_t COMPRESSED_GRAPH_HEADER_OFFSET = 1024;
+
+// True if sector 0 of a graph file carries the compressed format header.
+inline bool is_compressed_graph_header(const char *sector0)
+{
+    uint64_t magic;
+    uint32_t version;
+    std::memcpy(&magic, sector0 + COMPRESSED_GRAPH_HEADER_OFFSET, sizeof(magic));
+    std::memcpy(&version, sector0 + COMPRESSED_GRAPH_HEADER_OFFSET + sizeof(magic), sizeof(version));
+    return magic == COMPRESSED_GRAPH_MAGIC && version == COMPRESSED_GRAPH_VERSION;
+}
+
+inline void write_compressed_graph_header(char *sector0)
+{
+    std::memcpy(sector0 + COMPRESSED_GRAPH_HEADER_OFFSET, &COMPRESSED_GRAPH_MAGIC, sizeof(uint64_t));
+    std::memcpy(sector0 + COMPRESSED_GRAPH_HEADER_OFFSET + sizeof(uint64_t), &COMPRESSED_GRAPH_VERSION,
+                sizeof(uint32_t));
+}
+
+inline void append_varint(uint32_t value, std::vector<uint8_t> &out)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// Appends the record of a node with the given neighbors to out.
+inline void encode_adjacency(const uint32_t *nbrs, uint32_t num_nbrs, std::vector<uint8_t> &out)
+{
+    std::vector<uint32_t> sorted(nbrs, nbrs + num_nbrs);
+    std::sort(sorted.begin(), sorted.end());
+    append_varint(num_nbrs, out);
+    uint32_t prev = 0;
+    for (uint32_t nbr : sorted)
+    {
+        append_varint(nbr - prev, out);
+        prev = nbr;
+    }
+}
+
+// Reads one varint at src, returns false if it runs past end or over 32 bits.
+inline bool read_varint(const uint8_t *&src, const uint8_t *end, uint32_t &value)
+{
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 35 && src < end; shift += 7)
+    {
+        uint8_t byte = *src++;
+        result |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decodes the record in [src, src + len) into nbrs, which has room for
+// max_nbrs ids. Returns false if the record is malformed.
+inline bool decode_adjacency(const uint8_t *src, size_t len, uint32_t *nbrs, uint64_t max_nbrs, uint64_t &num_nbrs)
+{
+    const uint8_t *end = src + len;
+    uint32_t count;
+    if (!read_varint(src, end, count) || count > max_nbrs)
+        return false;
+
+    uint32_t prev = 0;
+    uint32_t i = 0;
+    while (i < count)
+    {
+        // gaps of close ids take one byte each, decode 8 of them at once when
+        // none of the next 8 bytes has its continuation bit set
+        if (count - i >= 8 && end - src >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, src, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0)
+            {
+                for (uint32_t k = 0; k < 8; k++)
+                {
+                    prev += (uint32_t)(word >> (8 * k)) & 0xff;
+                    nbrs[i + k] = prev;
+                }
+                src += 8;
+                i += 8;
+                continue;
+            }
+        }
+        uint32_t gap;
+        if (!read_varint(src, end, gap))
+            return false;
+        prev += gap;
+        nbrs[i++] = prev;
+    }
+    num_nbrs = count;
+    return true;
+}
+
+// Locates record j of a compressed graph sector, returns false if there is
+// no such record.
+inline bool get_compressed_record(const char *sector, size_t sector_len, uint32_t j, const uint8_t *&record,
+                                  size_t &record_len)
+{
+    uint16_t num_nodes, begin, end;
+    std::memcpy(&num_nodes, sector, sizeof(uint16_t));
+    if (j >= num_nodes || sizeof(uint16_t) * (num_nodes + 2) > sector_len)
+        return false;
+    std::memcpy(&begin, sector + sizeof(uint16_t) * (j + 1), sizeof(uint16_t));
+    std::memcpy(&end, sector + sizeof(uint16_t) * (j + 2), sizeof(uint16_t));
+    if (begin > end || end > sector_len)
+        return false;
+    record = reinterpret_cast<const uint8_t *>(sector) + begin;
+    record_len = end - begin;
+    return true;
+}
+
+} // namespace diskann
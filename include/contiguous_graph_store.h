@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include "abstract_graph_store.h"
+
+namespace diskann
+{
+
+// Graph store that keeps all adjacency lists in one aligned slab instead of a
+// vector per node. Node i owns the row at i * row stride:
+//
+//   uint32 version, uint32 degree, location_t neighbours[slots]
+//
+// rows padded to whole cache lines. The number of slots is the reserve graph
+// degree, or the largest degree of a loaded graph if that is larger.
+//
+// Writers must hold the lock of the node as with InMemGraphStore. Readers do
+// not need it: every modification other than add_neighbour runs under a per
+// node sequence lock (version odd while writing), and add_neighbour publishes
+// the new neighbour before the degree, so get_neighbours_snapshot retries
+// until it has copied a consistent list. resize_graph, swap_neighbours and
+// clear_graph are not safe with concurrent readers.
+class ContiguousGraphStore : public AbstractGraphStore
+{
+  public:
+    ContiguousGraphStore(const size_t total_pts, const size_t reserve_graph_degree);
+    ~ContiguousGraphStore();
+
+    // returns tuple of <nodes_read, start, num_frozen_points>
+    virtual std::tuple<uint32_t, uint32_t, size_t> load(const std::string &index_path_prefix,
+                                                        const size_t num_points) override;
+    virtual int store(const std::string &index_path_prefix, const size_t num_points, const size_t num_frozen_points,
+                      const uint32_t start) override;
+
+    virtual NeighbourList get_neighbours(const location_t i) const override;
+    virtual void add_neighbour(const location_t i, location_t neighbour_id) override;
+    virtual void clear_neighbours(const location_t i) override;
+    virtual void swap_neighbours(const location_t a, location_t b) override;
+
+    virtual void set_neighbours(const location_t i, std::vector<location_t> &neighbors) override;
+
+    virtual void get_neighbours_snapshot(const location_t i, std::vector<location_t> &out) const override;
+    virtual bool lock_free_reads() const override;
+
+    virtual size_t resize_graph(const size_t new_size) override;
+    virtual void clear_graph() override;
+
+    virtual size_t get_max_range_of_graph() override;
+    virtual uint32_t get_max_observed_degree() override;
+
+    // neighbour slots per node
+    size_t get_slots_per_node() const;
+
+  protected:
+    virtual std::tuple<uint32_t, uint32_t, size_t> load_impl(const std::string &filename, size_t expected_num_points);
+
+    int save_graph(const std::string &index_path_prefix, const size_t active_points, const size_t num_frozen_points,
+                   const uint32_t start);
+
+  private:
+    // reallocates the slab for num_points rows of slots neighbours, keeping
+    // the rows and neighbours that fit
+    void reallocate(const size_t num_points, const size_t slots);
+
+    uint32_t *row(const location_t i) const
+    {
+        return _slab + (size_t)i * _row_stride;
+    }
+    std::atomic<uint32_t> &version(const location_t i) const
+    {
+        return *reinterpret_cast<std::atomic<uint32_t> *>(row(i));
+    }
+    std::atomic<uint32_t> &degree(const location_t i) const
+    {
+        return *reinterpret_cast<std::atomic<uint32_t> *>(row(i) + 1);
+    }
+    location_t *neighbours(const location_t i) const
+    {
+        return row(i) + ROW_HEADER;
+    }
+
+    void begin_write(const location_t i);
+    void end_write(const location_t i);
+    void update_max_observed_degree(const uint32_t new_degree);
+
+    static const size_t ROW_HEADER = 2;
+
+    uint32_t *_slab = nullptr;
+    size_t _slots = 0;
+    // in uint32s
+    size_t _row_stride = 0;
+
+    size_t _max_range_of_graph = 0;
+    std::atomic<uint32_t> _max_observed_degree{0};
+};
+
+} // namespace diskann
@@ -23,6 +23,12 @@ const float GRAPH_SLACK_FACTOR = 1.3f;
 const uint64_t MAX_GRAPH_DEGREE = 512;
 const uint64_t SECTOR_LEN = 4096;
 const uint64_t MAX_N_SECTOR_READS = 128;
+// filtered disk searches matching at most this fraction of the points scan
+// them instead of the graph
+const float PREFILTER_SELECTIVITY = 0.01f;
+// start points a search of the navigation graph of a disk index seeds the
+// candidate list with
+const uint32_t NUM_NAV_GRAPH_START_POINTS = 8;
 
 // following constants should always be specified, but are useful as a
 // sensible default at cli / python boundaries
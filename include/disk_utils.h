@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <random>
@@ -27,6 +28,7 @@ typedef int FileHandle;
 
 #include "cached_io.h"
 #include "common_includes.h"
+#include "defaults.h"
 
 #include "utils.h"
 #include "windows_customizations.h"
@@ -65,7 +67,19 @@ DISKANN_DLLEXPORT int merge_shards(const std::string &vamana_prefix, const std::
                                    const std::string &idmaps_prefix, const std::string &idmaps_suffix,
                                    const uint64_t nshards, uint32_t max_degree, const std::string &output_vamana,
                                    const std::string &medoids_file, bool use_filters = false,
-                                   const std::string &labels_to_medoids_file = std::string(""));
+                                   const std::string &labels_to_medoids_file = std::string(""),
+                                   const std::string &pq_pivots_file = std::string(""),
+                                   const std::string &pq_compressed_file = std::string(""),
+                                   float prune_alpha = defaults::ALPHA);
+
+// RobustPrune of the candidate neighbors nhood of node_id on symmetric PQ
+// distances, keeping at most max_degree of them. pq_codes holds pq_nchunks
+// bytes per point and sdc_tables the tables filled by
+// FixedChunkPQTable::populate_symmetric_chunk_distances.
+DISKANN_DLLEXPORT void prune_neighbors_with_pq_codes(const uint32_t node_id, std::vector<uint32_t> &nhood,
+                                                    const uint8_t *pq_codes, const size_t pq_nchunks,
+                                                    const float *sdc_tables, const uint32_t max_degree,
+                                                    const float alpha);
 
 DISKANN_DLLEXPORT void extract_shard_labels(const std::string &in_label_file, const std::string &shard_ids_bin,
                                             const std::string &shard_label_file);
@@ -74,6 +88,18 @@ template <typename T>
 DISKANN_DLLEXPORT std::string preprocess_base_file(const std::string &infile, const std::string &indexPrefix,
                                                    diskann::Metric &distMetric);
 
+// Builds the shards of a merged index, shard_ram[p] being the estimated
+// memory of shard p. prepare_shard(p) extracts the data of shard p in the
+// background while earlier shards build, and build_shard(p, threads) builds
+// and saves it. Consecutive shards are built concurrently as long as their
+// memory fits in the budget, sharing the threads not held by running shards.
+// A shard keeps its memory and threads until it is saved; a shard over the
+// budget is built alone.
+DISKANN_DLLEXPORT void build_shards_in_groups(const std::vector<double> &shard_ram, const double ram_budget_bytes,
+                                              const uint32_t total_threads,
+                                              const std::function<void(int)> &prepare_shard,
+                                              const std::function<void(int, uint32_t)> &build_shard);
+
 template <typename T, typename LabelT = uint32_t>
 DISKANN_DLLEXPORT int build_merged_vamana_index(std::string base_file, diskann::Metric _compareMetric, uint32_t L,
                                                 uint32_t R, double sampling_rate, double ram_budget,
@@ -82,7 +108,9 @@ DISKANN_DLLEXPORT int build_merged_vamana_index(std::string base_file, diskann::
                                                 uint32_t num_threads, bool use_filters = false,
                                                 const std::string &label_file = std::string(""),
                                                 const std::string &labels_to_medoids_file = std::string(""),
-                                                const std::string &universal_label = "", const uint32_t Lf = 0);
+                                                const std::string &universal_label = "", const uint32_t Lf = 0,
+                                                const std::string &pq_pivots_path = std::string(""),
+                                                const std::string &pq_compressed_vectors_path = std::string(""));
 
 template <typename T, typename LabelT>
 DISKANN_DLLEXPORT uint32_t optimize_beamwidth(std::unique_ptr<diskann::PQFlashIndex<T, LabelT>> &_pFlashIndex,
@@ -90,6 +118,16 @@ DISKANN_DLLEXPORT uint32_t optimize_beamwidth(std::unique_ptr<diskann::PQFlashIn
                                               uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads,
                                               uint32_t start_bw = 2);
 
+// Builds the navigation graph of a disk index: an in-memory Vamana graph over
+// about num_points points sampled from base_file, saved as
+// <disk_index_path>_nav_graph with the ids of its points in
+// <disk_index_path>_nav_graph_ids.bin. PQFlashIndex loads it to find the
+// start points of unfiltered searches.
+template <typename T>
+DISKANN_DLLEXPORT int build_navigation_graph(const std::string &base_file, const std::string &disk_index_path,
+                                             const uint32_t num_points, const uint32_t R, const uint32_t L,
+                                             const uint32_t num_threads);
+
 template <typename T, typename LabelT = uint32_t>
 DISKANN_DLLEXPORT int build_disk_index(
     const char *dataFilePath, const char *indexFilePath, const char *indexBuildParameters,
@@ -98,7 +136,8 @@ DISKANN_DLLEXPORT int build_disk_index(
     bool use_filters = false,
     const std::string &label_file = std::string(""), // default is empty string for no label_file
     const std::string &universal_label = "", const uint32_t filter_threshold = 0,
-    const uint32_t Lf = 0); // default is empty string for no universal label
+    const uint32_t Lf = 0,                // default is empty string for no universal label
+    const uint32_t nav_graph_points = 0); // 0 builds no navigation graph
 
 template <typename T>
 DISKANN_DLLEXPORT void create_disk_layout(const std::string base_file, const std::string mem_index_file,
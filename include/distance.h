@@ -191,6 +191,8 @@ template <typename T> class DistanceFastL2 : public DistanceInnerProduct<T>
     }
     float norm(const T *a, unsigned size) const;
     float compare(const T *a, const T *b, float norm, unsigned size) const;
+    // squared L2 distance, for callers that do not keep the norms
+    float compare(const T *a, const T *b, unsigned size) const;
 };
 
 class AVXDistanceInnerProductFloat : public Distance<float>
@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Gathers the embedding requests of concurrent search threads into larger
+// batches for the embedding server.
+//
+// The first thread to request embeddings opens a batch and becomes its
+// leader. Threads arriving within window_us add their node ids to the same
+// batch, ids requested by several threads are fetched once. The leader then
+// fetches the batch, or fetches earlier if the batch reaches max_batch_size
+// ids, and all threads of the batch copy their embeddings out of it. Requests
+// arriving while a batch is being fetched open the next batch.
+class EmbeddingCoalescer
+{
+  public:
+    // Same contract as EmbeddingProvider::get_embeddings.
+    typedef std::function<bool(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim)>
+        FetchFunction;
+
+    DISKANN_DLLEXPORT EmbeddingCoalescer(FetchFunction fetch, uint32_t window_us, uint32_t max_batch_size);
+
+    // Writes dim floats per id to out_embeddings. Thread-safe. Returns false
+    // if the batch containing the request failed. An exception thrown by the
+    // fetch function reaches the leader of the batch, its other threads get
+    // false.
+    DISKANN_DLLEXPORT bool fetch(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                                 uint32_t &dim);
+
+    // requests, batches sent to the server and the ids in them
+    uint64_t get_num_requests() const
+    {
+        return _num_requests.load();
+    }
+    uint64_t get_num_batches() const
+    {
+        return _num_batches.load();
+    }
+    uint64_t get_num_fetched_ids() const
+    {
+        return _num_fetched_ids.load();
+    }
+
+  private:
+    struct Batch;
+
+    FetchFunction _fetch;
+    uint32_t _window_us;
+    uint32_t _max_batch_size;
+
+    std::mutex _mutex;
+    // batch accepting requests, nullptr if none
+    std::shared_ptr<Batch> _open_batch;
+
+    std::atomic<uint64_t> _num_requests{0};
+    std::atomic<uint64_t> _num_batches{0};
+    std::atomic<uint64_t> _num_fetched_ids{0};
+};
+
+} // namespace diskann
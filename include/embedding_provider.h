@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Source of the full precision embeddings that recompute search uses in place
+// of the vectors stored on disk.
+class EmbeddingProvider
+{
+  public:
+    virtual ~EmbeddingProvider() = default;
+
+    // Writes the embeddings of node_ids to embeddings, one row of dim floats
+    // per id, in order. Called concurrently from search threads. Returns false
+    // if the embeddings could not be computed.
+    virtual bool get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                uint32_t &dim) = 0;
+};
+
+// Embedding server in another process: shm://<name> for the shared memory
+// channel of a server on this host (see embedding_shm_channel.h), any other
+// endpoint (tcp://host:port, ipc://path) is a ZMQ server speaking the
+// NodeEmbeddingRequest/NodeEmbeddingResponse protocol.
+class RemoteEmbeddingProvider : public EmbeddingProvider
+{
+  public:
+    DISKANN_DLLEXPORT RemoteEmbeddingProvider(const std::string &endpoint);
+    DISKANN_DLLEXPORT bool get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                          uint32_t &dim) override;
+
+  private:
+    std::string _endpoint;
+};
+
+// Embeddings computed in process, without IPC.
+class CallbackEmbeddingProvider : public EmbeddingProvider
+{
+  public:
+    // Writes num_ids * dim floats to embeddings, returns false on failure.
+    // Must be thread-safe.
+    typedef std::function<bool(const uint32_t *node_ids, size_t num_ids, float *embeddings)> Callback;
+
+    DISKANN_DLLEXPORT CallbackEmbeddingProvider(uint32_t dim, Callback callback);
+    DISKANN_DLLEXPORT bool get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                          uint32_t &dim) override;
+
+  private:
+    uint32_t _dim;
+    Callback _callback;
+};
+
+// Embeddings precomputed in a float .bin file, row i being the embedding of
+// node i. Loaded into memory; makes recompute runs reproducible without a
+// server.
+class BinFileEmbeddingProvider : public EmbeddingProvider
+{
+  public:
+    DISKANN_DLLEXPORT BinFileEmbeddingProvider(const std::string &bin_file);
+    DISKANN_DLLEXPORT bool get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                          uint32_t &dim) override;
+
+  private:
+    std::unique_ptr<float[]> _data;
+    size_t _num_points = 0;
+    size_t _dim = 0;
+};
+
+// Fetches embeddings from the server at endpoint as RemoteEmbeddingProvider
+// does. An empty endpoint is tcp://127.0.0.1:<zmq_port>.
+DISKANN_DLLEXPORT bool fetch_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                        uint32_t &dim, const std::string &endpoint, int zmq_port);
+
+} // namespace diskann
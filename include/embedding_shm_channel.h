@@ -0,0 +1,134 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Same-host transport for the embedding recompute channel. Instead of sending
+// protobuf messages over loopback TCP, the searcher writes node ids into a
+// POSIX shared memory segment created by the embedding server and reads the
+// float embeddings the server writes back into the same segment.
+//
+// The segment is a ring of num_slots request slots shared by all searcher
+// threads of a process (and by several processes). It starts with a 128 byte
+// header, followed by the slots, each slot_size bytes:
+//
+//   header: uint64 magic, uint32 version, uint32 dim, uint32 max_batch,
+//           uint32 num_slots, uint64 slot_size, at byte 64: uint64 head
+//   slot:   uint64 sequence, uint32 num_ids, int32 status,
+//           at byte 64: uint32 ids[max_batch],
+//           at byte 64 + round_up(4 * max_batch, 64): float embeddings[max_batch * dim]
+//
+// head is the next ticket handed to a client. The request with ticket t uses
+// slot t % num_slots, whose sequence moves through
+//   t              slot is free for ticket t,
+//   t + 1          the client claimed the slot and is writing the ids,
+//   t + 2          ids are written, the server may process them,
+//   t + 3          embeddings (status 0) or an error (status != 0) are written,
+//   t + num_slots  the client has read the response, free for the next round.
+// Every step is a compare and swap from the expected value, so a side that
+// gave up cannot overwrite the slot once the other side has moved on. A
+// client that times out waiting for the response releases the slot itself
+// (t + 2 to t + num_slots) and the server skips its ticket. The server skips
+// a taken ticket whose slot stays free or claimed for longer than the
+// abandon timeout, and frees a slot whose response is not read within it, so
+// a client that crashed does not stall the ring. Requests are served in
+// ticket order, larger batches are split into requests of at most max_batch
+// ids. All fields are little endian and the counters are updated with atomic
+// 64 bit operations, so a server written in another language only needs to
+// follow the sequence protocol above.
+//
+// Not supported on Windows.
+class EmbeddingShmServer
+{
+  public:
+    // Writes the embeddings of ids[0..num_ids) to embeddings (num_ids * dim
+    // floats), returns false on failure.
+    typedef std::function<bool(const uint32_t *ids, uint32_t num_ids, float *embeddings)> Handler;
+
+    // Creates the segment, replacing a stale segment of the same name.
+    // num_slots must be at least 4. A slot left by a client for
+    // abandon_timeout_us is recycled.
+    DISKANN_DLLEXPORT EmbeddingShmServer(const std::string &name, uint32_t dim, uint32_t max_batch = 1024,
+                                         uint32_t num_slots = 64, uint64_t abandon_timeout_us = 1000000);
+    // Unmaps and removes the segment.
+    DISKANN_DLLEXPORT ~EmbeddingShmServer();
+    EmbeddingShmServer(const EmbeddingShmServer &) = delete;
+    EmbeddingShmServer &operator=(const EmbeddingShmServer &) = delete;
+
+    // Serves the next request, waiting up to timeout_us for it. Returns false
+    // if no request was served, because none arrived or its client abandoned
+    // it. Requests must be served from one thread.
+    DISKANN_DLLEXPORT bool serve_one(const Handler &handler, uint64_t timeout_us);
+
+    // Serves requests until stop is set.
+    DISKANN_DLLEXPORT void serve(const Handler &handler, const std::atomic<bool> &stop);
+
+  private:
+    // Recycles the slot of _next_ticket if its client left it at sequence
+    // for longer than the abandon timeout. Returns true if the ticket was
+    // skipped.
+    bool recover_stalled_slot(uint64_t sequence);
+
+    std::string _name;
+    char *_base = nullptr;
+    size_t _size = 0;
+    uint64_t _next_ticket = 0;
+    uint64_t _abandon_timeout_us = 0;
+    std::vector<uint32_t> _request_ids;
+    // the slot sequence the server has been waiting on since _stalled_since
+    uint64_t _stalled_sequence = UINT64_MAX;
+    std::chrono::steady_clock::time_point _stalled_since;
+};
+
+class EmbeddingShmClient
+{
+  public:
+    // Attaches to the segment created by the server, throws if there is none.
+    DISKANN_DLLEXPORT EmbeddingShmClient(const std::string &name);
+    DISKANN_DLLEXPORT ~EmbeddingShmClient();
+    EmbeddingShmClient(const EmbeddingShmClient &) = delete;
+    EmbeddingShmClient &operator=(const EmbeddingShmClient &) = delete;
+
+    // Writes get_dim() floats per id to out_embeddings. Thread-safe. Returns
+    // false if the server reported an error, skipped the request or did not
+    // answer within timeout_us; after a timeout the client is broken.
+    DISKANN_DLLEXPORT bool fetch(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                                 uint64_t timeout_us);
+
+    bool is_broken() const
+    {
+        return _broken.load();
+    }
+    uint32_t get_dim() const
+    {
+        return _dim;
+    }
+
+  private:
+    char *_base = nullptr;
+    size_t _size = 0;
+    uint32_t _dim = 0;
+    uint32_t _max_batch = 0;
+    uint32_t _num_slots = 0;
+    uint64_t _slot_size = 0;
+    std::atomic<bool> _broken{false};
+};
+
+// Fetches embeddings over the channel called name, attaching to it on first
+// use. A broken client is replaced on the next call, so a restarted server is
+// picked up.
+DISKANN_DLLEXPORT bool fetch_embeddings_shm(const std::string &name, const std::vector<uint32_t> &node_ids,
+                                            std::vector<float> &out_embeddings, uint32_t &dim);
+
+} // namespace diskann
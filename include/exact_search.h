@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "distance.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Brute-force search used to compute ground truth. The base file is streamed
+// in blocks of block_size points (two blocks are resident, one being searched
+// and one being read). Within a block, distances are computed for tiles of
+// queries x base points so that the tile and the vectors it is computed from
+// stay in cache, and the top-k selection is run on the tile right after it is
+// produced.
+
+// squared L2 norms of num_points row-major vectors of dimension dim
+DISKANN_DLLEXPORT void compute_l2sq(float *const points_l2sq, const float *const matrix, const int64_t num_points,
+                                    const uint64_t dim);
+
+// normalizes the points in place and recomputes their norms; cosine distance
+// is computed as the L2 distance between normalized vectors
+DISKANN_DLLEXPORT void normalize_points(float *const points, float *const points_l2sq, const int64_t num_points,
+                                        const uint64_t dim);
+
+// Exact search of nqueries queries over the whole base file. queries_l2sq
+// holds the squared norms of the queries, which are expected normalized for
+// COSINE. For every query either the k nearest points (knn_ids/knn_dists,
+// sorted, knn_sizes entries) or all points closer than radius (range_results,
+// unsorted) are returned; range search is used if range_results is not null.
+// Distances are squared L2 for L2 and COSINE and the negated inner product for
+// INNER_PRODUCT. Points whose bit is not set in eligible are skipped, an empty
+// eligible accepts all points.
+//
+// Work is split into query tiles. If there are fewer query tiles than
+// threads, the base tiles of every block are additionally split into
+// interleaved stripes, each with its own result lists which are merged at the
+// end, so small query sets still use all threads.
+template <typename T>
+DISKANN_DLLEXPORT void exact_search(const std::string &base_file, size_t block_size, size_t dim, size_t nqueries,
+                                    const float *queries, const float *queries_l2sq, diskann::Metric metric,
+                                    const std::vector<uint64_t> &eligible, size_t k, std::vector<uint32_t> &knn_ids,
+                                    std::vector<float> &knn_dists, std::vector<uint32_t> &knn_sizes, float radius,
+                                    std::vector<std::vector<std::pair<uint32_t, float>>> *range_results);
+
+} // namespace diskann
@@ -63,6 +63,75 @@ DISKANN_DLLEXPORT std::tuple<std::vector<std::vector<LabelT>>, tsl::robin_set<La
 
 DISKANN_DLLEXPORT parse_label_file_return_values parse_label_file(path label_data_path, std::string universal_label);
 
+/*
+ * Labels of an index as written to <prefix>_labels.bin, the binary form of
+ * <prefix>_labels.txt, _labels_to_medoids.txt, _dummy_map.txt and
+ * _universal_label.txt that is mapped at load instead of parsing the text.
+ *
+ * The file has a header of 8 uint64s:
+ *    num_points, num_point_labels, sizeof(LabelT), num_medoids, num_dummies,
+ *    use_universal_label, universal_label, 0
+ * followed by these arrays, each starting at a multiple of 8 bytes:
+ *    uint32 offsets[num_points], uint32 counts[num_points],
+ *    LabelT labels[num_point_labels], LabelT medoid_labels[num_medoids],
+ *    uint32 medoids[num_medoids], uint32 dummy_ids[num_dummies],
+ *    uint32 dummy_real_ids[num_dummies]
+ * The labels of point i are labels[offsets[i], offsets[i] + counts[i]). A
+ * label with several medoids has one medoid entry for each.
+ */
+template <typename LabelT> struct LabelLists
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> counts;
+    std::vector<LabelT> labels;
+    std::vector<std::pair<LabelT, uint32_t>> medoids;
+    // (dummy point, real point)
+    std::vector<std::pair<uint32_t, uint32_t>> dummy_map;
+    bool use_universal_label = false;
+    LabelT universal_label = 0;
+};
+
+const uint64_t BIN_LABELS_HEADER_SIZE = 8 * sizeof(uint64_t);
+
+// Reads the text label files of the index at prefix. Files other than
+// <prefix>_labels.txt are optional.
+template <typename LabelT> DISKANN_DLLEXPORT LabelLists<LabelT> read_text_label_files(const std::string &prefix);
+
+template <typename LabelT>
+DISKANN_DLLEXPORT void save_bin_labels(const std::string &bin_labels_file, const LabelLists<LabelT> &lists);
+
+// Writes <prefix>_labels.bin from the text label files of the index at
+// prefix. Returns false if the index has no labels.
+template <typename LabelT> DISKANN_DLLEXPORT bool convert_label_files_to_bin(const std::string &prefix);
+
+// sizeof(LabelT) of the labels in a <prefix>_labels.bin file
+DISKANN_DLLEXPORT size_t get_bin_labels_label_size(const std::string &bin_labels_file);
+
+// Read-only mapping of a <prefix>_labels.bin file, the arrays point into the
+// mapping.
+template <typename LabelT> class MappedBinLabels
+{
+  public:
+    DISKANN_DLLEXPORT MappedBinLabels(const std::string &bin_labels_file);
+
+    uint64_t num_points = 0;
+    uint64_t num_point_labels = 0;
+    uint64_t num_medoids = 0;
+    uint64_t num_dummies = 0;
+    const uint32_t *offsets = nullptr;
+    const uint32_t *counts = nullptr;
+    const LabelT *labels = nullptr;
+    const LabelT *medoid_labels = nullptr;
+    const uint32_t *medoids = nullptr;
+    const uint32_t *dummy_ids = nullptr;
+    const uint32_t *dummy_real_ids = nullptr;
+    bool use_universal_label = false;
+    LabelT universal_label = 0;
+
+  private:
+    std::unique_ptr<MemoryMapper> _mapper;
+};
+
 template <typename T>
 DISKANN_DLLEXPORT tsl::robin_map<std::string, std::vector<uint32_t>> generate_label_specific_vector_files_compat(
     path input_data_path, tsl::robin_map<std::string, uint32_t> labels_to_number_of_points,
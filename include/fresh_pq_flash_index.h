@@ -0,0 +1,127 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "index.h"
+#include "parameters.h"
+#include "percentile_stats.h"
+#include "pq_flash_index.h"
+#include "tsl/robin_map.h"
+#include "tsl/robin_set.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Fresh-update layer on top of a read-only PQFlashIndex, along the lines of
+// FreshDiskANN. Points are identified by uint32_t tags:
+//  - inserts go to an in-memory dynamic Index (the delta) and are searchable
+//    as soon as insert() returns,
+//  - deletes of disk points set a bit in the delete bitmap of the
+//    PQFlashIndex, deletes of delta points are lazy deletes in the delta,
+//  - search() queries the disk index and the delta and merges the results.
+//
+// merge() writes the disk index and the delta into a new disk index at a new
+// prefix by streaming the current disk layout: deleted points are dropped and
+// the neighborhoods pointing at them are patched with the neighbors of the
+// deleted points, delta points are linked to the disk graph and their reverse
+// edges are patched into the existing neighborhoods. All pruning uses the
+// in-memory PQ codes, so the merge needs no random disk reads. While a merge
+// runs, inserts go to a new delta and the old one stays searchable; the new
+// disk index is swapped in when it is ready.
+//
+// The location -> tag map of a disk index is stored in
+// <prefix>_disk.index_tags.bin; without it tags are the disk locations.
+// Only L2 disk indices whose nodes store full precision coordinates are
+// supported (no disk PQ, reorder data or partitioned graph).
+template <typename T, typename LabelT = uint32_t> class FreshPQFlashIndex
+{
+  public:
+    // Loads the disk index at index_prefix. The delta is built with
+    // delta_params and holds initial_delta_capacity points, inserts fail once
+    // it is full until the next merge starts a new one.
+    DISKANN_DLLEXPORT FreshPQFlashIndex(diskann::Metric metric, const std::string &index_prefix, uint32_t num_threads,
+                                        const IndexWriteParameters &delta_params,
+                                        size_t initial_delta_capacity = 100000, int zmq_port = 5555);
+    DISKANN_DLLEXPORT ~FreshPQFlashIndex();
+
+    // Returns -1 if the point could not be inserted, also if tag is already
+    // present and not deleted.
+    DISKANN_DLLEXPORT int insert(const T *point, const uint32_t tag);
+
+    // Returns -1 if tag is not present.
+    DISKANN_DLLEXPORT int lazy_delete(const uint32_t tag);
+
+    // Writes up to k_search tags and distances, returns the number written.
+    DISKANN_DLLEXPORT size_t search(const T *query, const uint64_t k_search, const uint64_t l_search,
+                                    const uint64_t beam_width, uint32_t *tags, float *distances,
+                                    QueryStats *stats = nullptr);
+
+    // Merges the delta and the deletes into a new disk index at
+    // new_index_prefix and switches to it. Only one merge runs at a time.
+    DISKANN_DLLEXPORT void merge(const std::string &new_index_prefix);
+
+    // Runs merge() on a background thread.
+    DISKANN_DLLEXPORT std::future<void> merge_async(const std::string &new_index_prefix);
+
+    DISKANN_DLLEXPORT size_t get_num_disk_points();
+    DISKANN_DLLEXPORT size_t get_num_delta_points();
+
+  private:
+    // PQFlashIndex keeps references to its readers, so they live with it
+    struct DiskIndex
+    {
+        std::shared_ptr<AlignedFileReader> reader;
+        std::shared_ptr<AlignedFileReader> graph_reader;
+        std::unique_ptr<PQFlashIndex<T, LabelT>> index;
+    };
+
+    std::unique_ptr<DiskIndex> load_disk_index(const std::string &index_prefix);
+    std::unique_ptr<Index<T, uint32_t, uint32_t>> create_delta();
+    void load_disk_tags(const std::string &index_prefix, size_t num_points);
+
+    // encodes vectors with the PQ pivots of the disk index
+    void compress_vectors(const T *vectors, size_t num_points, uint8_t *codes);
+
+    // neighbors of every point of the merging delta, in merged ids
+    void link_delta_points(const std::vector<uint32_t> &delta_tags, const T *delta_vectors,
+                           const std::vector<uint32_t> &new_location, const std::vector<bool> &deleted,
+                           const tsl::robin_map<uint32_t, uint32_t> &delta_tag_to_new_id, const uint8_t *codes,
+                           const float *sdc_tables, std::vector<std::vector<uint32_t>> &delta_nhoods);
+
+    diskann::Metric _metric;
+    uint32_t _num_threads;
+    int _zmq_port;
+    IndexWriteParameters _delta_params;
+    size_t _initial_delta_capacity;
+    std::string _index_prefix;
+
+    std::unique_ptr<DiskIndex> _disk;
+    std::vector<uint32_t> _disk_tags;
+    tsl::robin_map<uint32_t, uint32_t> _tag_to_disk_location;
+    std::vector<T> _start_point;
+
+    std::unique_ptr<Index<T, uint32_t, uint32_t>> _delta;
+    // delta being merged, read-only except for deletes
+    std::unique_ptr<Index<T, uint32_t, uint32_t>> _merging_delta;
+
+    // searches, inserts and deletes hold it shared, swapping in a new disk
+    // index or delta holds it exclusively
+    std::shared_timed_mutex _lock;
+    std::mutex _merge_mutex;
+
+    // deletes received during a merge, applied to the merged index, and the
+    // tags of the merging delta that are not deleted
+    std::mutex _pending_deletes_mutex;
+    std::vector<uint32_t> _pending_deletes;
+    tsl::robin_set<uint32_t> _merging_delta_tags;
+};
+
+} // namespace diskann
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Relabels the points of an index so that graph neighbors get nearby ids.
+// Nearby ids share disk sectors and rows of the PQ code table, so a search
+// touches fewer sectors and cache lines.
+//
+// An order is a permutation new_to_old: the point with id i in the reordered
+// index is point new_to_old[i] of the original index. The reordered index is
+// written with an id map file <output>_id_map.bin (uint32 bin, npts x 1)
+// holding new_to_old. A disk index loaded with the map present returns search
+// results, and takes lazy deletes, in the original ids, and fetches
+// recompute embeddings by original id.
+
+// Cuthill-McKee order: breadth first from start, the neighbors of a node in
+// increasing degree order, components not reachable from start in id order.
+// reverse gives reverse Cuthill-McKee.
+DISKANN_DLLEXPORT std::vector<uint32_t> compute_bfs_order(const std::vector<std::vector<uint32_t>> &graph,
+                                                          uint32_t start, bool reverse);
+
+// Order of the partitions written by graph_partition: the nodes of partition
+// 0, then those of partition 1, and so on.
+DISKANN_DLLEXPORT std::vector<uint32_t> load_partition_order(const std::string &partition_file, size_t num_points);
+
+// Reads the adjacency lists and the medoid of a disk index.
+template <typename T>
+DISKANN_DLLEXPORT void load_disk_index_graph(const std::string &disk_index_file,
+                                             std::vector<std::vector<uint32_t>> &graph, uint32_t &medoid);
+
+// Rewrites the disk index <index_prefix>_disk.index, its PQ codes, medoids,
+// labels and tags under output_prefix in the given order. Indexes with
+// appended reorder data are not supported.
+template <typename T>
+DISKANN_DLLEXPORT void reorder_disk_index(const std::string &index_prefix, const std::string &output_prefix,
+                                          const std::vector<uint32_t> &new_to_old);
+
+// Rewrites the graph partition files <partition_prefix>_partition.bin and
+// <partition_prefix>_disk_graph.index that graph_partition wrote for the
+// original index under output_prefix in the given order. Nodes stay in their
+// partitions and sectors, only their ids and neighbor ids change. Throws if a
+// compressed partition no longer fits in its sector.
+DISKANN_DLLEXPORT void reorder_partition_files(const std::string &partition_prefix, const std::string &output_prefix,
+                                               const std::vector<uint32_t> &new_to_old);
+
+// Reads the adjacency lists and the start point of an in-memory index.
+DISKANN_DLLEXPORT void load_memory_index_graph(const std::string &index_file,
+                                               std::vector<std::vector<uint32_t>> &graph, uint32_t &start);
+
+// Rewrites the in-memory index index_file, its data, tags and labels to
+// output_file in the given order. Indexes with frozen points are not
+// supported.
+template <typename T>
+DISKANN_DLLEXPORT void reorder_memory_index(const std::string &index_file, const std::string &output_file,
+                                            const std::vector<uint32_t> &new_to_old);
+
+} // namespace diskann
@@ -19,7 +19,7 @@ class InMemGraphStore : public AbstractGraphStore
     virtual int store(const std::string &index_path_prefix, const size_t num_points, const size_t num_frozen_points,
                       const uint32_t start) override;
 
-    virtual const std::vector<location_t> &get_neighbours(const location_t i) const override;
+    virtual NeighbourList get_neighbours(const location_t i) const override;
     virtual void add_neighbour(const location_t i, location_t neighbour_id) override;
     virtual void clear_neighbours(const location_t i) override;
     virtual void swap_neighbours(const location_t a, location_t b) override;
@@ -4,6 +4,10 @@
 #pragma once
 
 #include "common_includes.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #ifdef EXEC_ENV_OLS
 #include "aligned_file_reader.h"
@@ -21,6 +25,7 @@
 #include "in_mem_data_store.h"
 #include "in_mem_graph_store.h"
 #include "abstract_index.h"
+#include "memory_mapper.h"
 
 #include "quantized_distance.h"
 #include "pq_data_store.h"
@@ -122,10 +127,13 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // to have higher consistency between index builds.
     DISKANN_DLLEXPORT void set_start_points_at_random(T radius, uint32_t random_seed = 0);
 
-    // For FastL2 search on a static index, we interleave the data with graph
+    // Packs a static index into one buffer holding each vector next to its
+    // neighbours. search(), search_with_filters() and search_with_tags() then
+    // run on the packed layout, and save() writes it to <prefix>.packed, which
+    // load() maps instead of reading the graph and data files.
     DISKANN_DLLEXPORT void optimize_index_layout() override;
 
-    // For FastL2 search on optimized layout
+    // Same as search() without distances, kept for existing callers.
     DISKANN_DLLEXPORT void search_with_optimized_layout(const T *query, size_t K, size_t L, uint32_t *indices);
 
     // Added search overload that takes L as parameter, so that we
@@ -168,6 +176,20 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // alongside inserts and lazy deletes, else it acquires _update_lock
     DISKANN_DLLEXPORT consolidation_report consolidate_deletes(const IndexWriteParameters &parameters) override;
 
+    // Runs consolidate_deletes on a background thread whenever at least
+    // min_deletes points are lazily deleted, checking every check_interval_ms.
+    // A round repairs at most max_nodes_per_sec nodes per second (0 means
+    // unthrottled). Requires concurrent_consolidate so that searches, inserts
+    // and lazy deletes can continue meanwhile. A round that throws stops the
+    // thread, its deleted points stay in the delete set.
+    DISKANN_DLLEXPORT void start_background_consolidation(const IndexWriteParameters &parameters,
+                                                          size_t min_deletes, uint32_t check_interval_ms = 1000,
+                                                          size_t max_nodes_per_sec = 0) override;
+
+    // Stops the background thread, waiting for a running round to finish
+    // without throttling.
+    DISKANN_DLLEXPORT void stop_background_consolidation() override;
+
     DISKANN_DLLEXPORT void prune_all_neighbors(const uint32_t max_degree, const uint32_t max_occlusion,
                                                const float alpha);
 
@@ -190,6 +212,10 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
 
     DISKANN_DLLEXPORT void count_nodes_at_bfs_levels();
 
+    // Number of edges of the points in the index to empty slots, which
+    // consolidation should never leave behind.
+    DISKANN_DLLEXPORT size_t count_dangling_edges();
+
     // This variable MUST be updated if the number of entries in the metadata
     // change.
     DISKANN_DLLEXPORT static const int METADATA_ROWS = 5;
@@ -253,6 +279,10 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
 
     void parse_label_file(const std::string &label_file, size_t &num_pts_labels);
 
+    // reads <index>_labels.bin, which replaces the text label, medoid and
+    // universal label files
+    void load_bin_labels(const std::string &bin_labels_file, size_t &num_pts_labels);
+
     std::unordered_map<std::string, LabelT> load_label_map(const std::string &map_file);
 
     // Returns the locations of start point and frozen points suitable for use
@@ -264,6 +294,11 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
                                                          const std::vector<uint32_t> &init_ids, bool use_filter,
                                                          const std::vector<LabelT> &filters, bool search_invocation);
 
+    // iterate_to_fixed_point on the packed layout of optimize_index_layout
+    std::pair<uint32_t, uint32_t> iterate_to_fixed_point_packed(InMemQueryScratch<T> *scratch, const uint32_t Lindex,
+                                                                const std::vector<uint32_t> &init_ids,
+                                                                bool use_filter, const std::vector<LabelT> &filters);
+
     void search_for_point_and_prune(int location, uint32_t Lindex, std::vector<uint32_t> &pruned_list,
                                     InMemQueryScratch<T> *scratch, bool use_filter = false,
                                     uint32_t filteredLindex = 0);
@@ -315,6 +350,14 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     void process_delete(const tsl::robin_set<uint32_t> &old_delete_set, size_t loc, const uint32_t range,
                         const uint32_t maxc, const float alpha, InMemQueryScratch<T> *scratch);
 
+    // Returns the live locations (including frozen points) with an out-edge
+    // to a location in delete_set. Only these need process_delete. Reads
+    // every adjacency list, so each call costs O((max_points + frozen) * R).
+    std::vector<uint32_t> get_in_neighbours_of_deleted(const tsl::robin_set<uint32_t> &delete_set,
+                                                       uint32_t num_threads);
+
+    consolidation_report consolidate_deletes(const IndexWriteParameters &parameters, size_t max_nodes_per_sec);
+
     void initialize_query_scratch(uint32_t num_threads, uint32_t search_l, uint32_t indexing_l, uint32_t r,
                                   uint32_t maxc, size_t dim);
 
@@ -324,6 +367,10 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     DISKANN_DLLEXPORT size_t save_data(std::string filename);
     DISKANN_DLLEXPORT size_t save_tags(std::string filename);
     DISKANN_DLLEXPORT size_t save_delete_list(const std::string &filename);
+    DISKANN_DLLEXPORT size_t save_packed(const std::string &filename);
+#ifndef EXEC_ENV_OLS
+    DISKANN_DLLEXPORT size_t load_packed(const std::string &filename);
+#endif
 #ifdef EXEC_ENV_OLS
     DISKANN_DLLEXPORT size_t load_graph(AlignedFileReader &reader, size_t expected_num_points);
     DISKANN_DLLEXPORT size_t load_data(AlignedFileReader &reader);
@@ -346,7 +393,11 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // Graph related data structures
     std::unique_ptr<AbstractGraphStore> _graph_store;
 
+    // Packed layout of optimize_index_layout, node i at _opt_graph + i *
+    // _node_size: the vector, its norm, the degree and the neighbours.
+    // Either allocated or mapped from a .packed file.
     char *_opt_graph = nullptr;
+    std::unique_ptr<MemoryMapper> _opt_graph_mapper;
 
     // Dimensions
     size_t _dim = 0;
@@ -447,6 +498,18 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // Per node lock, cardinality=_max_points + _num_frozen_points
     std::vector<non_recursive_mutex> _locks;
 
+    // Inserts that started and finished linking a point into the graph. A
+    // concurrent consolidation rescans for edges to deleted points only if
+    // an insert overlapped its repair.
+    std::atomic<uint64_t> _num_graph_inserts_started{0};
+    std::atomic<uint64_t> _num_graph_inserts_finished{0};
+
+    // Background consolidation started by start_background_consolidation
+    std::thread _consolidation_thread;
+    std::mutex _consolidation_thread_mutex;
+    std::condition_variable _consolidation_thread_cv;
+    bool _stop_consolidation_thread = false;
+
     static const float INDEX_GROWTH_FACTOR;
 };
 } // namespace diskann
@@ -12,7 +12,9 @@ enum class DataStoreStrategy
 
 enum class GraphStoreStrategy
 {
-    MEMORY
+    MEMORY,
+    // all adjacency lists in one slab with a fixed number of slots per node
+    CONTIGUOUS
 };
 
 struct IndexConfig
@@ -33,6 +35,8 @@ struct IndexConfig
 
     size_t num_pq_chunks;
     size_t num_frozen_pts;
+    // 0 keeps full precision vectors, 8 or 4 stores scalar quantized vectors
+    uint32_t num_sq_bits;
 
     std::string label_type;
     std::string tag_type;
@@ -45,16 +49,17 @@ struct IndexConfig
 
   private:
     IndexConfig(DataStoreStrategy data_strategy, GraphStoreStrategy graph_strategy, Metric metric, size_t dimension,
-                size_t max_points, size_t num_pq_chunks, size_t num_frozen_points, bool dynamic_index, bool enable_tags,
-                bool pq_dist_build, bool concurrent_consolidate, bool use_opq, bool filtered_index,
-                std::string &data_type, const std::string &tag_type, const std::string &label_type,
-                std::shared_ptr<IndexWriteParameters> index_write_params,
+                size_t max_points, size_t num_pq_chunks, size_t num_frozen_points, uint32_t num_sq_bits,
+                bool dynamic_index, bool enable_tags, bool pq_dist_build, bool concurrent_consolidate, bool use_opq,
+                bool filtered_index, std::string &data_type, const std::string &tag_type,
+                const std::string &label_type, std::shared_ptr<IndexWriteParameters> index_write_params,
                 std::shared_ptr<IndexSearchParams> index_search_params)
         : data_strategy(data_strategy), graph_strategy(graph_strategy), metric(metric), dimension(dimension),
           max_points(max_points), dynamic_index(dynamic_index), enable_tags(enable_tags), pq_dist_build(pq_dist_build),
           concurrent_consolidate(concurrent_consolidate), use_opq(use_opq), filtered_index(filtered_index),
-          num_pq_chunks(num_pq_chunks), num_frozen_pts(num_frozen_points), label_type(label_type), tag_type(tag_type),
-          data_type(data_type), index_write_params(index_write_params), index_search_params(index_search_params)
+          num_pq_chunks(num_pq_chunks), num_frozen_pts(num_frozen_points), num_sq_bits(num_sq_bits),
+          label_type(label_type), tag_type(tag_type), data_type(data_type), index_write_params(index_write_params),
+          index_search_params(index_search_params)
     {
     }
 
@@ -144,6 +149,12 @@ class IndexConfigBuilder
         return *this;
     }
 
+    IndexConfigBuilder &with_num_sq_bits(uint32_t num_sq_bits)
+    {
+        this->_num_sq_bits = num_sq_bits;
+        return *this;
+    }
+
     IndexConfigBuilder &with_label_type(const std::string &label_type)
     {
         this->_label_type = label_type;
@@ -220,9 +231,9 @@ class IndexConfigBuilder
         }
 
         return IndexConfig(_data_strategy, _graph_strategy, _metric, _dimension, _max_points, _num_pq_chunks,
-                           _num_frozen_pts, _dynamic_index, _enable_tags, _pq_dist_build, _concurrent_consolidate,
-                           _use_opq, _filtered_index, _data_type, _tag_type, _label_type, _index_write_params,
-                           _index_search_params);
+                           _num_frozen_pts, _num_sq_bits, _dynamic_index, _enable_tags, _pq_dist_build,
+                           _concurrent_consolidate, _use_opq, _filtered_index, _data_type, _tag_type, _label_type,
+                           _index_write_params, _index_search_params);
     }
 
     IndexConfigBuilder(const IndexConfigBuilder &) = delete;
@@ -245,6 +256,7 @@ class IndexConfigBuilder
 
     size_t _num_pq_chunks = 0;
     size_t _num_frozen_pts{defaults::NUM_FROZEN_POINTS_STATIC};
+    uint32_t _num_sq_bits = 0;
 
     std::string _label_type{"uint32"};
     std::string _tag_type{"uint32"};
@@ -3,7 +3,9 @@
 #include "index.h"
 #include "abstract_graph_store.h"
 #include "in_mem_graph_store.h"
+#include "contiguous_graph_store.h"
 #include "pq_data_store.h"
+#include "sq_data_store.h"
 
 namespace diskann
 {
@@ -28,6 +30,10 @@ class IndexFactory
                                                                                     size_t num_points, size_t dimension,
                                                                                     Metric m, size_t num_pq_chunks,
                                                                                     bool use_opq);
+    template <typename T>
+    DISKANN_DLLEXPORT static std::shared_ptr<SQDataStore<T>> construct_sq_datastore(DataStoreStrategy strategy,
+                                                                                    size_t num_points, size_t dimension,
+                                                                                    Metric m, uint32_t num_sq_bits);
     template <typename T> static Distance<T> *construct_inmem_distance_fn(Metric m);
 
   private:
@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+
+// Boolean expression over the labels of a point: a single label, a
+// conjunction or disjunction of sub-expressions, or a negation. An empty
+// conjunction is true and an empty disjunction is false.
+template <typename LabelT> class LabelPredicate
+{
+  public:
+    enum class Op : uint8_t
+    {
+        LABEL,
+        ALL_OF,
+        ANY_OF,
+        NOT
+    };
+
+    DISKANN_DLLEXPORT static LabelPredicate label(const LabelT &label);
+    DISKANN_DLLEXPORT static LabelPredicate all_of(std::vector<LabelPredicate> operands);
+    DISKANN_DLLEXPORT static LabelPredicate any_of(std::vector<LabelPredicate> operands);
+    DISKANN_DLLEXPORT static LabelPredicate all_of(const std::vector<LabelT> &labels);
+    DISKANN_DLLEXPORT static LabelPredicate any_of(const std::vector<LabelT> &labels);
+    DISKANN_DLLEXPORT static LabelPredicate negate(LabelPredicate operand);
+
+    Op op() const
+    {
+        return _op;
+    }
+    const LabelT &get_label() const
+    {
+        return _label;
+    }
+    const std::vector<LabelPredicate> &operands() const
+    {
+        return _operands;
+    }
+
+    // labels named by the predicate outside of any negation; their medoids
+    // seed a filtered search. Under any_of a matching point may have only one
+    // of them, so this is not a set of labels every match must carry.
+    DISKANN_DLLEXPORT void get_positive_labels(std::vector<LabelT> &labels) const;
+
+  private:
+    Op _op = Op::LABEL;
+    LabelT _label = 0;
+    std::vector<LabelPredicate> _operands;
+};
+
+// Label membership of the points of an index, built from the per-point label
+// lists. Small vocabularies (up to MAX_POINT_BITSET_LABELS labels) are kept as
+// one bitset per point, so that a conjunction or disjunction of labels is a
+// few word operations. Larger ones are kept per label, as a bitset over all
+// points for labels common enough that it is smaller than the sorted list of
+// their points, and as that list otherwise. With point bitsets the rare labels
+// keep that list as well, so that the points matching a selective filter can
+// be enumerated without scanning all points.
+template <typename LabelT> class LabelIndex
+{
+  public:
+    static const uint32_t MAX_POINT_BITSET_LABELS = 256;
+
+    // A predicate resolved against the labels of one index by compile().
+    class Filter
+    {
+      private:
+        friend class LabelIndex;
+        typedef typename LabelPredicate<LabelT>::Op Op;
+
+        struct Node
+        {
+            Op op;
+            // dense label id for LABEL nodes
+            uint32_t label;
+            // operands are _operand_ids[first, last)
+            uint32_t first, last;
+            // offset of the label mask in _masks when all operands are
+            // labels and points have bitsets, else NO_MASK
+            uint32_t mask;
+        };
+
+        std::vector<Node> _nodes;
+        std::vector<uint32_t> _operand_ids;
+        std::vector<uint64_t> _masks;
+        uint32_t _root = 0;
+        uint32_t _universal_label = NO_LABEL;
+    };
+
+    // builds from label lists in CSR form: the labels of point i are
+    // labels[offsets[i], offsets[i] + counts[i])
+    DISKANN_DLLEXPORT void build(const size_t num_points, const uint32_t *offsets, const uint32_t *counts,
+                                 const LabelT *labels);
+
+    DISKANN_DLLEXPORT bool empty() const;
+    DISKANN_DLLEXPORT size_t get_num_points() const;
+    DISKANN_DLLEXPORT size_t get_num_labels() const;
+    DISKANN_DLLEXPORT bool uses_point_bitsets() const;
+
+    // number of points with label, 0 for unknown labels
+    DISKANN_DLLEXPORT size_t get_label_count(const LabelT &label) const;
+
+    DISKANN_DLLEXPORT bool has_label(const uint32_t point, const LabelT &label) const;
+
+    // Points with universal_label, if given, match every label of the
+    // predicate. Labels the index does not know match no point.
+    DISKANN_DLLEXPORT Filter compile(const LabelPredicate<LabelT> &predicate,
+                                     const LabelT *universal_label = nullptr) const;
+
+    // Upper bound on the number of points matching filter, from the label
+    // counts alone.
+    DISKANN_DLLEXPORT size_t estimate_matches(const Filter &filter) const;
+
+    // Appends the points matching filter to points in increasing order. The
+    // candidates come from the lists or bitsets of the labels the filter
+    // requires. If some required label has neither or the filter requires no
+    // label (a negation or an empty conjunction), every point is tested with
+    // point bitsets, and false is returned, leaving points unchanged, without.
+    DISKANN_DLLEXPORT bool get_matching_points(const Filter &filter, std::vector<uint32_t> &points) const;
+
+    bool matches(const Filter &filter, const uint32_t point) const
+    {
+        bool universal = filter._universal_label != NO_LABEL && has_dense_label(point, filter._universal_label);
+        return evaluate(filter, filter._root, point, universal);
+    }
+
+  private:
+    static const uint32_t NO_LABEL = std::numeric_limits<uint32_t>::max();
+    static const uint32_t NO_MASK = std::numeric_limits<uint32_t>::max();
+
+    uint32_t get_dense_label(const LabelT &label) const;
+    uint32_t compile_node(const LabelPredicate<LabelT> &predicate, Filter &filter) const;
+    size_t estimate_node(const Filter &filter, const uint32_t node_id) const;
+    // sorted superset of the points matching node node_id
+    bool collect_candidates(const Filter &filter, const uint32_t node_id, std::vector<uint32_t> &points) const;
+    bool append_label_points(const uint32_t label, std::vector<uint32_t> &points) const;
+
+    bool has_dense_label(const uint32_t point, const uint32_t label) const
+    {
+        if (_point_words > 0)
+            return (_point_bits[(size_t)point * _point_words + label / 64] >> (label % 64)) & 1;
+        if (!_label_bits[label].empty())
+            return (_label_bits[label][point / 64] >> (point % 64)) & 1;
+        const std::vector<uint32_t> &points = _label_points[label];
+        return std::binary_search(points.begin(), points.end(), point);
+    }
+
+    bool evaluate(const Filter &filter, const uint32_t node_id, const uint32_t point, const bool universal) const
+    {
+        typedef typename LabelPredicate<LabelT>::Op Op;
+        const typename Filter::Node &node = filter._nodes[node_id];
+        if (node.op == Op::LABEL)
+            return universal || (node.label != NO_LABEL && has_dense_label(point, node.label));
+        if (node.op == Op::NOT)
+            return !evaluate(filter, filter._operand_ids[node.first], point, universal);
+
+        bool all = node.op == Op::ALL_OF;
+        if (node.mask != NO_MASK)
+        {
+            if (universal)
+                return all || node.first != node.last;
+            const uint64_t *bits = _point_bits.data() + (size_t)point * _point_words;
+            const uint64_t *mask = filter._masks.data() + node.mask;
+            for (uint32_t w = 0; w < _point_words; w++)
+            {
+                uint64_t common = bits[w] & mask[w];
+                if (all && common != mask[w])
+                    return false;
+                if (!all && common != 0)
+                    return true;
+            }
+            return all;
+        }
+        for (uint32_t i = node.first; i < node.last; i++)
+        {
+            if (evaluate(filter, filter._operand_ids[i], point, universal) != all)
+                return !all;
+        }
+        return all;
+    }
+
+    size_t _num_points = 0;
+    std::unordered_map<LabelT, uint32_t> _label_to_dense;
+    std::vector<size_t> _label_counts;
+
+    // with point bitsets: _point_words words per point
+    uint32_t _point_words = 0;
+    std::vector<uint64_t> _point_bits;
+
+    // without: for every label either a bitset over the points or the sorted
+    // list of its points. With point bitsets only the lists of rare labels.
+    std::vector<std::vector<uint64_t>> _label_bits;
+    std::vector<std::vector<uint32_t>> _label_points;
+};
+
+} // namespace diskann
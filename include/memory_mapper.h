@@ -34,6 +34,15 @@ class MemoryMapper
   public:
     MemoryMapper(const char *filename);
     MemoryMapper(const std::string &filename);
+    // populate: prefault the whole mapping so that the first random accesses
+    // do not stall on page faults.
+    // advise_hugepages: madvise(MADV_HUGEPAGE) the mapping before it is
+    // prefaulted. The mapping is file-backed, so this only has an effect on
+    // kernels that put read-only file pages in transparent hugepages
+    // (CONFIG_READ_ONLY_THP_FOR_FS), and there only once khugepaged collapses
+    // them; otherwise the pages stay regular page cache pages.
+    // Both are ignored on Windows.
+    MemoryMapper(const char *filename, bool populate, bool advise_hugepages);
 
     char *getBuf();
     size_t getFileSize();
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <mutex>
 #include <vector>
@@ -36,14 +37,26 @@ struct Neighbor
 
 // Invariant: after every `insert` and `closest_unexpanded()`, `_cur` points to
 //            the first Neighbor which is unexpanded.
+//
+// Inserting into the sorted array moves O(capacity) neighbors, which
+// dominates searches with large L. Queues of at least MIN_BATCHED_CAPACITY
+// neighbors therefore only check an inserted neighbor against the worst one
+// and keep it pending. The pending neighbors are sorted and merged into the
+// array, moving each neighbor at most once, on the next access that needs the
+// order: usually the next `closest_unexpanded()` after inserting the neighbors
+// of an expanded node. As long as an id is always inserted with the same
+// distance, both give the same neighbors in the same order.
 class NeighborPriorityQueue
 {
   public:
-    NeighborPriorityQueue() : _size(0), _capacity(0), _cur(0)
+    static const size_t MIN_BATCHED_CAPACITY = 512;
+
+    NeighborPriorityQueue() : _size(0), _capacity(0), _cur(0), _batched(false)
     {
     }
 
-    explicit NeighborPriorityQueue(size_t capacity) : _size(0), _capacity(capacity), _cur(0), _data(capacity + 1)
+    explicit NeighborPriorityQueue(size_t capacity)
+        : _size(0), _capacity(capacity), _cur(0), _batched(capacity >= MIN_BATCHED_CAPACITY), _data(capacity + 1)
     {
     }
 
@@ -59,6 +72,12 @@ class NeighborPriorityQueue
             return;
         }
 
+        if (_batched)
+        {
+            _pending.emplace_back(nbr.id, nbr.distance);
+            return;
+        }
+
         size_t lo = 0, hi = _size;
         while (lo < hi)
         {
@@ -95,6 +114,7 @@ class NeighborPriorityQueue
 
     Neighbor closest_unexpanded()
     {
+        merge_pending();
         _data[_cur].expanded = true;
         size_t pre = _cur;
         while (_cur < _size && _data[_cur].expanded)
@@ -106,11 +126,13 @@ class NeighborPriorityQueue
 
     bool has_unexpanded_node() const
     {
+        merge_pending();
         return _cur < _size;
     }
 
     size_t size() const
     {
+        merge_pending();
         return _size;
     }
 
@@ -121,20 +143,24 @@ class NeighborPriorityQueue
 
     void reserve(size_t capacity)
     {
+        merge_pending();
         if (capacity + 1 > _data.size())
         {
             _data.resize(capacity + 1);
         }
         _capacity = capacity;
+        _batched = capacity >= MIN_BATCHED_CAPACITY;
     }
 
     Neighbor &operator[](size_t i)
     {
+        merge_pending();
         return _data[i];
     }
 
     Neighbor operator[](size_t i) const
     {
+        merge_pending();
         return _data[i];
     }
 
@@ -142,11 +168,94 @@ class NeighborPriorityQueue
     {
         _size = 0;
         _cur = 0;
+        _pending.clear();
     }
 
   private:
-    size_t _size, _capacity, _cur;
-    std::vector<Neighbor> _data;
+    // position of the first neighbor in _data after nbr, without branches on
+    // the comparisons as they are unpredictable
+    size_t upper_bound(const Neighbor &nbr) const
+    {
+        if (_size == 0)
+        {
+            return 0;
+        }
+        size_t base = 0, n = _size;
+        while (n > 1)
+        {
+            size_t half = n / 2;
+            base = nbr < _data[base + half] ? base : base + half;
+            n -= half;
+        }
+        return base + (nbr < _data[base] ? 0 : 1);
+    }
+
+    // Merges the pending neighbors into _data from the back, so that only the
+    // neighbors after the best pending one move, dropping duplicates and all
+    // neighbors beyond the capacity. Logically const, as the pending
+    // neighbors are part of the set.
+    void merge_pending() const
+    {
+        if (_pending.empty())
+        {
+            return;
+        }
+
+        std::sort(_pending.begin(), _pending.end());
+        _positions.resize(_pending.size());
+        size_t num_pending = 0;
+        for (size_t j = 0; j < _pending.size(); j++)
+        {
+            // drop neighbors pending twice or already in the set
+            if (num_pending > 0 && !(_pending[num_pending - 1] < _pending[j]))
+                continue;
+            size_t pos = upper_bound(_pending[j]);
+            if (pos > 0 && !(_data[pos - 1] < _pending[j]))
+                continue;
+            _positions[num_pending] = pos;
+            _pending[num_pending++] = _pending[j];
+        }
+        if (num_pending == 0)
+        {
+            _pending.clear();
+            return;
+        }
+
+        // place the pending neighbors from the worst, moving the neighbors
+        // after each in one block and dropping those beyond the capacity
+        size_t new_size = (std::min)(_capacity, _size + num_pending);
+        size_t i = _size, w = _size + num_pending;
+        for (size_t j = num_pending; j > 0; j--)
+        {
+            size_t lo = _positions[j - 1];
+            size_t dst = w - (i - lo);
+            if (dst < new_size)
+            {
+                std::memmove(&_data[dst], &_data[lo], ((std::min)(w, new_size) - dst) * sizeof(Neighbor));
+            }
+            w = dst - 1;
+            if (w < new_size)
+            {
+                _data[w] = _pending[j - 1];
+            }
+            i = lo;
+        }
+        if (w < _cur)
+        {
+            _cur = w;
+        }
+        _size = new_size;
+        _cur = (std::min)(_cur, _size);
+        _pending.clear();
+    }
+
+    mutable size_t _size;
+    size_t _capacity;
+    mutable size_t _cur;
+    bool _batched;
+    mutable std::vector<Neighbor> _data, _pending;
+    // insert positions of the pending neighbors during a merge
+    mutable std::vector<size_t> _positions;
 };
 
 } // namespace diskann
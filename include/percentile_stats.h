@@ -33,6 +33,19 @@ struct QueryStats
     unsigned n_cmps = 0;       // # cmps
     unsigned n_cache_hits = 0; // # cache_hits
     unsigned n_hops = 0;       // # search hops
+
+    // embedding recompute
+    unsigned n_recompute_rpcs = 0;       // # embedding fetches issued
+    unsigned n_recompute_requested = 0;  // # exact distances asked for, reused ones included
+    unsigned n_recomputed = 0;           // # embeddings fetched
+    unsigned n_recompute_cache_hits = 0; // # exact distances reused from earlier hops
+    unsigned n_recompute_skipped = 0;    // # nodes left with PQ distances by the budget
+
+    // time per stage in micros
+    float recompute_rpc_us = 0; // waiting for embedding fetches
+    float preprocess_us = 0;    // preprocessing fetched embeddings
+    float pq_us = 0;            // computing PQ distances
+    float rerank_us = 0;        // reranking the final candidates, fetches included
 };
 
 template <typename T>
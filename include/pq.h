@@ -45,6 +45,10 @@ class FixedChunkPQTable
     void inflate_vector(uint8_t *base_vec, float *out_vec);
 
     void populate_chunk_inner_products(const float *query_vec, float *dist_vec);
+
+    // symmetric distances between codes: fills sdc_tables[(256 * chunk + i) * 256 + j]
+    // with the squared L2 distance between centers i and j of the chunk
+    void populate_symmetric_chunk_distances(float *sdc_tables);
 };
 
 void aggregate_coords(const std::vector<unsigned> &ids, const uint8_t *all_coords, const uint64_t ndims, uint8_t *out);
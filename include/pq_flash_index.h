@@ -6,6 +6,10 @@
 
 #include "aligned_file_reader.h"
 #include "concurrent_queue.h"
+#include "embedding_coalescer.h"
+#include "embedding_provider.h"
+#include "label_index.h"
+#include "memory_mapper.h"
 #include "neighbor.h"
 #include "parameters.h"
 #include "percentile_stats.h"
@@ -21,6 +25,9 @@
 namespace diskann
 {
 
+template <typename LabelT> class MappedBinLabels;
+class ContiguousGraphStore;
+
 template <typename T, typename LabelT = uint32_t> class PQFlashIndex
 {
   public:
@@ -29,6 +36,33 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                    diskann::Metric metric = diskann::Metric::L2);
     DISKANN_DLLEXPORT ~PQFlashIndex();
 
+    // Must be called before load(). When mmap_pq_data is set, the PQ codes
+    // file is mapped read-only and prefaulted instead of being copied to the
+    // heap, so that processes on the same host share one page-cache copy.
+    // When use_hugepages is set, the node/coord caches are backed by 2MB pages
+    // and the PQ codes mapping is advised to use transparent hugepages, which
+    // only takes effect where the kernel supports them for file pages.
+    DISKANN_DLLEXPORT void set_memory_options(bool mmap_pq_data, bool use_hugepages);
+
+    // Coalesces the embedding requests of concurrent searches: requests
+    // arriving within window_us of each other are deduplicated and sent to the
+    // embedding server as one batch of up to max_batch_size ids (see
+    // EmbeddingCoalescer). A window of 0 sends every request on its own.
+    DISKANN_DLLEXPORT void set_embedding_coalescing(uint32_t window_us, uint32_t max_batch_size = 4096);
+
+    // Recompute search gets its embeddings from provider instead of the
+    // embedding server at _embedding_endpoint / _zmq_port. nullptr switches
+    // back to the server. Must not be called during searches.
+    DISKANN_DLLEXPORT void set_embedding_provider(std::shared_ptr<EmbeddingProvider> provider);
+
+    // Filtered searches whose filter matches at most max(l_search,
+    // selectivity * number of points) points, by the label counts, skip the
+    // graph: the matching points are scanned with PQ distances and the
+    // closest l_search are reranked at full precision, or the closest
+    // recompute_budget of them when embeddings are recomputed under a budget.
+    // 0 always searches the graph.
+    DISKANN_DLLEXPORT void set_prefilter_selectivity(float selectivity);
+
 #ifdef EXEC_ENV_OLS
     DISKANN_DLLEXPORT int load(diskann::MemoryMappedFiles &files, uint32_t num_threads, const char *index_prefix,
                                const char *pq_prefix = nullptr);
@@ -65,6 +99,13 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void cache_bfs_levels(uint64_t num_nodes_to_cache, std::vector<uint32_t> &node_list,
                                             const bool shuffle = false);
 
+    // With recompute_beighbor_embeddings, recompute_budget > 0 caps the number
+    // of embeddings a query fetches: nodes are ranked by PQ distance and only
+    // those that could enter the candidate list are recomputed, the others
+    // keep their PQ distance during the search. The results only rank nodes
+    // with exact distances: in partition mode the nodes left with a PQ
+    // distance are dropped before the final sort, unless none was
+    // recomputed. Budget use is reported in stats.
     DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
                                               uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
                                               const bool use_reorder_data = false, QueryStats *stats = nullptr,
@@ -72,7 +113,8 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                               const bool skip_search_reorder = false,
                                               const bool recompute_beighbor_embeddings = false,
                                               const bool dedup_node_dis = false, float prune_ratio = 0,
-                                              const bool batch_recompute = false, bool global_pruning = false);
+                                              const bool batch_recompute = false, bool global_pruning = false,
+                                              const uint32_t recompute_budget = 0);
 
     DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
                                               uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
@@ -82,7 +124,8 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                               const bool skip_search_reorder = false,
                                               const bool recompute_beighbor_embeddings = false,
                                               const bool dedup_node_dis = false, float prune_ratio = 0,
-                                              const bool batch_recompute = false, bool global_pruning = false);
+                                              const bool batch_recompute = false, bool global_pruning = false,
+                                              const uint32_t recompute_budget = 0);
 
     DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
                                               uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
@@ -91,7 +134,8 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                               const bool skip_search_reorder = false,
                                               const bool recompute_beighbor_embeddings = false,
                                               const bool dedup_node_dis = false, float prune_ratio = 0,
-                                              const bool batch_recompute = false, bool global_pruning = false);
+                                              const bool batch_recompute = false, bool global_pruning = false,
+                                              const uint32_t recompute_budget = 0);
 
     DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
                                               uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
@@ -101,7 +145,25 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                               const bool skip_search_reorder = false,
                                               const bool recompute_beighbor_embeddings = false,
                                               const bool dedup_node_dis = false, float prune_ratio = 0,
-                                              const bool batch_recompute = false, bool global_pruning = false);
+                                              const bool batch_recompute = false, bool global_pruning = false,
+                                              const uint32_t recompute_budget = 0);
+
+    // Filtered search for the points matching filter, e.g.
+    // all_of({label(a), any_of({b, c}), negate(label(d))}). Points with the
+    // universal label match every label. Search starts from the closest
+    // medoid of the labels the filter requires, or from the unfiltered start
+    // point if none of them has one.
+    DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
+                                              uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
+                                              const LabelPredicate<LabelT> &filter,
+                                              const uint32_t io_limit = std::numeric_limits<uint32_t>::max(),
+                                              const bool use_reorder_data = false, QueryStats *stats = nullptr,
+                                              const bool USE_DEFERRED_FETCH = false,
+                                              const bool skip_search_reorder = false,
+                                              const bool recompute_beighbor_embeddings = false,
+                                              const bool dedup_node_dis = false, float prune_ratio = 0,
+                                              const bool batch_recompute = false, bool global_pruning = false,
+                                              const uint32_t recompute_budget = 0);
 
     DISKANN_DLLEXPORT LabelT get_converted_label(const std::string &filter_label);
 
@@ -130,6 +192,15 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT std::vector<std::uint8_t> get_pq_vector(std::uint64_t vid);
     DISKANN_DLLEXPORT uint64_t get_num_points();
 
+    // Marks a point as deleted. Deleted points are still used to route
+    // searches but are no longer returned. Can be called concurrently with
+    // searches. Returns -1 if id is out of range or already deleted. Ids are
+    // those returned by search, which for a reordered index are the ids
+    // before reordering.
+    DISKANN_DLLEXPORT int lazy_delete(uint32_t id);
+    DISKANN_DLLEXPORT bool is_deleted(uint32_t id) const;
+    DISKANN_DLLEXPORT uint64_t get_num_deleted_points() const;
+
   protected:
     DISKANN_DLLEXPORT void use_medoids_data_as_centroids();
     DISKANN_DLLEXPORT void setup_thread_data(uint64_t nthreads, uint64_t visited_reserve = 4096);
@@ -137,9 +208,28 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void set_universal_label(const LabelT &label);
 
   private:
+    // filter is nullptr for unfiltered searches
+    void cached_beam_search_impl(const T *query, const uint64_t k_search, const uint64_t l_search, uint64_t *res_ids,
+                                 float *res_dists, const uint64_t beam_width, const LabelPredicate<LabelT> *filter,
+                                 const uint32_t io_limit, const bool use_reorder_data, QueryStats *stats,
+                                 const bool USE_DEFERRED_FETCH, const bool skip_search_reorder,
+                                 const bool recompute_beighbor_embeddings, const bool dedup_node_dis,
+                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                 const uint32_t recompute_budget);
+
     DISKANN_DLLEXPORT inline bool point_has_label(uint32_t point_id, LabelT label_id);
     std::unordered_map<std::string, LabelT> load_label_map(std::basic_istream<char> &infile);
     DISKANN_DLLEXPORT void parse_label_file(std::basic_istream<char> &infile, size_t &num_pts_labels);
+    // maps <index>_labels.bin, which replaces the text label, medoid,
+    // universal label and dummy map files
+    void load_bin_labels(const std::string &bin_labels_file, const std::string &labels_map_file);
+    void add_dummy_point(uint32_t dummy_id, uint32_t real_id);
+    void load_navigation_graph(const std::string &nav_graph_file);
+    // best start points of a search by a search of the navigation graph in
+    // PQ space with list size l_search, in the nav graph buffers and the PQ
+    // scratch of query_scratch
+    void search_navigation_graph(SSDQueryScratch<T> *query_scratch, const float *pq_dists, const uint64_t l_search,
+                                 std::vector<uint32_t> &start_points);
     DISKANN_DLLEXPORT void get_label_file_metadata(const std::string &fileContent, uint32_t &num_pts,
                                                    uint32_t &num_total_labels);
     DISKANN_DLLEXPORT void generate_random_labels(std::vector<LabelT> &labels, const uint32_t num_labels,
@@ -160,10 +250,26 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
 
     DISKANN_DLLEXPORT int load_graph_index(const std::string &graph_index_file);
 
+    // maps _pq_compressed.bin read-only and points `data` past its header
+    DISKANN_DLLEXPORT int map_pq_compressed_vectors(const std::string &pq_compressed_vectors, size_t &npts,
+                                                    size_t &nchunks);
+
     DISKANN_DLLEXPORT int read_partition_info(const std::string &partition_bin);
 
     DISKANN_DLLEXPORT int read_neighbors(const std::string &graph_index_file, uint64_t target_node_id);
 
+    // copies the neighbors of node_id out of the sector of its partition,
+    // decoding them if the graph file is compressed. nbrs must have room for
+    // _max_degree ids. Returns false if the node is not in the sector.
+    bool read_partition_nbrs(const char *sector_buf, uint32_t partition_id, uint32_t node_id, uint32_t *nbrs,
+                             uint64_t &nnbrs);
+
+    // fetches embeddings from the provider or the embedding server, through
+    // the coalescer if set, counting the fetch in stats. Writes dim floats per
+    // id to embeddings.
+    bool fetch_node_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim,
+                               QueryStats *stats = nullptr);
+
     // index info for multi-node sectors
     // nhood of node `i` is in sector: [i / nnodes_per_sector]
     // offset in sector: [(i % nnodes_per_sector) * max_node_len]
@@ -210,6 +316,10 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     // pq_tables = float* [[2^8 * [chunk_size]] * _n_chunks]
     uint8_t *data = nullptr;
     uint64_t _n_chunks;
+    // set when `data` points into a read-only mapping of the PQ codes file
+    std::unique_ptr<MemoryMapper> _pq_data_mapper;
+    bool _mmap_pq_data = false;
+    bool _use_hugepages = false;
     FixedChunkPQTable _pq_table;
 
     // distance comparator
@@ -241,6 +351,17 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     T *_coord_cache_buf = nullptr;
     tsl::robin_map<uint32_t, T *> _coord_cache;
 
+    // non-zero when the cache buffers above were allocated with
+    // alloc_hugepage_backed, holds the mapped sizes for freeing
+    size_t _nhood_cache_buf_alloc_size = 0;
+    size_t _coord_cache_buf_alloc_size = 0;
+
+    // navigation graph over a sample of the points (see
+    // build_navigation_graph), with local ids; _nav_ids maps them to points
+    std::unique_ptr<ContiguousGraphStore> _nav_graph;
+    std::vector<uint32_t> _nav_ids;
+    uint32_t _nav_start = 0;
+
     // thread-specific scratch
     ConcurrentQueue<SSDThreadData<T> *> _thread_data;
     uint64_t _max_nthreads;
@@ -253,6 +374,11 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     uint32_t *_pts_to_label_offsets = nullptr;
     uint32_t *_pts_to_label_counts = nullptr;
     LabelT *_pts_to_labels = nullptr;
+    // membership of the labels above, for filter checks during search
+    LabelIndex<LabelT> _label_index;
+    // set when the label arrays above point into a mapped _labels.bin
+    std::unique_ptr<MappedBinLabels<LabelT>> _bin_labels;
+    float _prefilter_selectivity = defaults::PREFILTER_SELECTIVITY;
     std::unordered_map<LabelT, std::vector<uint32_t>> _filter_to_medoid_ids;
     bool _use_universal_label = false;
     LabelT _universal_filter_label;
@@ -262,16 +388,33 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     tsl::robin_map<uint32_t, std::vector<uint32_t>> _real_to_dummy_map;
     std::unordered_map<std::string, LabelT> _label_map;
 
+    // one bit per point, set by lazy_delete
+    std::vector<std::atomic<uint64_t>> _deleted_bitmap;
+    std::atomic<uint64_t> _num_deleted_points{0};
+
   public:
     // ZMQ port for embedding server communication (public for runtime updates)
     int _zmq_port = 5555; // Default ZMQ port
+    // Embedding server endpoint: shm://<name> for the shared memory channel
+    // of a server on this host (see embedding_shm_channel.h), or any ZMQ
+    // endpoint such as tcp://host:port. Empty means tcp://127.0.0.1:_zmq_port.
+    std::string _embedding_endpoint;
 
   private:
+    // set by set_embedding_coalescing and set_embedding_provider
+    std::unique_ptr<EmbeddingCoalescer> _embedding_coalescer;
+    std::shared_ptr<EmbeddingProvider> _embedding_provider;
+
+    // original id of each point of a reordered index (see graph_reorder.h),
+    // empty otherwise
+    std::vector<uint32_t> _id_map;
+
     bool _use_partition = false;
 
     std::shared_ptr<AlignedFileReader> graph_reader; // Graph file reader
     std::string _graph_index_file;                   // Graph file path
     uint64_t _graph_node_len;                        // Graph node length
+    bool _compressed_graph = false;                  // Graph file uses compressed_graph.h
     uint64_t _emb_node_len;                          // Embedding node length
 
     // Partition related data structures
@@ -286,5 +429,8 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     static const int HEADER_SIZE = defaults::SECTOR_LEN;
     char *getHeaderBytes();
 #endif
+
+    // the fresh-update layer merges its delta by streaming the disk layout
+    template <typename, typename> friend class FreshPQFlashIndex;
 };
 } // namespace diskann
@@ -68,6 +68,10 @@ const char *GRAPH_BUILD_ALPHA = "Alpha controls density and diameter of graph, s
                                 "denser graphs with lower diameter";
 const char *BUIlD_GRAPH_PQ_BYTES = "Number of PQ bytes to build the index; 0 for full precision build";
 const char *USE_OPQ = "Use Optimized Product Quantization (OPQ).";
+const char *SQ_BITS = "Number of bits per dimension (8 or 4) to scalar quantize the in-memory vectors with; 0 for "
+                      "full precision";
+const char *PACKED_LAYOUT = "Save the index in the packed layout (<index_path_prefix>.packed), which interleaves each "
+                            "vector with its neighbours and is memory mapped on load";
 const char *LABEL_FILE = "Input label file in txt format for Filtered Index build. The file should contain comma "
                          "separated filters for each node with each line corresponding to a graph node";
 const char *UNIVERSAL_LABEL =
@@ -150,6 +150,12 @@ template <typename T> class SSDQueryScratch : public AbstractScratch<T>
     NeighborPriorityQueue retset;
     std::vector<Neighbor> full_retset;
 
+    // search of the navigation graph for start points, in nav graph ids
+    tsl::robin_set<uint32_t> nav_visited;
+    NeighborPriorityQueue nav_retset;
+    std::vector<uint32_t> nav_local_ids;
+    std::vector<uint32_t> nav_ids;
+
     SSDQueryScratch(size_t aligned_dim, size_t visited_reserve);
     ~SSDQueryScratch();
 
@@ -0,0 +1,127 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "abstract_data_store.h"
+#include "distance.h"
+
+namespace diskann
+{
+// Data store holding per-dimension scalar quantized vectors. Every dimension j
+// is mapped to [0, 2^num_bits - 1] using x_j ~= min_j + code_j * scale_j, where
+// min_j and scale_j are learnt from the data passed to populate_data(). With
+// num_bits = 8 a vector takes one byte per dimension, with num_bits = 4 two
+// dimensions are packed into one byte (low nibble first).
+//
+// Distances between a full precision query and a stored vector are computed
+// asymmetrically, i.e. the query is never quantized. L2, inner product and
+// cosine are supported. For cosine, vectors are normalized before they are
+// quantized and queries are normalized before comparison.
+//
+// On disk, save(filename) writes the codes to filename with the usual
+// [npts (int32), dim (int32)] header followed by npts rows of code_len() bytes,
+// and the quantization parameters to filename + "_sq_params.bin" as a float
+// bin of shape [3, dim]: mins, then scales, then a row whose first entry is
+// the number of bits per dimension.
+template <typename data_t> class SQDataStore : public AbstractDataStore<data_t>
+{
+  public:
+    SQDataStore(const location_t capacity, const size_t dim, const uint32_t num_bits,
+                std::unique_ptr<Distance<data_t>> distance_fn);
+    SQDataStore(const SQDataStore &) = delete;
+    SQDataStore &operator=(const SQDataStore &) = delete;
+    virtual ~SQDataStore();
+
+    virtual location_t load(const std::string &filename) override;
+    virtual size_t save(const std::string &filename, const location_t num_points) override;
+
+    virtual size_t get_aligned_dim() const override;
+
+    // Learns the quantization parameters from the vectors and encodes them.
+    virtual void populate_data(const data_t *vectors, const location_t num_pts) override;
+    virtual void populate_data(const std::string &filename, const size_t offset) override;
+
+    // Writes the dequantized vectors in the regular bin format.
+    virtual void extract_data_to_bin(const std::string &filename, const location_t num_pts) override;
+
+    // get_vector returns the dequantized vector; set_vector encodes with the
+    // already learnt parameters and throws if there are none yet.
+    virtual void get_vector(const location_t i, data_t *target) const override;
+    virtual void set_vector(const location_t i, const data_t *const vector) override;
+    virtual void prefetch_vector(const location_t loc) override;
+
+    virtual void move_vectors(const location_t old_location_start, const location_t new_location_start,
+                              const location_t num_points) override;
+    virtual void copy_vectors(const location_t from_loc, const location_t to_loc, const location_t num_points) override;
+
+    // Copies the query to the scratch and prepares it there once, so that the
+    // get_distance calls taking the scratch only run the distance kernel.
+    // Must be called again for every new query.
+    virtual void preprocess_query(const data_t *query, AbstractScratch<data_t> *query_scratch) const override;
+
+    virtual float get_distance(const data_t *preprocessed_query, const location_t loc) const override;
+    virtual float get_distance(const location_t loc1, const location_t loc2) const override;
+
+    virtual void get_distance(const data_t *preprocessed_query, const location_t *locations,
+                              const uint32_t location_count, float *distances,
+                              AbstractScratch<data_t> *scratch) const override;
+    virtual void get_distance(const data_t *preprocessed_query, const std::vector<location_t> &ids,
+                              std::vector<float> &distances, AbstractScratch<data_t> *scratch_space) const override;
+
+    virtual location_t calculate_medoid() const override;
+
+    // Full precision distance function of the metric, kept for callers that
+    // need a Distance<data_t>.
+    virtual Distance<data_t> *get_dist_fn() const override;
+
+    virtual size_t get_alignment_factor() const override;
+
+    // Returns the number of bits per dimension recorded in the parameters of
+    // a file written by save(), or 0 if filename has no parameters file.
+    // Throws if the parameters do not match the data file, e.g. when they are
+    // left over from another index.
+    DISKANN_DLLEXPORT static uint32_t get_num_bits_from_file(const std::string &filename);
+
+    uint32_t get_num_bits() const;
+    // bytes used by one quantized vector
+    size_t code_len() const;
+
+  protected:
+    virtual location_t expand(const location_t new_size) override;
+    virtual location_t shrink(const location_t new_size) override;
+
+  private:
+    // converts a raw vector to float, normalizing it for cosine
+    void to_float(const data_t *vector, float *out) const;
+    void update_range(const float *vector, float *mins, float *maxs) const;
+    void finalize_range(const float *mins, const float *maxs);
+    void encode(const float *vector, uint8_t *code) const;
+    void decode(const uint8_t *code, float *out) const;
+
+    // Folds the quantization parameters into the query so that the kernels
+    // only need one multiply-add per dimension. Returns the constant term.
+    float prepare_query(const float *query, float *prepared) const;
+    // converts a raw query and prepares it into prepared, returns the bias
+    float prepare_raw_query(const data_t *query, std::vector<float> &prepared) const;
+    float distance_to_code(const float *prepared, float bias, const uint8_t *code) const;
+    void reallocate(const location_t new_size, const location_t points_to_copy);
+
+    uint8_t *_quantized_data = nullptr;
+    uint32_t _num_bits;
+    // dims are padded to a multiple of 32 so the kernels need no tail loop,
+    // padded dims have min = scale = 0 and code 0
+    size_t _padded_dim;
+    size_t _code_len;
+    bool _trained = false;
+
+    std::vector<float> _mins;
+    std::vector<float> _scales;
+
+    Metric _metric;
+    std::unique_ptr<Distance<data_t>> _distance_fn;
+};
+
+} // namespace diskann
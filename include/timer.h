@@ -26,6 +26,12 @@ class Timer
         return std::chrono::duration_cast<std::chrono::microseconds>(_clock::now() - check_point).count();
     }
 
+    // elapsed() without rounding down to whole micros, for short steps
+    float elapsed_us() const
+    {
+        return std::chrono::duration<float, std::micro>(_clock::now() - check_point).count();
+    }
+
     float elapsed_seconds() const
     {
         return (float)elapsed() / 1000000.0f;
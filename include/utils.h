@@ -17,6 +17,7 @@
 #include <Windows.h>
 typedef HANDLE FileHandle;
 #else
+#include <sys/mman.h>
 #include <unistd.h>
 typedef int FileHandle;
 #endif
@@ -503,6 +504,50 @@ inline void aligned_free(void *ptr)
 #endif
 }
 
+#define HUGEPAGE_SIZE_2MB (2 * 1024 * 1024)
+
+// Allocates a zero-filled buffer of at least `size` bytes backed by 2MB pages
+// where the platform allows it. Explicit hugepages (MAP_HUGETLB) are tried
+// first; if none are reserved we fall back to a regular anonymous mapping and
+// ask for transparent hugepages. Returns the number of bytes actually
+// reserved, which must be passed back to free_hugepage_backed.
+inline size_t alloc_hugepage_backed(void **ptr, size_t size)
+{
+    *ptr = nullptr;
+    size_t alloc_size = ROUND_UP(size, HUGEPAGE_SIZE_2MB);
+#if defined(_WINDOWS) || defined(__APPLE__)
+    alloc_aligned(ptr, alloc_size, 4096);
+    memset(*ptr, 0, alloc_size);
+#else
+    void *buf = mmap(nullptr, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (buf == MAP_FAILED)
+    {
+        buf = mmap(nullptr, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf == MAP_FAILED)
+            report_memory_allocation_failure();
+#ifdef MADV_HUGEPAGE
+        madvise(buf, alloc_size, MADV_HUGEPAGE);
+#endif
+    }
+    *ptr = buf;
+#endif
+    return alloc_size;
+}
+
+inline void free_hugepage_backed(void *ptr, size_t alloc_size)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+#if defined(_WINDOWS) || defined(__APPLE__)
+    aligned_free(ptr);
+#else
+    if (munmap(ptr, alloc_size) != 0)
+        diskann::cerr << "munmap of hugepage-backed buffer failed with error " << errno << std::endl;
+#endif
+}
+
 inline void GenRandom(std::mt19937 &rng, unsigned *addr, unsigned size, unsigned N)
 {
     for (unsigned i = 0; i < size; ++i)
@@ -565,6 +610,10 @@ inline void get_bin_metadata(const std::string &bin_file, size_t &nrows, size_t
 #ifndef EXEC_ENV_OLS
 inline size_t get_graph_num_frozen_points(const std::string &graph_file)
 {
+    // packed indices have no graph file and no frozen points
+    if (!file_exists(graph_file) && file_exists(graph_file + ".packed"))
+        return 0;
+
     size_t expected_file_size;
     uint32_t max_observed_degree, start;
     size_t file_frozen_pts;
@@ -15,7 +15,7 @@ template <typename DT>
 void build_disk_index(diskann::Metric metric, const std::string &data_file_path, const std::string &index_prefix_path,
                       uint32_t complexity, uint32_t graph_degree, double final_index_ram_limit,
                       double indexing_ram_budget, uint32_t num_threads, uint32_t pq_disk_bytes,
-                      const std::string &codebook_prefix);
+                      const std::string &codebook_prefix, uint32_t nav_graph_points);
 
 template <typename DT, typename TagT = DynamicIdType, typename LabelT = filterT>
 void build_memory_index(diskann::Metric metric, const std::string &vector_bin_path,
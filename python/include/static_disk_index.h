@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <string>
 
 #include <pybind11/pybind11.h>
@@ -38,7 +39,8 @@ template <typename DT> class StaticDiskIndex
   public:
     StaticDiskIndex(diskann::Metric metric, const std::string &index_path_prefix, uint32_t num_threads,
                     size_t num_nodes_to_cache, uint32_t cache_mechanism, int zmq_port,
-                    const std::string &pq_prefix, const std::string &partition_prefix);
+                    const std::string &pq_prefix, const std::string &partition_prefix, bool mmap_pq_data = false,
+                    bool use_hugepages = false);
 
     void cache_bfs_levels(size_t num_nodes_to_cache);
 
@@ -49,21 +51,31 @@ template <typename DT> class StaticDiskIndex
                                                bool USE_DEFERRED_FETCH = false, bool skip_search_reorder = false,
                                                bool recompute_beighbor_embeddings = false, bool dedup_node_dis = false,
                                                float prune_ratio = 0, bool batch_recompute = false,
-                                               bool global_pruning = false);
+                                               bool global_pruning = false, uint32_t recompute_budget = 0);
 
     NeighborsAndDistances<StaticIdType> batch_search(
         py::array_t<DT, py::array::c_style | py::array::forcecast> &queries, uint64_t num_queries, uint64_t knn,
         uint64_t complexity, uint64_t beam_width, uint32_t num_threads, bool USE_DEFERRED_FETCH = false,
         bool skip_search_reorder = false, bool recompute_beighbor_embeddings = false, bool dedup_node_dis = false,
-        float prune_ratio = 0, bool batch_recompute = false, bool global_pruning = false);
+        float prune_ratio = 0, bool batch_recompute = false, bool global_pruning = false,
+        uint32_t recompute_budget = 0);
+
+    // per-query means of the QueryStats of the last batch_search
+    std::map<std::string, double> get_last_batch_stats() const;
 
     // ZMQ port access methods
     int get_zmq_port() const;
     void set_zmq_port(int port);
 
+    // shm://<name> or a ZMQ endpoint, empty uses the ZMQ port on localhost
+    std::string get_embedding_endpoint() const;
+    void set_embedding_endpoint(const std::string &endpoint);
+    void set_embedding_coalescing(uint32_t window_us, uint32_t max_batch_size);
+
   private:
     std::shared_ptr<AlignedFileReader> _reader;
     std::shared_ptr<AlignedFileReader> _graph_reader;
     diskann::PQFlashIndex<DT> _index;
+    std::map<std::string, double> _last_batch_stats;
 };
 } // namespace diskannpy
@@ -62,6 +62,7 @@ def build_disk_index(
     vector_dtype: Optional[VectorDType] = None,
     index_prefix: str = "ann",
     codebook_prefix: str = "",
+    nav_graph_points: int = 0,
 ) -> None:
     """
     This function will construct a DiskANN disk index. Disk indices are ideal for very large datasets that
@@ -105,6 +106,9 @@ def build_disk_index(
       than the number of bytes used for the PQ compressed data stored in-memory. Default is `0`.
     - **vector_dtype**: Required if the provided `data` is of type `str`, else we use the `data.dtype` if np array.
     - **index_prefix**: The prefix of the index files. Defaults to "ann".
+    - **nav_graph_points**: Number of sampled points of an in-memory navigation graph that is searched with the
+      in-memory PQ codes to find the start points of a disk search, saving hops near the start. `0` builds none.
+      Default is `0`.
     """
 
     _assert(
@@ -119,6 +123,7 @@ def build_disk_index(
     _assert(build_memory_maximum > 0, "build_memory_maximum must be larger than 0")
     _assert_is_nonnegative_uint32(num_threads, "num_threads")
     _assert_is_nonnegative_uint32(pq_disk_bytes, "pq_disk_bytes")
+    _assert_is_nonnegative_uint32(nav_graph_points, "nav_graph_points")
     _assert(index_prefix != "", "index_prefix cannot be an empty string")
 
     index_path = Path(index_directory)
@@ -159,6 +164,7 @@ def build_disk_index(
         num_threads=num_threads,
         pq_disk_bytes=pq_disk_bytes,
         codebook_prefix=codebook_prefix,
+        nav_graph_points=nav_graph_points,
     )
     _write_index_metadata(
         index_prefix_path, vector_dtype_actual, dap_metric, num_points, dimensions
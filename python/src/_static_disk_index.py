@@ -47,6 +47,8 @@ class StaticDiskIndex:
         index_prefix: str = "ann",
         pq_prefix: str = "",
         partition_prefix: str = "",
+        mmap_pq_data: bool = False,
+        use_hugepages: bool = False,
     ):
         """
         ### Parameters
@@ -80,6 +82,9 @@ class StaticDiskIndex:
           dimensionality. **This value is only used if a `{index_prefix}_metadata.bin` file does not exist.** If it
           does not exist, you are required to provide it.
         - **index_prefix**: The prefix of the index files. Defaults to "ann".
+        - **mmap_pq_data**: Memory-map `{index_prefix}_pq_compressed.bin` read-only instead of copying it to the heap.
+          Startup no longer pays for the copy, and processes on the same host share one page-cache copy of the codes.
+        - **use_hugepages**: Back the PQ codes mapping and the node caches with 2MB pages where available.
         """
         index_prefix_path = _valid_index_prefix(index_directory, index_prefix)
         vector_dtype, metric, _, _ = _ensure_index_metadata(
@@ -109,6 +114,8 @@ class StaticDiskIndex:
             cache_mechanism=cache_mechanism,
             pq_prefix=pq_prefix,
             partition_prefix=partition_prefix,
+            mmap_pq_data=mmap_pq_data,
+            use_hugepages=use_hugepages,
         )
         print("After index init")
 
@@ -125,6 +132,7 @@ class StaticDiskIndex:
         prune_ratio: float = 0,
         batch_recompute: bool = False,
         global_pruning: bool = False,
+        recompute_budget: int = 0,
     ) -> QueryResponse:
         """
         Searches the index by a single query vector.
@@ -145,12 +153,15 @@ class StaticDiskIndex:
         - **recompute_beighbor_embeddings**: Whether to recompute the neighbor embeddings.
         - **dedup_node_dis**: Whether to dedup node distances.
         - **batch_recompute**: Whether to batch recompute.
+        - **recompute_budget**: With recompute_beighbor_embeddings, the maximum number of embeddings recomputed for
+          the query; other nodes are scored with PQ distances. 0 means no limit.
         """
         _query = _castable_dtype_or_raise(query, expected=self._vector_dtype)
         _assert(len(_query.shape) == 1, "query vector must be 1-d")
         _assert_is_positive_uint32(k_neighbors, "k_neighbors")
         _assert_is_positive_uint32(complexity, "complexity")
         _assert_is_positive_uint32(beam_width, "beam_width")
+        _assert_is_nonnegative_uint32(recompute_budget, "recompute_budget")
 
         if k_neighbors > complexity:
             warnings.warn(
@@ -170,6 +181,7 @@ class StaticDiskIndex:
             prune_ratio=prune_ratio,
             batch_recompute=batch_recompute,
             global_pruning=global_pruning,
+            recompute_budget=recompute_budget,
         )
         return QueryResponse(identifiers=neighbors, distances=distances)
 
@@ -187,6 +199,7 @@ class StaticDiskIndex:
         prune_ratio: float = 0,
         batch_recompute: bool = False,
         global_pruning: bool = False,
+        recompute_budget: int = 0,
     ) -> QueryResponseBatch:
         """
         Searches the index by a batch of query vectors.
@@ -208,6 +221,10 @@ class StaticDiskIndex:
           Specifying 0 will optimize the beamwidth depending on the number of threads performing search, but will
           involve some tuning overhead.
         - **skip_search_reorder**: Whether to skip search reorder for diskann search.
+        - **recompute_budget**: With recompute_beighbor_embeddings, the maximum number of embeddings recomputed per
+          query; other nodes are scored with PQ distances. 0 means no limit.
+
+        The per-query means of the search statistics of the batch are available in `last_batch_stats` afterwards.
         """
         _queries = _castable_dtype_or_raise(queries, expected=self._vector_dtype)
         _assert_2d(_queries, "queries")
@@ -215,6 +232,7 @@ class StaticDiskIndex:
         _assert_is_positive_uint32(complexity, "complexity")
         _assert_is_nonnegative_uint32(num_threads, "num_threads")
         _assert_is_positive_uint32(beam_width, "beam_width")
+        _assert_is_nonnegative_uint32(recompute_budget, "recompute_budget")
 
         if k_neighbors > complexity:
             warnings.warn(
@@ -240,5 +258,19 @@ class StaticDiskIndex:
             prune_ratio=prune_ratio,
             batch_recompute=batch_recompute,
             global_pruning=global_pruning,
+            recompute_budget=recompute_budget,
         )
         return QueryResponseBatch(identifiers=neighbors, distances=distances)
+
+    @property
+    def last_batch_stats(self) -> dict:
+        """
+        Per-query means of the statistics of the last `batch_search`, keyed by name: the time in microseconds
+        (`total_us`, `io_us`, `cpu_us`) and per stage (`recompute_rpc_us` waiting for embedding fetches,
+        `preprocess_us` preparing fetched embeddings, `pq_us` computing PQ distances, `rerank_us` reranking the final
+        candidates), the counts of the search (`n_ios`, `n_cmps`, `n_cache_hits`, `n_hops`) and of the recompute
+        (`n_recompute_rpcs` fetches, `n_recompute_requested` exact distances asked for, `n_recompute_cache_hits` of
+        them deduplicated, `n_recomputed` embeddings fetched, `n_recompute_skipped` left to PQ by the budget).
+        Empty before the first `batch_search`.
+        """
+        return self._index.get_last_batch_stats()
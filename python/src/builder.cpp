@@ -13,7 +13,7 @@ template <typename DT>
 void build_disk_index(const diskann::Metric metric, const std::string &data_file_path,
                       const std::string &index_prefix_path, const uint32_t complexity, const uint32_t graph_degree,
                       const double final_index_ram_limit, const double indexing_ram_budget, const uint32_t num_threads,
-                      const uint32_t pq_disk_bytes, const std::string &codebook_prefix)
+                      const uint32_t pq_disk_bytes, const std::string &codebook_prefix, const uint32_t nav_graph_points)
 {
     std::string params = std::to_string(graph_degree) + " " + std::to_string(complexity) + " " +
                          std::to_string(final_index_ram_limit) + " " + std::to_string(indexing_ram_budget) + " " +
@@ -23,16 +23,16 @@ void build_disk_index(const diskann::Metric metric, const std::string &data_file
     if (!codebook_prefix.empty())
         params = params + " " + codebook_prefix;
     diskann::build_disk_index<DT>(data_file_path.c_str(), index_prefix_path.c_str(), params.c_str(), metric, false,
-                                  codebook_prefix);
+                                  codebook_prefix, false, "", "", 0, 0, nav_graph_points);
 }
 
 template void build_disk_index<float>(diskann::Metric, const std::string &, const std::string &, uint32_t, uint32_t,
-                                      double, double, uint32_t, uint32_t, const std::string &);
+                                      double, double, uint32_t, uint32_t, const std::string &, uint32_t);
 
 template void build_disk_index<uint8_t>(diskann::Metric, const std::string &, const std::string &, uint32_t, uint32_t,
-                                        double, double, uint32_t, uint32_t, const std::string &);
+                                        double, double, uint32_t, uint32_t, const std::string &, uint32_t);
 template void build_disk_index<int8_t>(diskann::Metric, const std::string &, const std::string &, uint32_t, uint32_t,
-                                       double, double, uint32_t, uint32_t, const std::string &);
+                                       double, double, uint32_t, uint32_t, const std::string &, uint32_t);
 
 template <typename T, typename TagT, typename LabelT>
 std::string prepare_filtered_label_map(diskann::Index<T, TagT, LabelT> &index, const std::string &index_output_path,
@@ -44,7 +44,7 @@ template <typename T> inline void add_variant(py::module_ &m, const Variant &var
 {
     m.def(variant.disk_builder_name.c_str(), &diskannpy::build_disk_index<T>, "distance_metric"_a, "data_file_path"_a,
           "index_prefix_path"_a, "complexity"_a, "graph_degree"_a, "final_index_ram_limit"_a, "indexing_ram_budget"_a,
-          "num_threads"_a, "pq_disk_bytes"_a, "codebook_prefix"_a = "");
+          "num_threads"_a, "pq_disk_bytes"_a, "codebook_prefix"_a = "", "nav_graph_points"_a = 0);
 
     m.def(variant.memory_builder_name.c_str(), &diskannpy::build_memory_index<T>, "distance_metric"_a,
           "data_file_path"_a, "index_output_path"_a, "graph_degree"_a, "complexity"_a, "alpha"_a, "num_threads"_a,
@@ -87,19 +87,26 @@ template <typename T> inline void add_variant(py::module_ &m, const Variant &var
 
     py::class_<diskannpy::StaticDiskIndex<T>>(m, variant.static_disk_index_name.c_str())
         .def(py::init<const diskann::Metric, const std::string &, const uint32_t, const size_t, const uint32_t,
-                      const int, const std::string &, const std::string &>(),
+                      const int, const std::string &, const std::string &, const bool, const bool>(),
              "distance_metric"_a, "index_path_prefix"_a, "num_threads"_a, "num_nodes_to_cache"_a,
-             "cache_mechanism"_a = 1, "zmq_port"_a = 5555, "pq_prefix"_a = "", "partition_prefix"_a)
+             "cache_mechanism"_a = 1, "zmq_port"_a = 5555, "pq_prefix"_a = "", "partition_prefix"_a,
+             "mmap_pq_data"_a = false, "use_hugepages"_a = false)
         .def("cache_bfs_levels", &diskannpy::StaticDiskIndex<T>::cache_bfs_levels, "num_nodes_to_cache"_a)
         .def("search", &diskannpy::StaticDiskIndex<T>::search, "query"_a, "knn"_a, "complexity"_a, "beam_width"_a,
              "USE_DEFERRED_FETCH"_a = false, "skip_search_reorder"_a = false, "recompute_beighbor_embeddings"_a = false,
-             "dedup_node_dis"_a = false, "prune_ratio"_a = 0, "batch_recompute"_a = false, "global_pruning"_a = false)
+             "dedup_node_dis"_a = false, "prune_ratio"_a = 0, "batch_recompute"_a = false, "global_pruning"_a = false,
+             "recompute_budget"_a = 0)
         .def("batch_search", &diskannpy::StaticDiskIndex<T>::batch_search, "queries"_a, "num_queries"_a, "knn"_a,
              "complexity"_a, "beam_width"_a, "num_threads"_a, "USE_DEFERRED_FETCH"_a = false,
              "skip_search_reorder"_a = false, "recompute_beighbor_embeddings"_a = false, "dedup_node_dis"_a = false,
-             "prune_ratio"_a = 0, "batch_recompute"_a = false, "global_pruning"_a = false)
+             "prune_ratio"_a = 0, "batch_recompute"_a = false, "global_pruning"_a = false, "recompute_budget"_a = 0)
+        .def("get_last_batch_stats", &diskannpy::StaticDiskIndex<T>::get_last_batch_stats)
         .def("get_zmq_port", &diskannpy::StaticDiskIndex<T>::get_zmq_port)
-        .def("set_zmq_port", &diskannpy::StaticDiskIndex<T>::set_zmq_port, "port"_a);
+        .def("set_zmq_port", &diskannpy::StaticDiskIndex<T>::set_zmq_port, "port"_a)
+        .def("get_embedding_endpoint", &diskannpy::StaticDiskIndex<T>::get_embedding_endpoint)
+        .def("set_embedding_endpoint", &diskannpy::StaticDiskIndex<T>::set_embedding_endpoint, "endpoint"_a)
+        .def("set_embedding_coalescing", &diskannpy::StaticDiskIndex<T>::set_embedding_coalescing, "window_us"_a,
+             "max_batch_size"_a = 4096);
 }
 
 PYBIND11_MODULE(_diskannpy, m)
@@ -12,12 +12,15 @@ template <typename DT>
 StaticDiskIndex<DT>::StaticDiskIndex(const diskann::Metric metric, const std::string &index_path_prefix,
                                      const uint32_t num_threads, const size_t num_nodes_to_cache,
                                      const uint32_t cache_mechanism, const int zmq_port,
-                                     const std::string &pq_prefix, const std::string &partition_prefix)
+                                     const std::string &pq_prefix, const std::string &partition_prefix,
+                                     const bool mmap_pq_data, const bool use_hugepages)
     : _reader(std::make_shared<PlatformSpecificAlignedFileReader>()),
       _graph_reader(std::make_shared<PlatformSpecificAlignedFileReader>()), _index(_reader, _graph_reader, metric)
 {
     std::cout << "Before index load" << std::endl;
 
+    _index.set_memory_options(mmap_pq_data, use_hugepages);
+
     const uint32_t _num_threads = num_threads != 0 ? num_threads : omp_get_num_procs();
     int load_success =
         _index.load(_num_threads, index_path_prefix.c_str(), zmq_port, pq_prefix.c_str(), partition_prefix.c_str());
@@ -64,7 +67,7 @@ NeighborsAndDistances<StaticIdType> StaticDiskIndex<DT>::search(
     py::array_t<DT, py::array::c_style | py::array::forcecast> &query, const uint64_t knn, const uint64_t complexity,
     const uint64_t beam_width, const bool USE_DEFERRED_FETCH, const bool skip_search_reorder,
     const bool recompute_beighbor_embeddings, const bool dedup_node_dis, const float prune_ratio,
-    const bool batch_recompute, const bool global_pruning)
+    const bool batch_recompute, const bool global_pruning, const uint32_t recompute_budget)
 {
     py::array_t<StaticIdType> ids(knn);
     py::array_t<float> dists(knn);
@@ -75,7 +78,7 @@ NeighborsAndDistances<StaticIdType> StaticDiskIndex<DT>::search(
 
     _index.cached_beam_search(query.data(), knn, complexity, u64_ids.data(), dists.mutable_data(), beam_width, false,
                               &stats, USE_DEFERRED_FETCH, skip_search_reorder, recompute_beighbor_embeddings,
-                              dedup_node_dis, prune_ratio, batch_recompute, global_pruning);
+                              dedup_node_dis, prune_ratio, batch_recompute, global_pruning, recompute_budget);
 
     auto r = ids.mutable_unchecked<1>();
     for (uint64_t i = 0; i < knn; ++i)
@@ -89,7 +92,7 @@ NeighborsAndDistances<StaticIdType> StaticDiskIndex<DT>::batch_search(
     py::array_t<DT, py::array::c_style | py::array::forcecast> &queries, const uint64_t num_queries, const uint64_t knn,
     const uint64_t complexity, const uint64_t beam_width, const uint32_t num_threads, const bool USE_DEFERRED_FETCH,
     const bool skip_search_reorder, const bool recompute_beighbor_embeddings, const bool dedup_node_dis,
-    const float prune_ratio, const bool batch_recompute, const bool global_pruning)
+    const float prune_ratio, const bool batch_recompute, const bool global_pruning, const uint32_t recompute_budget)
 {
     py::array_t<StaticIdType> ids({num_queries, knn});
     py::array_t<float> dists({num_queries, knn});
@@ -97,18 +100,42 @@ NeighborsAndDistances<StaticIdType> StaticDiskIndex<DT>::batch_search(
     omp_set_num_threads(num_threads);
 
     std::vector<uint64_t> u64_ids(knn * num_queries);
+    std::vector<diskann::QueryStats> stats(num_queries);
 
 #pragma omp parallel for schedule(dynamic, 1) default(none)                                                            \
     shared(num_queries, queries, knn, complexity, u64_ids, dists, beam_width, USE_DEFERRED_FETCH, skip_search_reorder, \
-               recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute, global_pruning)
+               recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute, global_pruning,            \
+               recompute_budget, stats)
     for (int64_t i = 0; i < (int64_t)num_queries; i++)
     {
         _index.cached_beam_search(queries.data(i), knn, complexity, u64_ids.data() + i * knn, dists.mutable_data(i),
-                                  beam_width, false, nullptr, USE_DEFERRED_FETCH, skip_search_reorder,
+                                  beam_width, false, stats.data() + i, USE_DEFERRED_FETCH, skip_search_reorder,
                                   recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute,
-                                  global_pruning);
+                                  global_pruning, recompute_budget);
     }
 
+    const std::map<std::string, std::function<double(const diskann::QueryStats &)>> stat_fns = {
+        {"total_us", [](const diskann::QueryStats &s) { return s.total_us; }},
+        {"io_us", [](const diskann::QueryStats &s) { return s.io_us; }},
+        {"cpu_us", [](const diskann::QueryStats &s) { return s.cpu_us; }},
+        {"n_ios", [](const diskann::QueryStats &s) { return s.n_ios; }},
+        {"n_cmps", [](const diskann::QueryStats &s) { return s.n_cmps; }},
+        {"n_cache_hits", [](const diskann::QueryStats &s) { return s.n_cache_hits; }},
+        {"n_hops", [](const diskann::QueryStats &s) { return s.n_hops; }},
+        {"n_recompute_rpcs", [](const diskann::QueryStats &s) { return s.n_recompute_rpcs; }},
+        {"n_recompute_requested", [](const diskann::QueryStats &s) { return s.n_recompute_requested; }},
+        {"n_recomputed", [](const diskann::QueryStats &s) { return s.n_recomputed; }},
+        {"n_recompute_cache_hits", [](const diskann::QueryStats &s) { return s.n_recompute_cache_hits; }},
+        {"n_recompute_skipped", [](const diskann::QueryStats &s) { return s.n_recompute_skipped; }},
+        {"recompute_rpc_us", [](const diskann::QueryStats &s) { return s.recompute_rpc_us; }},
+        {"preprocess_us", [](const diskann::QueryStats &s) { return s.preprocess_us; }},
+        {"pq_us", [](const diskann::QueryStats &s) { return s.pq_us; }},
+        {"rerank_us", [](const diskann::QueryStats &s) { return s.rerank_us; }},
+    };
+    _last_batch_stats.clear();
+    for (const auto &stat_fn : stat_fns)
+        _last_batch_stats[stat_fn.first] = diskann::get_mean_stats<double>(stats.data(), num_queries, stat_fn.second);
+
     auto r = ids.mutable_unchecked();
     for (uint64_t i = 0; i < num_queries; ++i)
         for (uint64_t j = 0; j < knn; ++j)
@@ -117,6 +144,11 @@ NeighborsAndDistances<StaticIdType> StaticDiskIndex<DT>::batch_search(
     return std::make_pair(ids, dists);
 }
 
+template <typename DT> std::map<std::string, double> StaticDiskIndex<DT>::get_last_batch_stats() const
+{
+    return _last_batch_stats;
+}
+
 template <typename DT>
 int StaticDiskIndex<DT>::get_zmq_port() const
 {
@@ -129,6 +161,24 @@ void StaticDiskIndex<DT>::set_zmq_port(int port)
     _index._zmq_port = port;
 }
 
+template <typename DT>
+std::string StaticDiskIndex<DT>::get_embedding_endpoint() const
+{
+    return _index._embedding_endpoint;
+}
+
+template <typename DT>
+void StaticDiskIndex<DT>::set_embedding_endpoint(const std::string &endpoint)
+{
+    _index._embedding_endpoint = endpoint;
+}
+
+template <typename DT>
+void StaticDiskIndex<DT>::set_embedding_coalescing(uint32_t window_us, uint32_t max_batch_size)
+{
+    _index.set_embedding_coalescing(window_us, max_batch_size);
+}
+
 template class StaticDiskIndex<float>;
 template class StaticDiskIndex<uint8_t>;
 template class StaticDiskIndex<int8_t>;
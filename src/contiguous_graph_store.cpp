@@ -0,0 +1,306 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+#include <thread>
+
+#include "contiguous_graph_store.h"
+#include "utils.h"
+
+namespace diskann
+{
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "rows keep atomics in uint32 slots");
+
+// rows are padded to whole cache lines
+static const size_t ROW_ALIGNMENT = 64;
+
+ContiguousGraphStore::ContiguousGraphStore(const size_t total_pts, const size_t reserve_graph_degree)
+    : AbstractGraphStore(total_pts, reserve_graph_degree)
+{
+    reallocate(total_pts, reserve_graph_degree);
+}
+
+ContiguousGraphStore::~ContiguousGraphStore()
+{
+    aligned_free(_slab);
+}
+
+std::tuple<uint32_t, uint32_t, size_t> ContiguousGraphStore::load(const std::string &index_path_prefix,
+                                                                  const size_t num_points)
+{
+    return load_impl(index_path_prefix, num_points);
+}
+
+int ContiguousGraphStore::store(const std::string &index_path_prefix, const size_t num_points,
+                                const size_t num_frozen_points, const uint32_t start)
+{
+    return save_graph(index_path_prefix, num_points, num_frozen_points, start);
+}
+
+NeighbourList ContiguousGraphStore::get_neighbours(const location_t i) const
+{
+    if (i >= get_total_points())
+        throw ANNException("Error: location out of range of the graph.", -1, __FUNCSIG__, __FILE__, __LINE__);
+    return NeighbourList(neighbours(i), degree(i).load(std::memory_order_acquire));
+}
+
+void ContiguousGraphStore::add_neighbour(const location_t i, location_t neighbour_id)
+{
+    uint32_t k = degree(i).load(std::memory_order_relaxed);
+    if (k >= _slots)
+    {
+        throw ANNException("Error: node " + std::to_string(i) + " has no free neighbour slot.", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
+    // appending does not touch the first k neighbours, publishing the new one
+    // before the degree is enough for readers
+    neighbours(i)[k] = neighbour_id;
+    degree(i).store(k + 1, std::memory_order_release);
+    update_max_observed_degree(k + 1);
+}
+
+void ContiguousGraphStore::clear_neighbours(const location_t i)
+{
+    begin_write(i);
+    degree(i).store(0, std::memory_order_relaxed);
+    end_write(i);
+}
+
+void ContiguousGraphStore::swap_neighbours(const location_t a, location_t b)
+{
+    if (a == b)
+        return;
+    uint32_t k_a = degree(a).load(std::memory_order_relaxed);
+    uint32_t k_b = degree(b).load(std::memory_order_relaxed);
+    std::vector<location_t> tmp(neighbours(a), neighbours(a) + k_a);
+
+    begin_write(a);
+    begin_write(b);
+    std::memcpy(neighbours(a), neighbours(b), k_b * sizeof(location_t));
+    std::memcpy(neighbours(b), tmp.data(), k_a * sizeof(location_t));
+    degree(a).store(k_b, std::memory_order_relaxed);
+    degree(b).store(k_a, std::memory_order_relaxed);
+    end_write(b);
+    end_write(a);
+}
+
+void ContiguousGraphStore::set_neighbours(const location_t i, std::vector<location_t> &neighbors)
+{
+    if (neighbors.size() > _slots)
+    {
+        throw ANNException("Error: " + std::to_string(neighbors.size()) + " neighbours for node " +
+                               std::to_string(i) + " exceed the " + std::to_string(_slots) + " slots per node.",
+                           -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    begin_write(i);
+    std::memcpy(neighbours(i), neighbors.data(), neighbors.size() * sizeof(location_t));
+    degree(i).store((uint32_t)neighbors.size(), std::memory_order_relaxed);
+    end_write(i);
+    update_max_observed_degree((uint32_t)neighbors.size());
+}
+
+void ContiguousGraphStore::get_neighbours_snapshot(const location_t i, std::vector<location_t> &out) const
+{
+    if (i >= get_total_points())
+        throw ANNException("Error: location out of range of the graph.", -1, __FUNCSIG__, __FILE__, __LINE__);
+    while (true)
+    {
+        uint32_t before = version(i).load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t k = degree(i).load(std::memory_order_acquire);
+        out.assign(neighbours(i), neighbours(i) + (std::min)((size_t)k, _slots));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version(i).load(std::memory_order_relaxed) == before)
+            return;
+    }
+}
+
+bool ContiguousGraphStore::lock_free_reads() const
+{
+    return true;
+}
+
+size_t ContiguousGraphStore::resize_graph(const size_t new_size)
+{
+    reallocate(new_size, _slots);
+    set_total_points(new_size);
+    return new_size;
+}
+
+void ContiguousGraphStore::clear_graph()
+{
+    if (_slab != nullptr)
+        std::memset(_slab, 0, get_total_points() * _row_stride * sizeof(uint32_t));
+    _max_observed_degree = 0;
+}
+
+size_t ContiguousGraphStore::get_slots_per_node() const
+{
+    return _slots;
+}
+
+void ContiguousGraphStore::reallocate(const size_t num_points, const size_t slots)
+{
+    size_t row_stride = ROUND_UP((ROW_HEADER + slots) * sizeof(uint32_t), ROW_ALIGNMENT) / sizeof(uint32_t);
+    uint32_t *slab = nullptr;
+    if (num_points > 0)
+    {
+        alloc_aligned((void **)&slab, num_points * row_stride * sizeof(uint32_t), ROW_ALIGNMENT);
+        std::memset(slab, 0, num_points * row_stride * sizeof(uint32_t));
+    }
+
+    if (_slab != nullptr)
+    {
+        size_t rows = (std::min)(num_points, get_total_points());
+        size_t copy_len = (std::min)(row_stride, _row_stride);
+        for (size_t i = 0; i < rows; i++)
+        {
+            std::memcpy(slab + i * row_stride, _slab + i * _row_stride, copy_len * sizeof(uint32_t));
+            uint32_t &k = slab[i * row_stride + 1];
+            k = (uint32_t)(std::min)((size_t)k, slots);
+        }
+        aligned_free(_slab);
+    }
+
+    _slab = slab;
+    _slots = slots;
+    _row_stride = row_stride;
+}
+
+void ContiguousGraphStore::begin_write(const location_t i)
+{
+    std::atomic<uint32_t> &v = version(i);
+    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ContiguousGraphStore::end_write(const location_t i)
+{
+    std::atomic<uint32_t> &v = version(i);
+    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void ContiguousGraphStore::update_max_observed_degree(const uint32_t new_degree)
+{
+    uint32_t current = _max_observed_degree.load(std::memory_order_relaxed);
+    while (current < new_degree && !_max_observed_degree.compare_exchange_weak(current, new_degree))
+    {
+    }
+}
+
+std::tuple<uint32_t, uint32_t, size_t> ContiguousGraphStore::load_impl(const std::string &filename,
+                                                                       size_t expected_num_points)
+{
+    size_t expected_file_size;
+    size_t file_frozen_pts;
+    uint32_t start;
+    uint32_t file_max_degree;
+
+    std::ifstream in;
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+    in.open(filename, std::ios::binary);
+    in.read((char *)&expected_file_size, sizeof(size_t));
+    in.read((char *)&file_max_degree, sizeof(uint32_t));
+    in.read((char *)&start, sizeof(uint32_t));
+    in.read((char *)&file_frozen_pts, sizeof(size_t));
+    size_t vamana_metadata_size = sizeof(size_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(size_t);
+
+    diskann::cout << "From graph header, expected_file_size: " << expected_file_size
+                  << ", _max_observed_degree: " << file_max_degree << ", _start: " << start
+                  << ", file_frozen_pts: " << file_frozen_pts << std::endl;
+
+    diskann::cout << "Loading vamana graph " << filename << "..." << std::flush;
+
+    // Lay the slab out for the larger of the two before reading, so that the
+    // lists are read straight into their rows.
+    if (get_total_points() < expected_num_points || _slots < file_max_degree)
+    {
+        reallocate((std::max)(get_total_points(), expected_num_points), (std::max)(_slots, (size_t)file_max_degree));
+        set_total_points((std::max)(get_total_points(), expected_num_points));
+    }
+
+    size_t bytes_read = vamana_metadata_size;
+    size_t cc = 0;
+    uint32_t nodes_read = 0;
+    uint32_t max_degree = 0;
+    while (bytes_read != expected_file_size)
+    {
+        uint32_t k;
+        in.read((char *)&k, sizeof(uint32_t));
+
+        if (k == 0)
+        {
+            diskann::cerr << "ERROR: Point found with no out-neighbours, point#" << nodes_read << std::endl;
+        }
+        if (nodes_read >= get_total_points())
+        {
+            throw ANNException("Error: graph file " + filename + " has more than " +
+                                   std::to_string(get_total_points()) + " points.",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        // the header degree may be stale in files written by other tools
+        if (k > _slots)
+            reallocate(get_total_points(), k);
+
+        in.read((char *)neighbours(nodes_read), k * sizeof(uint32_t));
+        degree(nodes_read).store(k, std::memory_order_relaxed);
+        cc += k;
+        ++nodes_read;
+        bytes_read += sizeof(uint32_t) * ((size_t)k + 1);
+        if (nodes_read % 10000000 == 0)
+            diskann::cout << "." << std::flush;
+        max_degree = (std::max)(max_degree, k);
+    }
+    _max_range_of_graph = (std::max)(_max_range_of_graph, (size_t)max_degree);
+    _max_observed_degree = (std::max)(file_max_degree, max_degree);
+
+    diskann::cout << "done. Index has " << nodes_read << " nodes and " << cc << " out-edges, _start is set to " << start
+                  << std::endl;
+    return std::make_tuple(nodes_read, start, file_frozen_pts);
+}
+
+int ContiguousGraphStore::save_graph(const std::string &index_path_prefix, const size_t num_points,
+                                     const size_t num_frozen_points, const uint32_t start)
+{
+    std::ofstream out;
+    open_file_to_write(out, index_path_prefix);
+
+    size_t index_size = 24;
+    uint32_t max_degree = 0;
+    out.write((char *)&index_size, sizeof(uint64_t));
+    out.write((char *)&max_degree, sizeof(uint32_t));
+    out.write((char *)&start, sizeof(uint32_t));
+    out.write((char *)&num_frozen_points, sizeof(size_t));
+
+    // Note: num_points = _nd + _num_frozen_points
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        uint32_t k = degree(i).load(std::memory_order_relaxed);
+        out.write((char *)&k, sizeof(uint32_t));
+        out.write((char *)neighbours(i), k * sizeof(uint32_t));
+        max_degree = (std::max)(max_degree, k);
+        index_size += (size_t)(sizeof(uint32_t) * (k + 1));
+    }
+    out.seekp(0, out.beg);
+    out.write((char *)&index_size, sizeof(uint64_t));
+    out.write((char *)&max_degree, sizeof(uint32_t));
+    out.close();
+    return (int)index_size;
+}
+
+size_t ContiguousGraphStore::get_max_range_of_graph()
+{
+    return _max_range_of_graph;
+}
+
+uint32_t ContiguousGraphStore::get_max_observed_degree()
+{
+    return _max_observed_degree;
+}
+
+} // namespace diskann
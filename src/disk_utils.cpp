@@ -2,6 +2,10 @@
 // Licensed under the MIT license.
 
 #include "common_includes.h"
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #if defined(DISKANN_RELEASE_UNUSED_TCMALLOC_MEMORY_AT_CHECKPOINTS) && defined(DISKANN_BUILD)
 #include "gperftools/malloc_extension.h"
@@ -16,6 +20,7 @@
 #include "logger.h"
 #include "disk_utils.h"
 #include "cached_io.h"
+#include "filter_utils.h"
 #include "index.h"
 #include "omp.h"
 #include "percentile_stats.h"
@@ -243,10 +248,57 @@ void read_idmap(const std::string &fname, std::vector<uint32_t> &ivecs)
     reader.close();
 }
 
+void prune_neighbors_with_pq_codes(const uint32_t node_id, std::vector<uint32_t> &nhood, const uint8_t *pq_codes,
+                                   const size_t pq_nchunks, const float *sdc_tables, const uint32_t max_degree,
+                                   const float alpha)
+{
+    auto pq_distance = [&](uint32_t a, uint32_t b) {
+        const uint8_t *code_a = pq_codes + (size_t)a * pq_nchunks;
+        const uint8_t *code_b = pq_codes + (size_t)b * pq_nchunks;
+        float dist = 0;
+        for (size_t c = 0; c < pq_nchunks; c++)
+            dist += sdc_tables[(256 * c + code_a[c]) * 256 + code_b[c]];
+        return dist;
+    };
+
+    // same occlusion rule as Index::occlude_list for L2
+    std::vector<Neighbor> pool;
+    pool.reserve(nhood.size());
+    for (auto nbr : nhood)
+        pool.emplace_back(nbr, pq_distance(node_id, nbr));
+    std::sort(pool.begin(), pool.end());
+    if (pool.size() > defaults::MAX_OCCLUSION_SIZE)
+        pool.resize(defaults::MAX_OCCLUSION_SIZE);
+
+    nhood.clear();
+    std::vector<float> occlude_factor(pool.size(), 0.0f);
+    float cur_alpha = 1;
+    while (cur_alpha <= alpha && nhood.size() < max_degree)
+    {
+        for (size_t i = 0; nhood.size() < max_degree && i < pool.size(); i++)
+        {
+            if (occlude_factor[i] > cur_alpha)
+                continue;
+            occlude_factor[i] = std::numeric_limits<float>::max();
+            nhood.push_back(pool[i].id);
+            for (size_t j = i + 1; j < pool.size(); j++)
+            {
+                if (occlude_factor[j] > alpha)
+                    continue;
+                float djk = pq_distance(pool[j].id, pool[i].id);
+                occlude_factor[j] = (djk == 0) ? std::numeric_limits<float>::max()
+                                               : std::max(occlude_factor[j], pool[j].distance / djk);
+            }
+        }
+        cur_alpha *= 1.2f;
+    }
+}
+
 int merge_shards(const std::string &vamana_prefix, const std::string &vamana_suffix, const std::string &idmaps_prefix,
                  const std::string &idmaps_suffix, const uint64_t nshards, uint32_t max_degree,
                  const std::string &output_vamana, const std::string &medoids_file, bool use_filters,
-                 const std::string &labels_to_medoids_file)
+                 const std::string &labels_to_medoids_file, const std::string &pq_pivots_file,
+                 const std::string &pq_compressed_file, float prune_alpha)
 {
     // Read ID maps
     std::vector<std::string> vamana_names(nshards);
@@ -407,14 +459,91 @@ int merge_shards(const std::string &vamana_prefix, const std::string &vamana_suf
 
     diskann::cout << "Starting merge" << std::endl;
 
+    // Prune-on-merge: the union of the shard neighborhoods of a node is pruned
+    // with RobustPrune on symmetric PQ distances instead of being shuffled and
+    // truncated. Only the PQ codes and per chunk center-to-center distance
+    // tables are held in memory. Label aware pruning is not supported, so
+    // filtered merges keep the truncation.
+    const bool prune_on_merge = !pq_pivots_file.empty() && !pq_compressed_file.empty() && !use_filters;
+    std::unique_ptr<uint8_t[]> pq_codes;
+    std::vector<float> sdc_tables;
+    size_t pq_npts = 0, pq_nchunks = 0;
+    if (prune_on_merge)
+    {
+        uint8_t *codes = nullptr;
+        diskann::load_bin<uint8_t>(pq_compressed_file, codes, pq_npts, pq_nchunks);
+        pq_codes.reset(codes);
+        if (pq_npts < nnodes)
+        {
+            std::stringstream stream;
+            stream << "PQ compressed file " << pq_compressed_file << " has " << pq_npts << " points, expected "
+                   << nnodes << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        FixedChunkPQTable pq_table;
+        pq_table.load_pq_centroid_bin(pq_pivots_file.c_str(), pq_nchunks);
+        sdc_tables.resize(256 * 256 * pq_nchunks);
+        pq_table.populate_symmetric_chunk_distances(sdc_tables.data());
+        diskann::cout << "Pruning merged neighborhoods with alpha " << prune_alpha << " using " << pq_nchunks
+                      << " byte PQ codes" << std::endl;
+    }
+
     // Gopal. random_shuffle() is deprecated.
     std::random_device rng;
     std::mt19937 urng(rng());
 
+    // Neighborhoods are collected for a batch of nodes, pruned (or truncated)
+    // in parallel and written out in order.
+    const size_t merge_batch_size = 65536;
+    std::vector<uint32_t> batch_ids;
+    std::vector<std::vector<uint32_t>> batch_nhoods;
+    auto flush_batch = [&]() {
+        if (prune_on_merge)
+        {
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int64_t i = 0; i < (int64_t)batch_ids.size(); i++)
+                prune_neighbors_with_pq_codes(batch_ids[i], batch_nhoods[i], pq_codes.get(), pq_nchunks,
+                                              sdc_tables.data(), max_degree, prune_alpha);
+        }
+        else
+        {
+            for (auto &nhood : batch_nhoods)
+            {
+                // Gopal. random_shuffle() is deprecated.
+                std::shuffle(nhood.begin(), nhood.end(), urng);
+                nhood.resize((std::min)(nhood.size(), (size_t)max_degree));
+            }
+        }
+        for (size_t i = 0; i < batch_ids.size(); i++)
+        {
+            uint32_t nnbrs = (uint32_t)batch_nhoods[i].size();
+            // write into merged ofstream
+            merged_vamana_writer.write((char *)&nnbrs, sizeof(uint32_t));
+            if (nnbrs > 0)
+                merged_vamana_writer.write((char *)batch_nhoods[i].data(), nnbrs * sizeof(uint32_t));
+            merged_index_size += (sizeof(uint32_t) + nnbrs * sizeof(uint32_t));
+            if (batch_ids[i] % 499999 == 1)
+            {
+                diskann::cout << "." << std::flush;
+            }
+        }
+        batch_ids.clear();
+        batch_nhoods.clear();
+    };
+
     std::vector<bool> nhood_set(nnodes, 0);
     std::vector<uint32_t> final_nhood;
-
-    uint32_t nnbrs = 0, shard_nnbrs = 0;
+    auto finish_node = [&](uint32_t node_id) {
+        for (auto &p : final_nhood)
+            nhood_set[p] = 0;
+        batch_ids.push_back(node_id);
+        batch_nhoods.emplace_back(std::move(final_nhood));
+        final_nhood.clear();
+        if (batch_ids.size() == merge_batch_size)
+            flush_batch();
+    };
+
+    uint32_t shard_nnbrs = 0;
     uint32_t cur_id = 0;
     for (const auto &id_shard : node_shard)
     {
@@ -422,22 +551,8 @@ int merge_shards(const std::string &vamana_prefix, const std::string &vamana_suf
         uint32_t shard_id = id_shard.second;
         if (cur_id < node_id)
         {
-            // Gopal. random_shuffle() is deprecated.
-            std::shuffle(final_nhood.begin(), final_nhood.end(), urng);
-            nnbrs = (uint32_t)(std::min)(final_nhood.size(), (size_t)max_degree);
-            // write into merged ofstream
-            merged_vamana_writer.write((char *)&nnbrs, sizeof(uint32_t));
-            merged_vamana_writer.write((char *)final_nhood.data(), nnbrs * sizeof(uint32_t));
-            merged_index_size += (sizeof(uint32_t) + nnbrs * sizeof(uint32_t));
-            if (cur_id % 499999 == 1)
-            {
-                diskann::cout << "." << std::flush;
-            }
+            finish_node(cur_id);
             cur_id = node_id;
-            nnbrs = 0;
-            for (auto &p : final_nhood)
-                nhood_set[p] = 0;
-            final_nhood.clear();
         }
         // read from shard_id ifstream
         vamana_readers[shard_id].read((char *)&shard_nnbrs, sizeof(uint32_t));
@@ -460,20 +575,8 @@ int merge_shards(const std::string &vamana_prefix, const std::string &vamana_suf
             }
         }
     }
-
-    // Gopal. random_shuffle() is deprecated.
-    std::shuffle(final_nhood.begin(), final_nhood.end(), urng);
-    nnbrs = (uint32_t)(std::min)(final_nhood.size(), (size_t)max_degree);
-    // write into merged ofstream
-    merged_vamana_writer.write((char *)&nnbrs, sizeof(uint32_t));
-    if (nnbrs > 0)
-    {
-        merged_vamana_writer.write((char *)final_nhood.data(), nnbrs * sizeof(uint32_t));
-    }
-    merged_index_size += (sizeof(uint32_t) + nnbrs * sizeof(uint32_t));
-    for (auto &p : final_nhood)
-        nhood_set[p] = 0;
-    final_nhood.clear();
+    finish_node(cur_id);
+    flush_batch();
 
     diskann::cout << "Expected size: " << merged_index_size << std::endl;
 
@@ -497,99 +600,141 @@ void breakup_dense_points(const std::string data_file, const std::string labels_
                           const std::string out_data_file, const std::string out_labels_file,
                           const std::string out_metadata_file)
 {
-    std::string token, line;
-    std::ifstream labels_stream(labels_file);
-    T *data;
+    // The data and labels are streamed, only the parent of each dummy point
+    // is kept in memory. Labels of dummy points and the dummy vectors are
+    // staged in temporary files and appended after the original points.
+    const size_t read_blk_size = 64 * 1024 * 1024;
+    const std::string dummy_labels_file = out_labels_file + "_dummy.tmp";
+    const std::string dummy_data_file = out_data_file + "_dummy.tmp";
+
     size_t npts, ndims;
-    diskann::load_bin<T>(data_file, data, npts, ndims);
+    diskann::get_bin_metadata(data_file, npts, ndims);
 
-    std::unordered_map<uint32_t, uint32_t> dummy_pt_ids;
-    uint32_t next_dummy_id = (uint32_t)npts;
+    std::string token, line;
+    std::ifstream labels_stream(labels_file);
 
+    // dummy_parents[i] is the real point of dummy point npts + i
+    std::vector<uint32_t> dummy_parents;
     uint32_t point_cnt = 0;
-
-    std::vector<std::vector<uint32_t>> labels_per_point;
-    labels_per_point.resize(npts);
-
     uint32_t dense_pts = 0;
-    if (labels_stream.is_open())
     {
-        while (getline(labels_stream, line))
+        std::ofstream label_writer(out_labels_file);
+        std::ofstream dummy_label_writer(dummy_labels_file);
+        assert(label_writer.is_open() && dummy_label_writer.is_open());
+        if (labels_stream.is_open())
         {
-            std::stringstream iss(line);
-            uint32_t lbl_cnt = 0;
-            uint32_t label_host = point_cnt;
-            while (getline(iss, token, ','))
+            while (getline(labels_stream, line))
             {
-                if (lbl_cnt == density)
+                if (point_cnt >= npts)
                 {
-                    if (label_host == point_cnt)
-                        dense_pts++;
-                    label_host = next_dummy_id;
-                    labels_per_point.resize(next_dummy_id + 1);
-                    dummy_pt_ids[next_dummy_id] = (uint32_t)point_cnt;
-                    next_dummy_id++;
-                    lbl_cnt = 0;
+                    dummy_label_writer.close();
+                    std::remove(dummy_labels_file.c_str());
+                    std::stringstream stream;
+                    stream << "Labels file " << labels_file << " has more lines than the " << npts << " points in "
+                           << data_file << std::endl;
+                    throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
                 }
-                token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
-                token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
-                uint32_t token_as_num = std::stoul(token);
-                labels_per_point[label_host].push_back(token_as_num);
-                lbl_cnt++;
+                std::stringstream iss(line);
+                uint32_t lbl_cnt = 0;
+                bool is_dummy = false;
+                while (getline(iss, token, ','))
+                {
+                    if (lbl_cnt == density)
+                    {
+                        if (!is_dummy)
+                        {
+                            dense_pts++;
+                            label_writer << std::endl;
+                        }
+                        else
+                        {
+                            dummy_label_writer << std::endl;
+                        }
+                        is_dummy = true;
+                        dummy_parents.push_back(point_cnt);
+                        lbl_cnt = 0;
+                    }
+                    token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
+                    token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
+                    uint32_t token_as_num = std::stoul(token);
+                    std::ofstream &writer = is_dummy ? dummy_label_writer : label_writer;
+                    if (lbl_cnt != 0)
+                        writer << ",";
+                    writer << token_as_num;
+                    lbl_cnt++;
+                }
+                (is_dummy ? dummy_label_writer : label_writer) << std::endl;
+                point_cnt++;
             }
-            point_cnt++;
         }
+        // points without a line in the labels file get no labels
+        for (; point_cnt < npts; point_cnt++)
+            label_writer << std::endl;
+        dummy_label_writer.close();
+
+        std::ifstream dummy_label_reader(dummy_labels_file);
+        label_writer << dummy_label_reader.rdbuf();
+        label_writer.close();
     }
+    std::remove(dummy_labels_file.c_str());
+
     diskann::cout << "fraction of dense points with >= " << density << " labels = " << (float)dense_pts / (float)npts
                   << std::endl;
+    diskann::cout << npts + dummy_parents.size() << " is the new number of points" << std::endl;
 
-    if (labels_per_point.size() != 0)
+    if (dummy_parents.size() != 0)
     {
-        diskann::cout << labels_per_point.size() << " is the new number of points" << std::endl;
-        std::ofstream label_writer(out_labels_file);
-        assert(label_writer.is_open());
-        for (uint32_t i = 0; i < labels_per_point.size(); i++)
-        {
-            for (uint32_t j = 0; j < (labels_per_point[i].size() - 1); j++)
-            {
-                label_writer << labels_per_point[i][j] << ",";
-            }
-            if (labels_per_point[i].size() != 0)
-                label_writer << labels_per_point[i][labels_per_point[i].size() - 1];
-            label_writer << std::endl;
-        }
-        label_writer.close();
+        diskann::cout << dummy_parents.size() << " is the number of dummy points created" << std::endl;
+        std::ofstream dummy_writer(out_metadata_file);
+        assert(dummy_writer.is_open());
+        for (size_t i = 0; i < dummy_parents.size(); i++)
+            dummy_writer << npts + i << "," << dummy_parents[i] << std::endl;
+        dummy_writer.close();
     }
 
-    if (dummy_pt_ids.size() != 0)
+    // Copy the vectors block by block. Dummy points are created in the order
+    // of their parents, so their vectors can be collected in the same pass.
+    const size_t vec_size = ndims * sizeof(T);
+    const size_t block_pts = (std::max)((size_t)1, read_blk_size / vec_size);
+    const uint32_t new_npts = (uint32_t)(npts + dummy_parents.size());
+    const uint32_t ndims_u32 = (uint32_t)ndims;
     {
-        diskann::cout << dummy_pt_ids.size() << " is the number of dummy points created" << std::endl;
-
-        T *ptr = (T *)std::realloc((void *)data, labels_per_point.size() * ndims * sizeof(T));
-        if (ptr == nullptr)
+        cached_ifstream reader(data_file, read_blk_size);
+        cached_ofstream writer(out_data_file, read_blk_size);
+        std::unique_ptr<cached_ofstream> dummy_writer;
+        if (dummy_parents.size() != 0)
+            dummy_writer = std::make_unique<cached_ofstream>(dummy_data_file, read_blk_size);
+
+        uint32_t tmp;
+        reader.read((char *)&tmp, sizeof(uint32_t));
+        reader.read((char *)&tmp, sizeof(uint32_t));
+        writer.write((char *)&new_npts, sizeof(uint32_t));
+        writer.write((char *)&ndims_u32, sizeof(uint32_t));
+
+        std::unique_ptr<T[]> block = std::make_unique<T[]>(block_pts * ndims);
+        size_t next_dummy = 0;
+        for (size_t start = 0; start < npts; start += block_pts)
         {
-            diskann::cerr << "Realloc failed while creating dummy points" << std::endl;
-            free(data);
-            data = nullptr;
-            throw new diskann::ANNException("Realloc failed while expanding data.", -1, __FUNCTION__, __FILE__,
-                                            __LINE__);
+            size_t cur_pts = (std::min)(block_pts, npts - start);
+            reader.read((char *)block.get(), cur_pts * vec_size);
+            writer.write((char *)block.get(), cur_pts * vec_size);
+            for (; next_dummy < dummy_parents.size() && dummy_parents[next_dummy] < start + cur_pts; next_dummy++)
+                dummy_writer->write((char *)(block.get() + (dummy_parents[next_dummy] - start) * ndims), vec_size);
         }
-        else
+        if (dummy_writer != nullptr)
         {
-            data = ptr;
-        }
-
-        std::ofstream dummy_writer(out_metadata_file);
-        assert(dummy_writer.is_open());
-        for (auto i = dummy_pt_ids.begin(); i != dummy_pt_ids.end(); i++)
-        {
-            dummy_writer << i->first << "," << i->second << std::endl;
-            std::memcpy(data + i->first * ndims, data + i->second * ndims, ndims * sizeof(T));
+            dummy_writer->close();
+            cached_ifstream dummy_reader(dummy_data_file, read_blk_size);
+            for (size_t start = 0; start < dummy_parents.size(); start += block_pts)
+            {
+                size_t cur_pts = (std::min)(block_pts, dummy_parents.size() - start);
+                dummy_reader.read((char *)block.get(), cur_pts * vec_size);
+                writer.write((char *)block.get(), cur_pts * vec_size);
+            }
         }
-        dummy_writer.close();
+        writer.close();
     }
-
-    diskann::save_bin<T>(out_data_file, data, labels_per_point.size(), ndims);
+    std::remove(dummy_data_file.c_str());
 }
 
 void extract_shard_labels(const std::string &in_label_file, const std::string &shard_ids_bin,
@@ -629,13 +774,144 @@ void extract_shard_labels(const std::string &in_label_file, const std::string &s
         delete[] ids;
 }
 
+void build_shards_in_groups(const std::vector<double> &shard_ram, const double ram_budget_bytes,
+                            const uint32_t total_threads, const std::function<void(int)> &prepare_shard,
+                            const std::function<void(int, uint32_t)> &build_shard)
+{
+    const int num_parts = (int)shard_ram.size();
+    if (num_parts == 0)
+        return;
+
+    // a build task marks its shard finished and wakes the scheduler, whether
+    // the build succeeded or threw
+    std::mutex finished_mutex;
+    std::condition_variable finished_cv;
+    std::vector<bool> finished(num_parts, false);
+    auto run_shard = [&](int p, uint32_t shard_threads) {
+        auto mark_finished = [&]() {
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            finished[p] = true;
+            finished_cv.notify_one();
+        };
+        try
+        {
+            build_shard(p, shard_threads);
+        }
+        catch (...)
+        {
+            mark_finished();
+            throw;
+        }
+        mark_finished();
+    };
+
+    struct RunningShard
+    {
+        int shard;
+        double ram;
+        uint32_t threads;
+        std::future<void> done;
+    };
+
+    // declared after everything the tasks reference, so that on an exception
+    // the futures wait for the running tasks before those are destroyed
+    std::vector<std::future<void>> prepared(num_parts);
+    std::vector<RunningShard> building;
+    double reserved_ram = 0;
+    uint32_t free_threads = total_threads;
+    int next_shard = 0;
+    prepared[0] = std::async(std::launch::async, prepare_shard, 0);
+    while (next_shard < num_parts || !building.empty())
+    {
+        // release the memory and threads of shards that are built and saved
+        for (size_t i = 0; i < building.size();)
+        {
+            {
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                if (!finished[building[i].shard])
+                {
+                    i++;
+                    continue;
+                }
+            }
+            building[i].done.get();
+            reserved_ram -= building[i].ram;
+            free_threads += building[i].threads;
+            building.erase(building.begin() + i);
+        }
+
+        if (next_shard < num_parts && free_threads > 0)
+        {
+            // the consecutive shards that fit in the remaining budget, at most
+            // one per free thread, a shard over the budget is still built when
+            // nothing else is running
+            int group_end = next_shard;
+            double group_ram = 0;
+            while (group_end < num_parts && (uint32_t)(group_end - next_shard) < free_threads &&
+                   reserved_ram + group_ram + shard_ram[group_end] <= ram_budget_bytes)
+            {
+                group_ram += shard_ram[group_end];
+                group_end++;
+            }
+            if (group_end == next_shard && building.empty())
+            {
+                group_ram = shard_ram[next_shard];
+                group_end = next_shard + 1;
+            }
+
+            if (group_end > next_shard)
+            {
+#if defined(DISKANN_RELEASE_UNUSED_TCMALLOC_MEMORY_AT_CHECKPOINTS) && defined(DISKANN_BUILD)
+                MallocExtension::instance()->ReleaseFreeMemory();
+#endif
+                for (int p = next_shard; p < group_end; p++)
+                {
+                    if (!prepared[p].valid())
+                        prepared[p] = std::async(std::launch::async, prepare_shard, p);
+                }
+                for (int p = next_shard; p < group_end; p++)
+                    prepared[p].get();
+                if (group_end < num_parts)
+                    prepared[group_end] = std::async(std::launch::async, prepare_shard, group_end);
+
+                // the free threads are split between the shards of the group,
+                // the first ones get the remainder
+                const uint32_t group_size = (uint32_t)(group_end - next_shard);
+                diskann::cout << "Building shards [" << next_shard << ", " << group_end << ") concurrently with "
+                              << free_threads << " of " << total_threads << " threads" << std::endl;
+                for (int p = next_shard; p < group_end; p++)
+                {
+                    const uint32_t shard_threads =
+                        free_threads / group_size + ((uint32_t)(p - next_shard) < free_threads % group_size ? 1 : 0);
+                    building.push_back({p, shard_ram[p], shard_threads,
+                                        std::async(std::launch::async, run_shard, p, shard_threads)});
+                }
+                reserved_ram += group_ram;
+                free_threads = 0;
+                next_shard = group_end;
+                continue;
+            }
+        }
+
+        // nothing more can start until a running shard finishes, unless all
+        // of them are done
+        std::unique_lock<std::mutex> lock(finished_mutex);
+        finished_cv.wait(lock, [&]() {
+            return building.empty() ||
+                   std::any_of(building.begin(), building.end(),
+                               [&](const RunningShard &running) { return finished[running.shard]; });
+        });
+    }
+}
+
 template <typename T, typename LabelT>
 int build_merged_vamana_index(std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R,
                               double sampling_rate, double ram_budget, std::string mem_index_path,
                               std::string medoids_file, std::string centroids_file, size_t build_pq_bytes, bool use_opq,
                               uint32_t num_threads, bool use_filters, const std::string &label_file,
                               const std::string &labels_to_medoids_file, const std::string &universal_label,
-                              const uint32_t Lf)
+                              const uint32_t Lf, const std::string &pq_pivots_path,
+                              const std::string &pq_compressed_vectors_path)
 {
     size_t base_num, base_dim;
     diskann::get_bin_metadata(base_file, base_num, base_dim);
@@ -749,26 +1025,36 @@ int build_merged_vamana_index(std::string base_file, diskann::Metric compareMetr
     std::rename(cur_centroid_filepath.c_str(), centroids_file.c_str());
 
     timer.reset();
+    const double ram_budget_bytes = ram_budget * 1024 * 1024 * 1024;
+    const uint32_t total_threads = num_threads == 0 ? (uint32_t)omp_get_num_procs() : num_threads;
+    std::vector<double> shard_ram(num_parts);
     for (int p = 0; p < num_parts; p++)
     {
-#if defined(DISKANN_RELEASE_UNUSED_TCMALLOC_MEMORY_AT_CHECKPOINTS) && defined(DISKANN_BUILD)
-        MallocExtension::instance()->ReleaseFreeMemory();
-#endif
+        size_t shard_pts, shard_ids_dim;
+        get_bin_metadata(merged_index_prefix + "_subshard-" + std::to_string(p) + "_ids_uint32.bin", shard_pts,
+                         shard_ids_dim);
+        shard_ram[p] = estimate_ram_usage(shard_pts, (uint32_t)base_dim, sizeof(T), 2 * R / 3);
+    }
 
+    auto prepare_shard = [&](int p) {
         std::string shard_base_file = merged_index_prefix + "_subshard-" + std::to_string(p) + ".bin";
-
         std::string shard_ids_file = merged_index_prefix + "_subshard-" + std::to_string(p) + "_ids_uint32.bin";
-
         std::string shard_labels_file = merged_index_prefix + "_subshard-" + std::to_string(p) + "_labels.txt";
 
         retrieve_shard_data_from_ids<T>(base_file, shard_ids_file, shard_base_file);
+        if (use_filters)
+            diskann::extract_shard_labels(label_file, shard_ids_file, shard_labels_file);
+    };
 
+    auto build_shard = [&](int p, uint32_t shard_threads) {
+        std::string shard_base_file = merged_index_prefix + "_subshard-" + std::to_string(p) + ".bin";
+        std::string shard_labels_file = merged_index_prefix + "_subshard-" + std::to_string(p) + "_labels.txt";
         std::string shard_index_file = merged_index_prefix + "_subshard-" + std::to_string(p) + "_mem.index";
 
         diskann::IndexWriteParameters low_degree_params = diskann::IndexWriteParametersBuilder(L, 2 * R / 3)
                                                               .with_filter_list_size(Lf)
                                                               .with_saturate_graph(false)
-                                                              .with_num_threads(num_threads)
+                                                              .with_num_threads(shard_threads)
                                                               .build();
 
         size_t shard_base_dim, shard_base_pts;
@@ -784,7 +1070,6 @@ int build_merged_vamana_index(std::string base_file, diskann::Metric compareMetr
         }
         else
         {
-            diskann::extract_shard_labels(label_file, shard_ids_file, shard_labels_file);
             if (universal_label != "")
             { //  indicates no universal label
                 LabelT unv_label_as_num = 0;
@@ -814,13 +1099,15 @@ int build_merged_vamana_index(std::string base_file, diskann::Metric compareMetr
         }
 
         std::remove(shard_base_file.c_str());
-    }
+    };
+
+    build_shards_in_groups(shard_ram, ram_budget_bytes, total_threads, prepare_shard, build_shard);
     diskann::cout << timer.elapsed_seconds_for_step("building indices on shards") << std::endl;
 
     timer.reset();
     diskann::merge_shards(merged_index_prefix + "_subshard-", "_mem.index", merged_index_prefix + "_subshard-",
                           "_ids_uint32.bin", num_parts, R, mem_index_path, medoids_file, use_filters,
-                          labels_to_medoids_file);
+                          labels_to_medoids_file, pq_pivots_path, pq_compressed_vectors_path);
     diskann::cout << timer.elapsed_seconds_for_step("merging indices") << std::endl;
 
     // delete tempFiles
@@ -1160,11 +1447,65 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
     diskann::cout << "Output disk index file written to " << output_file << std::endl;
 }
 
+template <typename T>
+int build_navigation_graph(const std::string &base_file, const std::string &disk_index_path, const uint32_t num_points,
+                           const uint32_t R, const uint32_t L, const uint32_t num_threads)
+{
+    size_t base_num, base_dim;
+    diskann::get_bin_metadata(base_file, base_num, base_dim);
+    if (base_num == 0 || num_points == 0)
+        return -1;
+
+    std::string nav_graph_path = disk_index_path + "_nav_graph";
+    std::string sample_prefix = nav_graph_path + "_sample";
+    gen_random_slice<T>(base_file, sample_prefix, (std::min)(1.0, (double)num_points / (double)base_num));
+    size_t sample_num, sample_dim;
+    diskann::get_bin_metadata(sample_prefix + "_data.bin", sample_num, sample_dim);
+    if (sample_num == 0)
+    {
+        diskann::cout << "Sampled no points for the navigation graph, not building it" << std::endl;
+        std::remove((sample_prefix + "_data.bin").c_str());
+        std::remove((sample_prefix + "_ids.bin").c_str());
+        return -1;
+    }
+
+    // the base file is already transformed for L2, as for the disk graph
+    diskann::IndexWriteParameters paras =
+        diskann::IndexWriteParametersBuilder(L, R).with_num_threads(num_threads).build();
+    diskann::Index<T> nav_index(diskann::Metric::L2, base_dim, sample_num,
+                                std::make_shared<diskann::IndexWriteParameters>(paras), nullptr,
+                                defaults::NUM_FROZEN_POINTS_STATIC, false, false);
+    try
+    {
+        nav_index.build((sample_prefix + "_data.bin").c_str(), sample_num);
+        nav_index.save(nav_graph_path.c_str());
+    }
+    catch (const diskann::ANNException &e)
+    {
+        diskann::cerr << "Failed to build the navigation graph: " << e.what() << std::endl;
+        std::remove(nav_graph_path.c_str());
+        std::remove((nav_graph_path + ".data").c_str());
+        std::remove((nav_graph_path + ".tags").c_str());
+        std::remove((sample_prefix + "_data.bin").c_str());
+        std::remove((sample_prefix + "_ids.bin").c_str());
+        return -1;
+    }
+
+    // only the graph is kept, the search uses the in-memory PQ codes
+    std::remove((nav_graph_path + ".data").c_str());
+    std::remove((nav_graph_path + ".tags").c_str());
+    std::remove((sample_prefix + "_data.bin").c_str());
+    std::remove((nav_graph_path + "_ids.bin").c_str());
+    std::rename((sample_prefix + "_ids.bin").c_str(), (nav_graph_path + "_ids.bin").c_str());
+    diskann::cout << "Built navigation graph over " << sample_num << " points" << std::endl;
+    return 0;
+}
+
 template <typename T, typename LabelT>
 int build_disk_index(const char *dataFilePath, const char *indexFilePath, const char *indexBuildParameters,
                      diskann::Metric compareMetric, bool use_opq, const std::string &codebook_prefix, bool use_filters,
                      const std::string &label_file, const std::string &universal_label, const uint32_t filter_threshold,
-                     const uint32_t Lf)
+                     const uint32_t Lf, const uint32_t nav_graph_points)
 {
     std::stringstream parser;
     parser << std::string(indexBuildParameters);
@@ -1264,6 +1605,12 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         "_prepped_base.bin"; // temp file for storing pre-processed base file for cosine/ mips metrics
     bool created_temp_file_for_processed_data = false;
 
+    // load() uses a nav graph found next to the disk index, so one left by an
+    // earlier build at this prefix must not outlive this build
+    std::string nav_graph_path = disk_index_path + "_nav_graph";
+    std::remove(nav_graph_path.c_str());
+    std::remove((nav_graph_path + "_ids.bin").c_str());
+
     // output a new base file which contains extra dimension with sqrt(1 -
     // ||x||^2/M^2) for every x, M is max norm of all points. Extra space on
     // disk needed!
@@ -1359,9 +1706,7 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         if (filter_threshold != 0)
         {
             breakup_dense_points<T>(data_file_to_use, labels_file_to_use, filter_threshold, augmented_data_file,
-                                    augmented_labels_file,
-                                    dummy_remap_file); // RKNOTE: This has large memory footprint,
-                                                       // need to make this streaming
+                                    augmented_labels_file, dummy_remap_file);
             data_file_to_use = augmented_data_file;
             labels_file_to_use = augmented_labels_file;
         }
@@ -1411,7 +1756,8 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     diskann::build_merged_vamana_index<T, LabelT>(data_file_to_use.c_str(), diskann::Metric::L2, L, R, p_val,
                                                   indexing_ram_budget, mem_index_path, medoids_path, centroids_path,
                                                   build_pq_bytes, use_opq, num_threads, use_filters, labels_file_to_use,
-                                                  labels_to_medoids_path, universal_label, Lf);
+                                                  labels_to_medoids_path, universal_label, Lf, pq_pivots_path,
+                                                  pq_compressed_vectors_path);
     diskann::cout << timer.elapsed_seconds_for_step("building merged vamana index") << std::endl;
 
     timer.reset();
@@ -1434,6 +1780,17 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         ten_percent_points > MAX_SAMPLE_POINTS_FOR_WARMUP ? MAX_SAMPLE_POINTS_FOR_WARMUP : ten_percent_points;
     double sample_sampling_rate = num_sample_points / points_num;
     gen_random_slice<T>(data_file_to_use.c_str(), sample_base_prefix, sample_sampling_rate);
+    if (nav_graph_points > 0)
+    {
+        timer.reset();
+        if (build_navigation_graph<T>(data_file_to_use, disk_index_path, nav_graph_points, R, L, num_threads) != 0)
+        {
+            diskann::cerr << "Navigation graph not built, searches will start from the medoids" << std::endl;
+            std::remove(nav_graph_path.c_str());
+            std::remove((nav_graph_path + "_ids.bin").c_str());
+        }
+        diskann::cout << timer.elapsed_seconds_for_step("building navigation graph") << std::endl;
+    }
     if (use_filters)
     {
         copy_file(labels_file_to_use, disk_labels_file);
@@ -1446,6 +1803,7 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         std::remove(augmented_data_file.c_str());
         std::remove(augmented_labels_file.c_str());
         std::remove(labels_file_to_use.c_str());
+        convert_label_files_to_bin<LabelT>(disk_index_path);
     }
     if (created_temp_file_for_processed_data)
         std::remove(prepped_base.c_str());
@@ -1513,27 +1871,43 @@ template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<float, uint16_t>(
     std::unique_ptr<diskann::PQFlashIndex<float, uint16_t>> &pFlashIndex, float *tuning_sample,
     uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
 
+template DISKANN_DLLEXPORT int build_navigation_graph<int8_t>(const std::string &base_file,
+                                                              const std::string &disk_index_path,
+                                                              const uint32_t num_points, const uint32_t R,
+                                                              const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT int build_navigation_graph<uint8_t>(const std::string &base_file,
+                                                               const std::string &disk_index_path,
+                                                               const uint32_t num_points, const uint32_t R,
+                                                               const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT int build_navigation_graph<float>(const std::string &base_file,
+                                                             const std::string &disk_index_path,
+                                                             const uint32_t num_points, const uint32_t R,
+                                                             const uint32_t L, const uint32_t num_threads);
+
 template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                   const char *indexBuildParameters,
                                                                   diskann::Metric compareMetric, bool use_opq,
                                                                   const std::string &codebook_prefix, bool use_filters,
                                                                   const std::string &label_file,
                                                                   const std::string &universal_label,
-                                                                  const uint32_t filter_threshold, const uint32_t Lf);
+                                                                  const uint32_t filter_threshold, const uint32_t Lf,
+                                                                  const uint32_t nav_graph_points);
 template DISKANN_DLLEXPORT int build_disk_index<uint8_t, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                    const char *indexBuildParameters,
                                                                    diskann::Metric compareMetric, bool use_opq,
                                                                    const std::string &codebook_prefix, bool use_filters,
                                                                    const std::string &label_file,
                                                                    const std::string &universal_label,
-                                                                   const uint32_t filter_threshold, const uint32_t Lf);
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const uint32_t nav_graph_points);
 template DISKANN_DLLEXPORT int build_disk_index<float, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                  const char *indexBuildParameters,
                                                                  diskann::Metric compareMetric, bool use_opq,
                                                                  const std::string &codebook_prefix, bool use_filters,
                                                                  const std::string &label_file,
                                                                  const std::string &universal_label,
-                                                                 const uint32_t filter_threshold, const uint32_t Lf);
+                                                                 const uint32_t filter_threshold, const uint32_t Lf,
+                                                                 const uint32_t nav_graph_points);
 // LabelT = uint16
 template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                   const char *indexBuildParameters,
@@ -1541,51 +1915,60 @@ template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint16_t>(const char *da
                                                                   const std::string &codebook_prefix, bool use_filters,
                                                                   const std::string &label_file,
                                                                   const std::string &universal_label,
-                                                                  const uint32_t filter_threshold, const uint32_t Lf);
+                                                                  const uint32_t filter_threshold, const uint32_t Lf,
+                                                                  const uint32_t nav_graph_points);
 template DISKANN_DLLEXPORT int build_disk_index<uint8_t, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                    const char *indexBuildParameters,
                                                                    diskann::Metric compareMetric, bool use_opq,
                                                                    const std::string &codebook_prefix, bool use_filters,
                                                                    const std::string &label_file,
                                                                    const std::string &universal_label,
-                                                                   const uint32_t filter_threshold, const uint32_t Lf);
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const uint32_t nav_graph_points);
 template DISKANN_DLLEXPORT int build_disk_index<float, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                  const char *indexBuildParameters,
                                                                  diskann::Metric compareMetric, bool use_opq,
                                                                  const std::string &codebook_prefix, bool use_filters,
                                                                  const std::string &label_file,
                                                                  const std::string &universal_label,
-                                                                 const uint32_t filter_threshold, const uint32_t Lf);
+                                                                 const uint32_t filter_threshold, const uint32_t Lf,
+                                                                 const uint32_t nav_graph_points);
 
 template DISKANN_DLLEXPORT int build_merged_vamana_index<int8_t, uint32_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 template DISKANN_DLLEXPORT int build_merged_vamana_index<float, uint32_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 template DISKANN_DLLEXPORT int build_merged_vamana_index<uint8_t, uint32_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 // Label=16_t
 template DISKANN_DLLEXPORT int build_merged_vamana_index<int8_t, uint16_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 template DISKANN_DLLEXPORT int build_merged_vamana_index<float, uint16_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 template DISKANN_DLLEXPORT int build_merged_vamana_index<uint8_t, uint16_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
-    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf,
+    const std::string &pq_pivots_path, const std::string &pq_compressed_vectors_path);
 }; // namespace diskann
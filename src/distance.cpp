@@ -423,6 +423,11 @@ template <typename T> float DistanceFastL2<T>::compare(const T *a, const T *b, f
     return result;
 }
 
+template <typename T> float DistanceFastL2<T>::compare(const T *a, const T *b, uint32_t size) const
+{
+    return compare(a, b, norm(a, size), size) + norm(b, size);
+}
+
 template <typename T> float DistanceFastL2<T>::norm(const T *a, uint32_t size) const
 {
     if (!std::is_floating_point<T>::value)
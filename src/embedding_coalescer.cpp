@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <chrono>
+#include <cstring>
+
+#include "embedding_coalescer.h"
+#include "tsl/robin_map.h"
+
+namespace diskann
+{
+
+struct EmbeddingCoalescer::Batch
+{
+    // unique ids of the batch and their positions in it
+    std::vector<uint32_t> node_ids;
+    tsl::robin_map<uint32_t, uint32_t> positions;
+    std::vector<float> embeddings;
+    uint32_t dim = 0;
+
+    // signals the leader that the batch is full and the members that it is done
+    std::condition_variable cv;
+    bool closed = false;
+    bool done = false;
+    bool success = false;
+};
+
+EmbeddingCoalescer::EmbeddingCoalescer(FetchFunction fetch, uint32_t window_us, uint32_t max_batch_size)
+    : _fetch(std::move(fetch)), _window_us(window_us), _max_batch_size(max_batch_size)
+{
+}
+
+bool EmbeddingCoalescer::fetch(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                               uint32_t &dim)
+{
+    _num_requests++;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool leader = _open_batch == nullptr;
+    if (leader)
+        _open_batch = std::make_shared<Batch>();
+    std::shared_ptr<Batch> batch = _open_batch;
+
+    std::vector<uint32_t> positions(node_ids.size());
+    for (size_t i = 0; i < node_ids.size(); i++)
+    {
+        auto iter = batch->positions.find(node_ids[i]);
+        if (iter == batch->positions.end())
+        {
+            positions[i] = (uint32_t)batch->node_ids.size();
+            batch->positions[node_ids[i]] = positions[i];
+            batch->node_ids.push_back(node_ids[i]);
+        }
+        else
+        {
+            positions[i] = iter->second;
+        }
+    }
+    bool full = batch->node_ids.size() >= _max_batch_size;
+    if (full)
+    {
+        // no more requests for this batch, the next one opens a new batch
+        _open_batch = nullptr;
+        batch->closed = true;
+        if (!leader)
+            batch->cv.notify_all();
+    }
+
+    if (leader)
+    {
+        if (!batch->closed)
+        {
+            batch->cv.wait_for(lock, std::chrono::microseconds(_window_us), [&batch]() { return batch->closed; });
+            if (!batch->closed)
+            {
+                _open_batch = nullptr;
+                batch->closed = true;
+            }
+        }
+
+        // the batch is closed, nobody else touches it until done is set
+        lock.unlock();
+        bool success;
+        try
+        {
+            success = _fetch(batch->node_ids, batch->embeddings, batch->dim) &&
+                      batch->embeddings.size() == batch->node_ids.size() * batch->dim;
+        }
+        catch (...)
+        {
+            // the members of the batch fail instead of waiting for it forever
+            lock.lock();
+            batch->success = false;
+            batch->done = true;
+            batch->cv.notify_all();
+            throw;
+        }
+        _num_batches++;
+        _num_fetched_ids += batch->node_ids.size();
+        lock.lock();
+        batch->success = success;
+        batch->done = true;
+        batch->cv.notify_all();
+    }
+    else
+    {
+        batch->cv.wait(lock, [&batch]() { return batch->done; });
+    }
+    lock.unlock();
+
+    // embeddings are read-only once the batch is done
+    if (!batch->success)
+        return false;
+    dim = batch->dim;
+    out_embeddings.resize(node_ids.size() * dim);
+    for (size_t i = 0; i < node_ids.size(); i++)
+        std::memcpy(out_embeddings.data() + i * dim, batch->embeddings.data() + (size_t)positions[i] * dim,
+                    dim * sizeof(float));
+    return true;
+}
+
+} // namespace diskann
@@ -0,0 +1,229 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <zmq.h>
+
+#include "ann_exception.h"
+#include "embedding.pb.h" // from embedding.proto -> embedding.pb.h
+#include "embedding_provider.h"
+#include "embedding_shm_channel.h"
+#include "logger.h"
+#include "utils.h"
+
+namespace diskann
+{
+
+static void *g_zmq_context = zmq_ctx_new();
+
+struct ZmqContextManager
+{
+    ~ZmqContextManager()
+    {
+        if (g_zmq_context)
+        {
+            zmq_ctx_destroy(g_zmq_context);
+            g_zmq_context = nullptr;
+        }
+    }
+};
+static ZmqContextManager g_zmq_manager;
+
+static bool fetch_embeddings_zmq(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                                 uint32_t &out_dim, const std::string &endpoint)
+{
+    // 1. Protobuf 序列化：创建请求消息
+    protoembedding::NodeEmbeddingRequest req_proto;
+    for (const auto id : node_ids)
+    {
+        req_proto.add_node_ids(id);
+    }
+    std::string req_str;
+    if (!req_proto.SerializeToString(&req_str))
+    {
+        std::cerr << "ZMQ_FETCH_ERROR: Failed to serialize NodeEmbeddingRequest.\n";
+        return false;
+    }
+
+    // 2. Use thread-local (thread_local) Socket for connection reuse
+    // Each thread will have its own persistent Socket
+    thread_local void *tl_socket = nullptr;
+    thread_local std::string tl_endpoint;
+
+    // Thread-local cleanup helper
+    thread_local struct SocketCleanup
+    {
+        ~SocketCleanup()
+        {
+            if (tl_socket && g_zmq_context)
+            {
+                zmq_close(tl_socket);
+                tl_socket = nullptr;
+            }
+        }
+    } cleanup;
+
+    // A socket connected to another endpoint (e.g. another index) is replaced
+    if (tl_socket != nullptr && tl_endpoint != endpoint)
+    {
+        zmq_close(tl_socket);
+        tl_socket = nullptr;
+    }
+
+    // If current thread's Socket is not created, initialize and connect
+    if (tl_socket == nullptr)
+    {
+        // Create Socket from global Context
+        tl_socket = zmq_socket(g_zmq_context, ZMQ_REQ);
+        if (!tl_socket)
+        {
+            std::cerr << "ZMQ_FETCH_ERROR: zmq_socket() failed: " << zmq_strerror(zmq_errno()) << "\n";
+            return false;
+        }
+
+        int timeout = 300000; // 300 seconds timeout, same as embedding server
+        zmq_setsockopt(tl_socket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+        zmq_setsockopt(tl_socket, ZMQ_SNDTIMEO, &timeout, sizeof(timeout));
+
+        if (zmq_connect(tl_socket, endpoint.c_str()) != 0)
+        {
+            std::cerr << "ZMQ_FETCH_ERROR: zmq_connect() to " << endpoint << " failed: " << zmq_strerror(zmq_errno())
+                      << "\n";
+            zmq_close(tl_socket);
+            tl_socket = nullptr; // Reset to nullptr for next call to try rebuilding
+            return false;
+        }
+        tl_endpoint = endpoint;
+    }
+
+    // 3. Send request using established connection
+    if (zmq_send(tl_socket, req_str.data(), req_str.size(), 0) < 0)
+    {
+        std::cerr << "ZMQ_FETCH_ERROR: zmq_send() failed: " << zmq_strerror(zmq_errno()) << "\n";
+        zmq_close(tl_socket); // Connection may be invalid, close it
+        tl_socket = nullptr;  // Reset, force next rebuild
+        return false;
+    }
+
+    // 4. Receive response
+    zmq_msg_t response_msg;
+    zmq_msg_init(&response_msg);
+    bool success = true;
+
+    if (zmq_msg_recv(&response_msg, tl_socket, 0) < 0)
+    {
+        std::cerr << "ZMQ_FETCH_ERROR: zmq_msg_recv() failed: " << zmq_strerror(zmq_errno()) << "\n";
+        zmq_close(tl_socket); // Same, connection may be invalid after timeout
+        tl_socket = nullptr;  // Reset, force next rebuild
+        success = false;
+    }
+    else
+    {
+        // 5. Protobuf deserialization and extract data
+        protoembedding::NodeEmbeddingResponse resp_proto;
+        if (!resp_proto.ParseFromArray(zmq_msg_data(&response_msg), static_cast<int>(zmq_msg_size(&response_msg))))
+        {
+            std::cerr << "ZMQ_FETCH_ERROR: Failed to parse NodeEmbeddingResponse from server.\n";
+            success = false;
+        }
+        else
+        {
+            if (resp_proto.dimensions_size() == 2)
+            {
+                int batch_size = resp_proto.dimensions(0);
+                int embedding_dim = resp_proto.dimensions(1);
+                const std::string &emb_data = resp_proto.embeddings_data();
+                size_t expected_bytes = (size_t)batch_size * embedding_dim * sizeof(float);
+
+                if (batch_size >= 0 && emb_data.size() == expected_bytes)
+                {
+                    out_embeddings.resize((size_t)batch_size * embedding_dim);
+                    out_dim = (uint32_t)embedding_dim;
+                    if (batch_size > 0)
+                        std::memcpy(out_embeddings.data(), emb_data.data(), expected_bytes);
+                }
+                else
+                {
+                    std::cerr << "ZMQ_FETCH_ERROR: Embedding data size mismatch. Expected " << expected_bytes
+                              << " bytes, got " << emb_data.size() << ".\n";
+                    success = false;
+                }
+            }
+            else
+            {
+                std::cerr << "ZMQ_FETCH_ERROR: Server response has invalid dimensions size.\n";
+                success = false;
+            }
+        }
+    }
+
+    // 6. Clean up message object, but keep Socket and Context open for next reuse
+    zmq_msg_close(&response_msg);
+
+    return success;
+}
+
+bool fetch_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim,
+                      const std::string &endpoint, int zmq_port)
+{
+    const std::string shm_scheme = "shm://";
+    if (endpoint.compare(0, shm_scheme.size(), shm_scheme) == 0)
+        return fetch_embeddings_shm(endpoint.substr(shm_scheme.size()), node_ids, embeddings, dim);
+    if (endpoint.empty())
+        return fetch_embeddings_zmq(node_ids, embeddings, dim, "tcp://127.0.0.1:" + std::to_string(zmq_port));
+    return fetch_embeddings_zmq(node_ids, embeddings, dim, endpoint);
+}
+
+RemoteEmbeddingProvider::RemoteEmbeddingProvider(const std::string &endpoint) : _endpoint(endpoint)
+{
+}
+
+bool RemoteEmbeddingProvider::get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                             uint32_t &dim)
+{
+    return fetch_embeddings(node_ids, embeddings, dim, _endpoint, 0);
+}
+
+CallbackEmbeddingProvider::CallbackEmbeddingProvider(uint32_t dim, Callback callback)
+    : _dim(dim), _callback(std::move(callback))
+{
+}
+
+bool CallbackEmbeddingProvider::get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                               uint32_t &dim)
+{
+    embeddings.resize(node_ids.size() * _dim);
+    dim = _dim;
+    return _callback(node_ids.data(), node_ids.size(), embeddings.data());
+}
+
+BinFileEmbeddingProvider::BinFileEmbeddingProvider(const std::string &bin_file)
+{
+    float *data = nullptr;
+    diskann::load_bin<float>(bin_file, data, _num_points, _dim);
+    _data.reset(data);
+    diskann::cout << "Loaded " << _num_points << " embeddings of dim " << _dim << " from " << bin_file << std::endl;
+}
+
+bool BinFileEmbeddingProvider::get_embeddings(const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings,
+                                              uint32_t &dim)
+{
+    embeddings.resize(node_ids.size() * _dim);
+    dim = (uint32_t)_dim;
+    for (size_t i = 0; i < node_ids.size(); i++)
+    {
+        if (node_ids[i] >= _num_points)
+        {
+            diskann::cerr << "Node " << node_ids[i] << " is not in the embedding file (" << _num_points
+                          << " points)" << std::endl;
+            return false;
+        }
+        std::memcpy(embeddings.data() + i * _dim, _data.get() + (size_t)node_ids[i] * _dim, _dim * sizeof(float));
+    }
+    return true;
+}
+
+} // namespace diskann
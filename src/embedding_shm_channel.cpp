@@ -0,0 +1,488 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ann_exception.h"
+#include "embedding_shm_channel.h"
+#include "logger.h"
+
+#define SHM_CHANNEL_MAGIC 0x314d48534e4e4144ULL // "DANNSHM1"
+#define SHM_CHANNEL_VERSION 2
+#define SHM_CHANNEL_HEADER_SIZE 128
+#define SHM_CHANNEL_HEAD_OFFSET 64
+#define SHM_SLOT_HEADER_SIZE 64
+// same timeout as the ZMQ transport
+#define SHM_CHANNEL_TIMEOUT_US 300000000ULL
+// busy polls before a waiter starts yielding, and yields before it sleeps
+#define SHM_CHANNEL_SPINS 2000
+#define SHM_CHANNEL_YIELDS 200
+#define SHM_CHANNEL_SLEEP_US 20
+// how often a waiting server checks for abandoned slots
+#define SHM_CHANNEL_STALL_CHECK_US 10000
+
+namespace diskann
+{
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters must be lock free");
+
+namespace
+{
+struct ChannelHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t dim;
+    uint32_t max_batch;
+    uint32_t num_slots;
+    uint64_t slot_size;
+};
+
+struct SlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint32_t num_ids;
+    int32_t status;
+};
+
+uint64_t round_up_64(uint64_t n)
+{
+    return (n + 63) / 64 * 64;
+}
+
+uint64_t ids_bytes(uint32_t max_batch)
+{
+    return round_up_64((uint64_t)max_batch * sizeof(uint32_t));
+}
+
+std::atomic<uint64_t> *head_of(char *base)
+{
+    return reinterpret_cast<std::atomic<uint64_t> *>(base + SHM_CHANNEL_HEAD_OFFSET);
+}
+
+SlotHeader *slot_of(char *base, uint64_t slot_size, uint64_t index)
+{
+    return reinterpret_cast<SlotHeader *>(base + SHM_CHANNEL_HEADER_SIZE + index * slot_size);
+}
+
+uint32_t *slot_ids(SlotHeader *slot)
+{
+    return reinterpret_cast<uint32_t *>(reinterpret_cast<char *>(slot) + SHM_SLOT_HEADER_SIZE);
+}
+
+float *slot_embeddings(SlotHeader *slot, uint32_t max_batch)
+{
+    return reinterpret_cast<float *>(reinterpret_cast<char *>(slot) + SHM_SLOT_HEADER_SIZE + ids_bytes(max_batch));
+}
+
+// POSIX shared memory names are "/name"
+std::string shm_path(const std::string &name)
+{
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+uint64_t elapsed_us(const std::chrono::steady_clock::time_point &start)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Waits until sequence reaches at least expected, and returns the value read
+// in value. Requests take tens of microseconds, so waiters spin first and
+// only sleep once the other side is clearly busy.
+bool wait_for_sequence(const std::atomic<uint64_t> &sequence, uint64_t expected, uint64_t timeout_us,
+                       uint64_t &value)
+{
+    for (uint32_t i = 0; i < SHM_CHANNEL_SPINS; i++)
+    {
+        value = sequence.load(std::memory_order_acquire);
+        if (value >= expected)
+            return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0;; i++)
+    {
+        value = sequence.load(std::memory_order_acquire);
+        if (value >= expected)
+            return true;
+        if (i < SHM_CHANNEL_YIELDS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (elapsed_us(start) >= timeout_us)
+            return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(SHM_CHANNEL_SLEEP_US));
+    }
+}
+} // namespace
+
+#ifndef _WINDOWS
+
+EmbeddingShmServer::EmbeddingShmServer(const std::string &name, uint32_t dim, uint32_t max_batch, uint32_t num_slots,
+                                       uint64_t abandon_timeout_us)
+    : _name(shm_path(name)), _abandon_timeout_us(abandon_timeout_us), _request_ids(max_batch)
+{
+    // the four states of a ticket must not alias the free state of the next
+    // round
+    if (dim == 0 || max_batch == 0 || num_slots < 4)
+        throw ANNException("dim and max_batch must be positive, num_slots at least 4", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+
+    uint64_t slot_size = round_up_64(SHM_SLOT_HEADER_SIZE + ids_bytes(max_batch) + (uint64_t)max_batch * dim * 4);
+    _size = SHM_CHANNEL_HEADER_SIZE + num_slots * slot_size;
+
+    shm_unlink(_name.c_str());
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+    {
+        std::stringstream stream;
+        stream << "shm_open of " << _name << " failed with error " << errno;
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (ftruncate(fd, _size) != 0)
+    {
+        close(fd);
+        shm_unlink(_name.c_str());
+        throw ANNException("ftruncate of " + _name + " failed", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    void *buf = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED)
+    {
+        shm_unlink(_name.c_str());
+        throw ANNException("mmap of " + _name + " failed", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    _base = (char *)buf;
+
+    // the segment is zero filled, so only the sequences need initializing
+    auto header = reinterpret_cast<ChannelHeader *>(_base);
+    header->version = SHM_CHANNEL_VERSION;
+    header->dim = dim;
+    header->max_batch = max_batch;
+    header->num_slots = num_slots;
+    header->slot_size = slot_size;
+    new (head_of(_base)) std::atomic<uint64_t>(0);
+    for (uint64_t i = 0; i < num_slots; i++)
+        new (&slot_of(_base, slot_size, i)->sequence) std::atomic<uint64_t>(i);
+
+    // clients check the magic, so it is published last
+    std::atomic_thread_fence(std::memory_order_release);
+    reinterpret_cast<std::atomic<uint64_t> *>(&header->magic)->store(SHM_CHANNEL_MAGIC, std::memory_order_release);
+
+    diskann::cout << "Created embedding channel " << _name << " (" << num_slots << " slots of " << max_batch
+                  << " ids, dim " << dim << ")" << std::endl;
+}
+
+EmbeddingShmServer::~EmbeddingShmServer()
+{
+    if (_base != nullptr)
+        munmap(_base, _size);
+    shm_unlink(_name.c_str());
+}
+
+bool EmbeddingShmServer::serve_one(const Handler &handler, uint64_t timeout_us)
+{
+    auto header = reinterpret_cast<ChannelHeader *>(_base);
+    const uint64_t ticket = _next_ticket;
+    SlotHeader *slot = slot_of(_base, header->slot_size, ticket % header->num_slots);
+
+    // the ids are ready at ticket + 2; at ticket + num_slots or later the
+    // client released the slot without waiting for the response
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sequence;
+    while (!wait_for_sequence(slot->sequence, ticket + 2, (std::min)(timeout_us, (uint64_t)SHM_CHANNEL_STALL_CHECK_US),
+                              sequence))
+    {
+        if (recover_stalled_slot(sequence))
+            return false;
+        if (elapsed_us(start) >= timeout_us)
+            return false;
+    }
+    _next_ticket++;
+    _stalled_sequence = UINT64_MAX;
+    if (sequence != ticket + 2)
+        return false;
+
+    // the ids are copied and checked to be still published, so that a client
+    // releasing the slot meanwhile cannot change them under the handler
+    uint32_t num_ids = slot->num_ids;
+    bool success = false;
+    if (num_ids <= header->max_batch)
+    {
+        std::memcpy(_request_ids.data(), slot_ids(slot), num_ids * sizeof(uint32_t));
+        if (slot->sequence.load(std::memory_order_acquire) != ticket + 2)
+            return false;
+        try
+        {
+            success = handler(_request_ids.data(), num_ids, slot_embeddings(slot, header->max_batch));
+        }
+        catch (const std::exception &e)
+        {
+            diskann::cerr << "Embedding handler failed: " << e.what() << std::endl;
+        }
+    }
+    slot->status = success ? 0 : 1;
+    // fails if the client timed out and released the slot
+    slot->sequence.compare_exchange_strong(sequence, ticket + 3, std::memory_order_release);
+    return true;
+}
+
+bool EmbeddingShmServer::recover_stalled_slot(uint64_t sequence)
+{
+    auto header = reinterpret_cast<ChannelHeader *>(_base);
+    const uint64_t ticket = _next_ticket, num_slots = header->num_slots;
+    SlotHeader *slot = slot_of(_base, header->slot_size, ticket % num_slots);
+
+    // the ticket is only waited on while a client holds it
+    if (head_of(_base)->load(std::memory_order_acquire) <= ticket)
+    {
+        _stalled_sequence = UINT64_MAX;
+        return false;
+    }
+    if (sequence != _stalled_sequence)
+    {
+        _stalled_sequence = sequence;
+        _stalled_since = std::chrono::steady_clock::now();
+        return false;
+    }
+    if (elapsed_us(_stalled_since) < _abandon_timeout_us)
+        return false;
+
+    _stalled_sequence = UINT64_MAX;
+    if (sequence == ticket + 3 - num_slots)
+    {
+        // the response of the previous round was never read
+        if (slot->sequence.compare_exchange_strong(sequence, ticket, std::memory_order_acq_rel))
+            diskann::cerr << "Embedding channel " << _name << ": recycled an unread response" << std::endl;
+        return false;
+    }
+    if ((sequence == ticket || sequence == ticket + 1) &&
+        slot->sequence.compare_exchange_strong(sequence, ticket + num_slots, std::memory_order_acq_rel))
+    {
+        diskann::cerr << "Embedding channel " << _name << ": skipped a request abandoned by its client" << std::endl;
+        _next_ticket++;
+        return true;
+    }
+    return false;
+}
+
+void EmbeddingShmServer::serve(const Handler &handler, const std::atomic<bool> &stop)
+{
+    while (!stop.load())
+        serve_one(handler, 100000);
+}
+
+EmbeddingShmClient::EmbeddingShmClient(const std::string &name)
+{
+    std::string path = shm_path(name);
+    int fd = shm_open(path.c_str(), O_RDWR, 0);
+    if (fd == -1)
+    {
+        std::stringstream stream;
+        stream << "No embedding channel " << path << " (errno " << errno << "), is the embedding server running?";
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < SHM_CHANNEL_HEADER_SIZE)
+    {
+        close(fd);
+        throw ANNException("Embedding channel " + path + " is not initialized", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    _size = sb.st_size;
+    void *buf = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED)
+        throw ANNException("mmap of " + path + " failed", -1, __FUNCSIG__, __FILE__, __LINE__);
+    _base = (char *)buf;
+
+    auto header = reinterpret_cast<ChannelHeader *>(_base);
+    uint64_t magic = reinterpret_cast<std::atomic<uint64_t> *>(&header->magic)->load(std::memory_order_acquire);
+    if (magic != SHM_CHANNEL_MAGIC || header->version != SHM_CHANNEL_VERSION ||
+        SHM_CHANNEL_HEADER_SIZE + header->num_slots * header->slot_size > _size)
+    {
+        munmap(_base, _size);
+        _base = nullptr;
+        throw ANNException("Embedding channel " + path + " has an unknown layout", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    _dim = header->dim;
+    _max_batch = header->max_batch;
+    _num_slots = header->num_slots;
+    _slot_size = header->slot_size;
+}
+
+EmbeddingShmClient::~EmbeddingShmClient()
+{
+    if (_base != nullptr)
+        munmap(_base, _size);
+}
+
+bool EmbeddingShmClient::fetch(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                               uint64_t timeout_us)
+{
+    if (_broken.load())
+        return false;
+    out_embeddings.resize(node_ids.size() * _dim);
+
+    bool success = true;
+    for (size_t start = 0; start < node_ids.size(); start += _max_batch)
+    {
+        uint32_t num_ids = (uint32_t)(std::min)((size_t)_max_batch, node_ids.size() - start);
+        uint64_t ticket = head_of(_base)->fetch_add(1);
+        SlotHeader *slot = slot_of(_base, _slot_size, ticket % _num_slots);
+
+        // the server skips the ticket once the slot is free, if the wait
+        // times out
+        uint64_t sequence;
+        if (!wait_for_sequence(slot->sequence, ticket, timeout_us, sequence))
+        {
+            diskann::cerr << "SHM_FETCH_ERROR: no free slot in the embedding channel" << std::endl;
+            _broken = true;
+            return false;
+        }
+        if (sequence != ticket ||
+            !slot->sequence.compare_exchange_strong(sequence, ticket + 1, std::memory_order_acq_rel))
+        {
+            diskann::cerr << "SHM_FETCH_ERROR: embedding server skipped the request" << std::endl;
+            return false;
+        }
+        std::memcpy(slot_ids(slot), node_ids.data() + start, num_ids * sizeof(uint32_t));
+        slot->num_ids = num_ids;
+        sequence = ticket + 1;
+        if (!slot->sequence.compare_exchange_strong(sequence, ticket + 2, std::memory_order_acq_rel))
+        {
+            diskann::cerr << "SHM_FETCH_ERROR: embedding server skipped the request" << std::endl;
+            return false;
+        }
+
+        if (!wait_for_sequence(slot->sequence, ticket + 3, timeout_us, sequence))
+        {
+            // release the slot unless the response arrived meanwhile
+            sequence = ticket + 2;
+            if (slot->sequence.compare_exchange_strong(sequence, ticket + _num_slots, std::memory_order_acq_rel))
+            {
+                diskann::cerr << "SHM_FETCH_ERROR: embedding server did not answer" << std::endl;
+                _broken = true;
+                return false;
+            }
+        }
+        if (slot->status == 0)
+        {
+            std::memcpy(out_embeddings.data() + start * _dim, slot_embeddings(slot, _max_batch),
+                        (size_t)num_ids * _dim * sizeof(float));
+        }
+        else
+        {
+            diskann::cerr << "SHM_FETCH_ERROR: embedding server failed to compute embeddings" << std::endl;
+            success = false;
+        }
+        // fails if the server recycled the slot while the response was read
+        sequence = ticket + 3;
+        if (!slot->sequence.compare_exchange_strong(sequence, ticket + _num_slots, std::memory_order_acq_rel))
+        {
+            diskann::cerr << "SHM_FETCH_ERROR: embedding server recycled the slot before the response was read"
+                          << std::endl;
+            return false;
+        }
+        if (!success)
+            break;
+    }
+    return success;
+}
+
+bool fetch_embeddings_shm(const std::string &name, const std::vector<uint32_t> &node_ids,
+                          std::vector<float> &out_embeddings, uint32_t &dim)
+{
+    static std::mutex clients_mutex;
+    static std::map<std::string, std::shared_ptr<EmbeddingShmClient>> clients;
+
+    std::shared_ptr<EmbeddingShmClient> client;
+    {
+        std::lock_guard<std::mutex> guard(clients_mutex);
+        auto &entry = clients[name];
+        if (entry == nullptr || entry->is_broken())
+        {
+            try
+            {
+                entry = std::make_shared<EmbeddingShmClient>(name);
+            }
+            catch (const ANNException &e)
+            {
+                diskann::cerr << "SHM_FETCH_ERROR: " << e.what() << std::endl;
+                entry.reset();
+                return false;
+            }
+        }
+        client = entry;
+    }
+    dim = client->get_dim();
+    return client->fetch(node_ids, out_embeddings, SHM_CHANNEL_TIMEOUT_US);
+}
+
+#else
+
+EmbeddingShmServer::EmbeddingShmServer(const std::string &name, uint32_t dim, uint32_t max_batch, uint32_t num_slots,
+                                       uint64_t abandon_timeout_us)
+{
+    throw ANNException("Shared memory embedding channels are not supported on Windows", -1, __FUNCSIG__, __FILE__,
+                       __LINE__);
+}
+
+EmbeddingShmServer::~EmbeddingShmServer()
+{
+}
+
+bool EmbeddingShmServer::serve_one(const Handler &handler, uint64_t timeout_us)
+{
+    return false;
+}
+
+bool EmbeddingShmServer::recover_stalled_slot(uint64_t sequence)
+{
+    return false;
+}
+
+void EmbeddingShmServer::serve(const Handler &handler, const std::atomic<bool> &stop)
+{
+}
+
+EmbeddingShmClient::EmbeddingShmClient(const std::string &name)
+{
+    throw ANNException("Shared memory embedding channels are not supported on Windows", -1, __FUNCSIG__, __FILE__,
+                       __LINE__);
+}
+
+EmbeddingShmClient::~EmbeddingShmClient()
+{
+}
+
+bool EmbeddingShmClient::fetch(const std::vector<uint32_t> &node_ids, std::vector<float> &out_embeddings,
+                               uint64_t timeout_us)
+{
+    return false;
+}
+
+bool fetch_embeddings_shm(const std::string &name, const std::vector<uint32_t> &node_ids,
+                          std::vector<float> &out_embeddings, uint32_t &dim)
+{
+    diskann::cerr << "SHM_FETCH_ERROR: shared memory embedding channels are not supported on Windows" << std::endl;
+    return false;
+}
+
+#endif
+
+} // namespace diskann
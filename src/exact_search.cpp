@@ -0,0 +1,427 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <sstream>
+
+#include <omp.h>
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#else
+#include <mkl.h>
+#endif
+#ifdef USE_AVX2
+#include <immintrin.h>
+#endif
+
+#include "exact_search.h"
+#include "logger.h"
+#include "utils.h"
+
+#define ALIGNMENT 512
+#define QUERY_TILE 64
+#define BASE_TILE 1024
+
+namespace diskann
+{
+#ifdef __APPLE__
+typedef int MKL_INT;
+#endif
+
+void compute_l2sq(float *const points_l2sq, const float *const matrix, const int64_t num_points, const uint64_t dim)
+{
+    assert(points_l2sq != NULL);
+#pragma omp parallel for schedule(static, 65536)
+    for (int64_t d = 0; d < num_points; ++d)
+        points_l2sq[d] = cblas_sdot((int64_t)dim, matrix + (ptrdiff_t)d * (ptrdiff_t)dim, 1,
+                                    matrix + (ptrdiff_t)d * (ptrdiff_t)dim, 1);
+}
+
+void normalize_points(float *const points, float *const points_l2sq, const int64_t num_points, const uint64_t dim)
+{
+#pragma omp parallel for schedule(static, 4096)
+    for (int64_t i = 0; i < num_points; i++)
+    {
+        float norm = std::sqrt(points_l2sq[i]);
+        if (norm == 0)
+        {
+            norm = std::numeric_limits<float>::epsilon();
+        }
+        for (uint64_t j = 0; j < dim; j++)
+        {
+            points[i * dim + j] /= norm;
+        }
+    }
+    // recalculate norms after normalizing, they should all be one.
+    compute_l2sq(points_l2sq, points, num_points, dim);
+}
+
+namespace
+{
+#ifdef USE_AVX2
+inline int lowest_set_bit(int mask)
+{
+#ifdef _WINDOWS
+    unsigned long index;
+    _BitScanForward(&index, (unsigned long)mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Keeps the k smallest (distance, id) pairs seen so far for one query in an
+// array sorted by distance.
+class TopKSink
+{
+  public:
+    TopKSink(uint32_t *ids, float *dists, uint32_t *size, uint32_t k) : _ids(ids), _dists(dists), _size(size), _k(k)
+    {
+    }
+
+    // candidates with distance >= bound() can not enter the list
+    inline float bound() const
+    {
+        return *_size < _k ? std::numeric_limits<float>::max() : _dists[_k - 1];
+    }
+
+    inline void push(uint32_t id, float dist)
+    {
+        if (dist >= bound())
+            return;
+        uint32_t pos = (uint32_t)(std::upper_bound(_dists, _dists + *_size, dist) - _dists);
+        uint32_t last = *_size < _k ? *_size : _k - 1;
+        std::memmove(_ids + pos + 1, _ids + pos, (last - pos) * sizeof(uint32_t));
+        std::memmove(_dists + pos + 1, _dists + pos, (last - pos) * sizeof(float));
+        _ids[pos] = id;
+        _dists[pos] = dist;
+        if (*_size < _k)
+            (*_size)++;
+    }
+
+  private:
+    uint32_t *_ids;
+    float *_dists;
+    uint32_t *_size;
+    uint32_t _k;
+};
+
+// Collects every point within the search radius of one query.
+class RangeSink
+{
+  public:
+    RangeSink(std::vector<std::pair<uint32_t, float>> *results, float radius)
+        : _results(results), _bound(std::nextafter(radius, std::numeric_limits<float>::max()))
+    {
+    }
+
+    inline float bound() const
+    {
+        return _bound;
+    }
+
+    inline void push(uint32_t id, float dist)
+    {
+        _results->emplace_back(id, dist);
+    }
+
+  private:
+    std::vector<std::pair<uint32_t, float>> *_results;
+    float _bound;
+};
+
+inline bool is_eligible(const std::vector<uint64_t> &eligible, size_t id)
+{
+    return eligible.empty() || ((eligible[id >> 6] >> (id & 63)) & 1);
+}
+
+// Turns one row of inner products between a query and count consecutive base
+// points into distances and feeds the points closer than sink.bound() to the
+// sink. For L2 (and cosine) dist = |x|^2 - 2 <q,x> + |q|^2, for MIPS
+// dist = -<q,x>. The bound is re-read after every insertion so it tightens as
+// the top-k fills up.
+template <typename Sink>
+inline void scan_tile_row(const float *ip, const float *base_l2sq, size_t count, uint32_t first_id, float query_l2sq,
+                          bool use_l2, const std::vector<uint64_t> &eligible, Sink &sink)
+{
+    size_t j = 0;
+#ifdef USE_AVX2
+    const __m256 minus_two = _mm256_set1_ps(-2.0f);
+    const __m256 q_norm = _mm256_set1_ps(query_l2sq);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 ip_v = _mm256_loadu_ps(ip + j);
+        __m256 dist_v = use_l2 ? _mm256_add_ps(_mm256_fmadd_ps(minus_two, ip_v, _mm256_loadu_ps(base_l2sq + j)), q_norm)
+                               : _mm256_xor_ps(ip_v, sign);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(dist_v, _mm256_set1_ps(sink.bound()), _CMP_LT_OQ));
+        if (mask == 0)
+            continue;
+        alignas(32) float dists[8];
+        _mm256_store_ps(dists, dist_v);
+        while (mask != 0)
+        {
+            int lane = lowest_set_bit(mask);
+            mask &= mask - 1;
+            uint32_t id = first_id + (uint32_t)(j + lane);
+            if (dists[lane] < sink.bound() && is_eligible(eligible, id))
+                sink.push(id, dists[lane]);
+        }
+    }
+#endif
+    for (; j < count; j++)
+    {
+        float dist = use_l2 ? base_l2sq[j] - 2 * ip[j] + query_l2sq : -ip[j];
+        uint32_t id = first_id + (uint32_t)j;
+        if (dist < sink.bound() && is_eligible(eligible, id))
+            sink.push(id, dist);
+    }
+}
+
+// One streamed block of base points, converted to float.
+struct BaseBlock
+{
+    float *data = nullptr;
+    std::vector<float> l2sq;
+    size_t start = 0;
+    size_t count = 0;
+};
+
+// Reads the base file sequentially, one block at a time. Only one read is in
+// flight at any time, so the stream needs no locking.
+template <typename T> class BaseBlockReader
+{
+  public:
+    BaseBlockReader(const std::string &filename, size_t block_size, diskann::Metric metric)
+        : _block_size(block_size), _metric(metric)
+    {
+        _reader.exceptions(std::ios::failbit | std::ios::badbit);
+        _reader.open(filename, std::ios::binary);
+        int npts_i32, ndims_i32;
+        _reader.read((char *)&npts_i32, sizeof(int));
+        _reader.read((char *)&ndims_i32, sizeof(int));
+        _npts = (size_t)npts_i32;
+        _dim = (size_t)ndims_i32;
+        _raw.resize(_block_size * _dim);
+        diskann::cout << "Streaming base file " << filename << " with #pts = " << _npts << ", #dims = " << _dim
+                  << " in blocks of " << _block_size << " points" << std::endl;
+    }
+
+    size_t num_points() const
+    {
+        return _npts;
+    }
+
+    size_t dim() const
+    {
+        return _dim;
+    }
+
+    size_t num_blocks() const
+    {
+        return DIV_ROUND_UP(_npts, _block_size);
+    }
+
+    void read_block(size_t block_id, BaseBlock &block)
+    {
+        block.start = block_id * _block_size;
+        block.count = (std::min)(_block_size, _npts - block.start);
+        _reader.seekg(block.start * _dim * sizeof(T) + 2 * sizeof(uint32_t), std::ios::beg);
+        _reader.read((char *)_raw.data(), block.count * _dim * sizeof(T));
+        for (size_t i = 0; i < block.count * _dim; i++)
+            block.data[i] = (float)_raw[i];
+        compute_l2sq(block.l2sq.data(), block.data, block.count, _dim);
+        if (_metric == diskann::Metric::COSINE)
+            normalize_points(block.data, block.l2sq.data(), block.count, _dim);
+    }
+
+  private:
+    std::ifstream _reader;
+    std::vector<T> _raw;
+    size_t _npts = 0;
+    size_t _dim = 0;
+    size_t _block_size;
+    diskann::Metric _metric;
+};
+
+} // namespace
+
+template <typename T>
+void exact_search(const std::string &base_file, size_t block_size, size_t dim, size_t nqueries, const float *queries,
+                  const float *queries_l2sq, diskann::Metric metric, const std::vector<uint64_t> &eligible, size_t k,
+                  std::vector<uint32_t> &knn_ids, std::vector<float> &knn_dists, std::vector<uint32_t> &knn_sizes,
+                  float radius, std::vector<std::vector<std::pair<uint32_t, float>>> *range_results)
+{
+    BaseBlockReader<T> reader(base_file, block_size, metric);
+    if (reader.dim() != dim)
+    {
+        std::stringstream stream;
+        stream << "Base dimension " << reader.dim() << " does not match query dimension " << dim << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (!eligible.empty() && eligible.size() * 64 < reader.num_points())
+    {
+        throw diskann::ANNException("Filter does not cover all base points", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    const bool range_search = range_results != nullptr;
+    const bool use_l2 = metric != diskann::Metric::INNER_PRODUCT;
+    const size_t num_query_tiles = DIV_ROUND_UP(nqueries, QUERY_TILE);
+    const size_t num_threads = (size_t)omp_get_max_threads();
+    const size_t num_stripes = (std::max)((size_t)1, num_threads / num_query_tiles);
+
+    diskann::cout << "Going to compute " << (range_search ? "range" : std::to_string(k) + "-NN") << " ground truth for "
+              << nqueries << " queries over " << reader.num_points() << " points in " << dim << " dimensions using";
+    if (metric == diskann::Metric::INNER_PRODUCT)
+        diskann::cout << " MIPS ";
+    else if (metric == diskann::Metric::COSINE)
+        diskann::cout << " Cosine ";
+    else
+        diskann::cout << " L2 ";
+    diskann::cout << "distance fn, " << num_stripes << " base stripe(s) per query tile." << std::endl;
+
+    if (range_search)
+    {
+        range_results->assign(nqueries * num_stripes, std::vector<std::pair<uint32_t, float>>());
+    }
+    else
+    {
+        knn_ids.assign(num_stripes * nqueries * k, 0);
+        knn_dists.assign(num_stripes * nqueries * k, std::numeric_limits<float>::max());
+        knn_sizes.assign(num_stripes * nqueries, 0);
+    }
+
+    std::vector<float> tiles(num_threads * QUERY_TILE * BASE_TILE);
+
+    BaseBlock blocks[2];
+    for (auto &block : blocks)
+    {
+        diskann::alloc_aligned((void **)&block.data, ROUND_UP(block_size * dim * sizeof(float), ALIGNMENT),
+                               ALIGNMENT);
+        block.l2sq.resize(block_size);
+    }
+
+    if (reader.num_blocks() > 0)
+        reader.read_block(0, blocks[0]);
+
+    for (size_t b = 0; b < reader.num_blocks(); b++)
+    {
+        BaseBlock &block = blocks[b % 2];
+        // read the next block while this one is searched
+        std::future<void> next_block;
+        if (b + 1 < reader.num_blocks())
+        {
+            next_block = std::async(std::launch::async,
+                                    [&reader, &blocks, b]() { reader.read_block(b + 1, blocks[(b + 1) % 2]); });
+        }
+
+        const size_t num_base_tiles = DIV_ROUND_UP(block.count, BASE_TILE);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t w = 0; w < (int64_t)(num_query_tiles * num_stripes); w++)
+        {
+            const size_t q_tile = (size_t)w / num_stripes;
+            const size_t stripe = (size_t)w % num_stripes;
+            const size_t q_b = q_tile * QUERY_TILE;
+            const size_t q_e = (std::min)(q_b + QUERY_TILE, nqueries);
+            float *tile = tiles.data() + (size_t)omp_get_thread_num() * QUERY_TILE * BASE_TILE;
+
+            for (size_t t = stripe; t < num_base_tiles; t += num_stripes)
+            {
+                const size_t p_b = t * BASE_TILE;
+                const size_t p_e = (std::min)(p_b + BASE_TILE, block.count);
+                // tile[q][p] = <query q, point p>
+                cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, (MKL_INT)(q_e - q_b), (MKL_INT)(p_e - p_b),
+                            (MKL_INT)dim, 1.0f, queries + q_b * dim, (MKL_INT)dim, block.data + p_b * dim,
+                            (MKL_INT)dim, 0.0f, tile, (MKL_INT)(p_e - p_b));
+
+                for (size_t q = q_b; q < q_e; q++)
+                {
+                    const float *row = tile + (q - q_b) * (p_e - p_b);
+                    const uint32_t first_id = (uint32_t)(block.start + p_b);
+                    const size_t slot = stripe * nqueries + q;
+                    if (range_search)
+                    {
+                        RangeSink sink(&(*range_results)[slot], radius);
+                        scan_tile_row(row, block.l2sq.data() + p_b, p_e - p_b, first_id, queries_l2sq[q], use_l2,
+                                      eligible, sink);
+                    }
+                    else
+                    {
+                        TopKSink sink(knn_ids.data() + slot * k, knn_dists.data() + slot * k, knn_sizes.data() + slot,
+                                      (uint32_t)k);
+                        scan_tile_row(row, block.l2sq.data() + p_b, p_e - p_b, first_id, queries_l2sq[q], use_l2,
+                                      eligible, sink);
+                    }
+                }
+            }
+        }
+        diskann::cout << "Processed base points [" << block.start << "," << block.start + block.count << ")"
+                      << std::endl;
+
+        if (next_block.valid())
+            next_block.get();
+    }
+
+    for (auto &block : blocks)
+        diskann::aligned_free(block.data);
+
+    if (num_stripes == 1)
+        return;
+
+    // merge the per stripe results into stripe 0
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int64_t q = 0; q < (int64_t)nqueries; q++)
+    {
+        if (range_search)
+        {
+            for (size_t s = 1; s < num_stripes; s++)
+            {
+                auto &from = (*range_results)[s * nqueries + q];
+                (*range_results)[q].insert((*range_results)[q].end(), from.begin(), from.end());
+                std::vector<std::pair<uint32_t, float>>().swap(from);
+            }
+        }
+        else
+        {
+            TopKSink sink(knn_ids.data() + q * k, knn_dists.data() + q * k, knn_sizes.data() + q, (uint32_t)k);
+            for (size_t s = 1; s < num_stripes; s++)
+            {
+                const size_t slot = s * nqueries + q;
+                for (size_t j = 0; j < knn_sizes[slot]; j++)
+                    sink.push(knn_ids[slot * k + j], knn_dists[slot * k + j]);
+            }
+        }
+    }
+    if (range_search)
+        range_results->resize(nqueries);
+    else
+    {
+        knn_ids.resize(nqueries * k);
+        knn_dists.resize(nqueries * k);
+        knn_sizes.resize(nqueries);
+    }
+}
+
+template DISKANN_DLLEXPORT void exact_search<float>(
+    const std::string &base_file, size_t block_size, size_t dim, size_t nqueries, const float *queries,
+    const float *queries_l2sq, diskann::Metric metric, const std::vector<uint64_t> &eligible, size_t k,
+    std::vector<uint32_t> &knn_ids, std::vector<float> &knn_dists, std::vector<uint32_t> &knn_sizes, float radius,
+    std::vector<std::vector<std::pair<uint32_t, float>>> *range_results);
+template DISKANN_DLLEXPORT void exact_search<int8_t>(
+    const std::string &base_file, size_t block_size, size_t dim, size_t nqueries, const float *queries,
+    const float *queries_l2sq, diskann::Metric metric, const std::vector<uint64_t> &eligible, size_t k,
+    std::vector<uint32_t> &knn_ids, std::vector<float> &knn_dists, std::vector<uint32_t> &knn_sizes, float radius,
+    std::vector<std::vector<std::pair<uint32_t, float>>> *range_results);
+template DISKANN_DLLEXPORT void exact_search<uint8_t>(
+    const std::string &base_file, size_t block_size, size_t dim, size_t nqueries, const float *queries,
+    const float *queries_l2sq, diskann::Metric metric, const std::vector<uint64_t> &eligible, size_t k,
+    std::vector<uint32_t> &knn_ids, std::vector<float> &knn_dists, std::vector<uint32_t> &knn_sizes, float radius,
+    std::vector<std::vector<std::pair<uint32_t, float>>> *range_results);
+
+} // namespace diskann
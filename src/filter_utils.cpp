@@ -323,6 +323,187 @@ std::tuple<std::vector<std::vector<LabelT>>, tsl::robin_set<LabelT>> parse_forma
     return std::make_tuple(pts_to_labels, labels);
 }
 
+template <typename LabelT> LabelLists<LabelT> read_text_label_files(const std::string &prefix)
+{
+    LabelLists<LabelT> lists;
+    std::string line, token;
+
+    std::ifstream label_reader(prefix + "_labels.txt");
+    if (label_reader.fail())
+    {
+        throw diskann::ANNException(std::string("Failed to open file ") + prefix + "_labels.txt", -1);
+    }
+    while (std::getline(label_reader, line))
+    {
+        lists.offsets.push_back((uint32_t)lists.labels.size());
+        // labels end at the first tab, if any
+        std::istringstream iss(line.substr(0, line.find('\t')));
+        while (std::getline(iss, token, ','))
+        {
+            if (token.find_first_of("0123456789") != std::string::npos)
+                lists.labels.push_back((LabelT)std::stoul(token));
+        }
+        lists.counts.push_back((uint32_t)lists.labels.size() - lists.offsets.back());
+        if (lists.labels.size() > std::numeric_limits<uint32_t>::max())
+        {
+            throw diskann::ANNException("Labels file " + prefix + "_labels.txt has more than 2^32 labels", -1,
+                                        __FUNCSIG__, __FILE__, __LINE__);
+        }
+    }
+
+    // label,medoid[,medoid...] per line
+    std::ifstream medoid_reader(prefix + "_labels_to_medoids.txt");
+    while (medoid_reader.is_open() && std::getline(medoid_reader, line))
+    {
+        std::istringstream iss(line);
+        LabelT label = 0;
+        for (uint32_t cnt = 0; std::getline(iss, token, ','); cnt++)
+        {
+            if (cnt == 0)
+                label = (LabelT)std::stoul(token);
+            else
+                lists.medoids.emplace_back(label, (uint32_t)std::stoul(token));
+        }
+    }
+
+    // dummy,real per line
+    std::ifstream dummy_reader(prefix + "_dummy_map.txt");
+    while (dummy_reader.is_open() && std::getline(dummy_reader, line))
+    {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos)
+            continue;
+        lists.dummy_map.emplace_back((uint32_t)std::stoul(line.substr(0, comma)),
+                                     (uint32_t)std::stoul(line.substr(comma + 1)));
+    }
+
+    std::ifstream universal_label_reader(prefix + "_universal_label.txt");
+    std::string universal_label;
+    if (universal_label_reader.is_open() && (universal_label_reader >> universal_label))
+    {
+        lists.use_universal_label = true;
+        lists.universal_label = (LabelT)std::stoul(universal_label);
+    }
+    return lists;
+}
+
+namespace
+{
+void write_padded(std::ofstream &writer, const void *data, size_t size)
+{
+    static const char padding[8] = {0};
+    writer.write((const char *)data, size);
+    writer.write(padding, ROUND_UP(size, 8) - size);
+}
+} // namespace
+
+template <typename LabelT>
+void save_bin_labels(const std::string &bin_labels_file, const LabelLists<LabelT> &lists)
+{
+    std::vector<LabelT> medoid_labels;
+    std::vector<uint32_t> medoids, dummy_ids, dummy_real_ids;
+    for (const auto &medoid : lists.medoids)
+    {
+        medoid_labels.push_back(medoid.first);
+        medoids.push_back(medoid.second);
+    }
+    for (const auto &dummy : lists.dummy_map)
+    {
+        dummy_ids.push_back(dummy.first);
+        dummy_real_ids.push_back(dummy.second);
+    }
+
+    uint64_t header[8] = {lists.offsets.size(),
+                          lists.labels.size(),
+                          sizeof(LabelT),
+                          medoids.size(),
+                          dummy_ids.size(),
+                          lists.use_universal_label ? 1ULL : 0ULL,
+                          (uint64_t)lists.universal_label,
+                          0};
+    // open_file_to_write does not truncate an existing file
+    delete_file(bin_labels_file);
+    std::ofstream writer;
+    open_file_to_write(writer, bin_labels_file);
+    writer.write((const char *)header, BIN_LABELS_HEADER_SIZE);
+    write_padded(writer, lists.offsets.data(), lists.offsets.size() * sizeof(uint32_t));
+    write_padded(writer, lists.counts.data(), lists.counts.size() * sizeof(uint32_t));
+    write_padded(writer, lists.labels.data(), lists.labels.size() * sizeof(LabelT));
+    write_padded(writer, medoid_labels.data(), medoid_labels.size() * sizeof(LabelT));
+    write_padded(writer, medoids.data(), medoids.size() * sizeof(uint32_t));
+    write_padded(writer, dummy_ids.data(), dummy_ids.size() * sizeof(uint32_t));
+    write_padded(writer, dummy_real_ids.data(), dummy_real_ids.size() * sizeof(uint32_t));
+    writer.close();
+    diskann::cout << "Wrote labels of " << lists.offsets.size() << " points to " << bin_labels_file << std::endl;
+}
+
+template <typename LabelT> bool convert_label_files_to_bin(const std::string &prefix)
+{
+    if (!file_exists(prefix + "_labels.txt"))
+        return false;
+    save_bin_labels<LabelT>(prefix + "_labels.bin", read_text_label_files<LabelT>(prefix));
+    return true;
+}
+
+size_t get_bin_labels_label_size(const std::string &bin_labels_file)
+{
+    uint64_t header[8];
+    std::ifstream reader(bin_labels_file, std::ios::binary);
+    if (!reader.read((char *)header, BIN_LABELS_HEADER_SIZE))
+    {
+        throw diskann::ANNException(std::string("Failed to read header of ") + bin_labels_file, -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+    }
+    return (size_t)header[2];
+}
+
+template <typename LabelT> MappedBinLabels<LabelT>::MappedBinLabels(const std::string &bin_labels_file)
+{
+    _mapper = std::make_unique<MemoryMapper>(bin_labels_file);
+    const char *buf = _mapper->getBuf();
+    size_t file_size = _mapper->getFileSize();
+    if (buf == nullptr || file_size < BIN_LABELS_HEADER_SIZE)
+    {
+        throw diskann::ANNException(std::string("Failed to map labels file ") + bin_labels_file, -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+    }
+
+    const uint64_t *header = (const uint64_t *)buf;
+    if (header[2] != sizeof(LabelT))
+    {
+        std::stringstream stream;
+        stream << "Labels file " << bin_labels_file << " has " << header[2] << " byte labels, expected "
+               << sizeof(LabelT);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    num_points = header[0];
+    num_point_labels = header[1];
+    num_medoids = header[3];
+    num_dummies = header[4];
+    use_universal_label = header[5] != 0;
+    universal_label = (LabelT)header[6];
+
+    size_t offset = BIN_LABELS_HEADER_SIZE;
+    auto next_array = [&](size_t size) {
+        const char *array = buf + offset;
+        offset += ROUND_UP(size, 8);
+        return array;
+    };
+    offsets = (const uint32_t *)next_array(num_points * sizeof(uint32_t));
+    counts = (const uint32_t *)next_array(num_points * sizeof(uint32_t));
+    labels = (const LabelT *)next_array(num_point_labels * sizeof(LabelT));
+    medoid_labels = (const LabelT *)next_array(num_medoids * sizeof(LabelT));
+    medoids = (const uint32_t *)next_array(num_medoids * sizeof(uint32_t));
+    dummy_ids = (const uint32_t *)next_array(num_dummies * sizeof(uint32_t));
+    dummy_real_ids = (const uint32_t *)next_array(num_dummies * sizeof(uint32_t));
+    if (offset != file_size)
+    {
+        std::stringstream stream;
+        stream << "Labels file " << bin_labels_file << " has " << file_size << " bytes, expected " << offset;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
 template DISKANN_DLLEXPORT std::tuple<std::vector<std::vector<uint32_t>>, tsl::robin_set<uint32_t>>
 parse_formatted_label_file(path label_file);
 
@@ -352,4 +533,15 @@ generate_label_specific_vector_files_compat<int8_t>(path input_data_path,
                                                     tsl::robin_map<std::string, uint32_t> labels_to_number_of_points,
                                                     std::vector<label_set> point_ids_to_labels, label_set all_labels);
 
+template DISKANN_DLLEXPORT LabelLists<uint32_t> read_text_label_files<uint32_t>(const std::string &prefix);
+template DISKANN_DLLEXPORT LabelLists<uint16_t> read_text_label_files<uint16_t>(const std::string &prefix);
+template DISKANN_DLLEXPORT void save_bin_labels<uint32_t>(const std::string &bin_labels_file,
+                                                          const LabelLists<uint32_t> &lists);
+template DISKANN_DLLEXPORT void save_bin_labels<uint16_t>(const std::string &bin_labels_file,
+                                                          const LabelLists<uint16_t> &lists);
+template DISKANN_DLLEXPORT bool convert_label_files_to_bin<uint32_t>(const std::string &prefix);
+template DISKANN_DLLEXPORT bool convert_label_files_to_bin<uint16_t>(const std::string &prefix);
+template class MappedBinLabels<uint32_t>;
+template class MappedBinLabels<uint16_t>;
+
 } // namespace diskann
\ No newline at end of file
@@ -0,0 +1,636 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "common_includes.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+#include "cached_io.h"
+#include "disk_utils.h"
+#include "fresh_pq_flash_index.h"
+#include "timer.h"
+
+#ifdef _WINDOWS
+#ifdef USE_BING_INFRA
+#include "bing_aligned_file_reader.h"
+#else
+#include "windows_aligned_file_reader.h"
+#endif
+#elif __APPLE__
+#include "apple_aligned_file_reader.h"
+#else
+#include "linux_aligned_file_reader.h"
+#endif
+
+// beam width of the disk searches that link delta points during a merge
+#define MERGE_SEARCH_BEAM_WIDTH 4
+// number of disk nodes whose neighborhoods are patched in parallel
+#define MERGE_BATCH_SIZE 65536
+
+namespace diskann
+{
+
+template <typename T, typename LabelT>
+FreshPQFlashIndex<T, LabelT>::FreshPQFlashIndex(diskann::Metric metric, const std::string &index_prefix,
+                                                uint32_t num_threads, const IndexWriteParameters &delta_params,
+                                                size_t initial_delta_capacity, int zmq_port)
+    : _metric(metric), _num_threads(num_threads), _zmq_port(zmq_port), _delta_params(delta_params),
+      _initial_delta_capacity(initial_delta_capacity), _index_prefix(index_prefix)
+{
+    if (metric != diskann::Metric::L2)
+    {
+        throw ANNException("FreshPQFlashIndex only supports L2 disk indices", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _disk = load_disk_index(index_prefix);
+    load_disk_tags(index_prefix, _disk->index->get_num_points());
+
+    // the frozen point of every delta is placed at the medoid of the disk
+    // index, so that delta searches start in the same region
+    _start_point.resize(_disk->index->get_data_dim());
+    std::vector<uint32_t> medoid = {_disk->index->_medoids[0]};
+    std::vector<T *> coord_buffers = {_start_point.data()};
+    std::vector<std::pair<uint32_t, uint32_t *>> nbr_buffers = {{0, nullptr}};
+    _disk->index->read_nodes(medoid, coord_buffers, nbr_buffers);
+
+    _delta = create_delta();
+}
+
+template <typename T, typename LabelT> FreshPQFlashIndex<T, LabelT>::~FreshPQFlashIndex()
+{
+    // wait for a merge running in the background
+    std::lock_guard<std::mutex> guard(_merge_mutex);
+}
+
+template <typename T, typename LabelT>
+std::unique_ptr<typename FreshPQFlashIndex<T, LabelT>::DiskIndex> FreshPQFlashIndex<T, LabelT>::load_disk_index(
+    const std::string &index_prefix)
+{
+    auto disk = std::make_unique<DiskIndex>();
+#ifdef _WINDOWS
+#ifndef USE_BING_INFRA
+    disk->reader.reset(new WindowsAlignedFileReader());
+    disk->graph_reader.reset(new WindowsAlignedFileReader());
+#else
+    disk->reader.reset(new diskann::BingAlignedFileReader());
+    disk->graph_reader.reset(new diskann::BingAlignedFileReader());
+#endif
+#elif __APPLE__
+    disk->reader.reset(new AppleAlignedFileReader());
+    disk->graph_reader.reset(new AppleAlignedFileReader());
+#else
+    disk->reader.reset(new LinuxAlignedFileReader());
+    disk->graph_reader.reset(new LinuxAlignedFileReader());
+#endif
+
+    disk->index = std::make_unique<PQFlashIndex<T, LabelT>>(disk->reader, disk->graph_reader, _metric);
+    if (disk->index->load(_num_threads, index_prefix.c_str(), _zmq_port, nullptr, "") != 0)
+    {
+        throw ANNException("Failed to load disk index " + index_prefix, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (disk->index->_use_disk_index_pq || disk->index->_reorder_data_exists || disk->index->_use_partition)
+    {
+        throw ANNException("FreshPQFlashIndex needs full precision coordinates in the disk index nodes", -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    }
+    // the disk locations would be relabeled ids, while merges write indexes
+    // in location order
+    if (!disk->index->_id_map.empty())
+    {
+        throw ANNException("FreshPQFlashIndex does not support reordered disk indexes", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    // merges write neither labels nor the label medoids, so the labels of
+    // the loaded index would be lost on the first merge
+    if (disk->index->_pts_to_labels != nullptr || disk->index->_bin_labels != nullptr)
+    {
+        throw ANNException("FreshPQFlashIndex does not support disk indexes with labels", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    return disk;
+}
+
+template <typename T, typename LabelT>
+std::unique_ptr<Index<T, uint32_t, uint32_t>> FreshPQFlashIndex<T, LabelT>::create_delta()
+{
+    auto write_params = std::make_shared<IndexWriteParameters>(_delta_params);
+    auto search_params = std::make_shared<IndexSearchParams>(_delta_params.search_list_size, _num_threads);
+    auto delta = std::make_unique<Index<T, uint32_t, uint32_t>>(
+        _metric, _start_point.size(), _initial_delta_capacity, write_params, search_params,
+        defaults::NUM_FROZEN_POINTS_DYNAMIC, true, true, true);
+    delta->set_start_points(_start_point.data(), _start_point.size());
+    return delta;
+}
+
+template <typename T, typename LabelT>
+void FreshPQFlashIndex<T, LabelT>::load_disk_tags(const std::string &index_prefix, size_t num_points)
+{
+    std::string tags_file = index_prefix + "_disk.index_tags.bin";
+    _disk_tags.clear();
+    if (file_exists(tags_file))
+    {
+        uint32_t *tags = nullptr;
+        size_t npts, dim;
+        diskann::load_bin<uint32_t>(tags_file, tags, npts, dim);
+        if (npts != num_points || dim != 1)
+        {
+            delete[] tags;
+            std::stringstream stream;
+            stream << "Tags file " << tags_file << " has " << npts << "x" << dim << " entries, expected " << num_points
+                   << "x1" << std::endl;
+            throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        _disk_tags.assign(tags, tags + npts);
+        delete[] tags;
+    }
+    else
+    {
+        _disk_tags.resize(num_points);
+        for (size_t i = 0; i < num_points; i++)
+            _disk_tags[i] = (uint32_t)i;
+    }
+
+    _tag_to_disk_location.clear();
+    _tag_to_disk_location.reserve(num_points);
+    for (size_t i = 0; i < num_points; i++)
+        _tag_to_disk_location[_disk_tags[i]] = (uint32_t)i;
+}
+
+template <typename T, typename LabelT> int FreshPQFlashIndex<T, LabelT>::insert(const T *point, const uint32_t tag)
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+
+    // a tag can only be inserted again once it is deleted; the delta itself
+    // rejects tags it already holds
+    auto iter = _tag_to_disk_location.find(tag);
+    if (iter != _tag_to_disk_location.end() && !_disk->index->is_deleted(iter->second))
+        return -1;
+    if (_merging_delta != nullptr)
+    {
+        std::lock_guard<std::mutex> guard(_pending_deletes_mutex);
+        if (_merging_delta_tags.find(tag) != _merging_delta_tags.end())
+            return -1;
+    }
+    return _delta->insert_point(point, tag);
+}
+
+template <typename T, typename LabelT> int FreshPQFlashIndex<T, LabelT>::lazy_delete(const uint32_t tag)
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+
+    // a tag can be on disk (deleted) and in a delta (re-inserted)
+    auto iter = _tag_to_disk_location.find(tag);
+    if (iter == _tag_to_disk_location.end() || _disk->index->lazy_delete(iter->second) != 0)
+    {
+        if (_delta->lazy_delete(tag) == 0)
+            return 0;
+        if (_merging_delta == nullptr || _merging_delta->lazy_delete(tag) != 0)
+            return -1;
+    }
+
+    // the point is part of a running merge, delete it again after the swap
+    if (_merging_delta != nullptr)
+    {
+        std::lock_guard<std::mutex> guard(_pending_deletes_mutex);
+        _pending_deletes.push_back(tag);
+        _merging_delta_tags.erase(tag);
+    }
+    return 0;
+}
+
+template <typename T, typename LabelT>
+size_t FreshPQFlashIndex<T, LabelT>::search(const T *query, const uint64_t k_search, const uint64_t l_search,
+                                            const uint64_t beam_width, uint32_t *tags, float *distances,
+                                            QueryStats *stats)
+{
+    const uint64_t L = (std::max)(l_search, k_search);
+    std::vector<Neighbor> results;
+    results.reserve(3 * k_search);
+
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+
+    std::vector<uint64_t> disk_ids(k_search);
+    std::vector<float> disk_dists(k_search);
+    _disk->index->cached_beam_search(query, k_search, L, disk_ids.data(), disk_dists.data(), beam_width, false,
+                                    stats);
+    for (uint64_t i = 0; i < k_search && disk_ids[i] != std::numeric_limits<uint64_t>::max(); i++)
+        results.emplace_back(_disk_tags[disk_ids[i]], disk_dists[i]);
+
+    std::vector<uint32_t> delta_tags(k_search);
+    std::vector<float> delta_dists(k_search);
+    std::vector<T *> res_vectors;
+    for (auto *delta : {_delta.get(), _merging_delta.get()})
+    {
+        if (delta == nullptr || delta->get_num_points() == 0)
+            continue;
+        size_t n = delta->search_with_tags(query, k_search, (uint32_t)L, delta_tags.data(), delta_dists.data(),
+                                          res_vectors);
+        for (size_t i = 0; i < n; i++)
+            results.emplace_back(delta_tags[i], delta_dists[i]);
+    }
+
+    std::sort(results.begin(), results.end());
+    size_t num_results = (std::min)((size_t)k_search, results.size());
+    for (size_t i = 0; i < num_results; i++)
+    {
+        tags[i] = results[i].id;
+        if (distances != nullptr)
+            distances[i] = results[i].distance;
+    }
+    return num_results;
+}
+
+template <typename T, typename LabelT>
+void FreshPQFlashIndex<T, LabelT>::compress_vectors(const T *vectors, size_t num_points, uint8_t *codes)
+{
+    FixedChunkPQTable &pq_table = _disk->index->_pq_table;
+    const size_t dim = _disk->index->_data_dim;
+    const size_t n_chunks = _disk->index->_n_chunks;
+
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads)
+    for (int64_t i = 0; i < (int64_t)num_points; i++)
+    {
+        // same encoding as generate_pq_data_from_pivots: nearest center of
+        // every chunk after centering (and rotating for OPQ)
+        std::vector<float> vec(dim);
+        std::vector<float> chunk_dists(256 * n_chunks);
+        for (size_t d = 0; d < dim; d++)
+            vec[d] = (float)vectors[i * dim + d];
+        pq_table.preprocess_query(vec.data());
+        pq_table.populate_chunk_distances(vec.data(), chunk_dists.data());
+        for (size_t c = 0; c < n_chunks; c++)
+        {
+            const float *dists = chunk_dists.data() + 256 * c;
+            codes[i * n_chunks + c] = (uint8_t)(std::min_element(dists, dists + 256) - dists);
+        }
+    }
+}
+
+template <typename T, typename LabelT>
+void FreshPQFlashIndex<T, LabelT>::link_delta_points(const std::vector<uint32_t> &delta_tags, const T *delta_vectors,
+                                                     const std::vector<uint32_t> &new_location,
+                                                     const std::vector<bool> &deleted,
+                                                     const tsl::robin_map<uint32_t, uint32_t> &delta_tag_to_new_id,
+                                                     const uint8_t *codes, const float *sdc_tables,
+                                                     std::vector<std::vector<uint32_t>> &delta_nhoods)
+{
+    const size_t dim = _disk->index->_data_dim;
+    const uint32_t max_degree = (uint32_t)_disk->index->_max_degree;
+    const uint64_t L = (std::max)(_delta_params.search_list_size, max_degree);
+
+    // candidates are the closest points on disk and in the merging delta,
+    // pruned like a regular insert
+#pragma omp parallel for schedule(dynamic, 16) num_threads(_num_threads)
+    for (int64_t j = 0; j < (int64_t)delta_tags.size(); j++)
+    {
+        const T *vec = delta_vectors + j * dim;
+        uint32_t new_id = delta_tag_to_new_id.find(delta_tags[j])->second;
+        std::vector<uint32_t> &candidates = delta_nhoods[j];
+
+        std::vector<uint64_t> disk_ids(L);
+        std::vector<float> disk_dists(L);
+        _disk->index->cached_beam_search(vec, L, L, disk_ids.data(), disk_dists.data(), MERGE_SEARCH_BEAM_WIDTH);
+        for (uint64_t i = 0; i < L && disk_ids[i] != std::numeric_limits<uint64_t>::max(); i++)
+        {
+            if (!deleted[disk_ids[i]])
+                candidates.push_back(new_location[disk_ids[i]]);
+        }
+
+        std::vector<uint32_t> tags(L);
+        std::vector<float> dists(L);
+        std::vector<T *> res_vectors;
+        size_t n = _merging_delta->search_with_tags(vec, L, (uint32_t)L, tags.data(), dists.data(), res_vectors);
+        for (size_t i = 0; i < n; i++)
+        {
+            auto iter = delta_tag_to_new_id.find(tags[i]);
+            if (iter != delta_tag_to_new_id.end() && iter->second != new_id)
+                candidates.push_back(iter->second);
+        }
+
+        prune_neighbors_with_pq_codes(new_id, candidates, codes, _disk->index->_n_chunks, sdc_tables, max_degree,
+                                      _delta_params.alpha);
+    }
+}
+
+template <typename T, typename LabelT> void FreshPQFlashIndex<T, LabelT>::merge(const std::string &new_index_prefix)
+{
+    std::lock_guard<std::mutex> merge_guard(_merge_mutex);
+    if (new_index_prefix == _index_prefix)
+    {
+        throw ANNException("Merge must write to a new index prefix", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    Timer timer;
+    PQFlashIndex<T, LabelT> &disk = *_disk->index;
+    const size_t num_points = disk.get_num_points();
+    const size_t dim = disk._data_dim;
+    const size_t n_chunks = disk._n_chunks;
+    const uint32_t max_degree = (uint32_t)disk._max_degree;
+
+    // freeze the delta and take a snapshot of the deletes, later updates go
+    // to a new delta and to _pending_deletes
+    std::vector<bool> deleted(num_points, false);
+    std::vector<uint32_t> delta_tags;
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(_lock);
+        _merging_delta = std::move(_delta);
+        _delta = create_delta();
+        for (size_t i = 0; i < num_points; i++)
+            deleted[i] = disk.is_deleted((uint32_t)i);
+        std::lock_guard<std::mutex> guard(_pending_deletes_mutex);
+        _pending_deletes.clear();
+        _merging_delta->get_active_tags(_merging_delta_tags);
+        delta_tags.assign(_merging_delta_tags.begin(), _merging_delta_tags.end());
+    }
+    std::sort(delta_tags.begin(), delta_tags.end());
+
+    // points deleted from the merging delta since the snapshot are dropped,
+    // their deletes need not be replayed
+    std::vector<T> delta_vectors(delta_tags.size() * dim);
+    size_t num_delta_points = 0;
+    for (size_t j = 0; j < delta_tags.size(); j++)
+    {
+        uint32_t tag = delta_tags[j];
+        if (_merging_delta->get_vector_by_tag(tag, delta_vectors.data() + num_delta_points * dim) != 0)
+            continue;
+        if (num_delta_points != j)
+            delta_tags[num_delta_points] = tag;
+        num_delta_points++;
+    }
+    delta_tags.resize(num_delta_points);
+    delta_vectors.resize(num_delta_points * dim);
+
+    // merged ids: surviving disk points in their current order, then the delta
+    std::vector<uint32_t> new_location(num_points, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> new_tags;
+    new_tags.reserve(num_points + delta_tags.size());
+    for (size_t i = 0; i < num_points; i++)
+    {
+        if (deleted[i])
+            continue;
+        new_location[i] = (uint32_t)new_tags.size();
+        new_tags.push_back(_disk_tags[i]);
+    }
+    const size_t num_surviving = new_tags.size();
+    tsl::robin_map<uint32_t, uint32_t> delta_tag_to_new_id;
+    for (auto tag : delta_tags)
+    {
+        delta_tag_to_new_id[tag] = (uint32_t)new_tags.size();
+        new_tags.push_back(tag);
+    }
+    const size_t new_num_points = new_tags.size();
+    if (new_num_points == 0)
+    {
+        throw ANNException("Merge would produce an empty index", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    diskann::cout << "Merging " << num_points - num_surviving << " deletes and " << delta_tags.size()
+                  << " inserts into " << new_index_prefix << std::endl;
+
+    // PQ codes of the merged index, also used for all distances below
+    std::vector<uint8_t> codes(new_num_points * n_chunks);
+    for (size_t i = 0; i < num_points; i++)
+    {
+        if (!deleted[i])
+            memcpy(codes.data() + new_location[i] * n_chunks, disk.data + i * n_chunks, n_chunks);
+    }
+    compress_vectors(delta_vectors.data(), delta_tags.size(), codes.data() + num_surviving * n_chunks);
+    std::vector<float> sdc_tables(256 * 256 * n_chunks);
+    disk._pq_table.populate_symmetric_chunk_distances(sdc_tables.data());
+
+    // streams the nodes of the current disk layout in order
+    const size_t read_blk_size = 64 * 1024 * 1024;
+    auto for_each_disk_node = [&](const std::function<void(uint32_t, const char *, uint32_t, const uint32_t *)> &fn) {
+        cached_ifstream disk_reader(disk._disk_index_file, read_blk_size);
+        const uint64_t nodes_per_read = disk._nnodes_per_sector > 0 ? disk._nnodes_per_sector : 1;
+        const uint64_t sectors_per_read =
+            disk._nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(disk._max_node_len, defaults::SECTOR_LEN);
+        std::vector<char> buf(sectors_per_read * defaults::SECTOR_LEN);
+        disk_reader.read(buf.data(), defaults::SECTOR_LEN); // metadata
+        for (uint64_t id = 0; id < num_points;)
+        {
+            disk_reader.read(buf.data(), buf.size());
+            for (uint64_t j = 0; j < nodes_per_read && id < num_points; j++, id++)
+            {
+                char *node_buf = buf.data() + j * disk._max_node_len;
+                uint32_t *nhood = disk.offset_to_node_nhood(node_buf);
+                fn((uint32_t)id, node_buf, (std::min)(nhood[0], max_degree), nhood + 1);
+            }
+        }
+    };
+
+    // pass 1: neighborhoods of the deleted points
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> deleted_nhoods;
+    if (num_surviving < num_points)
+    {
+        for_each_disk_node([&](uint32_t id, const char *, uint32_t nnbrs, const uint32_t *nbrs) {
+            if (deleted[id])
+                deleted_nhoods[id].assign(nbrs, nbrs + nnbrs);
+        });
+    }
+
+    // out-edges of the delta points and the reverse edges to patch in
+    std::vector<std::vector<uint32_t>> delta_nhoods(delta_tags.size());
+    link_delta_points(delta_tags, delta_vectors.data(), new_location, deleted, delta_tag_to_new_id, codes.data(),
+                      sdc_tables.data(), delta_nhoods);
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> in_edges;
+    for (size_t j = 0; j < delta_nhoods.size(); j++)
+    {
+        for (auto nbr : delta_nhoods[j])
+            in_edges[nbr].push_back((uint32_t)(num_surviving + j));
+    }
+
+    // reverse edges between delta points go in here, those into disk points
+    // while streaming the disk nodes below
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads)
+    for (int64_t j = 0; j < (int64_t)delta_nhoods.size(); j++)
+    {
+        const uint32_t new_id = (uint32_t)(num_surviving + j);
+        auto iter = in_edges.find(new_id);
+        if (iter == in_edges.end())
+            continue;
+        std::vector<uint32_t> &nhood = delta_nhoods[j];
+        nhood.insert(nhood.end(), iter->second.begin(), iter->second.end());
+        std::sort(nhood.begin(), nhood.end());
+        nhood.erase(std::unique(nhood.begin(), nhood.end()), nhood.end());
+        if (nhood.size() > max_degree)
+            prune_neighbors_with_pq_codes(new_id, nhood, codes.data(), n_chunks, sdc_tables.data(), max_degree,
+                                          _delta_params.alpha);
+    }
+
+    // entry point: the old medoid or, if it was deleted, one of its neighbors.
+    // Failing that the first delta point, or the first surviving point if
+    // there is no delta.
+    const uint32_t medoid = disk._medoids[0];
+    uint32_t new_medoid = (uint32_t)new_num_points;
+    if (!deleted[medoid])
+        new_medoid = new_location[medoid];
+    else
+    {
+        for (auto nbr : deleted_nhoods[medoid])
+        {
+            if (!deleted[nbr])
+            {
+                new_medoid = new_location[nbr];
+                break;
+            }
+        }
+    }
+    if (new_medoid == new_num_points)
+        new_medoid = num_surviving < new_num_points ? (uint32_t)num_surviving : 0;
+
+    // pass 2: write the data and the patched graph in the in-memory index
+    // format, then lay them out on disk
+    const std::string data_file = new_index_prefix + "_merge_data.bin";
+    const std::string graph_file = new_index_prefix + "_merge_graph.index";
+    {
+        const size_t write_blk_size = 64 * 1024 * 1024;
+        cached_ofstream data_writer(data_file, write_blk_size);
+        cached_ofstream graph_writer(graph_file, write_blk_size);
+        int32_t npts_i32 = (int32_t)new_num_points, dim_i32 = (int32_t)dim;
+        data_writer.write((char *)&npts_i32, sizeof(int32_t));
+        data_writer.write((char *)&dim_i32, sizeof(int32_t));
+
+        uint64_t graph_file_size = sizeof(uint64_t) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+        uint64_t num_frozen = 0;
+        std::vector<char> header(graph_file_size, 0);
+        graph_writer.write(header.data(), header.size());
+
+        auto write_nhood = [&](const std::vector<uint32_t> &nhood) {
+            uint32_t nnbrs = (uint32_t)nhood.size();
+            graph_writer.write((char *)&nnbrs, sizeof(uint32_t));
+            if (nnbrs > 0)
+                graph_writer.write((char *)nhood.data(), nnbrs * sizeof(uint32_t));
+            graph_file_size += sizeof(uint32_t) + nnbrs * sizeof(uint32_t);
+        };
+
+        // neighborhoods that lost neighbors are pruned with the neighbors of
+        // the deleted points as extra candidates; neighborhoods that only
+        // gained reverse edges are pruned if they overflow
+        std::vector<uint32_t> batch_ids;
+        std::vector<std::vector<uint32_t>> batch_nhoods;
+        std::vector<bool> batch_prune;
+        auto flush_batch = [&]() {
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads)
+            for (int64_t i = 0; i < (int64_t)batch_ids.size(); i++)
+            {
+                if (batch_prune[i] || batch_nhoods[i].size() > max_degree)
+                    prune_neighbors_with_pq_codes(batch_ids[i], batch_nhoods[i], codes.data(), n_chunks,
+                                                  sdc_tables.data(), max_degree, _delta_params.alpha);
+            }
+            for (auto &nhood : batch_nhoods)
+                write_nhood(nhood);
+            batch_ids.clear();
+            batch_nhoods.clear();
+            batch_prune.clear();
+        };
+
+        for_each_disk_node([&](uint32_t id, const char *node_buf, uint32_t nnbrs, const uint32_t *nbrs) {
+            if (deleted[id])
+                return;
+            uint32_t new_id = new_location[id];
+            data_writer.write((char *)node_buf, dim * sizeof(T));
+
+            std::vector<uint32_t> nhood;
+            bool lost_neighbors = false;
+            for (uint32_t k = 0; k < nnbrs; k++)
+            {
+                if (!deleted[nbrs[k]])
+                {
+                    nhood.push_back(new_location[nbrs[k]]);
+                    continue;
+                }
+                lost_neighbors = true;
+                for (auto nbr : deleted_nhoods[nbrs[k]])
+                {
+                    if (!deleted[nbr] && nbr != id)
+                        nhood.push_back(new_location[nbr]);
+                }
+            }
+            auto iter = in_edges.find(new_id);
+            if (iter != in_edges.end())
+                nhood.insert(nhood.end(), iter->second.begin(), iter->second.end());
+            std::sort(nhood.begin(), nhood.end());
+            nhood.erase(std::unique(nhood.begin(), nhood.end()), nhood.end());
+
+            batch_ids.push_back(new_id);
+            batch_nhoods.push_back(std::move(nhood));
+            batch_prune.push_back(lost_neighbors);
+            if (batch_ids.size() == MERGE_BATCH_SIZE)
+                flush_batch();
+        });
+        flush_batch();
+
+        data_writer.write((char *)delta_vectors.data(), delta_vectors.size() * sizeof(T));
+        for (auto &nhood : delta_nhoods)
+            write_nhood(nhood);
+
+        graph_writer.reset();
+        graph_writer.write((char *)&graph_file_size, sizeof(uint64_t));
+        graph_writer.write((char *)&max_degree, sizeof(uint32_t));
+        graph_writer.write((char *)&new_medoid, sizeof(uint32_t));
+        graph_writer.write((char *)&num_frozen, sizeof(uint64_t));
+    }
+
+    create_disk_layout<T>(data_file, graph_file, new_index_prefix + "_disk.index");
+    diskann::save_bin<uint8_t>(new_index_prefix + "_pq_compressed.bin", codes.data(), new_num_points, n_chunks);
+    std::filesystem::copy_file(_index_prefix + "_pq_pivots.bin", new_index_prefix + "_pq_pivots.bin",
+                               std::filesystem::copy_options::overwrite_existing);
+    diskann::save_bin<uint32_t>(new_index_prefix + "_disk.index_tags.bin", new_tags.data(), new_num_points, 1);
+    std::remove(data_file.c_str());
+    std::remove(graph_file.c_str());
+
+    // load the merged index and swap it in
+    auto new_disk = load_disk_index(new_index_prefix);
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(_lock);
+        _disk = std::move(new_disk);
+        _index_prefix = new_index_prefix;
+        load_disk_tags(new_index_prefix, new_num_points);
+
+        std::lock_guard<std::mutex> guard(_pending_deletes_mutex);
+        for (auto tag : _pending_deletes)
+        {
+            auto iter = _tag_to_disk_location.find(tag);
+            if (iter != _tag_to_disk_location.end())
+                _disk->index->lazy_delete(iter->second);
+        }
+        _pending_deletes.clear();
+        _merging_delta_tags.clear();
+        _merging_delta.reset();
+    }
+
+    diskann::cout << "Merge done in " << timer.elapsed_seconds() << "s, disk index now has " << new_num_points
+                  << " points" << std::endl;
+}
+
+template <typename T, typename LabelT>
+std::future<void> FreshPQFlashIndex<T, LabelT>::merge_async(const std::string &new_index_prefix)
+{
+    return std::async(std::launch::async, [this, new_index_prefix]() { merge(new_index_prefix); });
+}
+
+template <typename T, typename LabelT> size_t FreshPQFlashIndex<T, LabelT>::get_num_disk_points()
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+    return _disk->index->get_num_points() - _disk->index->get_num_deleted_points();
+}
+
+template <typename T, typename LabelT> size_t FreshPQFlashIndex<T, LabelT>::get_num_delta_points()
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+    size_t num_points = _delta->get_num_points();
+    if (_merging_delta != nullptr)
+        num_points += _merging_delta->get_num_points();
+    return num_points;
+}
+
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<float>;
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<int8_t>;
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<uint8_t>;
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<float, uint16_t>;
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<int8_t, uint16_t>;
+template DISKANN_DLLEXPORT class FreshPQFlashIndex<uint8_t, uint16_t>;
+
+} // namespace diskann
@@ -0,0 +1,605 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "cached_io.h"
+#include "compressed_graph.h"
+#include "defaults.h"
+#include "filter_utils.h"
+#include "graph_reorder.h"
+#include "utils.h"
+
+namespace diskann
+{
+
+namespace
+{
+
+// Layout of a disk index as described by the metadata in its first sector.
+struct DiskIndexLayout
+{
+    std::vector<uint64_t> meta;
+    uint64_t npts = 0, ndims = 0, medoid = 0, max_node_len = 0, nnodes_per_sector = 0;
+    uint64_t num_frozen = 0, frozen_loc = 0, append_reorder_data = 0;
+
+    uint64_t node_offset(uint64_t id) const
+    {
+        if (nnodes_per_sector > 0)
+            return defaults::SECTOR_LEN * (1 + id / nnodes_per_sector) + (id % nnodes_per_sector) * max_node_len;
+        return defaults::SECTOR_LEN * (1 + id * DIV_ROUND_UP(max_node_len, defaults::SECTOR_LEN));
+    }
+};
+
+DiskIndexLayout read_disk_index_layout(const std::string &disk_index_file)
+{
+    std::ifstream reader(disk_index_file, std::ios::binary);
+    if (!reader.is_open())
+        throw ANNException("Could not open disk index " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    uint32_t nr, nc;
+    reader.read((char *)&nr, sizeof(uint32_t));
+    reader.read((char *)&nc, sizeof(uint32_t));
+    DiskIndexLayout layout;
+    layout.meta.resize(nr);
+    reader.read((char *)layout.meta.data(), nr * sizeof(uint64_t));
+    if (!reader || nr < 9)
+        throw ANNException("Unsupported metadata in disk index " + disk_index_file, -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+
+    layout.npts = layout.meta[0];
+    layout.ndims = layout.meta[1];
+    layout.medoid = layout.meta[2];
+    layout.max_node_len = layout.meta[3];
+    layout.nnodes_per_sector = layout.meta[4];
+    layout.num_frozen = layout.meta[5];
+    layout.frozen_loc = layout.meta[6];
+    layout.append_reorder_data = layout.meta[7];
+    return layout;
+}
+
+std::vector<uint32_t> invert_order(const std::vector<uint32_t> &new_to_old, size_t num_points)
+{
+    if (new_to_old.size() != num_points)
+    {
+        std::stringstream stream;
+        stream << "Order has " << new_to_old.size() << " ids, the index has " << num_points << " points";
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::vector<uint32_t> old_to_new(num_points, std::numeric_limits<uint32_t>::max());
+    for (size_t i = 0; i < num_points; i++)
+    {
+        uint32_t old_id = new_to_old[i];
+        if (old_id >= num_points || old_to_new[old_id] != std::numeric_limits<uint32_t>::max())
+            throw ANNException("Order is not a permutation of the point ids", -1, __FUNCSIG__, __FILE__, __LINE__);
+        old_to_new[old_id] = (uint32_t)i;
+    }
+    return old_to_new;
+}
+
+void copy_if_exists(const std::string &in_file, const std::string &out_file)
+{
+    if (!file_exists(in_file))
+        return;
+    std::ifstream in(in_file, std::ios::binary);
+    std::ofstream out(out_file, std::ios::binary);
+    out << in.rdbuf();
+}
+
+// Rows of a bin file in the new order.
+template <typename TT>
+void permute_bin_rows(const std::string &in_file, const std::string &out_file, const std::vector<uint32_t> &new_to_old)
+{
+    if (!file_exists(in_file))
+        return;
+    TT *data = nullptr;
+    size_t npts, dim;
+    load_bin<TT>(in_file, data, npts, dim);
+    std::unique_ptr<TT[]> data_holder(data);
+    if (npts != new_to_old.size())
+        throw ANNException("Unexpected number of rows in " + in_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    std::vector<TT> permuted(npts * dim);
+    for (size_t i = 0; i < npts; i++)
+        std::copy(data + (size_t)new_to_old[i] * dim, data + ((size_t)new_to_old[i] + 1) * dim,
+                  permuted.data() + i * dim);
+    save_bin<TT>(out_file, permuted.data(), npts, dim);
+}
+
+// Lines of a text file with one line per point, e.g. a labels file.
+void permute_lines(const std::string &in_file, const std::string &out_file, const std::vector<uint32_t> &new_to_old)
+{
+    if (!file_exists(in_file))
+        return;
+    std::ifstream in(in_file);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line))
+        lines.push_back(line);
+    if (lines.size() != new_to_old.size())
+        throw ANNException("Unexpected number of lines in " + in_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    std::ofstream out(out_file);
+    for (uint32_t old_id : new_to_old)
+        out << lines[old_id] << std::endl;
+}
+
+// Comma separated lines whose fields from first_id_field on are point ids,
+// e.g. label to medoid files.
+void remap_id_fields(const std::string &in_file, const std::string &out_file, const std::vector<uint32_t> &old_to_new,
+                     uint32_t first_id_field)
+{
+    if (!file_exists(in_file))
+        return;
+    std::ifstream in(in_file);
+    std::ofstream out(out_file);
+    std::string line, token;
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+        std::istringstream iss(line);
+        uint32_t field = 0;
+        while (std::getline(iss, token, ','))
+        {
+            if (field > 0)
+                out << ", ";
+            if (field >= first_id_field)
+            {
+                uint32_t id = (uint32_t)std::stoul(token);
+                out << (id < old_to_new.size() ? old_to_new[id] : id);
+            }
+            else
+            {
+                out << token;
+            }
+            field++;
+        }
+        out << std::endl;
+    }
+}
+
+// The binary labels are rebuilt from the reordered text label files, with
+// the label type of the input.
+void convert_labels_if_exists(const std::string &in_prefix, const std::string &out_prefix)
+{
+    if (!file_exists(in_prefix + "_labels.bin"))
+        return;
+    if (get_bin_labels_label_size(in_prefix + "_labels.bin") == sizeof(uint16_t))
+        convert_label_files_to_bin<uint16_t>(out_prefix);
+    else
+        convert_label_files_to_bin<uint32_t>(out_prefix);
+}
+
+} // namespace
+
+std::vector<uint32_t> compute_bfs_order(const std::vector<std::vector<uint32_t>> &graph, uint32_t start, bool reverse)
+{
+    const size_t num_points = graph.size();
+    std::vector<uint32_t> order;
+    order.reserve(num_points);
+    std::vector<bool> visited(num_points, false);
+    std::vector<uint32_t> nbrs;
+
+    auto bfs = [&](uint32_t root) {
+        size_t head = order.size();
+        visited[root] = true;
+        order.push_back(root);
+        while (head < order.size())
+        {
+            uint32_t node = order[head++];
+            nbrs.clear();
+            for (uint32_t nbr : graph[node])
+            {
+                if (nbr < num_points && !visited[nbr])
+                {
+                    visited[nbr] = true;
+                    nbrs.push_back(nbr);
+                }
+            }
+            std::sort(nbrs.begin(), nbrs.end(), [&graph](uint32_t a, uint32_t b) {
+                return graph[a].size() < graph[b].size() || (graph[a].size() == graph[b].size() && a < b);
+            });
+            order.insert(order.end(), nbrs.begin(), nbrs.end());
+        }
+    };
+
+    if (start < num_points)
+        bfs(start);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        if (!visited[i])
+            bfs(i);
+    }
+    if (reverse)
+        std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<uint32_t> load_partition_order(const std::string &partition_file, size_t num_points)
+{
+    std::ifstream reader(partition_file, std::ios::binary);
+    if (!reader.is_open())
+        throw ANNException("Could not open partition file " + partition_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    uint64_t C, num_partitions, nd;
+    reader.read((char *)&C, sizeof(uint64_t));
+    reader.read((char *)&num_partitions, sizeof(uint64_t));
+    reader.read((char *)&nd, sizeof(uint64_t));
+    if (nd != num_points)
+    {
+        std::stringstream stream;
+        stream << "Partition file " << partition_file << " covers " << nd << " points, the index has " << num_points;
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(num_points);
+    for (uint64_t p = 0; p < num_partitions; p++)
+    {
+        uint32_t psize;
+        reader.read((char *)&psize, sizeof(uint32_t));
+        size_t begin = order.size();
+        order.resize(begin + psize);
+        reader.read((char *)(order.data() + begin), psize * sizeof(uint32_t));
+    }
+    if (!reader)
+        throw ANNException("Truncated partition file " + partition_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    return order;
+}
+
+template <typename T>
+void load_disk_index_graph(const std::string &disk_index_file, std::vector<std::vector<uint32_t>> &graph,
+                           uint32_t &medoid)
+{
+    DiskIndexLayout layout = read_disk_index_layout(disk_index_file);
+    medoid = (uint32_t)layout.medoid;
+    graph.assign(layout.npts, std::vector<uint32_t>());
+
+    // nodes are stored in id order, read them sector by sector
+    cached_ifstream reader(disk_index_file, 64 * 1024 * 1024);
+    std::vector<char> buf(ROUND_UP(layout.max_node_len, defaults::SECTOR_LEN));
+    reader.read(buf.data(), defaults::SECTOR_LEN);
+    const uint64_t coords_len = layout.ndims * sizeof(T);
+    const uint64_t nodes_per_read = layout.nnodes_per_sector > 0 ? layout.nnodes_per_sector : 1;
+    const uint64_t read_len = layout.nnodes_per_sector > 0 ? defaults::SECTOR_LEN : buf.size();
+    for (uint64_t id = 0; id < layout.npts; id += nodes_per_read)
+    {
+        reader.read(buf.data(), read_len);
+        for (uint64_t j = 0; j < nodes_per_read && id + j < layout.npts; j++)
+        {
+            const char *node = buf.data() + j * layout.max_node_len + coords_len;
+            uint32_t nnbrs = *(const uint32_t *)node;
+            const uint32_t *nbrs = (const uint32_t *)(node + sizeof(uint32_t));
+            graph[id + j].assign(nbrs, nbrs + nnbrs);
+        }
+    }
+}
+
+template <typename T>
+void reorder_disk_index(const std::string &index_prefix, const std::string &output_prefix,
+                        const std::vector<uint32_t> &new_to_old)
+{
+    const std::string disk_index_file = index_prefix + "_disk.index";
+    const std::string out_disk_index_file = output_prefix + "_disk.index";
+    DiskIndexLayout layout = read_disk_index_layout(disk_index_file);
+    if (layout.append_reorder_data)
+        throw ANNException("Reordering disk indexes with reorder data is not supported", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    std::vector<uint32_t> old_to_new = invert_order(new_to_old, layout.npts);
+
+    // nodes: same layout, new positions, neighbor ids translated
+    std::vector<uint64_t> meta = layout.meta;
+    meta[2] = old_to_new[layout.medoid];
+    if (layout.num_frozen > 0)
+        meta[6] = old_to_new[layout.frozen_loc];
+
+    std::ifstream reader(disk_index_file, std::ios::binary);
+    cached_ofstream writer(out_disk_index_file, 64 * 1024 * 1024);
+    const uint64_t coords_len = layout.ndims * sizeof(T);
+    const uint64_t nodes_per_write = layout.nnodes_per_sector > 0 ? layout.nnodes_per_sector : 1;
+    const uint64_t write_len = layout.nnodes_per_sector > 0 ? defaults::SECTOR_LEN
+                                                            : ROUND_UP(layout.max_node_len, defaults::SECTOR_LEN);
+    std::vector<char> sector_buf(std::max<uint64_t>(write_len, defaults::SECTOR_LEN), 0);
+    writer.write(sector_buf.data(), defaults::SECTOR_LEN);
+
+    for (uint64_t id = 0; id < layout.npts; id += nodes_per_write)
+    {
+        std::fill(sector_buf.begin(), sector_buf.end(), 0);
+        for (uint64_t j = 0; j < nodes_per_write && id + j < layout.npts; j++)
+        {
+            char *node = sector_buf.data() + j * layout.max_node_len;
+            reader.seekg(layout.node_offset(new_to_old[id + j]), std::ios::beg);
+            reader.read(node, layout.max_node_len);
+
+            uint32_t nnbrs = *(uint32_t *)(node + coords_len);
+            uint32_t *nbrs = (uint32_t *)(node + coords_len + sizeof(uint32_t));
+            for (uint32_t k = 0; k < nnbrs; k++)
+                nbrs[k] = old_to_new[nbrs[k]];
+        }
+        writer.write(sector_buf.data(), write_len);
+    }
+    if (!reader)
+        throw ANNException("Failed to read disk index " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    writer.close();
+    save_bin<uint64_t>(out_disk_index_file, meta.data(), meta.size(), 1, 0);
+    diskann::cout << "Reordered disk index written to " << out_disk_index_file << std::endl;
+
+    // PQ codes, medoids and per point side files
+    permute_bin_rows<uint8_t>(index_prefix + "_pq_compressed.bin", output_prefix + "_pq_compressed.bin", new_to_old);
+    copy_if_exists(index_prefix + "_pq_pivots.bin", output_prefix + "_pq_pivots.bin");
+    copy_if_exists(disk_index_file + "_pq_pivots.bin", out_disk_index_file + "_pq_pivots.bin");
+    copy_if_exists(disk_index_file + "_max_base_norm.bin", out_disk_index_file + "_max_base_norm.bin");
+    copy_if_exists(disk_index_file + "_centroids.bin", out_disk_index_file + "_centroids.bin");
+    if (file_exists(disk_index_file + "_medoids.bin"))
+    {
+        uint32_t *medoids = nullptr;
+        size_t num_medoids, dim;
+        load_bin<uint32_t>(disk_index_file + "_medoids.bin", medoids, num_medoids, dim);
+        for (size_t i = 0; i < num_medoids * dim; i++)
+            medoids[i] = old_to_new[medoids[i]];
+        save_bin<uint32_t>(out_disk_index_file + "_medoids.bin", medoids, num_medoids, dim);
+        delete[] medoids;
+    }
+    permute_bin_rows<uint32_t>(disk_index_file + "_tags.bin", out_disk_index_file + "_tags.bin", new_to_old);
+
+    permute_lines(disk_index_file + "_labels.txt", out_disk_index_file + "_labels.txt", new_to_old);
+    copy_if_exists(disk_index_file + "_labels_map.txt", out_disk_index_file + "_labels_map.txt");
+    copy_if_exists(disk_index_file + "_universal_label.txt", out_disk_index_file + "_universal_label.txt");
+    remap_id_fields(disk_index_file + "_labels_to_medoids.txt", out_disk_index_file + "_labels_to_medoids.txt",
+                    old_to_new, 1);
+    remap_id_fields(disk_index_file + "_dummy_map.txt", out_disk_index_file + "_dummy_map.txt", old_to_new, 0);
+    convert_labels_if_exists(disk_index_file, out_disk_index_file);
+
+    save_bin<uint32_t>(out_disk_index_file + "_id_map.bin", const_cast<uint32_t *>(new_to_old.data()),
+                       new_to_old.size(), 1);
+}
+
+void reorder_partition_files(const std::string &partition_prefix, const std::string &output_prefix,
+                             const std::vector<uint32_t> &new_to_old)
+{
+    const std::string partition_file = partition_prefix + "_partition.bin";
+    const std::string graph_file = partition_prefix + "_disk_graph.index";
+    const std::string out_partition_file = output_prefix + "_partition.bin";
+    const std::string out_graph_file = output_prefix + "_disk_graph.index";
+    std::vector<uint32_t> old_to_new = invert_order(new_to_old, new_to_old.size());
+
+    // the partitions keep their nodes in the same order, so every node keeps
+    // its place in the sector of its partition
+    std::ifstream partition_reader(partition_file, std::ios::binary);
+    if (!partition_reader.is_open())
+        throw ANNException("Could not open partition file " + partition_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    uint64_t C, num_partitions, nd;
+    partition_reader.read((char *)&C, sizeof(uint64_t));
+    partition_reader.read((char *)&num_partitions, sizeof(uint64_t));
+    partition_reader.read((char *)&nd, sizeof(uint64_t));
+    if (nd != new_to_old.size())
+    {
+        std::stringstream stream;
+        stream << "Partition file " << partition_file << " covers " << nd << " points, the index has "
+               << new_to_old.size();
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::vector<std::vector<uint32_t>> partitions(num_partitions);
+    for (auto &partition : partitions)
+    {
+        uint32_t psize;
+        partition_reader.read((char *)&psize, sizeof(uint32_t));
+        partition.resize(psize);
+        partition_reader.read((char *)partition.data(), psize * sizeof(uint32_t));
+    }
+    std::vector<uint32_t> id2partition(nd);
+    partition_reader.read((char *)id2partition.data(), nd * sizeof(uint32_t));
+    if (!partition_reader)
+        throw ANNException("Truncated partition file " + partition_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    std::ofstream partition_writer(out_partition_file, std::ios::binary);
+    partition_writer.write((char *)&C, sizeof(uint64_t));
+    partition_writer.write((char *)&num_partitions, sizeof(uint64_t));
+    partition_writer.write((char *)&nd, sizeof(uint64_t));
+    for (auto &partition : partitions)
+    {
+        for (auto &id : partition)
+        {
+            if (id >= nd)
+                throw ANNException("Invalid node id in " + partition_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+            id = old_to_new[id];
+        }
+        uint32_t psize = (uint32_t)partition.size();
+        partition_writer.write((char *)&psize, sizeof(uint32_t));
+        partition_writer.write((char *)partition.data(), psize * sizeof(uint32_t));
+    }
+    for (uint64_t i = 0; i < nd; i++)
+        partition_writer.write((char *)&id2partition[new_to_old[i]], sizeof(uint32_t));
+    partition_writer.close();
+
+    // graph file: sector 0 holds the metadata, sector p + 1 the adjacency
+    // lists of partition p
+    std::ifstream graph_reader(graph_file, std::ios::binary);
+    if (!graph_reader.is_open())
+        throw ANNException("Could not open graph file " + graph_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    std::vector<char> sector(defaults::SECTOR_LEN, 0), out_sector(defaults::SECTOR_LEN, 0);
+    graph_reader.read(sector.data(), defaults::SECTOR_LEN);
+    int32_t meta_n = *(int32_t *)sector.data();
+    if (!graph_reader || meta_n < 9 || 8 + (size_t)meta_n * sizeof(uint64_t) > defaults::SECTOR_LEN)
+        throw ANNException("Unsupported metadata in graph file " + graph_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    uint64_t *meta = (uint64_t *)(sector.data() + 8);
+    const bool compressed = is_compressed_graph_header(sector.data());
+    const uint64_t graph_node_len = meta[3] - meta[1] * sizeof(float);
+    const uint64_t max_degree = graph_node_len / sizeof(uint32_t) - 1;
+    if (meta[2] < nd)
+        meta[2] = old_to_new[meta[2]];
+    if (meta[5] > 0 && meta[6] < nd)
+        meta[6] = old_to_new[meta[6]];
+
+    std::ofstream graph_writer(out_graph_file, std::ios::binary);
+    graph_writer.write(sector.data(), defaults::SECTOR_LEN);
+    std::vector<uint32_t> nbrs(max_degree);
+    std::vector<uint8_t> records;
+    std::vector<uint16_t> offsets;
+    for (uint64_t p = 0; p < num_partitions; p++)
+    {
+        graph_reader.read(sector.data(), defaults::SECTOR_LEN);
+        if (!graph_reader)
+            throw ANNException("Truncated graph file " + graph_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+        const uint32_t num_nodes = (uint32_t)partitions[p].size();
+        if (!compressed)
+        {
+            for (uint32_t j = 0; j < num_nodes && (j + 1) * graph_node_len <= defaults::SECTOR_LEN; j++)
+            {
+                uint32_t *node = (uint32_t *)(sector.data() + j * graph_node_len);
+                for (uint32_t k = 0; k < node[0] && k < max_degree; k++)
+                    node[k + 1] = node[k + 1] < nd ? old_to_new[node[k + 1]] : node[k + 1];
+            }
+            graph_writer.write(sector.data(), defaults::SECTOR_LEN);
+            continue;
+        }
+
+        // the gaps between the sorted neighbor ids change, so the records are
+        // encoded again and the sector rebuilt
+        records.clear();
+        offsets.assign(1, (uint16_t)(sizeof(uint16_t) * (num_nodes + 2)));
+        for (uint32_t j = 0; j < num_nodes; j++)
+        {
+            const uint8_t *record;
+            size_t record_len;
+            uint64_t nnbrs;
+            if (!get_compressed_record(sector.data(), defaults::SECTOR_LEN, j, record, record_len) ||
+                !decode_adjacency(record, record_len, nbrs.data(), max_degree, nnbrs))
+                throw ANNException("Malformed record in graph file " + graph_file, -1, __FUNCSIG__, __FILE__,
+                                   __LINE__);
+            for (uint64_t k = 0; k < nnbrs; k++)
+                nbrs[k] = nbrs[k] < nd ? old_to_new[nbrs[k]] : nbrs[k];
+            encode_adjacency(nbrs.data(), (uint32_t)nnbrs, records);
+            if (offsets[0] + records.size() > defaults::SECTOR_LEN)
+            {
+                std::stringstream stream;
+                stream << "Partition " << p << " no longer fits in a sector once its ids are reordered, partition "
+                       << "the reordered index again";
+                throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+            }
+            offsets.push_back((uint16_t)(offsets[0] + records.size()));
+        }
+        std::fill(out_sector.begin(), out_sector.end(), 0);
+        uint16_t num_records = (uint16_t)num_nodes;
+        std::memcpy(out_sector.data(), &num_records, sizeof(uint16_t));
+        std::memcpy(out_sector.data() + sizeof(uint16_t), offsets.data(), offsets.size() * sizeof(uint16_t));
+        std::memcpy(out_sector.data() + offsets[0], records.data(), records.size());
+        graph_writer.write(out_sector.data(), defaults::SECTOR_LEN);
+    }
+    graph_writer.close();
+    diskann::cout << "Reordered graph partition files written to " << out_partition_file << " and "
+                  << out_graph_file << std::endl;
+}
+
+void load_memory_index_graph(const std::string &index_file, std::vector<std::vector<uint32_t>> &graph,
+                             uint32_t &start)
+{
+    std::ifstream reader(index_file, std::ios::binary);
+    if (!reader.is_open())
+        throw ANNException("Could not open index " + index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    size_t expected_file_size, num_frozen;
+    uint32_t max_observed_degree;
+    reader.read((char *)&expected_file_size, sizeof(size_t));
+    reader.read((char *)&max_observed_degree, sizeof(uint32_t));
+    reader.read((char *)&start, sizeof(uint32_t));
+    reader.read((char *)&num_frozen, sizeof(size_t));
+    if (num_frozen > 0)
+        throw ANNException("Reordering indexes with frozen points is not supported", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+
+    graph.clear();
+    size_t bytes_read = 24;
+    while (bytes_read < expected_file_size)
+    {
+        uint32_t k;
+        reader.read((char *)&k, sizeof(uint32_t));
+        graph.emplace_back(k);
+        reader.read((char *)graph.back().data(), k * sizeof(uint32_t));
+        bytes_read += sizeof(uint32_t) * ((size_t)k + 1);
+    }
+    if (!reader)
+        throw ANNException("Failed to read index " + index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+}
+
+template <typename T>
+void reorder_memory_index(const std::string &index_file, const std::string &output_file,
+                          const std::vector<uint32_t> &new_to_old)
+{
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t start;
+    load_memory_index_graph(index_file, graph, start);
+    std::vector<uint32_t> old_to_new = invert_order(new_to_old, graph.size());
+
+    std::ofstream writer(output_file, std::ios::binary);
+    size_t index_size = 24, num_frozen = 0;
+    uint32_t max_degree = 0, new_start = old_to_new[start];
+    writer.write((char *)&index_size, sizeof(uint64_t));
+    writer.write((char *)&max_degree, sizeof(uint32_t));
+    writer.write((char *)&new_start, sizeof(uint32_t));
+    writer.write((char *)&num_frozen, sizeof(size_t));
+    std::vector<uint32_t> nbrs;
+    for (uint32_t old_id : new_to_old)
+    {
+        nbrs.clear();
+        for (uint32_t nbr : graph[old_id])
+            nbrs.push_back(old_to_new[nbr]);
+        uint32_t k = (uint32_t)nbrs.size();
+        writer.write((char *)&k, sizeof(uint32_t));
+        writer.write((char *)nbrs.data(), k * sizeof(uint32_t));
+        max_degree = (std::max)(max_degree, k);
+        index_size += sizeof(uint32_t) * ((size_t)k + 1);
+    }
+    writer.seekp(0, writer.beg);
+    writer.write((char *)&index_size, sizeof(uint64_t));
+    writer.write((char *)&max_degree, sizeof(uint32_t));
+    writer.close();
+    diskann::cout << "Reordered index written to " << output_file << std::endl;
+
+    permute_bin_rows<T>(index_file + ".data", output_file + ".data", new_to_old);
+    permute_bin_rows<uint32_t>(index_file + ".tags", output_file + ".tags", new_to_old);
+    permute_lines(index_file + "_labels.txt", output_file + "_labels.txt", new_to_old);
+    copy_if_exists(index_file + "_labels_map.txt", output_file + "_labels_map.txt");
+    copy_if_exists(index_file + "_universal_label.txt", output_file + "_universal_label.txt");
+    remap_id_fields(index_file + "_labels_to_medoids.txt", output_file + "_labels_to_medoids.txt", old_to_new, 1);
+    convert_labels_if_exists(index_file, output_file);
+
+    save_bin<uint32_t>(output_file + "_id_map.bin", const_cast<uint32_t *>(new_to_old.data()), new_to_old.size(),
+                       1);
+}
+
+template DISKANN_DLLEXPORT void load_disk_index_graph<float>(const std::string &disk_index_file,
+                                                             std::vector<std::vector<uint32_t>> &graph,
+                                                             uint32_t &medoid);
+template DISKANN_DLLEXPORT void load_disk_index_graph<int8_t>(const std::string &disk_index_file,
+                                                              std::vector<std::vector<uint32_t>> &graph,
+                                                              uint32_t &medoid);
+template DISKANN_DLLEXPORT void load_disk_index_graph<uint8_t>(const std::string &disk_index_file,
+                                                               std::vector<std::vector<uint32_t>> &graph,
+                                                               uint32_t &medoid);
+
+template DISKANN_DLLEXPORT void reorder_disk_index<float>(const std::string &index_prefix,
+                                                          const std::string &output_prefix,
+                                                          const std::vector<uint32_t> &new_to_old);
+template DISKANN_DLLEXPORT void reorder_disk_index<int8_t>(const std::string &index_prefix,
+                                                           const std::string &output_prefix,
+                                                           const std::vector<uint32_t> &new_to_old);
+template DISKANN_DLLEXPORT void reorder_disk_index<uint8_t>(const std::string &index_prefix,
+                                                            const std::string &output_prefix,
+                                                            const std::vector<uint32_t> &new_to_old);
+
+template DISKANN_DLLEXPORT void reorder_memory_index<float>(const std::string &index_file,
+                                                            const std::string &output_file,
+                                                            const std::vector<uint32_t> &new_to_old);
+template DISKANN_DLLEXPORT void reorder_memory_index<int8_t>(const std::string &index_file,
+                                                             const std::string &output_file,
+                                                             const std::vector<uint32_t> &new_to_old);
+template DISKANN_DLLEXPORT void reorder_memory_index<uint8_t>(const std::string &index_file,
+                                                              const std::string &output_file,
+                                                              const std::vector<uint32_t> &new_to_old);
+
+} // namespace diskann
@@ -6,6 +6,7 @@
 #include <type_traits>
 
 #include "boost/dynamic_bitset.hpp"
+#include "filter_utils.h"
 #include "index_factory.h"
 #include "memory_mapper.h"
 #include "timer.h"
@@ -24,6 +25,15 @@
 #include "index.h"
 
 #define MAX_POINTS_FOR_USING_BITSET 10000000
+// Nodes of the packed layout start on cache lines, which also keeps the
+// vectors aligned for the distance functions. The .packed file has a header
+// of this size so that the nodes stay aligned when the file is mapped. The
+// header starts with a magic word ("DANNPACK") and the layout version, which
+// is bumped whenever the header or the node layout changes.
+#define PACKED_NODE_ALIGNMENT 64
+#define PACKED_INDEX_HEADER_SIZE 4096
+#define PACKED_INDEX_MAGIC 0x4b4341504e4e4144ULL
+#define PACKED_INDEX_VERSION 1
 
 namespace diskann
 {
@@ -158,6 +168,8 @@ Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_point
 
 template <typename T, typename TagT, typename LabelT> Index<T, TagT, LabelT>::~Index()
 {
+    stop_background_consolidation();
+
     // Ensure that no other activity is happening before dtor()
     std::unique_lock<std::shared_timed_mutex> ul(_update_lock);
     std::unique_lock<std::shared_timed_mutex> cl(_consolidate_lock);
@@ -169,9 +181,9 @@ template <typename T, typename TagT, typename LabelT> Index<T, TagT, LabelT>::~I
         LockGuard lg(lock);
     }
 
-    if (_opt_graph != nullptr)
+    if (_opt_graph != nullptr && _opt_graph_mapper == nullptr)
     {
-        delete[] _opt_graph;
+        aligned_free(_opt_graph);
     }
 
     if (!_query_scratch.empty())
@@ -362,19 +374,37 @@ void Index<T, TagT, LabelT>::save(const char *filename, bool compact_before_save
             }
         }
 
+        // load() prefers the binary labels, so they are rewritten with the
+        // text files or removed if this index has no labels
+        std::string bin_labels_file = std::string(filename) + "_labels.bin";
+        if (_filtered_index && _location_to_labels.size() > 0)
+            convert_label_files_to_bin<LabelT>(filename);
+        else
+            delete_file(bin_labels_file);
+
         std::string graph_file = std::string(filename);
         std::string tags_file = std::string(filename) + ".tags";
         std::string data_file = std::string(filename) + ".data";
         std::string delete_list_file = std::string(filename) + ".del";
+        std::string packed_file = std::string(filename) + ".packed";
 
         // Because the save_* functions use append mode, ensure that
         // the files are deleted before save. Ideally, we should check
         // the error code for delete_file, but will ignore now because
         // delete should succeed if save will succeed.
         delete_file(graph_file);
-        save_graph(graph_file);
         delete_file(data_file);
-        save_data(data_file);
+        delete_file(packed_file);
+        // a packed index keeps graph and data in the .packed file only
+        if (_opt_graph != nullptr)
+        {
+            save_packed(packed_file);
+        }
+        else
+        {
+            save_graph(graph_file);
+            save_data(data_file);
+        }
         delete_file(tags_file);
         save_tags(tags_file);
         delete_file(delete_list_file);
@@ -558,7 +588,16 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
         std::string tags_file = std::string(filename) + ".tags";
         std::string delete_set_file = std::string(filename) + ".del";
         std::string graph_file = std::string(filename);
-        data_file_num_pts = load_data(data_file);
+        std::string packed_file = std::string(filename) + ".packed";
+        if (file_exists(packed_file))
+        {
+            data_file_num_pts = load_packed(packed_file);
+            graph_num_pts = data_file_num_pts;
+        }
+        else
+        {
+            data_file_num_pts = load_data(data_file);
+        }
         if (file_exists(delete_set_file))
         {
             load_delete_set(delete_set_file);
@@ -567,7 +606,10 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
         {
             tags_file_num_pts = load_tags(tags_file);
         }
-        graph_num_pts = load_graph(graph_file, data_file_num_pts);
+        if (_opt_graph == nullptr)
+        {
+            graph_num_pts = load_graph(graph_file, data_file_num_pts);
+        }
 #endif
     }
     else
@@ -588,11 +630,29 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
-    if (file_exists(labels_file))
+    // the labels of the points, and of the frozen points if save() wrote them
+    auto check_label_num_pts = [&](const std::string &file) {
+        if (label_num_pts != data_file_num_pts && label_num_pts != data_file_num_pts - _num_frozen_pts)
+        {
+            std::stringstream stream;
+            stream << "ERROR: When loading index, loaded labels of " << label_num_pts << " points from " << file
+                   << " for " << data_file_num_pts << " points in the datafile." << std::endl;
+            diskann::cerr << stream.str() << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+    };
+    std::string bin_labels_file = mem_index_file + "_labels.bin";
+    if (file_exists(bin_labels_file))
+    {
+        _label_map = load_label_map(labels_map_file);
+        load_bin_labels(bin_labels_file, label_num_pts);
+        check_label_num_pts(bin_labels_file);
+    }
+    else if (file_exists(labels_file))
     {
         _label_map = load_label_map(labels_map_file);
         parse_label_file(labels_file, label_num_pts);
-        assert(label_num_pts == data_file_num_pts - _num_frozen_pts);
+        check_label_num_pts(labels_file);
         if (file_exists(labels_to_medoids))
         {
             std::ifstream medoid_stream(labels_to_medoids);
@@ -654,8 +714,9 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
     // initialize_q_s().
     if (_query_scratch.size() == 0)
     {
-        initialize_query_scratch(num_threads, search_l, search_l, (uint32_t)_graph_store->get_max_range_of_graph(),
-                                 _indexingMaxC, _dim);
+        uint32_t max_range = _opt_graph != nullptr ? (uint32_t)(_neighbor_len / sizeof(uint32_t) - 1)
+                                                   : (uint32_t)_graph_store->get_max_range_of_graph();
+        initialize_query_scratch(num_threads, search_l, search_l, max_range, _indexingMaxC, _dim);
     }
 }
 
@@ -663,6 +724,10 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
 template <typename T, typename TagT, typename LabelT>
 size_t Index<T, TagT, LabelT>::get_graph_num_frozen_points(const std::string &graph_file)
 {
+    // packed indices have no graph file and no frozen points
+    if (!file_exists(graph_file) && file_exists(graph_file + ".packed"))
+        return 0;
+
     size_t expected_file_size;
     uint32_t max_observed_degree, start;
     size_t file_frozen_pts;
@@ -725,7 +790,10 @@ template <typename T, typename TagT, typename LabelT> int Index<T, TagT, LabelT>
     }
 
     location_t location = _tag_to_location[tag];
-    _data_store->get_vector(location, vec);
+    if (_opt_graph != nullptr)
+        std::memcpy(vec, _opt_graph + _node_size * location, _dim * sizeof(T));
+    else
+        _data_store->get_vector(location, vec);
 
     return 0;
 }
@@ -880,6 +948,10 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
     uint32_t hops = 0;
     uint32_t cmps = 0;
 
+    // stores with lock-free reads hand out consistent snapshots without _locks
+    bool lock_free_reads = _graph_store->lock_free_reads();
+    std::vector<location_t> nbrs;
+
     while (best_L_nodes.has_unexpanded_node())
     {
         auto nbr = best_L_nodes.closest_unexpanded();
@@ -906,7 +978,7 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         // Find which of the nodes in des have not been visited before
         id_scratch.clear();
         dist_scratch.clear();
-        if (_dynamic_index)
+        if (_dynamic_index && !lock_free_reads)
         {
             LockGuard guard(_locks[n]);
             for (auto id : _graph_store->get_neighbours(n))
@@ -928,9 +1000,16 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         }
         else
         {
-            _locks[n].lock();
-            auto nbrs = _graph_store->get_neighbours(n);
-            _locks[n].unlock();
+            if (lock_free_reads)
+            {
+                _graph_store->get_neighbours_snapshot(n, nbrs);
+            }
+            else
+            {
+                _locks[n].lock();
+                _graph_store->get_neighbours_snapshot(n, nbrs);
+                _locks[n].unlock();
+            }
             for (auto id : nbrs)
             {
                 assert(id < _max_points + _num_frozen_pts);
@@ -975,6 +1054,89 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
     return std::make_pair(hops, cmps);
 }
 
+template <typename T, typename TagT, typename LabelT>
+std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point_packed(
+    InMemQueryScratch<T> *scratch, const uint32_t Lsize, const std::vector<uint32_t> &init_ids, bool use_filter,
+    const std::vector<LabelT> &filter_labels)
+{
+    NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
+    best_L_nodes.reserve(Lsize);
+    tsl::robin_set<uint32_t> &inserted_into_pool_rs = scratch->inserted_into_pool_rs();
+    boost::dynamic_bitset<> &inserted_into_pool_bs = scratch->inserted_into_pool_bs();
+    const T *aligned_query = scratch->aligned_query();
+    const uint32_t aligned_dim = (uint32_t)_data_store->get_aligned_dim();
+
+    // Same visited set as iterate_to_fixed_point, kept in the per-thread scratch
+    bool fast_iterate = _nd <= MAX_POINTS_FOR_USING_BITSET;
+    if (fast_iterate && inserted_into_pool_bs.size() < _nd)
+        inserted_into_pool_bs.resize(_nd);
+    auto mark_visited = [fast_iterate, &inserted_into_pool_bs, &inserted_into_pool_rs](const uint32_t id) {
+        if (!fast_iterate)
+            return inserted_into_pool_rs.insert(id).second;
+        if (inserted_into_pool_bs[id])
+            return false;
+        inserted_into_pool_bs[id] = 1;
+        return true;
+    };
+
+    // FastL2 keeps the norm of each vector after it and adds the query norm
+    // computed once, all other metrics use the distance function of the data
+    // store
+    Distance<T> *distance = _data_store->get_dist_fn();
+    const bool fast_l2 = _dist_metric == diskann::Metric::FAST_L2;
+    const float query_norm = fast_l2 ? ((DistanceFastL2<T> *)distance)->norm(aligned_query, aligned_dim) : 0;
+    auto compute_dist = [this, distance, fast_l2, query_norm, aligned_query, aligned_dim](const uint32_t id) {
+        const T *vec = (const T *)(_opt_graph + _node_size * id);
+        if (fast_l2)
+        {
+            float norm;
+            std::memcpy(&norm, vec + aligned_dim, sizeof(float));
+            return ((DistanceFastL2<T> *)distance)->compare(vec, aligned_query, norm, aligned_dim) + query_norm;
+        }
+        return distance->compare(aligned_query, vec, aligned_dim);
+    };
+
+    for (auto id : init_ids)
+    {
+        if (id >= _nd)
+        {
+            diskann::cerr << "Out of range loc found as an edge : " << id << std::endl;
+            throw diskann::ANNException(std::string("Wrong loc") + std::to_string(id), -1, __FUNCSIG__, __FILE__,
+                                        __LINE__);
+        }
+        if (use_filter && !detect_common_filters(id, true, filter_labels))
+            continue;
+        if (mark_visited(id))
+            best_L_nodes.insert(Neighbor(id, compute_dist(id)));
+    }
+
+    uint32_t hops = 0;
+    uint32_t cmps = 0;
+    const size_t vector_len = aligned_dim * sizeof(T);
+    while (best_L_nodes.has_unexpanded_node())
+    {
+        auto n = best_L_nodes.closest_unexpanded().id;
+        const uint32_t *neighbors = (const uint32_t *)(_opt_graph + _node_size * n + _data_len);
+        uint32_t num_neighbors = *neighbors;
+        neighbors++;
+        for (uint32_t m = 0; m < num_neighbors; ++m)
+            diskann::prefetch_vector(_opt_graph + _node_size * neighbors[m], vector_len);
+        hops++;
+
+        for (uint32_t m = 0; m < num_neighbors; ++m)
+        {
+            uint32_t id = neighbors[m];
+            if (use_filter && !detect_common_filters(id, true, filter_labels))
+                continue;
+            if (!mark_visited(id))
+                continue;
+            cmps++;
+            best_L_nodes.insert(Neighbor(id, compute_dist(id)));
+        }
+    }
+    return std::make_pair(hops, cmps);
+}
+
 template <typename T, typename TagT, typename LabelT>
 void Index<T, TagT, LabelT>::search_for_point_and_prune(int location, uint32_t Lindex,
                                                         std::vector<uint32_t> &pruned_list,
@@ -1214,7 +1376,7 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
         bool prune_needed = false;
         {
             LockGuard guard(_locks[des]);
-            auto &des_pool = _graph_store->get_neighbours(des);
+            NeighbourList des_pool = _graph_store->get_neighbours(des);
             if (std::find(des_pool.begin(), des_pool.end(), n) == des_pool.end())
             {
                 if (des_pool.size() < (uint64_t)(defaults::GRAPH_SLACK_FACTOR * range))
@@ -1226,7 +1388,7 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
                 else
                 {
                     copy_of_neighbors.reserve(des_pool.size() + 1);
-                    copy_of_neighbors = des_pool;
+                    copy_of_neighbors.assign(des_pool.begin(), des_pool.end());
                     copy_of_neighbors.push_back(n);
                     prune_needed = true;
                 }
@@ -1242,8 +1404,15 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
             dummy_visited.reserve(reserveSize);
             dummy_pool.reserve(reserveSize);
 
+            // A concurrent consolidation may have repaired des since the copy
+            // was taken, so deleted neighbors must not be written back.
+            std::shared_lock<std::shared_timed_mutex> tlock(_tag_lock, std::defer_lock);
+            if (_conc_consolidate)
+                tlock.lock();
             for (auto cur_nbr : copy_of_neighbors)
             {
+                if (_conc_consolidate && cur_nbr < _max_points && !_location_to_tag.contains(cur_nbr))
+                    continue;
                 if (dummy_visited.find(cur_nbr) == dummy_visited.end() && cur_nbr != des)
                 {
                     float dist = _data_store->get_distance(des, cur_nbr);
@@ -1251,6 +1420,8 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
                     dummy_visited.insert(cur_nbr);
                 }
             }
+            if (_conc_consolidate)
+                tlock.unlock();
             std::vector<uint32_t> new_out_neighbors;
             prune_neighbors(des, dummy_pool, new_out_neighbors, scratch);
             {
@@ -1418,7 +1589,7 @@ void Index<T, TagT, LabelT>::prune_all_neighbors(const uint32_t max_degree, cons
     {
         if (i < _nd || i >= _max_points)
         {
-            const std::vector<uint32_t> &pool = _graph_store->get_neighbours((location_t)i);
+            NeighbourList pool = _graph_store->get_neighbours((location_t)i);
             max = (std::max)(max, pool.size());
             min = (std::min)(min, pool.size());
             total += pool.size();
@@ -1547,7 +1718,7 @@ void Index<T, TagT, LabelT>::build_with_data_populated(const std::vector<TagT> &
     size_t max = 0, min = SIZE_MAX, total = 0, cnt = 0;
     for (size_t i = 0; i < _nd; i++)
     {
-        auto &pool = _graph_store->get_neighbours((location_t)i);
+        NeighbourList pool = _graph_store->get_neighbours((location_t)i);
         max = std::max(max, pool.size());
         min = std::min(min, pool.size());
         total += pool.size();
@@ -1842,6 +2013,32 @@ void Index<T, TagT, LabelT>::parse_label_file(const std::string &label_file, siz
     diskann::cout << "Identified " << _labels.size() << " distinct label(s)" << std::endl;
 }
 
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::load_bin_labels(const std::string &bin_labels_file, size_t &num_points)
+{
+    MappedBinLabels<LabelT> bin_labels(bin_labels_file);
+    _location_to_labels.resize(bin_labels.num_points);
+    for (uint64_t i = 0; i < bin_labels.num_points; i++)
+    {
+        const LabelT *begin = bin_labels.labels + bin_labels.offsets[i];
+        _location_to_labels[i].assign(begin, begin + bin_labels.counts[i]);
+        std::sort(_location_to_labels[i].begin(), _location_to_labels[i].end());
+        _labels.insert(begin, begin + bin_labels.counts[i]);
+    }
+
+    _label_to_start_id.clear();
+    for (uint64_t i = 0; i < bin_labels.num_medoids; i++)
+        _label_to_start_id[bin_labels.medoid_labels[i]] = bin_labels.medoids[i];
+
+    if (bin_labels.use_universal_label)
+    {
+        _universal_label = bin_labels.universal_label;
+        _use_universal_label = true;
+    }
+    num_points = (size_t)bin_labels.num_points;
+    diskann::cout << "Identified " << _labels.size() << " distinct label(s)" << std::endl;
+}
+
 template <typename T, typename TagT, typename LabelT>
 void Index<T, TagT, LabelT>::_set_universal_label(const LabelType universal_label)
 {
@@ -1983,7 +2180,9 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search(const T *query, con
 
     _data_store->preprocess_query(query, scratch);
 
-    auto retval = iterate_to_fixed_point(scratch, L, init_ids, false, unused_filter_label, true);
+    auto retval = _opt_graph != nullptr
+                      ? iterate_to_fixed_point_packed(scratch, L, init_ids, false, unused_filter_label)
+                      : iterate_to_fixed_point(scratch, L, init_ids, false, unused_filter_label, true);
 
     NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
 
@@ -2087,7 +2286,8 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search_with_filters(const
     filter_vec.emplace_back(filter_label);
 
     _data_store->preprocess_query(query, scratch);
-    auto retval = iterate_to_fixed_point(scratch, L, init_ids, true, filter_vec, true);
+    auto retval = _opt_graph != nullptr ? iterate_to_fixed_point_packed(scratch, L, init_ids, true, filter_vec)
+                                        : iterate_to_fixed_point(scratch, L, init_ids, true, filter_vec, true);
 
     auto best_L_nodes = scratch->best_l_nodes();
 
@@ -2171,14 +2371,20 @@ size_t Index<T, TagT, LabelT>::search_with_tags(const T *query, const uint64_t K
     if (!use_filters)
     {
         const std::vector<LabelT> unused_filter_label;
-        iterate_to_fixed_point(scratch, L, init_ids, false, unused_filter_label, true);
+        if (_opt_graph != nullptr)
+            iterate_to_fixed_point_packed(scratch, L, init_ids, false, unused_filter_label);
+        else
+            iterate_to_fixed_point(scratch, L, init_ids, false, unused_filter_label, true);
     }
     else
     {
         std::vector<LabelT> filter_vec;
         auto converted_label = this->get_converted_label(filter_label);
         filter_vec.push_back(converted_label);
-        iterate_to_fixed_point(scratch, L, init_ids, true, filter_vec, true);
+        if (_opt_graph != nullptr)
+            iterate_to_fixed_point_packed(scratch, L, init_ids, true, filter_vec);
+        else
+            iterate_to_fixed_point(scratch, L, init_ids, true, filter_vec, true);
     }
 
     NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
@@ -2198,7 +2404,10 @@ size_t Index<T, TagT, LabelT>::search_with_tags(const T *query, const uint64_t K
 
             if (res_vectors.size() > 0)
             {
-                _data_store->get_vector(node.id, res_vectors[pos]);
+                if (_opt_graph != nullptr)
+                    std::memcpy(res_vectors[pos], _opt_graph + _node_size * node.id, _dim * sizeof(T));
+                else
+                    _data_store->get_vector(node.id, res_vectors[pos]);
             }
 
             if (distances != nullptr)
@@ -2312,7 +2521,7 @@ inline void Index<T, TagT, LabelT>::process_delete(const tsl::robin_set<uint32_t
         std::unique_lock<non_recursive_mutex> adj_list_lock;
         if (_conc_consolidate)
             adj_list_lock = std::unique_lock<non_recursive_mutex>(_locks[loc]);
-        adj_list = _graph_store->get_neighbours((location_t)loc);
+        _graph_store->get_neighbours_snapshot((location_t)loc, adj_list);
     }
 
     bool modify = false;
@@ -2362,9 +2571,54 @@ inline void Index<T, TagT, LabelT>::process_delete(const tsl::robin_set<uint32_t
     }
 }
 
+template <typename T, typename TagT, typename LabelT>
+std::vector<uint32_t> Index<T, TagT, LabelT>::get_in_neighbours_of_deleted(const tsl::robin_set<uint32_t> &delete_set,
+                                                                           uint32_t num_threads)
+{
+    const size_t total_locations = _max_points + _num_frozen_pts;
+    std::vector<uint8_t> is_deleted(total_locations, 0);
+    for (auto loc : delete_set)
+        is_deleted[loc] = 1;
+
+    // one read-only pass over all adjacency lists, O((max_points + frozen) * R);
+    // cheaper than calling process_delete on every location, which also
+    // takes locks and writes each list
+    std::vector<std::vector<uint32_t>> thread_results(num_threads);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 8192)
+    for (int64_t loc = 0; loc < (int64_t)total_locations; loc++)
+    {
+        if (is_deleted[loc] || (loc < (int64_t)_max_points && _empty_slots.is_in_set((uint32_t)loc)))
+            continue;
+
+        std::unique_lock<non_recursive_mutex> adj_list_lock;
+        if (_conc_consolidate)
+            adj_list_lock = std::unique_lock<non_recursive_mutex>(_locks[loc]);
+        for (auto ngh : _graph_store->get_neighbours((location_t)loc))
+        {
+            if (ngh < total_locations && is_deleted[ngh])
+            {
+                thread_results[omp_get_thread_num()].push_back((uint32_t)loc);
+                break;
+            }
+        }
+    }
+
+    std::vector<uint32_t> affected;
+    for (auto &res : thread_results)
+        affected.insert(affected.end(), res.begin(), res.end());
+    return affected;
+}
+
 // Returns number of live points left after consolidation
 template <typename T, typename TagT, typename LabelT>
 consolidation_report Index<T, TagT, LabelT>::consolidate_deletes(const IndexWriteParameters &params)
+{
+    return consolidate_deletes(params, 0);
+}
+
+template <typename T, typename TagT, typename LabelT>
+consolidation_report Index<T, TagT, LabelT>::consolidate_deletes(const IndexWriteParameters &params,
+                                                                 size_t max_nodes_per_sec)
 {
     if (!_enable_tags)
         throw diskann::ANNException("Point tag array not instantiated", -1, __FUNCSIG__, __FILE__, __LINE__);
@@ -2411,38 +2665,85 @@ consolidation_report Index<T, TagT, LabelT>::consolidate_deletes(const IndexWrit
     std::unique_ptr<tsl::robin_set<uint32_t>> old_delete_set(new tsl::robin_set<uint32_t>);
     {
         std::unique_lock<std::shared_timed_mutex> dl(_delete_lock);
+        // checked before the swap, so that the delete set is not lost
+        if (_delete_set->find(_start) != _delete_set->end())
+        {
+            throw diskann::ANNException("ERROR: start node has been deleted", -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
         std::swap(_delete_set, old_delete_set);
     }
 
-    if (old_delete_set->find(_start) != old_delete_set->end())
-    {
-        throw diskann::ANNException("ERROR: start node has been deleted", -1, __FUNCSIG__, __FILE__, __LINE__);
-    }
-
     const uint32_t range = params.max_degree;
     const uint32_t maxc = params.max_occlusion_size;
     const float alpha = params.alpha;
     const uint32_t num_threads = params.num_threads == 0 ? omp_get_num_procs() : params.num_threads;
 
-    uint32_t num_calls_to_process_delete = 0;
     diskann::Timer timer;
-#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 8192) reduction(+ : num_calls_to_process_delete)
-    for (int64_t loc = 0; loc < (int64_t)_max_points; loc++)
+    // Inserts that finished before the scan below; if no other insert starts
+    // until the repair is done, no edge to a deleted point can have been added
+    const uint64_t inserts_finished_before_scan = _num_graph_inserts_finished.load();
+
+    size_t num_calls_to_process_delete = 0, num_late_in_neighbours = 0;
+    try
     {
-        if (old_delete_set->find((uint32_t)loc) == old_delete_set->end() && !_empty_slots.is_in_set((uint32_t)loc))
+        // Only the in-neighbors of deleted points have edges to repair
+        std::vector<uint32_t> affected = get_in_neighbours_of_deleted(*old_delete_set, num_threads);
+        num_calls_to_process_delete = affected.size();
+
+        // Repair in chunks; when throttled, sleep between chunks so that at
+        // most max_nodes_per_sec nodes are processed per second.
+        const size_t chunk_size =
+            max_nodes_per_sec == 0 ? affected.size() : (std::max)((size_t)1, max_nodes_per_sec / 10);
+        for (size_t chunk_start = 0; chunk_start < affected.size(); chunk_start += chunk_size)
         {
-            ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
-            auto scratch = manager.scratch_space();
-            process_delete(*old_delete_set, loc, range, maxc, alpha, scratch);
-            num_calls_to_process_delete += 1;
+            const size_t chunk_end = (std::min)(chunk_start + chunk_size, affected.size());
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64)
+            for (int64_t i = (int64_t)chunk_start; i < (int64_t)chunk_end; i++)
+            {
+                ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+                auto scratch = manager.scratch_space();
+                process_delete(*old_delete_set, affected[i], range, maxc, alpha, scratch);
+            }
+
+            if (max_nodes_per_sec != 0)
+            {
+                const double target_us = 1000000.0 * (double)chunk_end / (double)max_nodes_per_sec;
+                const double elapsed_us = (double)timer.elapsed();
+                // a stop request finishes the round without throttling
+                std::unique_lock<std::mutex> lock(_consolidation_thread_mutex);
+                if (elapsed_us < target_us && !_stop_consolidation_thread)
+                    _consolidation_thread_cv.wait_for(lock,
+                                                      std::chrono::microseconds((int64_t)(target_us - elapsed_us)),
+                                                      [this]() { return _stop_consolidation_thread; });
+            }
+        }
+
+        // With concurrent consolidation, inserts may have linked a node to a
+        // deleted point after it was scanned or repaired, so if any insert ran
+        // meanwhile the in-neighbors are scanned again before the deleted
+        // locations are released for reuse.
+        if (_conc_consolidate && _num_graph_inserts_started.load() != inserts_finished_before_scan)
+        {
+            std::vector<uint32_t> late_affected = get_in_neighbours_of_deleted(*old_delete_set, num_threads);
+            num_late_in_neighbours = late_affected.size();
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64)
+            for (int64_t i = 0; i < (int64_t)late_affected.size(); i++)
+            {
+                ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+                auto scratch = manager.scratch_space();
+                process_delete(*old_delete_set, late_affected[i], range, maxc, alpha, scratch);
+            }
+            if (num_late_in_neighbours > 0)
+                diskann::cout << "repaired " << num_late_in_neighbours
+                              << " nodes linked to deleted points meanwhile... ";
         }
     }
-    for (int64_t loc = _max_points; loc < (int64_t)(_max_points + _num_frozen_pts); loc++)
+    catch (...)
     {
-        ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
-        auto scratch = manager.scratch_space();
-        process_delete(*old_delete_set, loc, range, maxc, alpha, scratch);
-        num_calls_to_process_delete += 1;
+        // the deleted points stay deleted and are repaired by a later round
+        std::unique_lock<std::shared_timed_mutex> dl(_delete_lock);
+        _delete_set->insert(old_delete_set->begin(), old_delete_set->end());
+        throw;
     }
 
     std::unique_lock<std::shared_timed_mutex> tl(_tag_lock);
@@ -2462,8 +2763,71 @@ consolidation_report Index<T, TagT, LabelT>::consolidate_deletes(const IndexWrit
     double duration = timer.elapsed() / 1000000.0;
     diskann::cout << " done in " << duration << " seconds." << std::endl;
     return consolidation_report(diskann::consolidation_report::status_code::SUCCESS, ret_nd, max_points,
-                                empty_slots_size, old_delete_set_size, delete_set_size, num_calls_to_process_delete,
-                                duration);
+                                empty_slots_size, old_delete_set_size, delete_set_size,
+                                num_calls_to_process_delete + num_late_in_neighbours, duration);
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::start_background_consolidation(const IndexWriteParameters &params, size_t min_deletes,
+                                                            uint32_t check_interval_ms, size_t max_nodes_per_sec)
+{
+    if (!_conc_consolidate)
+        throw ANNException("Background consolidation requires concurrent_consolidate", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+
+    stop_background_consolidation();
+    {
+        std::unique_lock<std::mutex> lock(_consolidation_thread_mutex);
+        _stop_consolidation_thread = false;
+    }
+
+    _consolidation_thread = std::thread([this, params, min_deletes, check_interval_ms, max_nodes_per_sec]() {
+        std::unique_lock<std::mutex> lock(_consolidation_thread_mutex);
+        while (!_stop_consolidation_thread)
+        {
+            _consolidation_thread_cv.wait_for(lock, std::chrono::milliseconds(check_interval_ms),
+                                              [this]() { return _stop_consolidation_thread; });
+            if (_stop_consolidation_thread)
+                break;
+
+            size_t num_deletes;
+            {
+                std::shared_lock<std::shared_timed_mutex> dl(_delete_lock);
+                num_deletes = _delete_set->size();
+            }
+            if (num_deletes == 0 || num_deletes < min_deletes)
+                continue;
+
+            // let stop requests through while the round runs
+            lock.unlock();
+            try
+            {
+                auto report = consolidate_deletes(params, max_nodes_per_sec);
+                if (report._status == consolidation_report::status_code::SUCCESS)
+                    diskann::cout << "Background consolidation released " << report._slots_released
+                                  << " slots after repairing " << report._num_calls_to_process_delete << " nodes"
+                                  << std::endl;
+            }
+            catch (const std::exception &e)
+            {
+                // the next round would fail the same way
+                diskann::cerr << "Background consolidation failed, stopping it: " << e.what() << std::endl;
+                return;
+            }
+            lock.lock();
+        }
+    });
+}
+
+template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::stop_background_consolidation()
+{
+    {
+        std::unique_lock<std::mutex> lock(_consolidation_thread_mutex);
+        _stop_consolidation_thread = true;
+    }
+    _consolidation_thread_cv.notify_all();
+    if (_consolidation_thread.joinable())
+        _consolidation_thread.join();
 }
 
 template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::compact_frozen_point()
@@ -2694,7 +3058,7 @@ void Index<T, TagT, LabelT>::reposition_points(uint32_t old_location_start, uint
     std::vector<location_t> updated_neighbours_location;
     for (uint32_t i = 0; i < _max_points + _num_frozen_pts; i++)
     {
-        auto &i_neighbours = _graph_store->get_neighbours((location_t)i);
+        NeighbourList i_neighbours = _graph_store->get_neighbours((location_t)i);
         std::vector<location_t> i_neighbours_copy(i_neighbours.begin(), i_neighbours.end());
         for (auto &loc : i_neighbours_copy)
         {
@@ -2962,6 +3326,7 @@ int Index<T, TagT, LabelT>::insert_point(const T *point, const TagT tag, const s
     }
     tl.unlock();
 
+    _num_graph_inserts_started++;
     _data_store->set_vector(location, point); // update datastore
 
     // Find and add appropriate graph edges
@@ -3003,6 +3368,7 @@ int Index<T, TagT, LabelT>::insert_point(const T *point, const TagT tag, const s
     }
 
     inter_insert(location, pruned_list, scratch);
+    _num_graph_inserts_finished++;
 
     return 0;
 }
@@ -3128,7 +3494,7 @@ void Index<T, TagT, LabelT>::get_degree_stats(size_t &max_deg, size_t &min_deg,
     size_t total = 0;
     for (size_t i = 0; i < _nd; i++)
     {
-        auto &pool = _graph_store->get_neighbours((location_t)i);
+        NeighbourList pool = _graph_store->get_neighbours((location_t)i);
         cnt_deg += (pool.size() < 2);
         max_deg = std::max(max_deg, pool.size());
         min_deg = std::min(min_deg, pool.size());
@@ -3150,7 +3516,7 @@ void Index<T, TagT, LabelT>::dump_degree_stats(std::string filename)
     // Write each node's degree to the file, one per line
     for (size_t i = 0; i < _nd; i++)
     {
-        auto &pool = _graph_store->get_neighbours((location_t)i);
+        NeighbourList pool = _graph_store->get_neighbours((location_t)i);
         file << pool.size() << std::endl;
     }
 
@@ -3176,6 +3542,26 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
                   << std::endl;
 }
 
+template <typename T, typename TagT, typename LabelT> size_t Index<T, TagT, LabelT>::count_dangling_edges()
+{
+    std::shared_lock<std::shared_timed_mutex> ul(_update_lock);
+    std::shared_lock<std::shared_timed_mutex> tl(_tag_lock);
+
+    size_t num_dangling = 0;
+    for (uint32_t loc = 0; loc < _max_points + _num_frozen_pts; loc++)
+    {
+        if (loc < _max_points && _empty_slots.is_in_set(loc))
+            continue;
+        LockGuard guard(_locks[loc]);
+        for (auto ngh : _graph_store->get_neighbours((location_t)loc))
+        {
+            if (ngh < _max_points && _empty_slots.is_in_set(ngh))
+                num_dangling++;
+        }
+    }
+    return num_dangling;
+}
+
 template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::count_nodes_at_bfs_levels()
 {
     std::unique_lock<std::shared_timed_mutex> ul(_update_lock);
@@ -3226,34 +3612,127 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
         throw diskann::ANNException("Optimize_index_layout not implemented for dyanmic indices", -1, __FUNCSIG__,
                                     __FILE__, __LINE__);
     }
+    if (_num_frozen_pts > 0)
+    {
+        throw diskann::ANNException("Optimize_index_layout not implemented for indices with frozen points", -1,
+                                    __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (_opt_graph != nullptr)
+        return;
+    if (_nd == 0)
+    {
+        throw diskann::ANNException("Optimize_index_layout called on an empty index", -1, __FUNCSIG__, __FILE__,
+                                    __LINE__);
+    }
+
+    std::unique_lock<std::shared_timed_mutex> ul(_update_lock);
 
-    float *cur_vec = new float[_data_store->get_aligned_dim()];
-    std::memset(cur_vec, 0, _data_store->get_aligned_dim() * sizeof(float));
-    _data_len = (_data_store->get_aligned_dim() + 1) * sizeof(float);
+    const size_t aligned_dim = _data_store->get_aligned_dim();
+    const bool fast_l2 = _dist_metric == diskann::Metric::FAST_L2;
+    _data_len = aligned_dim * sizeof(T) + sizeof(float);
     _neighbor_len = (_graph_store->get_max_observed_degree() + 1) * sizeof(uint32_t);
-    _node_size = _data_len + _neighbor_len;
-    _opt_graph = new char[_node_size * _nd];
+    _node_size = ROUND_UP(_data_len + _neighbor_len, PACKED_NODE_ALIGNMENT);
+    alloc_aligned((void **)&_opt_graph, _node_size * _nd, PACKED_NODE_ALIGNMENT);
+    std::memset(_opt_graph, 0, _node_size * _nd);
+
     auto dist_fast = (DistanceFastL2<T> *)(_data_store->get_dist_fn());
-    for (uint32_t i = 0; i < _nd; i++)
+#pragma omp parallel for schedule(static, 8192)
+    for (int64_t i = 0; i < (int64_t)_nd; i++)
     {
         char *cur_node_offset = _opt_graph + i * _node_size;
-        _data_store->get_vector(i, (T *)cur_vec);
-        float cur_norm = dist_fast->norm((T *)cur_vec, (uint32_t)_data_store->get_aligned_dim());
-        std::memcpy(cur_node_offset, &cur_norm, sizeof(float));
-        std::memcpy(cur_node_offset + sizeof(float), cur_vec, _data_len - sizeof(float));
+        _data_store->get_vector((location_t)i, (T *)cur_node_offset);
+        if (fast_l2)
+        {
+            float cur_norm = dist_fast->norm((T *)cur_node_offset, (uint32_t)aligned_dim);
+            std::memcpy(cur_node_offset + aligned_dim * sizeof(T), &cur_norm, sizeof(float));
+        }
 
         cur_node_offset += _data_len;
-        uint32_t k = (uint32_t)_graph_store->get_neighbours(i).size();
+        NeighbourList neighbours = _graph_store->get_neighbours((location_t)i);
+        uint32_t k = (uint32_t)neighbours.size();
         std::memcpy(cur_node_offset, &k, sizeof(uint32_t));
-        std::memcpy(cur_node_offset + sizeof(uint32_t), _graph_store->get_neighbours(i).data(), k * sizeof(uint32_t));
-        // std::vector<uint32_t>().swap(_graph_store->get_neighbours(i));
-        _graph_store->clear_neighbours(i);
+        std::memcpy(cur_node_offset + sizeof(uint32_t), neighbours.data(), k * sizeof(uint32_t));
     }
     _graph_store->clear_graph();
     _graph_store->resize_graph(0);
-    delete[] cur_vec;
 }
 
+template <typename T, typename TagT, typename LabelT>
+size_t Index<T, TagT, LabelT>::save_packed(const std::string &filename)
+{
+    std::ofstream writer;
+    open_file_to_write(writer, filename);
+
+    std::vector<uint64_t> header(PACKED_INDEX_HEADER_SIZE / sizeof(uint64_t), 0);
+    header[0] = PACKED_INDEX_MAGIC;
+    header[1] = PACKED_INDEX_VERSION;
+    header[2] = _nd;
+    header[3] = _dim;
+    header[4] = _data_store->get_aligned_dim();
+    header[5] = (uint64_t)_dist_metric;
+    header[6] = _node_size;
+    header[7] = _data_len;
+    header[8] = _neighbor_len;
+    header[9] = _start;
+    writer.write((char *)header.data(), PACKED_INDEX_HEADER_SIZE);
+    writer.write(_opt_graph, _node_size * _nd);
+    writer.close();
+    return PACKED_INDEX_HEADER_SIZE + _node_size * _nd;
+}
+
+#ifndef EXEC_ENV_OLS
+template <typename T, typename TagT, typename LabelT>
+size_t Index<T, TagT, LabelT>::load_packed(const std::string &filename)
+{
+    _opt_graph_mapper = std::make_unique<MemoryMapper>(filename.c_str(), true, true);
+    char *buf = _opt_graph_mapper->getBuf();
+    size_t file_size = _opt_graph_mapper->getFileSize();
+
+    std::vector<uint64_t> header(10, 0);
+    if (file_size >= PACKED_INDEX_HEADER_SIZE)
+        std::memcpy(header.data(), buf, header.size() * sizeof(uint64_t));
+    if (header[0] != PACKED_INDEX_MAGIC || header[1] != PACKED_INDEX_VERSION)
+    {
+        std::stringstream stream;
+        stream << "ERROR: " << filename << " is not a packed index of version " << PACKED_INDEX_VERSION;
+        if (header[0] == PACKED_INDEX_MAGIC)
+            stream << ", it has version " << header[1];
+        stream << "." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        _opt_graph_mapper.reset();
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    size_t npts = header[2];
+    if (file_size < PACKED_INDEX_HEADER_SIZE + header[6] * npts || header[3] != _dim ||
+        header[4] != _data_store->get_aligned_dim() || header[5] != (uint64_t)_dist_metric)
+    {
+        std::stringstream stream;
+        stream << "ERROR: packed index " << filename << " with " << npts << " points of dimension " << header[3]
+               << " (aligned " << header[4] << ", metric " << header[5] << ") does not match the index dimension "
+               << _dim << " (aligned " << _data_store->get_aligned_dim() << ", metric " << (uint64_t)_dist_metric
+               << ") or is truncated." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        _opt_graph_mapper.reset();
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _node_size = header[6];
+    _data_len = header[7];
+    _neighbor_len = header[8];
+    _start = (uint32_t)header[9];
+    _num_frozen_pts = 0;
+    _opt_graph = buf + PACKED_INDEX_HEADER_SIZE;
+
+    // the data and graph stores stay empty, only the id range grows
+    if (npts > _max_points)
+        _max_points = npts;
+
+    diskann::cout << "Mapped packed index " << filename << " with " << npts << " points, node size " << _node_size
+                  << ", _start is set to " << _start << std::endl;
+    return npts;
+}
+#endif
+
 template <typename T, typename TagT, typename LabelT>
 void Index<T, TagT, LabelT>::_search_with_optimized_layout(const DataType &query, size_t K, size_t L, uint32_t *indices)
 {
@@ -3277,84 +3756,12 @@ void Index<T, TagT, LabelT>::_search_with_optimized_layout(const DataType &query
 template <typename T, typename TagT, typename LabelT>
 void Index<T, TagT, LabelT>::search_with_optimized_layout(const T *query, size_t K, size_t L, uint32_t *indices)
 {
-    DistanceFastL2<T> *dist_fast = (DistanceFastL2<T> *)(_data_store->get_dist_fn());
-
-    NeighborPriorityQueue retset(L);
-    std::vector<uint32_t> init_ids(L);
-
-    boost::dynamic_bitset<> flags{_nd, 0};
-    uint32_t tmp_l = 0;
-    uint32_t *neighbors = (uint32_t *)(_opt_graph + _node_size * _start + _data_len);
-    uint32_t MaxM_ep = *neighbors;
-    neighbors++;
-
-    for (; tmp_l < L && tmp_l < MaxM_ep; tmp_l++)
-    {
-        init_ids[tmp_l] = neighbors[tmp_l];
-        flags[init_ids[tmp_l]] = true;
-    }
-
-    while (tmp_l < L)
-    {
-        uint32_t id = rand() % _nd;
-        if (flags[id])
-            continue;
-        flags[id] = true;
-        init_ids[tmp_l] = id;
-        tmp_l++;
-    }
-
-    for (uint32_t i = 0; i < init_ids.size(); i++)
-    {
-        uint32_t id = init_ids[i];
-        if (id >= _nd)
-            continue;
-        _mm_prefetch(_opt_graph + _node_size * id, _MM_HINT_T0);
-    }
-    L = 0;
-    for (uint32_t i = 0; i < init_ids.size(); i++)
-    {
-        uint32_t id = init_ids[i];
-        if (id >= _nd)
-            continue;
-        T *x = (T *)(_opt_graph + _node_size * id);
-        float norm_x = *x;
-        x++;
-        float dist = dist_fast->compare(x, query, norm_x, (uint32_t)_data_store->get_aligned_dim());
-        retset.insert(Neighbor(id, dist));
-        flags[id] = true;
-        L++;
-    }
-
-    while (retset.has_unexpanded_node())
-    {
-        auto nbr = retset.closest_unexpanded();
-        auto n = nbr.id;
-        _mm_prefetch(_opt_graph + _node_size * n + _data_len, _MM_HINT_T0);
-        neighbors = (uint32_t *)(_opt_graph + _node_size * n + _data_len);
-        uint32_t MaxM = *neighbors;
-        neighbors++;
-        for (uint32_t m = 0; m < MaxM; ++m)
-            _mm_prefetch(_opt_graph + _node_size * neighbors[m], _MM_HINT_T0);
-        for (uint32_t m = 0; m < MaxM; ++m)
-        {
-            uint32_t id = neighbors[m];
-            if (flags[id])
-                continue;
-            flags[id] = 1;
-            T *data = (T *)(_opt_graph + _node_size * id);
-            float norm = *data;
-            data++;
-            float dist = dist_fast->compare(query, data, norm, (uint32_t)_data_store->get_aligned_dim());
-            Neighbor nn(id, dist);
-            retset.insert(nn);
-        }
-    }
-
-    for (size_t i = 0; i < K; i++)
+    if (_opt_graph == nullptr)
     {
-        indices[i] = retset[i].id;
+        throw ANNException("Error: call optimize_index_layout() before search_with_optimized_layout()", -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
     }
+    search(query, K, (uint32_t)L, indices);
 }
 
 /*  Internals of the library */
@@ -34,6 +34,20 @@ void IndexFactory::check_config()
                                -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
+    if (_config->num_sq_bits != 0)
+    {
+        if (_config->num_sq_bits != 8 && _config->num_sq_bits != 4)
+            throw ANNException("ERROR: scalar quantization supports only 8 or 4 bits per dimension", -1, __FUNCSIG__,
+                               __FILE__, __LINE__);
+        if (_config->dynamic_index)
+            throw ANNException("ERROR: Dynamic Indexing not supported with scalar quantized data store", -1,
+                               __FUNCSIG__, __FILE__, __LINE__);
+        if (_config->pq_dist_build)
+            throw ANNException("ERROR: scalar quantized data store can not be combined with PQ distance based "
+                               "index construction",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
     if (_config->data_type != "float" && _config->data_type != "uint8" && _config->data_type != "int8")
     {
         throw ANNException("ERROR: invalid data type : + " + _config->data_type +
@@ -80,6 +94,23 @@ std::shared_ptr<AbstractDataStore<T>> IndexFactory::construct_datastore(DataStor
     return nullptr;
 }
 
+template <typename T>
+std::shared_ptr<SQDataStore<T>> IndexFactory::construct_sq_datastore(DataStoreStrategy strategy, size_t num_points,
+                                                                     size_t dimension, Metric m, uint32_t num_sq_bits)
+{
+    std::unique_ptr<Distance<T>> distance_fn;
+    switch (strategy)
+    {
+    case DataStoreStrategy::MEMORY:
+        distance_fn.reset(construct_inmem_distance_fn<T>(m));
+        return std::make_shared<diskann::SQDataStore<T>>((location_t)num_points, dimension, num_sq_bits,
+                                                         std::move(distance_fn));
+    default:
+        break;
+    }
+    return nullptr;
+}
+
 std::unique_ptr<AbstractGraphStore> IndexFactory::construct_graphstore(const GraphStoreStrategy strategy,
                                                                        const size_t size,
                                                                        const size_t reserve_graph_degree)
@@ -88,6 +119,8 @@ std::unique_ptr<AbstractGraphStore> IndexFactory::construct_graphstore(const Gra
     {
     case GraphStoreStrategy::MEMORY:
         return std::make_unique<InMemGraphStore>(size, reserve_graph_degree);
+    case GraphStoreStrategy::CONTIGUOUS:
+        return std::make_unique<ContiguousGraphStore>(size, reserve_graph_degree);
     default:
         throw ANNException("Error : Current GraphStoreStratagy is not supported.", -1);
     }
@@ -121,7 +154,16 @@ std::unique_ptr<AbstractIndex> IndexFactory::create_instance()
     size_t num_points = _config->max_points + _config->num_frozen_pts;
     size_t dim = _config->dimension;
     // auto graph_store = construct_graphstore(_config->graph_strategy, num_points);
-    auto data_store = construct_datastore<data_type>(_config->data_strategy, num_points, dim, _config->metric);
+    std::shared_ptr<AbstractDataStore<data_type>> data_store = nullptr;
+    if (_config->num_sq_bits != 0)
+    {
+        data_store = construct_sq_datastore<data_type>(_config->data_strategy, num_points, dim, _config->metric,
+                                                        _config->num_sq_bits);
+    }
+    else
+    {
+        data_store = construct_datastore<data_type>(_config->data_strategy, num_points, dim, _config->metric);
+    }
     std::shared_ptr<AbstractDataStore<data_type>> pq_data_store = nullptr;
 
     if (_config->data_strategy == DataStoreStrategy::MEMORY && _config->pq_dist_build)
@@ -0,0 +1,368 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <iterator>
+
+#include "label_index.h"
+#include "ann_exception.h"
+
+namespace diskann
+{
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::label(const LabelT &label)
+{
+    LabelPredicate predicate;
+    predicate._op = Op::LABEL;
+    predicate._label = label;
+    return predicate;
+}
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::all_of(std::vector<LabelPredicate> operands)
+{
+    LabelPredicate predicate;
+    predicate._op = Op::ALL_OF;
+    predicate._operands = std::move(operands);
+    return predicate;
+}
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::any_of(std::vector<LabelPredicate> operands)
+{
+    LabelPredicate predicate;
+    predicate._op = Op::ANY_OF;
+    predicate._operands = std::move(operands);
+    return predicate;
+}
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::all_of(const std::vector<LabelT> &labels)
+{
+    std::vector<LabelPredicate> operands;
+    for (const auto &l : labels)
+        operands.push_back(label(l));
+    return all_of(std::move(operands));
+}
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::any_of(const std::vector<LabelT> &labels)
+{
+    std::vector<LabelPredicate> operands;
+    for (const auto &l : labels)
+        operands.push_back(label(l));
+    return any_of(std::move(operands));
+}
+
+template <typename LabelT> LabelPredicate<LabelT> LabelPredicate<LabelT>::negate(LabelPredicate operand)
+{
+    LabelPredicate predicate;
+    predicate._op = Op::NOT;
+    predicate._operands.push_back(std::move(operand));
+    return predicate;
+}
+
+template <typename LabelT> void LabelPredicate<LabelT>::get_positive_labels(std::vector<LabelT> &labels) const
+{
+    if (_op == Op::LABEL)
+        labels.push_back(_label);
+    else if (_op != Op::NOT)
+    {
+        for (const auto &operand : _operands)
+            operand.get_positive_labels(labels);
+    }
+}
+
+template <typename LabelT>
+void LabelIndex<LabelT>::build(const size_t num_points, const uint32_t *offsets, const uint32_t *counts,
+                               const LabelT *labels)
+{
+    _num_points = num_points;
+    _label_to_dense.clear();
+    _label_counts.clear();
+
+    // dense id of every label entry, so that each label value is looked up
+    // once. Label values are usually small integers from the label map, then
+    // a table replaces the hash lookups.
+    size_t num_entries = 0;
+    LabelT max_label = 0;
+    for (size_t i = 0; i < num_points; i++)
+    {
+        num_entries = (std::max)(num_entries, (size_t)offsets[i] + counts[i]);
+        for (uint32_t j = offsets[i]; j < offsets[i] + counts[i]; j++)
+            max_label = (std::max)(max_label, labels[j]);
+    }
+    const uint32_t no_label = NO_LABEL;
+    std::vector<uint32_t> dense_ids(num_entries, no_label);
+    std::vector<uint32_t> label_table;
+    if ((size_t)max_label <= (std::max)(num_entries, (size_t)1 << 16))
+        label_table.assign((size_t)max_label + 1, no_label);
+    for (size_t i = 0; i < num_points; i++)
+    {
+        for (uint32_t j = offsets[i]; j < offsets[i] + counts[i]; j++)
+        {
+            uint32_t *l = label_table.empty() ? nullptr : &label_table[labels[j]];
+            if (l == nullptr || *l == NO_LABEL)
+            {
+                auto iter = _label_to_dense.emplace(labels[j], (uint32_t)_label_counts.size()).first;
+                if (iter->second == _label_counts.size())
+                    _label_counts.push_back(0);
+                if (l != nullptr)
+                    *l = iter->second;
+                dense_ids[j] = iter->second;
+            }
+            else
+            {
+                dense_ids[j] = *l;
+            }
+            _label_counts[dense_ids[j]]++;
+        }
+    }
+
+    size_t num_labels = _label_counts.size();
+    bool use_point_bits = num_labels <= MAX_POINT_BITSET_LABELS;
+    _point_words = use_point_bits ? (uint32_t)((num_labels + 63) / 64) : 0;
+    _point_bits.assign(num_points * _point_words, 0);
+    _label_bits.clear();
+    _label_bits.resize(use_point_bits ? 0 : num_labels);
+    _label_points.clear();
+    _label_points.resize(num_labels);
+    size_t bitset_words = (num_points + 63) / 64;
+    for (size_t l = 0; l < num_labels; l++)
+    {
+        // a bitset costs 8 bytes per 64 points, a list 4 bytes per point
+        bool rare = _label_counts[l] * sizeof(uint32_t) <= bitset_words * sizeof(uint64_t);
+        if (rare)
+            _label_points[l].reserve(_label_counts[l]);
+        else if (!use_point_bits)
+            _label_bits[l].assign(bitset_words, 0);
+    }
+    for (size_t i = 0; i < num_points; i++)
+    {
+        for (uint32_t j = offsets[i]; j < offsets[i] + counts[i]; j++)
+        {
+            uint32_t l = dense_ids[j];
+            if (use_point_bits)
+                _point_bits[i * _point_words + l / 64] |= (uint64_t)1 << (l % 64);
+            else if (!_label_bits[l].empty())
+                _label_bits[l][i / 64] |= (uint64_t)1 << (i % 64);
+            if (_label_points[l].capacity() > 0 && (_label_points[l].empty() || _label_points[l].back() != (uint32_t)i))
+                _label_points[l].push_back((uint32_t)i);
+        }
+    }
+}
+
+template <typename LabelT> bool LabelIndex<LabelT>::empty() const
+{
+    return _label_counts.empty();
+}
+
+template <typename LabelT> size_t LabelIndex<LabelT>::get_num_points() const
+{
+    return _num_points;
+}
+
+template <typename LabelT> size_t LabelIndex<LabelT>::get_num_labels() const
+{
+    return _label_counts.size();
+}
+
+template <typename LabelT> bool LabelIndex<LabelT>::uses_point_bitsets() const
+{
+    return _point_words > 0;
+}
+
+template <typename LabelT> size_t LabelIndex<LabelT>::get_label_count(const LabelT &label) const
+{
+    uint32_t l = get_dense_label(label);
+    return l == NO_LABEL ? 0 : _label_counts[l];
+}
+
+template <typename LabelT> bool LabelIndex<LabelT>::has_label(const uint32_t point, const LabelT &label) const
+{
+    uint32_t l = get_dense_label(label);
+    return l != NO_LABEL && has_dense_label(point, l);
+}
+
+template <typename LabelT> uint32_t LabelIndex<LabelT>::get_dense_label(const LabelT &label) const
+{
+    auto iter = _label_to_dense.find(label);
+    return iter == _label_to_dense.end() ? NO_LABEL : iter->second;
+}
+
+template <typename LabelT>
+typename LabelIndex<LabelT>::Filter LabelIndex<LabelT>::compile(const LabelPredicate<LabelT> &predicate,
+                                                                const LabelT *universal_label) const
+{
+    Filter filter;
+    filter._root = compile_node(predicate, filter);
+    filter._universal_label = universal_label != nullptr ? get_dense_label(*universal_label) : NO_LABEL;
+    return filter;
+}
+
+template <typename LabelT>
+uint32_t LabelIndex<LabelT>::compile_node(const LabelPredicate<LabelT> &predicate, Filter &filter) const
+{
+    typedef typename LabelPredicate<LabelT>::Op Op;
+    typename Filter::Node node;
+    node.op = predicate.op();
+    node.label = predicate.op() == Op::LABEL ? get_dense_label(predicate.get_label()) : NO_LABEL;
+    node.mask = NO_MASK;
+    if (node.op == Op::NOT && predicate.operands().size() != 1)
+        throw ANNException("Error: a negation takes exactly one operand.", -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    std::vector<uint32_t> operand_ids;
+    for (const auto &operand : predicate.operands())
+        operand_ids.push_back(compile_node(operand, filter));
+    node.first = (uint32_t)filter._operand_ids.size();
+    filter._operand_ids.insert(filter._operand_ids.end(), operand_ids.begin(), operand_ids.end());
+    node.last = (uint32_t)filter._operand_ids.size();
+
+    // a conjunction or disjunction of known labels is a mask test on the
+    // point bitsets; unknown labels make a conjunction false
+    if (_point_words > 0 && (node.op == Op::ALL_OF || node.op == Op::ANY_OF))
+    {
+        bool all_labels = true;
+        for (uint32_t id : operand_ids)
+        {
+            const auto &operand = filter._nodes[id];
+            all_labels = all_labels && operand.op == Op::LABEL && (operand.label != NO_LABEL || node.op == Op::ANY_OF);
+        }
+        if (all_labels)
+        {
+            node.mask = (uint32_t)filter._masks.size();
+            filter._masks.resize(filter._masks.size() + _point_words, 0);
+            for (uint32_t id : operand_ids)
+            {
+                uint32_t l = filter._nodes[id].label;
+                if (l != NO_LABEL)
+                    filter._masks[node.mask + l / 64] |= (uint64_t)1 << (l % 64);
+            }
+        }
+    }
+
+    filter._nodes.push_back(node);
+    return (uint32_t)filter._nodes.size() - 1;
+}
+
+template <typename LabelT> size_t LabelIndex<LabelT>::estimate_matches(const Filter &filter) const
+{
+    size_t estimate = estimate_node(filter, filter._root);
+    if (filter._universal_label != NO_LABEL)
+        estimate += _label_counts[filter._universal_label];
+    return (std::min)(estimate, _num_points);
+}
+
+template <typename LabelT>
+size_t LabelIndex<LabelT>::estimate_node(const Filter &filter, const uint32_t node_id) const
+{
+    typedef typename LabelPredicate<LabelT>::Op Op;
+    const typename Filter::Node &node = filter._nodes[node_id];
+    if (node.op == Op::LABEL)
+        return node.label == NO_LABEL ? 0 : _label_counts[node.label];
+    if (node.op == Op::NOT)
+        return _num_points;
+
+    size_t estimate = node.op == Op::ALL_OF ? _num_points : 0;
+    for (uint32_t i = node.first; i < node.last; i++)
+    {
+        size_t operand = estimate_node(filter, filter._operand_ids[i]);
+        estimate = node.op == Op::ALL_OF ? (std::min)(estimate, operand) : estimate + operand;
+    }
+    return (std::min)(estimate, _num_points);
+}
+
+template <typename LabelT>
+bool LabelIndex<LabelT>::get_matching_points(const Filter &filter, std::vector<uint32_t> &points) const
+{
+    std::vector<uint32_t> candidates, universal;
+    bool enumerable = collect_candidates(filter, filter._root, candidates);
+    if (enumerable && filter._universal_label != NO_LABEL)
+    {
+        std::vector<uint32_t> merged;
+        enumerable = append_label_points(filter._universal_label, universal);
+        std::set_union(candidates.begin(), candidates.end(), universal.begin(), universal.end(),
+                       std::back_inserter(merged));
+        candidates.swap(merged);
+    }
+    if (!enumerable)
+    {
+        // the point bitsets are cheap enough to test one by one
+        if (_point_words == 0)
+            return false;
+        for (uint32_t point = 0; point < _num_points; point++)
+        {
+            if (matches(filter, point))
+                points.push_back(point);
+        }
+        return true;
+    }
+    for (uint32_t point : candidates)
+    {
+        if (matches(filter, point))
+            points.push_back(point);
+    }
+    return true;
+}
+
+template <typename LabelT>
+bool LabelIndex<LabelT>::collect_candidates(const Filter &filter, const uint32_t node_id,
+                                            std::vector<uint32_t> &points) const
+{
+    typedef typename LabelPredicate<LabelT>::Op Op;
+    const typename Filter::Node &node = filter._nodes[node_id];
+    if (node.op == Op::LABEL)
+        return node.label == NO_LABEL || append_label_points(node.label, points);
+    if (node.op == Op::NOT || node.first == node.last)
+        return node.op == Op::ANY_OF;
+
+    if (node.op == Op::ALL_OF)
+    {
+        // the points of the most selective operand that can be enumerated
+        std::vector<uint32_t> operands(filter._operand_ids.begin() + node.first,
+                                       filter._operand_ids.begin() + node.last);
+        std::sort(operands.begin(), operands.end(), [&](const uint32_t a, const uint32_t b) {
+            return estimate_node(filter, a) < estimate_node(filter, b);
+        });
+        for (uint32_t operand : operands)
+        {
+            if (collect_candidates(filter, operand, points))
+                return true;
+        }
+        return false;
+    }
+
+    for (uint32_t i = node.first; i < node.last; i++)
+    {
+        std::vector<uint32_t> operand, merged;
+        if (!collect_candidates(filter, filter._operand_ids[i], operand))
+            return false;
+        std::set_union(points.begin(), points.end(), operand.begin(), operand.end(), std::back_inserter(merged));
+        points.swap(merged);
+    }
+    return true;
+}
+
+template <typename LabelT>
+bool LabelIndex<LabelT>::append_label_points(const uint32_t label, std::vector<uint32_t> &points) const
+{
+    if (!_label_points[label].empty())
+    {
+        points.insert(points.end(), _label_points[label].begin(), _label_points[label].end());
+        return true;
+    }
+    if (_label_bits.empty() || _label_bits[label].empty())
+        return false;
+    const std::vector<uint64_t> &bits = _label_bits[label];
+    for (size_t w = 0; w < bits.size(); w++)
+    {
+        for (uint32_t b = 0; b < 64 && bits[w] >> b != 0; b++)
+        {
+            if ((bits[w] >> b) & 1)
+                points.push_back((uint32_t)(w * 64 + b));
+        }
+    }
+    return true;
+}
+
+template class LabelPredicate<uint32_t>;
+template class LabelPredicate<uint16_t>;
+template class LabelIndex<uint32_t>;
+template class LabelIndex<uint16_t>;
+
+} // namespace diskann
@@ -3,6 +3,7 @@
 
 #include "logger.h"
 #include "memory_mapper.h"
+#include <cerrno>
 #include <iostream>
 #include <sstream>
 
@@ -12,7 +13,12 @@ MemoryMapper::MemoryMapper(const std::string &filename) : MemoryMapper(filename.
 {
 }
 
-MemoryMapper::MemoryMapper(const char *filename)
+MemoryMapper::MemoryMapper(const char *filename) : MemoryMapper(filename, false, false)
+{
+}
+
+MemoryMapper::MemoryMapper(const char *filename, bool populate, bool advise_hugepages)
+    : _buf(nullptr), _fileSize(0), _fileName(filename)
 {
 #ifndef _WINDOWS
     _fd = open(filename, O_RDONLY);
@@ -29,7 +35,36 @@ MemoryMapper::MemoryMapper(const char *filename)
     }
     _fileSize = sb.st_size;
     diskann::cout << "File Size: " << _fileSize << std::endl;
-    _buf = (char *)mmap(NULL, _fileSize, PROT_READ, MAP_PRIVATE, _fd, 0);
+    // map without MAP_POPULATE, so that the hugepage advice is given before
+    // the pages are faulted in
+    void *buf = mmap(NULL, _fileSize, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (buf == MAP_FAILED)
+    {
+        std::cerr << "mmap of " << filename << " failed with error " << errno << std::endl;
+        _buf = nullptr;
+        return;
+    }
+    _buf = (char *)buf;
+#ifdef MADV_HUGEPAGE
+    if (advise_hugepages && madvise(_buf, _fileSize, MADV_HUGEPAGE) != 0)
+        diskann::cout << "Transparent hugepages not available for " << filename << ", using regular pages"
+                      << std::endl;
+#endif
+    if (populate)
+    {
+        bool populated = false;
+#ifdef MADV_POPULATE_READ
+        populated = madvise(_buf, _fileSize, MADV_POPULATE_READ) == 0;
+#endif
+        if (!populated)
+        {
+            // older kernels: fault in every page by reading it
+            const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+            volatile char sink = 0;
+            for (size_t offset = 0; offset < _fileSize; offset += page_size)
+                sink = sink + _buf[offset];
+        }
+    }
 #else
     _bareFile =
         CreateFileA(filename, GENERIC_READ | GENERIC_EXECUTE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -84,9 +119,10 @@ size_t MemoryMapper::getFileSize()
 MemoryMapper::~MemoryMapper()
 {
 #ifndef _WINDOWS
-    if (munmap(_buf, _fileSize) != 0)
+    if (_buf != nullptr && munmap(_buf, _fileSize) != 0)
         std::cerr << "ERROR unmapping. CHECK!" << std::endl;
-    close(_fd);
+    if (_fd > 0)
+        close(_fd);
 #else
     if (FALSE == UnmapViewOfFile(_buf))
     {
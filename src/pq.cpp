@@ -287,6 +287,27 @@ void FixedChunkPQTable::populate_chunk_inner_products(const float *query_vec, fl
     }
 }
 
+void FixedChunkPQTable::populate_symmetric_chunk_distances(float *sdc_tables)
+{
+    memset(sdc_tables, 0, 256 * 256 * n_chunks * sizeof(float));
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        float *chunk_dists = sdc_tables + (256 * 256 * chunk);
+        for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+        {
+            const float *centers_dim_vec = tables_tr + (256 * j);
+            for (size_t idx1 = 0; idx1 < 256; idx1++)
+            {
+                for (size_t idx2 = 0; idx2 < 256; idx2++)
+                {
+                    float diff = centers_dim_vec[idx1] - centers_dim_vec[idx2];
+                    chunk_dists[idx1 * 256 + idx2] += diff * diff;
+                }
+            }
+        }
+    }
+}
+
 void aggregate_coords(const std::vector<uint32_t> &ids, const uint8_t *all_coords, const uint64_t ndims, uint8_t *out)
 {
     for (size_t i = 0; i < ids.size(); i++)
@@ -4,6 +4,7 @@
 #include "common_includes.h"
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <cmath>
 
@@ -12,8 +13,9 @@
 #include "pq_scratch.h"
 #include "pq_flash_index.h"
 #include "cosine_similarity.h"
-#include "embedding.pb.h" // from embedding.proto -> embedding.pb.h
-#include <zmq.h>
+#include "compressed_graph.h"
+#include "contiguous_graph_store.h"
+#include "filter_utils.h"
 #include <fstream>
 #include <atomic>
 #include <mutex>
@@ -73,7 +75,7 @@ PQFlashIndex<T, LabelT>::PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileRe
 template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
 {
 #ifndef EXEC_ENV_OLS
-    if (data != nullptr)
+    if (data != nullptr && _pq_data_mapper == nullptr)
     {
         delete[] data;
     }
@@ -84,8 +86,16 @@ template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
     // delete backing bufs for nhood and coord cache
     if (_nhood_cache_buf != nullptr)
     {
-        delete[] _nhood_cache_buf;
-        diskann::aligned_free(_coord_cache_buf);
+        if (_nhood_cache_buf_alloc_size > 0)
+        {
+            diskann::free_hugepage_backed(_nhood_cache_buf, _nhood_cache_buf_alloc_size);
+            diskann::free_hugepage_backed(_coord_cache_buf, _coord_cache_buf_alloc_size);
+        }
+        else
+        {
+            delete[] _nhood_cache_buf;
+            diskann::aligned_free(_coord_cache_buf);
+        }
     }
 
     if (_load_flag)
@@ -96,15 +106,15 @@ template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
         this->reader->deregister_all_threads();
         reader->close();
     }
-    if (_pts_to_label_offsets != nullptr)
+    if (_pts_to_label_offsets != nullptr && _bin_labels == nullptr)
     {
         delete[] _pts_to_label_offsets;
     }
-    if (_pts_to_label_counts != nullptr)
+    if (_pts_to_label_counts != nullptr && _bin_labels == nullptr)
     {
         delete[] _pts_to_label_counts;
     }
-    if (_pts_to_labels != nullptr)
+    if (_pts_to_labels != nullptr && _bin_labels == nullptr)
     {
         delete[] _pts_to_labels;
     }
@@ -284,41 +294,13 @@ std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t
             // Process all nodes in this partition
             for (size_t idx : indices)
             {
-                uint32_t node_id = node_ids[idx];
-
-                // Find node's position in partition (same as read_neighbors)
-                const auto &part_list = _graph_partitions[partition_id];
-                auto it = std::find(part_list.begin(), part_list.end(), node_id);
-                if (it == part_list.end())
-                {
-                    retval[idx] = false;
-                    continue;
-                }
-                size_t j = std::distance(part_list.begin(), it);
-
-                // Calculate node's offset within sector (same as read_neighbors)
-                uint64_t node_offset = j * _graph_node_len;
-                if (node_offset + 4 > defaults::SECTOR_LEN)
-                {
-                    retval[idx] = false;
-                    continue;
-                }
-
-                // Read neighbor count
-                char *adjacency_ptr = sector_buf + node_offset;
-                uint32_t neighbor_count = *reinterpret_cast<uint32_t *>(adjacency_ptr);
-
-                // Check if neighbor data exceeds sector range
-                size_t needed = neighbor_count * sizeof(uint32_t);
-                if (node_offset + 4 + needed > defaults::SECTOR_LEN)
+                uint64_t nnbrs;
+                if (!read_partition_nbrs(sector_buf, partition_id, node_ids[idx], nbr_buffers[idx].second, nnbrs))
                 {
                     retval[idx] = false;
                     continue;
                 }
-
-                // Copy neighbor data
-                nbr_buffers[idx].first = neighbor_count;
-                memcpy(nbr_buffers[idx].second, adjacency_ptr + 4, needed);
+                nbr_buffers[idx].first = (uint32_t)nnbrs;
             }
 
             aligned_free(sector_buf);
@@ -328,19 +310,110 @@ std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t
     return retval;
 }
 
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::read_partition_nbrs(const char *sector_buf, uint32_t partition_id, uint32_t node_id,
+                                                  uint32_t *nbrs, uint64_t &nnbrs)
+{
+    // partitions hold a sector worth of nodes, a linear scan is cheap
+    const auto &part_list = _graph_partitions[partition_id];
+    auto it = std::find(part_list.begin(), part_list.end(), node_id);
+    if (it == part_list.end())
+        return false;
+    uint32_t j = (uint32_t)std::distance(part_list.begin(), it);
+
+    if (_compressed_graph)
+    {
+        const uint8_t *record;
+        size_t record_len;
+        return get_compressed_record(sector_buf, defaults::SECTOR_LEN, j, record, record_len) &&
+               decode_adjacency(record, record_len, nbrs, _max_degree, nnbrs);
+    }
+
+    uint64_t node_offset = j * _graph_node_len;
+    if (node_offset + sizeof(uint32_t) > defaults::SECTOR_LEN)
+        return false;
+    uint32_t neighbor_count = *reinterpret_cast<const uint32_t *>(sector_buf + node_offset);
+    if (neighbor_count > _max_degree ||
+        node_offset + (1 + (uint64_t)neighbor_count) * sizeof(uint32_t) > defaults::SECTOR_LEN)
+        return false;
+    memcpy(nbrs, sector_buf + node_offset + sizeof(uint32_t), neighbor_count * sizeof(uint32_t));
+    nnbrs = neighbor_count;
+    return true;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_memory_options(bool mmap_pq_data, bool use_hugepages)
+{
+    if (_load_flag)
+    {
+        diskann::cerr << "Memory options must be set before the index is loaded, ignoring." << std::endl;
+        return;
+    }
+    _mmap_pq_data = mmap_pq_data;
+    _use_hugepages = use_hugepages;
+}
+
+#ifndef EXEC_ENV_OLS
+template <typename T, typename LabelT>
+int PQFlashIndex<T, LabelT>::map_pq_compressed_vectors(const std::string &pq_compressed_vectors, size_t &npts,
+                                                       size_t &nchunks)
+{
+    diskann::cout << "Memory-mapping PQ compressed vectors from " << pq_compressed_vectors << std::endl;
+    _pq_data_mapper = std::make_unique<MemoryMapper>(pq_compressed_vectors.c_str(), true, _use_hugepages);
+    char *buf = _pq_data_mapper->getBuf();
+    size_t file_size = _pq_data_mapper->getFileSize();
+    if (buf == nullptr || file_size < 2 * sizeof(int32_t))
+    {
+        diskann::cerr << "Failed to map " << pq_compressed_vectors << std::endl;
+        _pq_data_mapper.reset();
+        return -1;
+    }
+
+    int32_t npts_i32, nchunks_i32;
+    memcpy(&npts_i32, buf, sizeof(int32_t));
+    memcpy(&nchunks_i32, buf + sizeof(int32_t), sizeof(int32_t));
+    npts = (size_t)npts_i32;
+    nchunks = (size_t)nchunks_i32;
+
+    size_t expected_file_size = npts * nchunks * sizeof(uint8_t) + 2 * sizeof(int32_t);
+    if (file_size != expected_file_size)
+    {
+        diskann::cerr << "PQ compressed vectors file " << pq_compressed_vectors << " has size " << file_size
+                      << " while expected size is " << expected_file_size << std::endl;
+        _pq_data_mapper.reset();
+        return -1;
+    }
+
+    this->data = (uint8_t *)(buf + 2 * sizeof(int32_t));
+    return 0;
+}
+#endif
+
 template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::load_cache_list(std::vector<uint32_t> &node_list)
 {
     diskann::cout << "Loading the cache list into memory.." << std::flush;
     size_t num_cached_nodes = node_list.size();
 
-    // Allocate space for neighborhood cache
-    _nhood_cache_buf = new uint32_t[num_cached_nodes * (_max_degree + 1)];
-    memset(_nhood_cache_buf, 0, num_cached_nodes * (_max_degree + 1));
-
-    // Allocate space for coordinate cache
+    size_t nhood_cache_buf_len = num_cached_nodes * (_max_degree + 1);
     size_t coord_cache_buf_len = num_cached_nodes * _aligned_dim;
-    diskann::alloc_aligned((void **)&_coord_cache_buf, coord_cache_buf_len * sizeof(T), 8 * sizeof(T));
-    memset(_coord_cache_buf, 0, coord_cache_buf_len * sizeof(T));
+    if (_use_hugepages)
+    {
+        // hugepage-backed mappings come back zero-filled
+        _nhood_cache_buf_alloc_size =
+            diskann::alloc_hugepage_backed((void **)&_nhood_cache_buf, nhood_cache_buf_len * sizeof(uint32_t));
+        _coord_cache_buf_alloc_size =
+            diskann::alloc_hugepage_backed((void **)&_coord_cache_buf, coord_cache_buf_len * sizeof(T));
+    }
+    else
+    {
+        // Allocate space for neighborhood cache
+        _nhood_cache_buf = new uint32_t[nhood_cache_buf_len];
+        memset(_nhood_cache_buf, 0, nhood_cache_buf_len * sizeof(uint32_t));
+
+        // Allocate space for coordinate cache
+        diskann::alloc_aligned((void **)&_coord_cache_buf, coord_cache_buf_len * sizeof(T), 8 * sizeof(T));
+        memset(_coord_cache_buf, 0, coord_cache_buf_len * sizeof(T));
+    }
 
     size_t BLOCK_SIZE = 8;
     size_t num_blocks = DIV_ROUND_UP(num_cached_nodes, BLOCK_SIZE);
@@ -774,18 +847,7 @@ void PQFlashIndex<T, LabelT>::get_label_file_metadata(const std::string &fileCon
 template <typename T, typename LabelT>
 inline bool PQFlashIndex<T, LabelT>::point_has_label(uint32_t point_id, LabelT label_id)
 {
-    uint32_t start_vec = _pts_to_label_offsets[point_id];
-    uint32_t num_lbls = _pts_to_label_counts[point_id];
-    bool ret_val = false;
-    for (uint32_t i = 0; i < num_lbls; i++)
-    {
-        if (_pts_to_labels[start_vec + i] == label_id)
-        {
-            ret_val = true;
-            break;
-        }
-    }
-    return ret_val;
+    return _label_index.has_label(point_id, label_id);
 }
 
 template <typename T, typename LabelT>
@@ -877,6 +939,118 @@ template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_univers
     _universal_filter_label = label;
 }
 
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::load_bin_labels(const std::string &bin_labels_file, const std::string &labels_map_file)
+{
+    _bin_labels = std::make_unique<MappedBinLabels<LabelT>>(bin_labels_file);
+    if (_bin_labels->num_points != _num_points)
+    {
+        std::stringstream stream;
+        stream << "Labels file " << bin_labels_file << " has " << _bin_labels->num_points << " points, expected "
+               << _num_points;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    // read-only, nothing writes to the label arrays after load
+    _pts_to_label_offsets = const_cast<uint32_t *>(_bin_labels->offsets);
+    _pts_to_label_counts = const_cast<uint32_t *>(_bin_labels->counts);
+    _pts_to_labels = const_cast<LabelT *>(_bin_labels->labels);
+    _label_index.build(_num_points, _pts_to_label_offsets, _pts_to_label_counts, _pts_to_labels);
+
+    if (file_exists(labels_map_file))
+    {
+        std::ifstream map_reader(labels_map_file);
+        _label_map = load_label_map(map_reader);
+    }
+
+    _filter_to_medoid_ids.clear();
+    for (uint64_t i = 0; i < _bin_labels->num_medoids; i++)
+        _filter_to_medoid_ids[_bin_labels->medoid_labels[i]].push_back(_bin_labels->medoids[i]);
+
+    if (_bin_labels->use_universal_label)
+        set_universal_label(_bin_labels->universal_label);
+
+    for (uint64_t i = 0; i < _bin_labels->num_dummies; i++)
+        add_dummy_point(_bin_labels->dummy_ids[i], _bin_labels->dummy_real_ids[i]);
+    diskann::cout << "Loaded labels of " << _num_points << " points from " << bin_labels_file << std::endl;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::add_dummy_point(uint32_t dummy_id, uint32_t real_id)
+{
+    _dummy_pts.insert(dummy_id);
+    _has_dummy_pts.insert(real_id);
+    _dummy_to_real_map[dummy_id] = real_id;
+    _real_to_dummy_map[real_id].emplace_back(dummy_id);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::load_navigation_graph(const std::string &nav_graph_file)
+{
+    uint32_t *nav_ids = nullptr;
+    size_t num_nav_points, dim;
+    diskann::load_bin<uint32_t>(nav_graph_file + "_ids.bin", nav_ids, num_nav_points, dim);
+    _nav_ids.assign(nav_ids, nav_ids + num_nav_points);
+    delete[] nav_ids;
+    for (uint32_t id : _nav_ids)
+    {
+        if (id >= _num_points)
+            throw ANNException("Error: navigation graph point " + std::to_string(id) + " is not in the index.", -1,
+                               __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _nav_graph = std::make_unique<ContiguousGraphStore>(num_nav_points, 0);
+    auto graph_info = _nav_graph->load(nav_graph_file, num_nav_points);
+    if (std::get<0>(graph_info) != num_nav_points || std::get<1>(graph_info) >= num_nav_points)
+        throw ANNException("Error: navigation graph " + nav_graph_file + " does not match its ids.", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    _nav_start = std::get<1>(graph_info);
+    diskann::cout << "Loaded navigation graph over " << num_nav_points << " points" << std::endl;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::search_navigation_graph(SSDQueryScratch<T> *query_scratch, const float *pq_dists,
+                                                      const uint64_t l_search, std::vector<uint32_t> &start_points)
+{
+    uint8_t *pq_coord_scratch = query_scratch->pq_scratch()->aligned_pq_coord_scratch;
+    float *dist_scratch = query_scratch->pq_scratch()->aligned_dist_scratch;
+    NeighborPriorityQueue &candidates = query_scratch->nav_retset;
+    tsl::robin_set<uint32_t> &visited = query_scratch->nav_visited;
+    std::vector<uint32_t> &local_ids = query_scratch->nav_local_ids;
+    std::vector<uint32_t> &ids = query_scratch->nav_ids;
+    candidates.reserve(l_search);
+
+    // PQ distances of the nav graph points local_ids, which are inserted
+    auto insert_points = [&]() {
+        ids.clear();
+        for (uint32_t local_id : local_ids)
+            ids.push_back(_nav_ids[local_id]);
+        diskann::aggregate_coords(ids.data(), ids.size(), this->data, this->_n_chunks, pq_coord_scratch);
+        diskann::pq_dist_lookup(pq_coord_scratch, ids.size(), this->_n_chunks, pq_dists, dist_scratch);
+        for (size_t i = 0; i < local_ids.size(); i++)
+            candidates.insert(Neighbor(local_ids[i], dist_scratch[i]));
+        local_ids.clear();
+    };
+
+    visited.insert(_nav_start);
+    local_ids.push_back(_nav_start);
+    insert_points();
+    while (candidates.has_unexpanded_node())
+    {
+        for (location_t nbr : _nav_graph->get_neighbours(candidates.closest_unexpanded().id))
+        {
+            if (visited.insert(nbr).second)
+                local_ids.push_back(nbr);
+            if (local_ids.size() == defaults::MAX_GRAPH_DEGREE)
+                insert_points();
+        }
+        if (!local_ids.empty())
+            insert_points();
+    }
+
+    for (size_t i = 0; i < candidates.size() && i < defaults::NUM_NAV_GRAPH_START_POINTS; i++)
+        start_points.push_back(_nav_ids[candidates[i].id]);
+}
+
 #ifdef EXEC_ENV_OLS
 template <typename T, typename LabelT>
 int PQFlashIndex<T, LabelT>::load(MemoryMappedFiles &files, uint32_t num_threads, const char *index_prefix,
@@ -986,6 +1160,14 @@ int PQFlashIndex<T, LabelT>::load_graph_index(const std::string &graph_index_fil
                   << ", max_node_len= " << max_node_len << ", c_in_meta= " << c_in_meta
                   << ", entire_file_size= " << entire_file_sz << "\n";
 
+    // the compressed format marks itself in sector 0, after the metadata
+    std::vector<char> sector0(defaults::SECTOR_LEN, 0);
+    gf.seekg(0, std::ios::beg);
+    gf.read(sector0.data(), defaults::SECTOR_LEN);
+    _compressed_graph =
+        gf.gcount() == (std::streamsize)defaults::SECTOR_LEN && is_compressed_graph_header(sector0.data());
+    diskann::cout << "  adjacency format= " << (_compressed_graph ? "compressed" : "fixed slots") << "\n";
+
     uint64_t dim_size = dim_in_meta * sizeof(float);
 
     _graph_node_len = max_node_len - dim_size;
@@ -1059,11 +1241,28 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
 #ifdef EXEC_ENV_OLS
     diskann::load_bin<uint8_t>(files, pq_compressed_vectors, this->data, npts_u64, nchunks_u64);
 #else
-    diskann::load_bin<uint8_t>(pq_compressed_vectors, this->data, npts_u64, nchunks_u64);
+    if (_mmap_pq_data)
+    {
+        if (map_pq_compressed_vectors(pq_compressed_vectors, npts_u64, nchunks_u64) != 0)
+            return -1;
+    }
+    else
+    {
+        diskann::load_bin<uint8_t>(pq_compressed_vectors, this->data, npts_u64, nchunks_u64);
+    }
 #endif
 
     this->_num_points = npts_u64;
     this->_n_chunks = nchunks_u64;
+    this->_deleted_bitmap = std::vector<std::atomic<uint64_t>>(DIV_ROUND_UP(_num_points, 64));
+#ifndef EXEC_ENV_OLS
+    std::string bin_labels_file = std::string(_disk_index_file) + "_labels.bin";
+    if (file_exists(bin_labels_file))
+    {
+        load_bin_labels(bin_labels_file, labels_map_file);
+    }
+    else
+#endif
 #ifdef EXEC_ENV_OLS
     if (files.fileExists(labels_file))
     {
@@ -1080,6 +1279,7 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
 #endif
         parse_label_file(infile, num_pts_in_label_file);
         assert(num_pts_in_label_file == this->_num_points);
+        _label_index.build(num_pts_in_label_file, _pts_to_label_offsets, _pts_to_label_counts, _pts_to_labels);
 
 #ifndef EXEC_ENV_OLS
         infile.close();
@@ -1187,14 +1387,7 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
                         real_id = (uint32_t)stoul(token);
                     cnt++;
                 }
-                _dummy_pts.insert(dummy_id);
-                _has_dummy_pts.insert(real_id);
-                _dummy_to_real_map[dummy_id] = real_id;
-
-                if (_real_to_dummy_map.find(real_id) == _real_to_dummy_map.end())
-                    _real_to_dummy_map[real_id] = std::vector<uint32_t>();
-
-                _real_to_dummy_map[real_id].emplace_back(dummy_id);
+                add_dummy_point(dummy_id, real_id);
             }
 #ifndef EXEC_ENV_OLS
             dummy_map_stream.close();
@@ -1203,6 +1396,26 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         }
     }
 
+#ifndef EXEC_ENV_OLS
+    // written by reorder_disk_index, the original id of each point
+    std::string id_map_file = std::string(_disk_index_file) + "_id_map.bin";
+    if (file_exists(id_map_file))
+    {
+        uint32_t *id_map = nullptr;
+        size_t id_map_npts, id_map_dim;
+        diskann::load_bin<uint32_t>(id_map_file, id_map, id_map_npts, id_map_dim);
+        _id_map.assign(id_map, id_map + id_map_npts);
+        delete[] id_map;
+        if (id_map_npts != _num_points)
+        {
+            std::stringstream stream;
+            stream << "Id map " << id_map_file << " has " << id_map_npts << " ids, expected " << _num_points;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        diskann::cout << "Loaded id map of the reordered index" << std::endl;
+    }
+#endif
+
 #ifdef EXEC_ENV_OLS
     _pq_table.load_pq_centroid_bin(files, pq_table_bin.c_str(), nchunks_u64);
 #else
@@ -1455,6 +1668,12 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         delete[] norm_val;
     }
 
+#ifndef EXEC_ENV_OLS
+    std::string nav_graph_file = _disk_index_file + "_nav_graph";
+    if (file_exists(nav_graph_file) && file_exists(nav_graph_file + "_ids.bin"))
+        load_navigation_graph(nav_graph_file);
+#endif
+
     if (_use_partition)
     {
         read_partition_info(partition_file);
@@ -1518,11 +1737,12 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                                                  const bool use_reorder_data, QueryStats *stats,
                                                  bool USE_DEFERRED_FETCH, bool skip_search_reorder,
                                                  bool recompute_beighbor_embeddings, bool dedup_node_dis,
-                                                 float prune_ratio, const bool batch_recompute, bool global_pruning)
+                                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                                 const uint32_t recompute_budget)
 {
     cached_beam_search(query1, k_search, l_search, indices, distances, beam_width, std::numeric_limits<uint32_t>::max(),
                        use_reorder_data, stats, USE_DEFERRED_FETCH, skip_search_reorder, recompute_beighbor_embeddings,
-                       dedup_node_dis, prune_ratio, batch_recompute, global_pruning);
+                       dedup_node_dis, prune_ratio, batch_recompute, global_pruning, recompute_budget);
 }
 
 template <typename T, typename LabelT>
@@ -1532,12 +1752,13 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                                                  const bool use_reorder_data, QueryStats *stats,
                                                  bool USE_DEFERRED_FETCH, bool skip_search_reorder,
                                                  bool recompute_beighbor_embeddings, bool dedup_node_dis,
-                                                 float prune_ratio, const bool batch_recompute, bool global_pruning)
+                                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                                 const uint32_t recompute_budget)
 {
     cached_beam_search(query1, k_search, l_search, indices, distances, beam_width, use_filter, filter_label,
                        std::numeric_limits<uint32_t>::max(), use_reorder_data, stats, USE_DEFERRED_FETCH,
                        skip_search_reorder, recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute,
-                       global_pruning);
+                       global_pruning, recompute_budget);
 }
 
 template <typename T, typename LabelT>
@@ -1546,12 +1767,46 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                                                  const uint32_t io_limit, const bool use_reorder_data,
                                                  QueryStats *stats, bool USE_DEFERRED_FETCH, bool skip_search_reorder,
                                                  bool recompute_beighbor_embeddings, bool dedup_node_dis,
-                                                 float prune_ratio, const bool batch_recompute, bool global_pruning)
+                                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                                 const uint32_t recompute_budget)
 {
-    LabelT dummy_filter = 0;
-    cached_beam_search(query1, k_search, l_search, indices, distances, beam_width, false, dummy_filter, io_limit,
-                       use_reorder_data, stats, USE_DEFERRED_FETCH, skip_search_reorder, recompute_beighbor_embeddings,
-                       dedup_node_dis, prune_ratio, batch_recompute, global_pruning);
+    cached_beam_search_impl(query1, k_search, l_search, indices, distances, beam_width, nullptr, io_limit,
+                            use_reorder_data, stats, USE_DEFERRED_FETCH, skip_search_reorder,
+                            recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute, global_pruning,
+                            recompute_budget);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                                 uint64_t *indices, float *distances, const uint64_t beam_width,
+                                                 const bool use_filter, const LabelT &filter_label,
+                                                 const uint32_t io_limit, const bool use_reorder_data,
+                                                 QueryStats *stats, bool USE_DEFERRED_FETCH, bool skip_search_reorder,
+                                                 bool recompute_beighbor_embeddings, const bool dedup_node_dis,
+                                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                                 const uint32_t recompute_budget)
+{
+    LabelPredicate<LabelT> filter = LabelPredicate<LabelT>::label(filter_label);
+    cached_beam_search_impl(query1, k_search, l_search, indices, distances, beam_width,
+                            use_filter ? &filter : nullptr, io_limit, use_reorder_data, stats, USE_DEFERRED_FETCH,
+                            skip_search_reorder, recompute_beighbor_embeddings, dedup_node_dis, prune_ratio,
+                            batch_recompute, global_pruning, recompute_budget);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                                 uint64_t *indices, float *distances, const uint64_t beam_width,
+                                                 const LabelPredicate<LabelT> &filter, const uint32_t io_limit,
+                                                 const bool use_reorder_data, QueryStats *stats,
+                                                 bool USE_DEFERRED_FETCH, bool skip_search_reorder,
+                                                 bool recompute_beighbor_embeddings, const bool dedup_node_dis,
+                                                 float prune_ratio, const bool batch_recompute, bool global_pruning,
+                                                 const uint32_t recompute_budget)
+{
+    cached_beam_search_impl(query1, k_search, l_search, indices, distances, beam_width, &filter, io_limit,
+                            use_reorder_data, stats, USE_DEFERRED_FETCH, skip_search_reorder,
+                            recompute_beighbor_embeddings, dedup_node_dis, prune_ratio, batch_recompute, global_pruning,
+                            recompute_budget);
 }
 
 // A helper callback for cURL
@@ -1561,215 +1816,116 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *use
     return size * nmemb;
 }
 
-static void *g_zmq_context = zmq_ctx_new();
-
-struct ZmqContextManager
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_embedding_coalescing(uint32_t window_us, uint32_t max_batch_size)
 {
-    ~ZmqContextManager()
+    if (window_us == 0)
     {
-        if (g_zmq_context)
-        {
-            zmq_ctx_destroy(g_zmq_context);
-            g_zmq_context = nullptr;
-        }
+        _embedding_coalescer.reset();
+        return;
     }
-};
-static ZmqContextManager g_zmq_manager;
+    // the provider and endpoint are read at fetch time, so they can still be changed
+    _embedding_coalescer = std::make_unique<EmbeddingCoalescer>(
+        [this](const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim) {
+            if (this->_embedding_provider != nullptr)
+                return this->_embedding_provider->get_embeddings(node_ids, embeddings, dim);
+            return fetch_embeddings(node_ids, embeddings, dim, this->_embedding_endpoint, this->_zmq_port);
+        },
+        window_us, max_batch_size);
+}
 
-bool fetch_embeddings_zmq(const std::vector<uint32_t> &node_ids, std::vector<std::vector<float>> &out_embeddings,
-                          int zmq_port)
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_prefilter_selectivity(float selectivity)
 {
-    // 1. Protobuf 序列化：创建请求消息
-    protoembedding::NodeEmbeddingRequest req_proto;
-    for (const auto id : node_ids)
-    {
-        req_proto.add_node_ids(id);
-    }
-    std::string req_str;
-    if (!req_proto.SerializeToString(&req_str))
-    {
-        std::cerr << "ZMQ_FETCH_ERROR: Failed to serialize NodeEmbeddingRequest.\n";
-        return false;
-    }
-
-    // 2. Use thread-local (thread_local) Socket for connection reuse
-    // Each thread will have its own persistent Socket
-    thread_local void *tl_socket = nullptr;
-
-    // Thread-local cleanup helper
-    thread_local struct SocketCleanup
-    {
-        ~SocketCleanup()
-        {
-            if (tl_socket && g_zmq_context)
-            {
-                zmq_close(tl_socket);
-                tl_socket = nullptr;
-            }
-        }
-    } cleanup;
-
-    // If current thread's Socket is not created, initialize and connect
-    if (tl_socket == nullptr)
-    {
-        // Create Socket from global Context
-        tl_socket = zmq_socket(g_zmq_context, ZMQ_REQ);
-        if (!tl_socket)
-        {
-            std::cerr << "ZMQ_FETCH_ERROR: zmq_socket() failed: " << zmq_strerror(zmq_errno()) << "\n";
-            return false;
-        }
-
-        int timeout = 300000; // 300 seconds timeout, same as embedding server
-        zmq_setsockopt(tl_socket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
-        zmq_setsockopt(tl_socket, ZMQ_SNDTIMEO, &timeout, sizeof(timeout));
+    _prefilter_selectivity = selectivity;
+}
 
-        std::string endpoint = "tcp://127.0.0.1:" + std::to_string(zmq_port);
-        if (zmq_connect(tl_socket, endpoint.c_str()) != 0)
-        {
-            std::cerr << "ZMQ_FETCH_ERROR: zmq_connect() to " << endpoint << " failed: " << zmq_strerror(zmq_errno())
-                      << "\n";
-            zmq_close(tl_socket);
-            tl_socket = nullptr; // Reset to nullptr for next call to try rebuilding
-            return false;
-        }
-    }
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_embedding_provider(std::shared_ptr<EmbeddingProvider> provider)
+{
+    _embedding_provider = std::move(provider);
+}
 
-    // 3. Send request using established connection
-    if (zmq_send(tl_socket, req_str.data(), req_str.size(), 0) < 0)
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::fetch_node_embeddings(const std::vector<uint32_t> &node_ids,
+                                                    std::vector<float> &embeddings, uint32_t &dim, QueryStats *stats)
+{
+    Timer rpc_timer;
+    // embeddings are keyed by the ids the points had before reordering
+    std::vector<uint32_t> original_ids;
+    if (!_id_map.empty())
     {
-        std::cerr << "ZMQ_FETCH_ERROR: zmq_send() failed: " << zmq_strerror(zmq_errno()) << "\n";
-        zmq_close(tl_socket); // Connection may be invalid, close it
-        tl_socket = nullptr;  // Reset, force next rebuild
-        return false;
+        original_ids.resize(node_ids.size());
+        for (size_t i = 0; i < node_ids.size(); i++)
+            original_ids[i] = _id_map[node_ids[i]];
     }
+    const std::vector<uint32_t> &request_ids = _id_map.empty() ? node_ids : original_ids;
 
-    // 4. Receive response
-    zmq_msg_t response_msg;
-    zmq_msg_init(&response_msg);
-    bool success = true;
-
-    if (zmq_msg_recv(&response_msg, tl_socket, 0) < 0)
-    {
-        std::cerr << "ZMQ_FETCH_ERROR: zmq_msg_recv() failed: " << zmq_strerror(zmq_errno()) << "\n";
-        zmq_close(tl_socket); // Same, connection may be invalid after timeout
-        tl_socket = nullptr;  // Reset, force next rebuild
-        success = false;
-    }
+    dim = 0;
+    bool success;
+    if (_embedding_coalescer != nullptr)
+        success = _embedding_coalescer->fetch(request_ids, embeddings, dim);
+    else if (_embedding_provider != nullptr)
+        success = _embedding_provider->get_embeddings(request_ids, embeddings, dim);
     else
+        success = fetch_embeddings(request_ids, embeddings, dim, this->_embedding_endpoint, this->_zmq_port);
+    success = success && embeddings.size() == node_ids.size() * dim;
+    if (stats != nullptr)
     {
-        // 5. Protobuf deserialization and extract data
-        protoembedding::NodeEmbeddingResponse resp_proto;
-        if (!resp_proto.ParseFromArray(zmq_msg_data(&response_msg), static_cast<int>(zmq_msg_size(&response_msg))))
-        {
-            std::cerr << "ZMQ_FETCH_ERROR: Failed to parse NodeEmbeddingResponse from server.\n";
-            success = false;
-        }
-        else
-        {
-            if (resp_proto.dimensions_size() == 2)
-            {
-                int batch_size = resp_proto.dimensions(0);
-                int embedding_dim = resp_proto.dimensions(1);
-                const std::string &emb_data = resp_proto.embeddings_data();
-                size_t expected_bytes = (size_t)batch_size * embedding_dim * sizeof(float);
-
-                if (batch_size >= 0 && emb_data.size() == expected_bytes)
-                {
-                    out_embeddings.resize(batch_size);
-                    if (batch_size > 0)
-                    {
-                        const float *float_data = reinterpret_cast<const float *>(emb_data.data());
-                        for (int i = 0; i < batch_size; ++i)
-                        {
-                            out_embeddings[i].resize(embedding_dim);
-                            std::memcpy(out_embeddings[i].data(), float_data + (size_t)i * embedding_dim,
-                                        embedding_dim * sizeof(float));
-                        }
-                    }
-                }
-                else
-                {
-                    std::cerr << "ZMQ_FETCH_ERROR: Embedding data size mismatch. Expected " << expected_bytes
-                              << " bytes, got " << emb_data.size() << ".\n";
-                    success = false;
-                }
-            }
-            else
-            {
-                std::cerr << "ZMQ_FETCH_ERROR: Server response has invalid dimensions size.\n";
-                success = false;
-            }
-        }
+        stats->n_recompute_rpcs++;
+        stats->recompute_rpc_us += rpc_timer.elapsed_us();
+        if (success)
+            stats->n_recomputed += (unsigned)node_ids.size();
     }
-
-    // 6. Clean up message object, but keep Socket and Context open for next reuse
-    zmq_msg_close(&response_msg);
-
     return success;
 }
 
-/**
- * fetch_embeddings_http: Function for backward compatibility, now uses ZMQ exclusively
- */
-bool fetch_embeddings_http(const std::vector<uint32_t> &node_ids, std::vector<std::vector<float>> &out_embeddings,
-                           int zmq_port)
-{
-    // Use ZMQ implementation exclusively
-    return fetch_embeddings_zmq(node_ids, out_embeddings, zmq_port);
-}
-
 //! Should be aligned with utils.h::prepare_base_for_inner_products
-void preprocess_fetched_embeddings(std::vector<std::vector<float>> &embeddings, diskann::Metric metric,
-                                   float max_base_norm, uint32_t data_dim)
+// Converts the embeddings fetched from the embedding server, dim floats each,
+// to the format of the points of the index, padded with zeros to out_dim
+// floats each.
+void preprocess_fetched_embeddings(const std::vector<float> &embeddings, uint32_t dim, diskann::Metric metric,
+                                   float max_base_norm, uint32_t data_dim, size_t out_dim, std::vector<float> &out)
 {
-    for (auto &emb : embeddings)
+    const size_t num_embeddings = dim == 0 ? 0 : embeddings.size() / dim;
+    out.resize(num_embeddings * out_dim);
+    // the extra coordinate for MIPS->L2 conversion takes the last dimension
+    size_t copy_dim = (std::min)((size_t)dim, out_dim);
+    if (metric == diskann::Metric::INNER_PRODUCT)
+        copy_dim = (std::min)(copy_dim, (size_t)data_dim - 1);
+
+    for (size_t e = 0; e < num_embeddings; e++)
     {
-        // Ensure embedding has correct size
-        if (emb.size() < data_dim - 1)
-        {
-            // Pad with zeros if needed
-            emb.resize(data_dim - 1, 0);
-        }
+        const float *emb = embeddings.data() + e * dim;
+        float *out_emb = out.data() + e * out_dim;
+        std::copy(emb, emb + copy_dim, out_emb);
+        std::fill(out_emb + copy_dim, out_emb + out_dim, 0.0f);
 
         if (metric == diskann::Metric::INNER_PRODUCT)
         {
             // For inner product, apply same preprocessing as in prepare_base_for_inner_products
-
-            // Calculate original norm
             float norm_sq = 0;
-            for (size_t i = 0; i < data_dim - 1; i++)
-            {
-                norm_sq += emb[i] * emb[i];
-            }
+            for (size_t i = 0; i < copy_dim; i++)
+                norm_sq += out_emb[i] * out_emb[i];
 
             // Normalize by max_base_norm (same as in index construction)
-            for (size_t i = 0; i < data_dim - 1; i++)
-            {
-                emb[i] /= max_base_norm;
-            }
+            for (size_t i = 0; i < copy_dim; i++)
+                out_emb[i] /= max_base_norm;
 
-            // Add the extra coordinate for MIPS->L2 conversion
             float res = 1 - (norm_sq / (max_base_norm * max_base_norm));
-            res = res <= 0 ? 0 : std::sqrt(res);
-            emb.resize(data_dim, res);
+            if (data_dim - 1 < out_dim)
+                out_emb[data_dim - 1] = res <= 0 ? 0 : std::sqrt(res);
         }
         else if (metric == diskann::Metric::COSINE)
         {
             // For cosine similarity, just normalize the vector
             float norm = 0;
-            for (auto val : emb)
-            {
-                norm += val * val;
-            }
+            for (size_t i = 0; i < copy_dim; i++)
+                norm += out_emb[i] * out_emb[i];
             norm = std::sqrt(norm);
-
             if (norm > 0)
             {
-                for (size_t i = 0; i < emb.size(); i++)
-                {
-                    emb[i] /= norm;
-                }
+                for (size_t i = 0; i < copy_dim; i++)
+                    out_emb[i] /= norm;
             }
         }
         // For L2, no preprocessing needed
@@ -1777,13 +1933,15 @@ void preprocess_fetched_embeddings(std::vector<std::vector<float>> &embeddings,
 }
 
 template <typename T, typename LabelT>
-void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
-                                                 uint64_t *indices, float *distances, const uint64_t beam_width,
-                                                 const bool use_filter, const LabelT &filter_label,
-                                                 const uint32_t io_limit, const bool use_reorder_data,
-                                                 QueryStats *stats, bool USE_DEFERRED_FETCH, bool skip_search_reorder,
-                                                 bool recompute_beighbor_embeddings, const bool dedup_node_dis,
-                                                 float prune_ratio, const bool batch_recompute, bool global_pruning)
+void PQFlashIndex<T, LabelT>::cached_beam_search_impl(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                                      uint64_t *indices, float *distances, const uint64_t beam_width,
+                                                      const LabelPredicate<LabelT> *filter, const uint32_t io_limit,
+                                                      const bool use_reorder_data, QueryStats *stats,
+                                                      const bool USE_DEFERRED_FETCH, const bool skip_search_reorder,
+                                                      const bool recompute_beighbor_embeddings,
+                                                      const bool dedup_node_dis, float prune_ratio,
+                                                      const bool batch_recompute, bool global_pruning,
+                                                      const uint32_t recompute_budget)
 {
     // printf("cached_beam_search\n");
     // diskann::cout << "cached_beam_search" << std::endl;
@@ -1796,6 +1954,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         throw ANNException("Beamwidth can not be higher than defaults::MAX_N_SECTOR_READS", -1, __FUNCSIG__, __FILE__,
                            __LINE__);
 
+    const bool use_filter = filter != nullptr;
+    typename LabelIndex<LabelT>::Filter label_filter;
+    if (use_filter)
+        label_filter = _label_index.compile(*filter, _use_universal_label ? &_universal_filter_label : nullptr);
+
     ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
     auto data = manager.scratch_space();
     IOContext &ctx = data->ctx;
@@ -1879,17 +2042,114 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
     std::map<int, float> node_distances;
 
+    // With a recompute budget, nodes are scored with PQ distances first and
+    // only those that could enter the candidate list are recomputed, closest
+    // first, until the query has fetched recompute_budget embeddings. Exact
+    // distances are kept in node_distances for later hops and the final rerank.
+    const bool use_recompute_budget = recompute_beighbor_embeddings && recompute_budget > 0;
+    uint32_t recompute_budget_left = recompute_budget;
+    auto budgeted_dists = [this, pq_coord_scratch, pq_dists, aligned_query_T, data_buf, query_scratch, stats,
+                           &node_distances, &recompute_budget_left](const uint32_t *ids, const uint64_t n_ids,
+                                                                    float *dists_out) {
+        Timer pq_timer;
+        diskann::aggregate_coords(ids, n_ids, this->data, this->_n_chunks, pq_coord_scratch);
+        diskann::pq_dist_lookup(pq_coord_scratch, n_ids, this->_n_chunks, pq_dists, dists_out);
+        if (stats != nullptr)
+            stats->pq_us += pq_timer.elapsed_us();
+
+        // a node can only enter a full candidate list if it beats the last one
+        NeighborPriorityQueue &candidates = query_scratch->retset;
+        float threshold = candidates.size() < candidates.capacity() ? (std::numeric_limits<float>::max)()
+                                                                      : candidates[candidates.size() - 1].distance;
+        std::vector<std::pair<float, uint32_t>> promising; // PQ distance, position in ids
+        uint32_t num_requested = 0, num_cache_hits = 0, num_skipped = 0;
+        for (uint64_t i = 0; i < n_ids; i++)
+        {
+            auto iter = node_distances.find(ids[i]);
+            if (iter != node_distances.end())
+            {
+                dists_out[i] = iter->second;
+                num_requested++;
+                num_cache_hits++;
+            }
+            else if (query_scratch->visited.find(ids[i]) != query_scratch->visited.end())
+            {
+                // distance is not used by the caller
+            }
+            else if (dists_out[i] < threshold)
+            {
+                promising.emplace_back(dists_out[i], (uint32_t)i);
+                num_requested++;
+            }
+            else
+            {
+                num_requested++;
+                num_skipped++;
+            }
+        }
+        std::sort(promising.begin(), promising.end());
+        size_t num_recompute = (std::min)(promising.size(), (size_t)recompute_budget_left);
+        num_skipped += (uint32_t)(promising.size() - num_recompute);
+
+        if (num_recompute > 0)
+        {
+            std::vector<uint32_t> node_ids(num_recompute);
+            for (size_t i = 0; i < num_recompute; i++)
+                node_ids[i] = ids[promising[i].second];
+            std::vector<float> embeddings, points;
+            uint32_t dim;
+            if (this->fetch_node_embeddings(node_ids, embeddings, dim, stats))
+            {
+                Timer preprocess_timer;
+                preprocess_fetched_embeddings(embeddings, dim, this->metric, this->_max_base_norm, this->_data_dim,
+                                              this->_aligned_dim, points);
+                if (stats != nullptr)
+                    stats->preprocess_us += preprocess_timer.elapsed_us();
+                for (size_t i = 0; i < num_recompute; i++)
+                {
+                    memcpy(data_buf, points.data() + i * this->_aligned_dim, this->_aligned_dim * sizeof(T));
+                    float distance =
+                        this->_dist_cmp->compare(aligned_query_T, data_buf, static_cast<uint32_t>(this->_aligned_dim));
+                    dists_out[promising[i].second] = distance;
+                    node_distances[node_ids[i]] = distance;
+                }
+                recompute_budget_left -= (uint32_t)num_recompute;
+            }
+            else
+            {
+                // the PQ distances stay
+                diskann::cout << "Failed to fetch embeddings from the embedding server" << std::endl;
+                num_skipped += (uint32_t)num_recompute;
+            }
+        }
+
+        if (stats != nullptr)
+        {
+            stats->n_recompute_requested += num_requested;
+            stats->n_recompute_cache_hits += num_cache_hits;
+            stats->n_recompute_skipped += num_skipped;
+        }
+    };
+
     // Lambda to batch compute query<->node distances in PQ space
     auto compute_dists = [this, pq_coord_scratch, pq_dists, aligned_query_T, recompute_beighbor_embeddings, data_buf,
-                          &node_distances, &total_nodes_requested, &total_nodes_from_cache,
-                          dedup_node_dis](const uint32_t *ids, const uint64_t n_ids, float *dists_out) {
+                          &node_distances, &total_nodes_requested, &total_nodes_from_cache, dedup_node_dis,
+                          use_recompute_budget, &budgeted_dists, stats](const uint32_t *ids, const uint64_t n_ids,
+                                                                        float *dists_out) {
         // Vector[0], {3, 6, 2}
         // Distance = d[3][1] + d[6][2] + d[2][3]
         // recompute_beighbor_embeddings = true;
         if (!recompute_beighbor_embeddings)
         {
+            Timer pq_timer;
             diskann::aggregate_coords(ids, n_ids, this->data, this->_n_chunks, pq_coord_scratch);
             diskann::pq_dist_lookup(pq_coord_scratch, n_ids, this->_n_chunks, pq_dists, dists_out);
+            if (stats != nullptr)
+                stats->pq_us += pq_timer.elapsed_us();
+        }
+        else if (use_recompute_budget)
+        {
+            budgeted_dists(ids, n_ids, dists_out);
         }
         else
         {
@@ -1934,10 +2194,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             }
 
             // Fetch embeddings from the embedding server
-            std::vector<std::vector<float>> embeddings;
-            bool success = fetch_embeddings_http(node_ids, embeddings, this->_zmq_port);
+            std::vector<float> embeddings, points;
+            uint32_t dim;
+            bool success = this->fetch_node_embeddings(node_ids, embeddings, dim, stats);
 
-            if (!success || embeddings.size() != node_ids.size())
+            if (!success)
             {
                 diskann::cout << "Failed to fetch embeddings from the embedding server" << std::endl;
                 // Fallback to PQ-based distance computation if fetching fails
@@ -1947,7 +2208,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             }
 
             // Preprocess the fetched embeddings to match the format used in diskann
-            preprocess_fetched_embeddings(embeddings, this->metric, this->_max_base_norm, this->_data_dim);
+            Timer preprocess_timer;
+            preprocess_fetched_embeddings(embeddings, dim, this->metric, this->_max_base_norm, this->_data_dim,
+                                          this->_aligned_dim, points);
+            if (stats != nullptr)
+                stats->preprocess_us += preprocess_timer.elapsed_us();
 
             // Compute distances for fetched embeddings
             if (dedup_node_dis)
@@ -1961,8 +2226,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                         continue;
                     }
                     // Prepare embedding for distance computation
-                    embeddings[idx].resize(this->_aligned_dim, 0);
-                    memcpy(data_buf, embeddings[idx].data(), this->_aligned_dim * sizeof(T));
+                    memcpy(data_buf, points.data() + idx * this->_aligned_dim, this->_aligned_dim * sizeof(T));
 
                     // Compute distance
                     float distance =
@@ -1980,8 +2244,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                 for (size_t i = 0; i < n_ids; i++)
                 {
                     // Prepare embedding for distance computation
-                    embeddings[i].resize(this->_aligned_dim, 0);
-                    memcpy(data_buf, embeddings[i].data(), this->_aligned_dim * sizeof(T));
+                    memcpy(data_buf, points.data() + i * this->_aligned_dim, this->_aligned_dim * sizeof(T));
 
                     // Compute distance
                     float distance =
@@ -2007,8 +2270,8 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     // /powerrag/scaling_out/embeddings/facebook/contriever-msmarco/rpj_wiki/compressed_2/
     // 1.2 heruistic 2: use a lightweight reranker to rerank the node_nbrs and nnbrs that is not promising
     auto prune_node_nbrs = [this, pq_coord_scratch, pq_dists, recompute_beighbor_embeddings, dedup_node_dis,
-                            prune_ratio, global_pruning, &aq_priority_queue,
-                            &visited](uint32_t *&node_nbrs, uint64_t &nnbrs) {
+                            prune_ratio, global_pruning, &aq_priority_queue, &visited,
+                            stats](uint32_t *&node_nbrs, uint64_t &nnbrs) {
         if (!recompute_beighbor_embeddings)
         {
             return;
@@ -2023,8 +2286,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         float *dists_out = new float[nnbrs];
 
         // Compute distances using PQ directly instead of compute_dists
+        Timer pq_timer;
         diskann::aggregate_coords(node_nbrs, nnbrs, this->data, this->_n_chunks, pq_coord_scratch);
         diskann::pq_dist_lookup(pq_coord_scratch, nnbrs, this->_n_chunks, pq_dists, dists_out);
+        if (stats != nullptr)
+            stats->pq_us += pq_timer.elapsed_us();
 
         if (global_pruning)
         {
@@ -2102,7 +2368,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         // Free the allocated memory
         delete[] dists_out;
     };
-    Timer query_timer, io_timer, cpu_timer;
+    Timer query_timer, io_timer, cpu_timer, rerank_timer;
 
     NeighborPriorityQueue &retset = query_scratch->retset;
     retset.reserve(l_search);
@@ -2114,9 +2380,132 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     std::vector<std::vector<float>> exact_embeddings;
 #endif
 
+    // A filter matching few points makes the graph search skip most of the
+    // neighbors it reads, so those points are scanned in PQ space instead and
+    // the closest l_search are reranked below.
+    std::vector<uint32_t> prefilter_points;
+    const bool use_prefilter =
+        use_filter && _prefilter_selectivity > 0 &&
+        _label_index.estimate_matches(label_filter) <=
+            (std::max)((double)l_search, (double)_prefilter_selectivity * _num_points) &&
+        _label_index.get_matching_points(label_filter, prefilter_points);
+
+    std::vector<uint32_t> start_points;
     uint32_t best_medoid = 0;
     float best_dist = (std::numeric_limits<float>::max)();
-    if (!use_filter)
+    if (use_prefilter)
+    {
+        Timer pq_timer;
+        for (size_t start = 0; start < prefilter_points.size(); start += defaults::MAX_GRAPH_DEGREE)
+        {
+            uint64_t n_ids = (std::min)(prefilter_points.size() - start, (size_t)defaults::MAX_GRAPH_DEGREE);
+            diskann::aggregate_coords(prefilter_points.data() + start, n_ids, this->data, this->_n_chunks,
+                                      pq_coord_scratch);
+            diskann::pq_dist_lookup(pq_coord_scratch, n_ids, this->_n_chunks, pq_dists, dist_scratch);
+            for (uint64_t i = 0; i < n_ids; i++)
+                retset.insert(Neighbor(prefilter_points[start + i], dist_scratch[i]));
+        }
+        if (stats != nullptr)
+        {
+            stats->n_cmps += (uint32_t)prefilter_points.size();
+            stats->pq_us += pq_timer.elapsed_us();
+        }
+
+        rerank_timer.reset();
+        std::vector<uint32_t> rerank_ids;
+        for (size_t i = 0; i < retset.size(); i++)
+        {
+            full_retset.push_back(retset[i]);
+            rerank_ids.push_back(retset[i].id);
+        }
+        retset.clear();
+
+        // full precision distances from the embedding server or the disk,
+        // deferred fetch and skip_search_reorder keep the PQ distances
+        if (recompute_beighbor_embeddings && !USE_DEFERRED_FETCH)
+        {
+            if (use_recompute_budget && rerank_ids.size() > recompute_budget)
+                rerank_ids.resize(recompute_budget);
+            std::vector<float> embeddings, points;
+            uint32_t dim;
+            if (this->fetch_node_embeddings(rerank_ids, embeddings, dim, stats))
+            {
+                Timer preprocess_timer;
+                preprocess_fetched_embeddings(embeddings, dim, metric, _max_base_norm, this->_data_dim, _aligned_dim,
+                                              points);
+                if (stats != nullptr)
+                    stats->preprocess_us += preprocess_timer.elapsed_us();
+                for (size_t i = 0; i < rerank_ids.size(); i++)
+                {
+                    memcpy(data_buf, points.data() + i * _aligned_dim, _aligned_dim * sizeof(T));
+                    full_retset[i].distance = _dist_cmp->compare(aligned_query_T, data_buf, (uint32_t)_aligned_dim);
+                }
+                // the points past the budget only have PQ distances, which do
+                // not sort against full precision ones
+                full_retset.resize(rerank_ids.size());
+            }
+            else
+            {
+                diskann::cout << "Failed to fetch embeddings from the embedding server" << std::endl;
+            }
+        }
+        else if (!skip_search_reorder && !USE_DEFERRED_FETCH && !_use_partition)
+        {
+            const size_t batch_size = defaults::MAX_N_SECTOR_READS / num_sectors_per_node;
+            for (size_t start = 0; start < full_retset.size(); start += batch_size)
+            {
+                size_t end = (std::min)(start + batch_size, full_retset.size());
+                std::vector<AlignedRead> read_reqs;
+                for (size_t i = start; i < end; i++)
+                {
+                    if (_coord_cache.find(full_retset[i].id) != _coord_cache.end())
+                        continue;
+                    char *buf = sector_scratch + (i - start) * num_sectors_per_node * defaults::SECTOR_LEN;
+                    read_reqs.emplace_back(get_node_sector(full_retset[i].id) * defaults::SECTOR_LEN,
+                                           num_sectors_per_node * defaults::SECTOR_LEN, buf);
+                }
+                io_timer.reset();
+                reader->read(read_reqs, ctx);
+                if (stats != nullptr)
+                {
+                    stats->n_4k += (uint32_t)read_reqs.size();
+                    stats->n_ios += (uint32_t)read_reqs.size();
+                    stats->io_us += (float)io_timer.elapsed();
+                }
+
+                for (size_t i = start; i < end; i++)
+                {
+                    uint32_t id = full_retset[i].id;
+                    auto cache_iter = _coord_cache.find(id);
+                    if (cache_iter != _coord_cache.end())
+                    {
+                        memcpy(data_buf, cache_iter->second, _disk_bytes_per_point);
+                    }
+                    else
+                    {
+                        char *buf = sector_scratch + (i - start) * num_sectors_per_node * defaults::SECTOR_LEN;
+                        memcpy(data_buf, offset_to_node_coords(offset_to_node(buf, id)), _disk_bytes_per_point);
+                    }
+                    if (!_use_disk_index_pq)
+                        full_retset[i].distance = _dist_cmp->compare(aligned_query_T, data_buf, (uint32_t)_aligned_dim);
+                    else if (metric == diskann::Metric::INNER_PRODUCT)
+                        full_retset[i].distance = _disk_pq_table.inner_product(query_float, (uint8_t *)data_buf);
+                    else
+                        full_retset[i].distance = _disk_pq_table.l2_distance(query_float, (uint8_t *)data_buf);
+                }
+            }
+        }
+        if (stats != nullptr)
+            stats->rerank_us += rerank_timer.elapsed_us();
+    }
+    else if (!use_filter && _nav_graph != nullptr)
+    {
+        Timer pq_timer;
+        search_navigation_graph(query_scratch, pq_dists, l_search, start_points);
+        if (stats != nullptr)
+            stats->pq_us += pq_timer.elapsed_us();
+    }
+    else if (!use_filter)
     {
         for (uint64_t cur_m = 0; cur_m < _num_medoids; cur_m++)
         {
@@ -2131,9 +2520,15 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     }
     else
     {
-        if (_filter_to_medoid_ids.find(filter_label) != _filter_to_medoid_ids.end())
+        std::vector<LabelT> filter_labels;
+        filter->get_positive_labels(filter_labels);
+        bool found_medoid = false;
+        for (const auto &filter_label : filter_labels)
         {
-            const auto &medoid_ids = _filter_to_medoid_ids[filter_label];
+            auto iter = _filter_to_medoid_ids.find(filter_label);
+            if (iter == _filter_to_medoid_ids.end())
+                continue;
+            const auto &medoid_ids = iter->second;
             for (uint64_t cur_m = 0; cur_m < medoid_ids.size(); cur_m++)
             {
                 // for filtered index, we dont store global centroid data as for unfiltered index, so we use PQ distance
@@ -2144,18 +2539,39 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                 {
                     best_medoid = medoid_ids[cur_m];
                     best_dist = cur_expanded_dist;
+                    found_medoid = true;
                 }
             }
         }
-        else
+        if (!found_medoid && filter->op() == LabelPredicate<LabelT>::Op::LABEL)
         {
             throw ANNException("Cannot find medoid for specified filter.", -1, __FUNCSIG__, __FILE__, __LINE__);
         }
+        // the start point of the unfiltered graph, it is not returned unless it
+        // matches the filter
+        for (uint64_t cur_m = 0; !found_medoid && cur_m < _num_medoids; cur_m++)
+        {
+            float cur_expanded_dist =
+                _dist_cmp_float->compare(query_float, _centroid_data + _aligned_dim * cur_m, (uint32_t)_aligned_dim);
+            if (cur_expanded_dist < best_dist)
+            {
+                best_medoid = _medoids[cur_m];
+                best_dist = cur_expanded_dist;
+            }
+        }
     }
 
-    compute_dists(&best_medoid, 1, dist_scratch);
-    retset.insert(Neighbor(best_medoid, dist_scratch[0]));
-    visited.insert(best_medoid);
+    if (!use_prefilter)
+    {
+        if (start_points.empty())
+            start_points.push_back(best_medoid);
+        compute_dists(start_points.data(), start_points.size(), dist_scratch);
+        for (size_t i = 0; i < start_points.size(); i++)
+        {
+            retset.insert(Neighbor(start_points[i], dist_scratch[i]));
+            visited.insert(start_points[i]);
+        }
+    }
 
     uint32_t cmps = 0;
     uint32_t hops = 0;
@@ -2170,6 +2586,8 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     frontier_read_reqs.reserve(2 * beam_width);
     std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t *>>> cached_nhoods;
     cached_nhoods.reserve(2 * beam_width);
+    // neighbors of the frontier node being expanded in partition mode
+    std::vector<uint32_t> partition_nbrs(_use_partition ? _max_degree : 0);
 
     float *batched_dists = nullptr;
     if (batch_recompute)
@@ -2211,7 +2629,6 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         }
 
         std::vector<AlignedRead> graph_read_reqs;
-        std::map<uint32_t, int> node_offsets; // id -> offset
         std::map<uint32_t, std::vector<uint32_t>> node_nbrs_ori;
         std::map<uint32_t, std::vector<float>> node_cords;
 
@@ -2235,20 +2652,22 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 #endif
                     frontier_read_reqs.emplace_back(get_node_sector((size_t)id) * defaults::SECTOR_LEN,
                                                     num_sectors_per_node * defaults::SECTOR_LEN, fnhood.second);
+                    if (stats != nullptr)
+                    {
+                        stats->n_4k++;
+                        stats->n_ios++;
+                    }
+                    num_ios++;
 #if 1
                 }
 #endif
-                if (stats != nullptr)
-                {
-                    stats->n_4k++;
-                    stats->n_ios++;
-                }
-                num_ios++;
             }
 
             if (_use_partition)
             {
+                // frontier nodes sharing a partition share one sector read
                 sector_scratch_idx = 0;
+                std::map<uint32_t, char *> partition_sectors;
                 for (auto &frontier_nhood : frontier_nhoods)
                 {
                     uint32_t node_id = frontier_nhood.first;
@@ -2259,28 +2678,30 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                         assert(false);
                     }
 
-                    std::vector<uint32_t> part_list = _graph_partitions[partition_id];
-                    auto it = std::find(part_list.begin(), part_list.end(), node_id);
-                    if (it == part_list.end())
+                    auto sector_iter = partition_sectors.find(partition_id);
+                    if (sector_iter != partition_sectors.end())
                     {
-                        diskann::cerr << "Error: node " << node_id << " not found in partition " << partition_id
-                                      << std::endl;
-                        assert(false);
+                        frontier_nhood.second = sector_iter->second;
+                        continue;
                     }
-                    size_t j = std::distance(part_list.begin(), it);
-                    node_offsets[node_id] = j;
 
-                    uint64_t sector_offset = (partition_id + 1) * defaults::SECTOR_LEN;
-                    // ! Keep it same with frontier_nhood.second
                     char *sector_buffer = sector_scratch + sector_scratch_idx * defaults::SECTOR_LEN;
                     sector_scratch_idx++;
+                    frontier_nhood.second = sector_buffer;
+                    partition_sectors[partition_id] = sector_buffer;
 
                     AlignedRead partition_read;
                     partition_read.len = defaults::SECTOR_LEN;
                     partition_read.buf = sector_buffer;
-                    partition_read.offset = sector_offset;
-
+                    partition_read.offset = (partition_id + 1) * defaults::SECTOR_LEN;
                     graph_read_reqs.emplace_back(partition_read);
+
+                    if (stats != nullptr)
+                    {
+                        stats->n_4k++;
+                        stats->n_ios++;
+                    }
+                    num_ios++;
                 }
             }
 
@@ -2391,8 +2812,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                     if (!use_filter && _dummy_pts.find(id) != _dummy_pts.end())
                         continue;
 
-                    if (use_filter && !(point_has_label(id, filter_label)) &&
-                        (!_use_universal_label || !point_has_label(id, _universal_filter_label)))
+                    if (use_filter && !_label_index.matches(label_filter, id))
                         continue;
                     cmps++;
                     float dist = dist_scratch[m];
@@ -2434,12 +2854,23 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             {
                 cur_expanded_dist = 0.0f;
             }
-            else if (recompute_beighbor_embeddings && dedup_node_dis && _use_partition)
+            else if (recompute_beighbor_embeddings && (dedup_node_dis || use_recompute_budget) && _use_partition)
             {
                 // For _use_partition = True, we must rely on node_distances to get the distance
                 // Since we are using graph-structure only reading.
                 // ! Use node_distances to get the distance
-                cur_expanded_dist = node_distances[node_id];
+                auto iter = node_distances.find(node_id);
+                if (iter != node_distances.end())
+                {
+                    cur_expanded_dist = iter->second;
+                }
+                else
+                {
+                    // only scored in PQ space under the recompute budget
+                    diskann::aggregate_coords(&node_id, 1, this->data, this->_n_chunks, pq_coord_scratch);
+                    diskann::pq_dist_lookup(pq_coord_scratch, 1, this->_n_chunks, pq_dists, dist_scratch);
+                    cur_expanded_dist = dist_scratch[0];
+                }
             }
             else
             {
@@ -2508,59 +2939,16 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 #endif
             if (_use_partition)
             {
-                char *sector_buffer = frontier_nhood.second;
-                int j = node_offsets[node_id];
-                uint64_t node_offset = j * _graph_node_len;
-                if (node_offset + 4 > defaults::SECTOR_LEN)
-                {
-                    diskann::cerr << "Error: node offset out of range: " << node_offset << " (+4) > "
-                                  << defaults::SECTOR_LEN << " for node " << node_id << std::endl;
-                    assert(false);
-                }
-
-                char *adjacency_ptr = sector_buffer + node_offset;
-                uint32_t neighbor_count = *reinterpret_cast<uint32_t *>(adjacency_ptr);
-
-                if (neighbor_count > 10000)
-                {
-                    diskann::cerr << "Error: suspicious neighbor count: " << neighbor_count << " for node " << node_id
-                                  << std::endl;
-                    assert(false);
-                }
-
-                size_t needed = neighbor_count * sizeof(uint32_t);
-                if (node_offset + 4 + needed > defaults::SECTOR_LEN)
+                // copied out: the sector may be shared and pruning rewrites the list
+                if (!read_partition_nbrs(frontier_nhood.second, _id2partition[node_id], node_id,
+                                         partition_nbrs.data(), nnbrs))
                 {
-                    diskann::cerr << "Error: neighbor data out of range: " << (node_offset + 4 + needed) << " > "
-                                  << defaults::SECTOR_LEN << " for node " << node_id << std::endl;
-                    assert(false);
-                }
-
-#if 0
-                if (neighbor_count != nnbrs)
-                {
-                    diskann::cout << "Warning: neighbor_count != nnbrs: " << neighbor_count << " != " << nnbrs
-                                  << std::endl;
+                    diskann::cerr << "Error: cannot read the neighbors of node " << node_id << " in partition "
+                                  << _id2partition[node_id] << std::endl;
                     assert(false);
+                    nnbrs = 0;
                 }
-#endif
-
-                nnbrs = neighbor_count;
-
-#if 0
-                uint32_t *our_node_nbrs = (uint32_t *)(adjacency_ptr + 4);
-                for (uint32_t i = 0; i < nnbrs; i++)
-                {
-                    if (our_node_nbrs[i] != node_nbrs[i])
-                    {
-                        diskann::cout << "Warning: our_node_nbrs[" << i << "] != node_nbrs[" << i
-                                      << "]: " << our_node_nbrs[i] << " != " << node_nbrs[i] << std::endl;
-                        assert(false);
-                    }
-                }
-#endif
-
-                node_nbrs = reinterpret_cast<uint32_t *>(adjacency_ptr + 4);
+                node_nbrs = partition_nbrs.data();
             }
 
             // compute node_nbrs <-> query dist in PQ space
@@ -2589,8 +2977,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                         if (!use_filter && _dummy_pts.find(id) != _dummy_pts.end())
                             continue;
 
-                        if (use_filter && !(point_has_label(id, filter_label)) &&
-                            (!_use_universal_label || !point_has_label(id, _universal_filter_label)))
+                        if (use_filter && !_label_index.matches(label_filter, id))
                             continue;
                         cmps++;
                         float dist = dist_scratch[m];
@@ -2634,8 +3021,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                     if (!use_filter && _dummy_pts.find(id) != _dummy_pts.end())
                         continue;
 
-                    if (use_filter && !(point_has_label(id, filter_label)) &&
-                        (!_use_universal_label || !point_has_label(id, _universal_filter_label)))
+                    if (use_filter && !_label_index.matches(label_filter, id))
                         continue;
                     cmps++;
                     float dist = batched_dists[m];
@@ -2655,6 +3041,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     }
 
     delete[] batched_dists;
+    rerank_timer.reset();
 
     // diskann::cout << "Graph traversal completed, hops: " << hops << std::endl;
 
@@ -2677,61 +3064,43 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         }
 
         Timer fetch_timer;
-        std::vector<std::vector<float>> real_embeddings;
-        bool success = fetch_embeddings_http(node_ids, real_embeddings, this->_zmq_port);
+        std::vector<float> fetched_embeddings, real_embeddings;
+        uint32_t fetched_dim;
+        bool success = this->fetch_node_embeddings(node_ids, fetched_embeddings, fetched_dim, stats);
         if (!success)
         {
             throw ANNException("Failed to fetch embeddings", -1, __FUNCSIG__, __FILE__, __LINE__);
         }
 
-        diskann::cout << "Fetched " << real_embeddings.size() << " embeddings in " << fetch_timer.elapsed() << " us"
+        diskann::cout << "Fetched " << node_ids.size() << " embeddings in " << fetch_timer.elapsed() << " us"
                       << std::endl;
 
         // compute real-dist
         Timer compute_timer;
-        // preprocess the real embedding to match the format of  nomarlized version of diskann
-        preprocess_fetched_embeddings(real_embeddings, metric, _max_base_norm, this->_data_dim);
+        // preprocess the real embedding to match the format of  nomarlized version of diskann, padded to
+        // _aligned_dim
+        preprocess_fetched_embeddings(fetched_embeddings, fetched_dim, metric, _max_base_norm, this->_data_dim,
+                                      _aligned_dim, real_embeddings);
+        if (stats != nullptr)
+            stats->preprocess_us += compute_timer.elapsed_us();
 
 #if 0
-        assert(real_embeddings.size() == full_retset.size());
-        assert(real_embeddings.size() == exact_dist_retset.size());
-        assert(real_embeddings.size() == exact_embeddings.size());
+        assert(node_ids.size() == exact_dist_retset.size());
+        assert(node_ids.size() == exact_embeddings.size());
 #endif
 
-        for (int i = 0; i < real_embeddings.size(); i++)
+        for (size_t i = 0; i < node_ids.size(); i++)
         {
-            // padding real_embeddings[i] to _aligned_dim
-            real_embeddings[i].resize(_aligned_dim, 0);
+            const float *real_embedding = real_embeddings.data() + i * _aligned_dim;
 #if 0
-            // compare real_embeddings[i] with exact_embeddings[i]
-            if (real_embeddings[i].size() != exact_embeddings[i].size())
+            // compare real_embedding with exact_embeddings[i]
+            for (int j = 0; j < _aligned_dim; j++)
             {
-                diskann::cout << "real_embeddings[i].size(): " << real_embeddings[i].size() << std::endl;
-                diskann::cout << "exact_embeddings[i].size(): " << exact_embeddings[i].size() << std::endl;
-
-                // dumping to files
-                std::ofstream diff_file("./diff_embeddings.txt");
-                diff_file << "real_embeddings[i].size(): " << real_embeddings[i].size() << std::endl;
-                diff_file << "exact_embeddings[i].size(): " << exact_embeddings[i].size() << std::endl;
-                for (int j = 0; j < real_embeddings[i].size(); j++)
-                {
-                    diff_file << real_embeddings[i][j] << " ";
-                }
-                diff_file << std::endl;
-                for (int j = 0; j < exact_embeddings[i].size(); j++)
-                {
-                    diff_file << exact_embeddings[i][j] << " ";
-                }
-                diff_file << std::endl;
-                assert(false);
-            }
-            for (int j = 0; j < real_embeddings[i].size(); j++)
-            {
-                if (abs(real_embeddings[i][j] - exact_embeddings[i][j]) > 5e-4)
+                if (abs(real_embedding[j] - exact_embeddings[i][j]) > 5e-4)
                 {
                     diskann::cout << "Difference found at node_id: " << full_retset[i].id << " and dimension: " << j
                                   << std::endl;
-                    diskann::cout << "real_embeddings[i][j]: " << real_embeddings[i][j] << std::endl;
+                    diskann::cout << "real_embedding[j]: " << real_embedding[j] << std::endl;
                     diskann::cout << "exact_embeddings[i][j]: " << exact_embeddings[i][j] << std::endl;
                     assert(false);
                 }
@@ -2740,7 +3109,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
             float dist;
             assert(!_use_disk_index_pq);
-            memcpy(data_buf, real_embeddings[i].data(), real_embeddings[0].size() * sizeof(T));
+            memcpy(data_buf, real_embedding, _aligned_dim * sizeof(T));
             dist = _dist_cmp->compare(aligned_query_T, data_buf, (uint32_t)_aligned_dim);
 
             full_retset[i].distance = dist;
@@ -2758,6 +3127,32 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         diskann::cout << "compute_timer.elapsed(): " << compute_timer.elapsed() << std::endl;
     }
 
+    // rerank with the exact distances computed during the search. In
+    // partition mode the expanded nodes outside the budget only have PQ
+    // distances, which do not sort against exact ones, so they are dropped
+    // unless no node got an exact distance.
+    if (use_recompute_budget && !USE_DEFERRED_FETCH)
+    {
+        bool any_exact = false;
+        for (auto &nr : full_retset)
+        {
+            auto iter = node_distances.find(nr.id);
+            if (iter != node_distances.end())
+            {
+                nr.distance = iter->second;
+                any_exact = true;
+            }
+        }
+        if (_use_partition && any_exact)
+        {
+            full_retset.erase(std::remove_if(full_retset.begin(), full_retset.end(),
+                                             [&node_distances](const Neighbor &nr) {
+                                                 return node_distances.find(nr.id) == node_distances.end();
+                                             }),
+                              full_retset.end());
+        }
+    }
+
     std::sort(full_retset.begin(), full_retset.end());
 
 // Compare PQ results with exact results when skip_search_reorder is true
@@ -2857,20 +3252,33 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
         std::sort(full_retset.begin(), full_retset.end());
     }
+    if (stats != nullptr)
+        stats->rerank_us += rerank_timer.elapsed_us();
 
-    // copy k_search values
-    for (uint64_t i = 0; i < k_search; i++)
+    // copy k_search values, skipping lazily deleted points. If fewer than
+    // k_search points remain, the rest of the output is marked invalid.
+    uint64_t num_copied = 0;
+    for (uint64_t r = 0; r < full_retset.size() && num_copied < k_search; r++)
     {
-        indices[i] = full_retset[i].id;
+        uint64_t i = num_copied;
+        indices[i] = full_retset[r].id;
         auto key = (uint32_t)indices[i];
+        if (use_filter && !_label_index.matches(label_filter, key))
+            continue;
         if (_dummy_pts.find(key) != _dummy_pts.end())
         {
             indices[i] = _dummy_to_real_map[key];
         }
+        // a reordered index returns the ids the points had before reordering
+        if (!_id_map.empty())
+            indices[i] = _id_map[indices[i]];
+        if (_num_deleted_points.load(std::memory_order_relaxed) > 0 && is_deleted((uint32_t)indices[i]))
+            continue;
+        num_copied++;
 
         if (distances != nullptr)
         {
-            distances[i] = full_retset[i].distance;
+            distances[i] = full_retset[r].distance;
             if (metric == diskann::Metric::INNER_PRODUCT)
             {
                 // flip the sign to convert min to max
@@ -2882,6 +3290,12 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             }
         }
     }
+    for (uint64_t i = num_copied; i < k_search; i++)
+    {
+        indices[i] = std::numeric_limits<uint64_t>::max();
+        if (distances != nullptr)
+            distances[i] = std::numeric_limits<float>::max();
+    }
 
 #ifdef USE_BING_INFRA
     ctx.m_completeCount = 0;
@@ -2890,16 +3304,8 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     if (stats != nullptr)
     {
         stats->total_us = (float)query_timer.elapsed();
-    }
-
-    // After search is complete, print cache hit rate statistics
-    if (recompute_beighbor_embeddings && dedup_node_dis && total_nodes_requested > 0)
-    {
-        float cache_hit_rate = static_cast<float>(total_nodes_from_cache) / total_nodes_requested * 100.0f;
-        diskann::cout << "Node distance cache statistics:" << std::endl;
-        diskann::cout << "  Total nodes requested: " << total_nodes_requested << std::endl;
-        diskann::cout << "  Nodes served from cache: " << total_nodes_from_cache << std::endl;
-        diskann::cout << "  Cache hit rate: " << cache_hit_rate << "%" << std::endl;
+        stats->n_recompute_requested += (unsigned)total_nodes_requested;
+        stats->n_recompute_cache_hits += (unsigned)total_nodes_from_cache;
     }
 }
 
@@ -2987,6 +3393,29 @@ template <typename T, typename LabelT> std::uint64_t PQFlashIndex<T, LabelT>::ge
     return _num_points;
 }
 
+template <typename T, typename LabelT> int PQFlashIndex<T, LabelT>::lazy_delete(uint32_t id)
+{
+    if (id >= _num_points)
+        return -1;
+    uint64_t mask = 1ULL << (id % 64);
+    if (_deleted_bitmap[id / 64].fetch_or(mask, std::memory_order_relaxed) & mask)
+        return -1;
+    _num_deleted_points++;
+    return 0;
+}
+
+template <typename T, typename LabelT> bool PQFlashIndex<T, LabelT>::is_deleted(uint32_t id) const
+{
+    if (id >= _num_points)
+        return false;
+    return (_deleted_bitmap[id / 64].load(std::memory_order_relaxed) >> (id % 64)) & 1;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_num_deleted_points() const
+{
+    return _num_deleted_points.load();
+}
+
 // instantiations
 template class PQFlashIndex<uint8_t>;
 template class PQFlashIndex<int8_t>;
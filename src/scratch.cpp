@@ -91,6 +91,10 @@ template <typename T> void SSDQueryScratch<T>::reset()
     visited.clear();
     retset.clear();
     full_retset.clear();
+    nav_visited.clear();
+    nav_retset.clear();
+    nav_local_ids.clear();
+    nav_ids.clear();
 }
 
 template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, size_t visited_reserve)
@@ -109,6 +113,8 @@ template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, si
 
     visited.reserve(visited_reserve);
     full_retset.reserve(visited_reserve);
+    nav_local_ids.reserve(defaults::MAX_GRAPH_DEGREE);
+    nav_ids.reserve(defaults::MAX_GRAPH_DEGREE);
 }
 
 template <typename T> SSDQueryScratch<T>::~SSDQueryScratch()
@@ -0,0 +1,736 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#ifdef USE_AVX2
+#include <immintrin.h>
+#endif
+
+#include "abstract_scratch.h"
+#include "sq_data_store.h"
+
+#include "utils.h"
+
+#define SQ_DIM_PADDING 32
+#define SQ_BLOCK_NUM_POINTS 65536
+// mins, scales, and a row holding the number of bits in its first entry
+#define SQ_PARAMS_ROWS 3
+
+namespace diskann
+{
+
+template <typename data_t>
+SQDataStore<data_t>::SQDataStore(const location_t num_points, const size_t dim, const uint32_t num_bits,
+                                 std::unique_ptr<Distance<data_t>> distance_fn)
+    : AbstractDataStore<data_t>(num_points, dim), _num_bits(num_bits), _metric(distance_fn->get_metric()),
+      _distance_fn(std::move(distance_fn))
+{
+    if (_num_bits != 8 && _num_bits != 4)
+    {
+        std::stringstream ss;
+        ss << "ERROR: SQDataStore supports 8 or 4 bits per dimension, got " << _num_bits << std::endl;
+        throw diskann::ANNException(ss.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (_metric == diskann::Metric::FAST_L2)
+    {
+        _metric = diskann::Metric::L2;
+    }
+    if (_metric == diskann::Metric::COSINE && !std::is_floating_point<data_t>::value)
+    {
+        throw diskann::ANNException("ERROR: SQDataStore supports cosine distance only for float data", -1,
+                                    __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _padded_dim = ROUND_UP(dim, SQ_DIM_PADDING);
+    _code_len = _padded_dim * _num_bits / 8;
+    _mins.resize(_padded_dim, 0.0f);
+    _scales.resize(_padded_dim, 0.0f);
+
+    alloc_aligned(((void **)&_quantized_data), this->_capacity * _code_len, SQ_DIM_PADDING);
+    std::memset(_quantized_data, 0, this->_capacity * _code_len);
+}
+
+template <typename data_t> SQDataStore<data_t>::~SQDataStore()
+{
+    if (_quantized_data != nullptr)
+    {
+        aligned_free(_quantized_data);
+        _quantized_data = nullptr;
+    }
+}
+
+template <typename data_t> uint32_t SQDataStore<data_t>::get_num_bits_from_file(const std::string &filename)
+{
+    std::string params_file = filename + "_sq_params.bin";
+    if (!file_exists(filename) || !file_exists(params_file))
+    {
+        return 0;
+    }
+
+    std::unique_ptr<float[]> params;
+    size_t params_npts, params_dim;
+    diskann::load_bin<float>(params_file, params, params_npts, params_dim);
+    size_t npts, ndim;
+    diskann::get_bin_metadata(filename, npts, ndim);
+    uint32_t num_bits = params_npts == SQ_PARAMS_ROWS && params_dim == ndim
+                            ? (uint32_t)params[(SQ_PARAMS_ROWS - 1) * params_dim]
+                            : 0;
+    size_t padded_dim = ROUND_UP(ndim, SQ_DIM_PADDING);
+    if ((num_bits != 8 && num_bits != 4) ||
+        get_file_size(filename) != 2 * sizeof(uint32_t) + npts * padded_dim * num_bits / 8)
+    {
+        std::stringstream stream;
+        stream << "ERROR: " << params_file << " does not describe the scalar quantized data in " << filename
+               << ", it may be stale." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    return num_bits;
+}
+
+template <typename data_t> uint32_t SQDataStore<data_t>::get_num_bits() const
+{
+    return _num_bits;
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::code_len() const
+{
+    return _code_len;
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::get_aligned_dim() const
+{
+    return ROUND_UP(this->_dim, _distance_fn->get_required_alignment());
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::get_alignment_factor() const
+{
+    return _distance_fn->get_required_alignment();
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::load(const std::string &filename)
+{
+    std::string params_file = filename + "_sq_params.bin";
+    if (!file_exists(filename) || !file_exists(params_file))
+    {
+        std::stringstream stream;
+        stream << "ERROR: scalar quantized data file " << filename << " or " << params_file << " does not exist."
+               << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    std::unique_ptr<float[]> params;
+    size_t params_npts, params_dim;
+    diskann::load_bin<float>(params_file, params, params_npts, params_dim);
+    if (params_npts != SQ_PARAMS_ROWS || params_dim != this->_dim)
+    {
+        std::stringstream stream;
+        stream << "ERROR: " << params_file << " has shape [" << params_npts << ", " << params_dim << "], expected ["
+               << SQ_PARAMS_ROWS << ", " << this->_dim << "]." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    uint32_t file_num_bits = (uint32_t)params[(SQ_PARAMS_ROWS - 1) * params_dim];
+    if (file_num_bits != _num_bits)
+    {
+        std::stringstream stream;
+        stream << "ERROR: " << params_file << " is for " << file_num_bits << "-bit codes, expected " << _num_bits
+               << "." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    size_t file_num_points, file_dim;
+    diskann::get_bin_metadata(filename, file_num_points, file_dim);
+    size_t expected_file_size = 2 * sizeof(uint32_t) + file_num_points * _code_len;
+    if (file_dim != this->_dim || get_file_size(filename) != expected_file_size)
+    {
+        std::stringstream stream;
+        stream << "ERROR: " << filename << " is not a " << _num_bits << "-bit scalar quantized file of dimension "
+               << this->_dim << "." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    if (file_num_points > this->capacity())
+    {
+        this->resize((location_t)file_num_points);
+    }
+
+    std::fill(_mins.begin(), _mins.end(), 0.0f);
+    std::fill(_scales.begin(), _scales.end(), 0.0f);
+    std::memcpy(_mins.data(), params.get(), this->_dim * sizeof(float));
+    std::memcpy(_scales.data(), params.get() + this->_dim, this->_dim * sizeof(float));
+    _trained = true;
+
+    std::ifstream reader(filename, std::ios::binary);
+    reader.exceptions(std::ios::badbit | std::ios::failbit);
+    reader.seekg(2 * sizeof(uint32_t), reader.beg);
+    reader.read((char *)_quantized_data, file_num_points * _code_len);
+
+    diskann::cout << "Loaded " << file_num_points << " " << _num_bits << "-bit scalar quantized vectors from "
+                  << filename << std::endl;
+    return (location_t)file_num_points;
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::save(const std::string &filename, const location_t num_points)
+{
+    std::vector<float> params(SQ_PARAMS_ROWS * this->_dim, 0.0f);
+    std::memcpy(params.data(), _mins.data(), this->_dim * sizeof(float));
+    std::memcpy(params.data() + this->_dim, _scales.data(), this->_dim * sizeof(float));
+    params[(SQ_PARAMS_ROWS - 1) * this->_dim] = (float)_num_bits;
+    size_t bytes_written =
+        save_bin<float>(filename + "_sq_params.bin", params.data(), SQ_PARAMS_ROWS, this->_dim);
+
+    // truncate, the file may hold a larger index saved earlier
+    std::ofstream writer;
+    writer.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    writer.open(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+    int npts_i32 = (int)num_points, ndims_i32 = (int)this->_dim;
+    writer.write((char *)&npts_i32, sizeof(int));
+    writer.write((char *)&ndims_i32, sizeof(int));
+    writer.write((char *)_quantized_data, (size_t)num_points * _code_len);
+    writer.close();
+
+    bytes_written += 2 * sizeof(int) + (size_t)num_points * _code_len;
+    diskann::cout << "Saved " << num_points << " " << _num_bits << "-bit scalar quantized vectors to " << filename
+                  << std::endl;
+    return bytes_written;
+}
+
+template <typename data_t> void SQDataStore<data_t>::to_float(const data_t *vector, float *out) const
+{
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        out[j] = (float)vector[j];
+    }
+    if (_metric == diskann::Metric::COSINE)
+    {
+        float norm = 0.0f;
+        for (size_t j = 0; j < this->_dim; j++)
+        {
+            norm += out[j] * out[j];
+        }
+        norm = std::sqrt(norm);
+        if (norm > 0.0f)
+        {
+            for (size_t j = 0; j < this->_dim; j++)
+            {
+                out[j] /= norm;
+            }
+        }
+    }
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::update_range(const float *vector, float *mins, float *maxs) const
+{
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        mins[j] = (std::min)(mins[j], vector[j]);
+        maxs[j] = (std::max)(maxs[j], vector[j]);
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::finalize_range(const float *mins, const float *maxs)
+{
+    const float num_levels = (float)((1u << _num_bits) - 1);
+    std::fill(_mins.begin(), _mins.end(), 0.0f);
+    std::fill(_scales.begin(), _scales.end(), 0.0f);
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        if (mins[j] > maxs[j])
+        {
+            // no points were seen
+            continue;
+        }
+        _mins[j] = mins[j];
+        _scales[j] = (maxs[j] - mins[j]) / num_levels;
+    }
+    _trained = true;
+}
+
+template <typename data_t> void SQDataStore<data_t>::encode(const float *vector, uint8_t *code) const
+{
+    const float num_levels = (float)((1u << _num_bits) - 1);
+    std::memset(code, 0, _code_len);
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        float level = 0.0f;
+        if (_scales[j] > 0.0f)
+        {
+            level = std::round((vector[j] - _mins[j]) / _scales[j]);
+            level = (std::min)((std::max)(level, 0.0f), num_levels);
+        }
+        uint8_t c = (uint8_t)level;
+        if (_num_bits == 8)
+        {
+            code[j] = c;
+        }
+        else
+        {
+            code[j / 2] |= (j % 2 == 0) ? c : (uint8_t)(c << 4);
+        }
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::decode(const uint8_t *code, float *out) const
+{
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        uint8_t c = (_num_bits == 8) ? code[j] : (uint8_t)((j % 2 == 0) ? (code[j / 2] & 0x0F) : (code[j / 2] >> 4));
+        out[j] = _mins[j] + _scales[j] * (float)c;
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::populate_data(const data_t *vectors, const location_t num_pts)
+{
+    std::vector<float> mins(this->_dim, (std::numeric_limits<float>::max)());
+    std::vector<float> maxs(this->_dim, std::numeric_limits<float>::lowest());
+    std::vector<float> vec(_padded_dim, 0.0f);
+
+    for (location_t i = 0; i < num_pts; i++)
+    {
+        to_float(vectors + (size_t)i * this->_dim, vec.data());
+        update_range(vec.data(), mins.data(), maxs.data());
+    }
+    finalize_range(mins.data(), maxs.data());
+
+    std::memset(_quantized_data, 0, (size_t)num_pts * _code_len);
+    for (location_t i = 0; i < num_pts; i++)
+    {
+        to_float(vectors + (size_t)i * this->_dim, vec.data());
+        encode(vec.data(), _quantized_data + (size_t)i * _code_len);
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::populate_data(const std::string &filename, const size_t offset)
+{
+    size_t npts, ndim;
+    diskann::get_bin_metadata(filename, npts, ndim, offset);
+
+    if ((location_t)npts > this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Number of points in the file: " << filename
+           << " is greater than the capacity of data store: " << this->capacity()
+           << ". Must invoke resize before calling populate_data()" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+
+    if (ndim != this->get_dims())
+    {
+        std::stringstream ss;
+        ss << "Number of dimensions of a point in the file: " << filename
+           << " is not equal to dimensions of data store: " << this->get_dims() << "." << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+
+    // Two streaming passes over the file, the first one learns the per
+    // dimension ranges and the second one encodes. Only one block of full
+    // precision vectors is held in memory at a time.
+    std::ifstream reader;
+    reader.exceptions(std::ios::badbit | std::ios::failbit);
+    reader.open(filename, std::ios::binary);
+
+    size_t block_size = (std::min)(npts, (size_t)SQ_BLOCK_NUM_POINTS);
+    std::vector<data_t> block(block_size * ndim);
+    std::vector<float> vec(_padded_dim, 0.0f);
+    std::vector<float> mins(this->_dim, (std::numeric_limits<float>::max)());
+    std::vector<float> maxs(this->_dim, std::numeric_limits<float>::lowest());
+
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        reader.seekg(offset + 2 * sizeof(uint32_t), reader.beg);
+        for (size_t start = 0; start < npts; start += block_size)
+        {
+            size_t cur_block_size = (std::min)(block_size, npts - start);
+            reader.read((char *)block.data(), cur_block_size * ndim * sizeof(data_t));
+            for (size_t i = 0; i < cur_block_size; i++)
+            {
+                to_float(block.data() + i * ndim, vec.data());
+                if (pass == 0)
+                    update_range(vec.data(), mins.data(), maxs.data());
+                else
+                    encode(vec.data(), _quantized_data + (start + i) * _code_len);
+            }
+        }
+        if (pass == 0)
+            finalize_range(mins.data(), maxs.data());
+    }
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::extract_data_to_bin(const std::string &filename, const location_t num_points)
+{
+    std::vector<data_t> vectors((size_t)num_points * this->_dim);
+    for (location_t i = 0; i < num_points; i++)
+    {
+        get_vector(i, vectors.data() + (size_t)i * this->_dim);
+    }
+    save_bin<data_t>(filename, vectors.data(), num_points, this->_dim);
+}
+
+template <typename data_t> void SQDataStore<data_t>::get_vector(const location_t i, data_t *dest) const
+{
+    std::vector<float> vec(_padded_dim, 0.0f);
+    decode(_quantized_data + (size_t)i * _code_len, vec.data());
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        if (std::is_floating_point<data_t>::value)
+        {
+            dest[j] = (data_t)vec[j];
+        }
+        else
+        {
+            float v = std::round(vec[j]);
+            v = (std::min)((std::max)(v, (float)(std::numeric_limits<data_t>::min)()),
+                           (float)(std::numeric_limits<data_t>::max)());
+            dest[j] = (data_t)v;
+        }
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::set_vector(const location_t loc, const data_t *const vector)
+{
+    if (!_trained)
+    {
+        throw diskann::ANNException("ERROR: SQDataStore must be populated or loaded before vectors can be set", -1,
+                                    __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::vector<float> vec(_padded_dim, 0.0f);
+    to_float(vector, vec.data());
+    encode(vec.data(), _quantized_data + (size_t)loc * _code_len);
+}
+
+template <typename data_t> void SQDataStore<data_t>::prefetch_vector(const location_t loc)
+{
+    diskann::prefetch_vector((const char *)_quantized_data + (size_t)loc * _code_len, _code_len);
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::preprocess_query(const data_t *query, AbstractScratch<data_t> *query_scratch) const
+{
+    if (query_scratch != nullptr)
+    {
+        if (query != query_scratch->aligned_query_T())
+            memcpy(query_scratch->aligned_query_T(), query, sizeof(data_t) * this->get_dims());
+        query_scratch->prepared_query_bias() = prepare_raw_query(query, query_scratch->prepared_query());
+    }
+    else
+    {
+        std::stringstream ss;
+        ss << "In SQDataStore::preprocess_query: Query scratch is null";
+        diskann::cerr << ss.str() << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+}
+
+template <typename data_t> float SQDataStore<data_t>::prepare_query(const float *query, float *prepared) const
+{
+    std::memset(prepared, 0, _padded_dim * sizeof(float));
+    float bias = 0.0f;
+    if (_metric == diskann::Metric::L2)
+    {
+        // ||q - (min + s * c)||^2 = sum_j ((q_j - min_j) - s_j * c_j)^2
+        for (size_t j = 0; j < this->_dim; j++)
+        {
+            prepared[j] = query[j] - _mins[j];
+        }
+    }
+    else
+    {
+        // <q, min + s * c> = sum_j q_j * min_j + sum_j (q_j * s_j) * c_j
+        for (size_t j = 0; j < this->_dim; j++)
+        {
+            prepared[j] = query[j] * _scales[j];
+            bias += query[j] * _mins[j];
+        }
+    }
+    return bias;
+}
+
+#ifdef USE_AVX2
+static inline float sq_horizontal_sum(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    return _mm_cvtss_f32(sum);
+}
+
+// accumulates the 8 codes in the low 64 bits of `codes` against prepared[0..7]
+static inline void sq_accumulate8(__m128i codes, const float *prepared, const float *scales, bool l2, __m256 &acc)
+{
+    __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(codes));
+    __m256 q = _mm256_loadu_ps(prepared);
+    if (l2)
+    {
+        __m256 diff = _mm256_fnmadd_ps(_mm256_loadu_ps(scales), c, q);
+        acc = _mm256_fmadd_ps(diff, diff, acc);
+    }
+    else
+    {
+        acc = _mm256_fmadd_ps(q, c, acc);
+    }
+}
+#endif
+
+template <typename data_t>
+float SQDataStore<data_t>::distance_to_code(const float *prepared, float bias, const uint8_t *code) const
+{
+    const bool l2 = (_metric == diskann::Metric::L2);
+    const float *scales = _scales.data();
+    float result = 0.0f;
+#ifdef USE_AVX2
+    __m256 acc = _mm256_setzero_ps();
+    if (_num_bits == 8)
+    {
+        for (size_t j = 0; j < _padded_dim; j += 8)
+        {
+            sq_accumulate8(_mm_loadl_epi64((const __m128i *)(code + j)), prepared + j, scales + j, l2, acc);
+        }
+    }
+    else
+    {
+        const __m128i low_nibble_mask = _mm_set1_epi8(0x0F);
+        for (size_t j = 0; j < _padded_dim; j += 32)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(code + j / 2));
+            __m128i lo = _mm_and_si128(bytes, low_nibble_mask);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble_mask);
+            // interleaving restores dimension order: lo holds even dims, hi odd dims
+            __m128i first = _mm_unpacklo_epi8(lo, hi);
+            __m128i second = _mm_unpackhi_epi8(lo, hi);
+            sq_accumulate8(first, prepared + j, scales + j, l2, acc);
+            sq_accumulate8(_mm_srli_si128(first, 8), prepared + j + 8, scales + j + 8, l2, acc);
+            sq_accumulate8(second, prepared + j + 16, scales + j + 16, l2, acc);
+            sq_accumulate8(_mm_srli_si128(second, 8), prepared + j + 24, scales + j + 24, l2, acc);
+        }
+    }
+    result = sq_horizontal_sum(acc);
+#else
+    for (size_t j = 0; j < this->_dim; j++)
+    {
+        uint8_t c = (_num_bits == 8) ? code[j] : (uint8_t)((j % 2 == 0) ? (code[j / 2] & 0x0F) : (code[j / 2] >> 4));
+        if (l2)
+        {
+            float diff = prepared[j] - scales[j] * (float)c;
+            result += diff * diff;
+        }
+        else
+        {
+            result += prepared[j] * (float)c;
+        }
+    }
+#endif
+
+    if (l2)
+        return result;
+    float dot = bias + result;
+    // same conventions as DistanceInnerProduct and AVXNormalizedCosineDistanceFloat
+    return _metric == diskann::Metric::COSINE ? 1.0f - dot : -dot;
+}
+
+template <typename data_t>
+float SQDataStore<data_t>::prepare_raw_query(const data_t *query, std::vector<float> &prepared) const
+{
+    thread_local std::vector<float> query_float;
+    query_float.resize(_padded_dim);
+    prepared.resize(_padded_dim);
+    to_float(query, query_float.data());
+    return prepare_query(query_float.data(), prepared.data());
+}
+
+template <typename data_t> float SQDataStore<data_t>::get_distance(const data_t *query, const location_t loc) const
+{
+    thread_local std::vector<float> prepared;
+    float bias = prepare_raw_query(query, prepared);
+    return distance_to_code(prepared.data(), bias, _quantized_data + (size_t)loc * _code_len);
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::get_distance(const data_t *query, const location_t *locations,
+                                       const uint32_t location_count, float *distances,
+                                       AbstractScratch<data_t> *scratch_space) const
+{
+    // the query prepared by preprocess_query, or prepared here without a
+    // scratch
+    thread_local std::vector<float> local_prepared;
+    const float *prepared;
+    float bias;
+    if (scratch_space != nullptr)
+    {
+        if (scratch_space->prepared_query().size() != _padded_dim)
+        {
+            throw diskann::ANNException("ERROR: SQDataStore::preprocess_query was not called on the scratch", -1,
+                                        __FUNCSIG__, __FILE__, __LINE__);
+        }
+        prepared = scratch_space->prepared_query().data();
+        bias = scratch_space->prepared_query_bias();
+    }
+    else
+    {
+        bias = prepare_raw_query(query, local_prepared);
+        prepared = local_prepared.data();
+    }
+    for (uint32_t i = 0; i < location_count; i++)
+    {
+        if (i + 1 < location_count)
+        {
+            diskann::prefetch_vector((const char *)_quantized_data + (size_t)locations[i + 1] * _code_len, _code_len);
+        }
+        distances[i] = distance_to_code(prepared, bias, _quantized_data + (size_t)locations[i] * _code_len);
+    }
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::get_distance(const data_t *preprocessed_query, const std::vector<location_t> &ids,
+                                       std::vector<float> &distances, AbstractScratch<data_t> *scratch_space) const
+{
+    get_distance(preprocessed_query, ids.data(), (uint32_t)ids.size(), distances.data(), scratch_space);
+}
+
+template <typename data_t> float SQDataStore<data_t>::get_distance(const location_t loc1, const location_t loc2) const
+{
+    thread_local std::vector<float> decoded, prepared;
+    decoded.resize(_padded_dim);
+    prepared.resize(_padded_dim);
+    decode(_quantized_data + (size_t)loc1 * _code_len, decoded.data());
+    float bias = prepare_query(decoded.data(), prepared.data());
+    return distance_to_code(prepared.data(), bias, _quantized_data + (size_t)loc2 * _code_len);
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::reallocate(const location_t new_size, const location_t points_to_copy)
+{
+    uint8_t *new_data;
+    alloc_aligned((void **)&new_data, (size_t)new_size * _code_len, SQ_DIM_PADDING);
+    std::memset(new_data, 0, (size_t)new_size * _code_len);
+    memcpy(new_data, _quantized_data, (size_t)points_to_copy * _code_len);
+    aligned_free(_quantized_data);
+    _quantized_data = new_data;
+    this->_capacity = new_size;
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::expand(const location_t new_size)
+{
+    if (new_size == this->capacity())
+    {
+        return this->capacity();
+    }
+    else if (new_size < this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Cannot 'expand' datastore when new capacity (" << new_size << ") < existing capacity("
+           << this->capacity() << ")" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+    reallocate(new_size, this->capacity());
+    return this->_capacity;
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::shrink(const location_t new_size)
+{
+    if (new_size == this->capacity())
+    {
+        return this->capacity();
+    }
+    else if (new_size > this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Cannot 'shrink' datastore when new capacity (" << new_size << ") > existing capacity("
+           << this->capacity() << ")" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+    reallocate(new_size, new_size);
+    return this->_capacity;
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::move_vectors(const location_t old_location_start, const location_t new_location_start,
+                                       const location_t num_locations)
+{
+    if (num_locations == 0 || old_location_start == new_location_start)
+    {
+        return;
+    }
+
+    // The [start, end) interval which will contain obsolete points to be
+    // cleared, see InMemDataStore::move_vectors.
+    uint32_t mem_clear_loc_start = old_location_start;
+    uint32_t mem_clear_loc_end_limit = old_location_start + num_locations;
+
+    if (new_location_start < old_location_start)
+    {
+        if (mem_clear_loc_start < new_location_start + num_locations)
+        {
+            mem_clear_loc_start = new_location_start + num_locations;
+        }
+    }
+    else
+    {
+        if (mem_clear_loc_end_limit > new_location_start)
+        {
+            mem_clear_loc_end_limit = new_location_start;
+        }
+    }
+
+    copy_vectors(old_location_start, new_location_start, num_locations);
+    memset(_quantized_data + _code_len * mem_clear_loc_start, 0,
+           _code_len * (mem_clear_loc_end_limit - mem_clear_loc_start));
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::copy_vectors(const location_t from_loc, const location_t to_loc, const location_t num_points)
+{
+    assert(from_loc < this->_capacity);
+    assert(to_loc < this->_capacity);
+    assert(num_points < this->_capacity);
+    memmove(_quantized_data + _code_len * to_loc, _quantized_data + _code_len * from_loc, num_points * _code_len);
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::calculate_medoid() const
+{
+    std::vector<float> center(_padded_dim, 0.0f);
+    std::vector<float> vec(_padded_dim, 0.0f);
+    for (location_t i = 0; i < this->capacity(); i++)
+    {
+        decode(_quantized_data + (size_t)i * _code_len, vec.data());
+        for (size_t j = 0; j < this->_dim; j++)
+            center[j] += vec[j];
+    }
+    for (size_t j = 0; j < this->_dim; j++)
+        center[j] /= (float)this->capacity();
+
+    uint32_t min_idx = 0;
+    float min_dist = (std::numeric_limits<float>::max)();
+    for (location_t i = 0; i < this->capacity(); i++)
+    {
+        decode(_quantized_data + (size_t)i * _code_len, vec.data());
+        float dist = 0;
+        for (size_t j = 0; j < this->_dim; j++)
+            dist += (center[j] - vec[j]) * (center[j] - vec[j]);
+        if (dist < min_dist)
+        {
+            min_idx = i;
+            min_dist = dist;
+        }
+    }
+    return min_idx;
+}
+
+template <typename data_t> Distance<data_t> *SQDataStore<data_t>::get_dist_fn() const
+{
+    return this->_distance_fn.get();
+}
+
+template DISKANN_DLLEXPORT class SQDataStore<float>;
+template DISKANN_DLLEXPORT class SQDataStore<int8_t>;
+template DISKANN_DLLEXPORT class SQDataStore<uint8_t>;
+
+} // namespace diskann
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "filter_utils.h"
+#include "index.h"
+#include "utils.h"
+
+namespace
+{
+std::string write_label_files()
+{
+    const std::string prefix = "bin_labels_tests";
+    std::ofstream(prefix + "_labels.txt") << "1,2\n3\n2,3,7\n5\n";
+    std::ofstream(prefix + "_labels_to_medoids.txt") << "1,0\n2,0,2\n3, 1\n";
+    std::ofstream(prefix + "_dummy_map.txt") << "3,2\n";
+    std::ofstream(prefix + "_universal_label.txt") << "7\n";
+    return prefix;
+}
+
+void remove_label_files(const std::string &prefix)
+{
+    for (const char *suffix :
+         {"_labels.txt", "_labels_to_medoids.txt", "_dummy_map.txt", "_universal_label.txt", "_labels.bin"})
+        std::remove((prefix + suffix).c_str());
+}
+
+template <typename LabelT> void check_round_trip()
+{
+    std::string prefix = write_label_files();
+    BOOST_TEST(diskann::convert_label_files_to_bin<LabelT>(prefix));
+    BOOST_TEST(diskann::get_bin_labels_label_size(prefix + "_labels.bin") == sizeof(LabelT));
+
+    diskann::MappedBinLabels<LabelT> labels(prefix + "_labels.bin");
+    BOOST_TEST(labels.num_points == 4);
+    BOOST_TEST(labels.num_point_labels == 7);
+    std::vector<uint32_t> offsets(labels.offsets, labels.offsets + 4), counts(labels.counts, labels.counts + 4);
+    std::vector<LabelT> point_labels(labels.labels, labels.labels + 7);
+    BOOST_TEST(offsets == std::vector<uint32_t>({0, 2, 3, 6}), boost::test_tools::per_element());
+    BOOST_TEST(counts == std::vector<uint32_t>({2, 1, 3, 1}), boost::test_tools::per_element());
+    BOOST_TEST(point_labels == std::vector<LabelT>({1, 2, 3, 2, 3, 7, 5}), boost::test_tools::per_element());
+
+    // one entry per medoid, in file order
+    BOOST_TEST(labels.num_medoids == 4);
+    std::vector<LabelT> medoid_labels(labels.medoid_labels, labels.medoid_labels + 4);
+    std::vector<uint32_t> medoids(labels.medoids, labels.medoids + 4);
+    BOOST_TEST(medoid_labels == std::vector<LabelT>({1, 2, 2, 3}), boost::test_tools::per_element());
+    BOOST_TEST(medoids == std::vector<uint32_t>({0, 0, 2, 1}), boost::test_tools::per_element());
+
+    BOOST_TEST(labels.num_dummies == 1);
+    BOOST_TEST(labels.dummy_ids[0] == 3);
+    BOOST_TEST(labels.dummy_real_ids[0] == 2);
+    BOOST_TEST(labels.use_universal_label);
+    BOOST_TEST(labels.universal_label == 7);
+
+    // the label type must match the file
+    typedef typename std::conditional<sizeof(LabelT) == sizeof(uint32_t), uint16_t, uint32_t>::type OtherLabelT;
+    BOOST_CHECK_THROW(diskann::MappedBinLabels<OtherLabelT>(prefix + "_labels.bin"), diskann::ANNException);
+    remove_label_files(prefix);
+    BOOST_TEST(!diskann::convert_label_files_to_bin<LabelT>(prefix));
+}
+
+// Builds a filtered memory index over the first num_points points of data,
+// with label i % 5 for point i, and saves it at prefix.
+void build_filtered_index(const std::string &prefix, std::vector<float> &data, const uint32_t dim,
+                          const size_t num_points)
+{
+    const std::string base_file = prefix + "_base.bin";
+    diskann::save_bin<float>(base_file, data.data(), num_points, dim);
+    std::ofstream label_writer(prefix + "_build_labels.txt");
+    for (size_t i = 0; i < num_points; i++)
+        label_writer << i % 5 << "\n";
+    label_writer.close();
+
+    auto params = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(32, 16).with_filter_list_size(32).with_num_threads(1).build());
+    diskann::Index<float> index(diskann::Metric::L2, dim, num_points, params, nullptr, 0, false, false, false, false,
+                                0, false, true);
+    index.build_filtered_index(base_file.c_str(), prefix + "_build_labels.txt", num_points);
+    index.save(prefix.c_str());
+    std::remove((prefix + "_build_labels.txt").c_str());
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BinLabels_tests)
+
+BOOST_AUTO_TEST_CASE(test_round_trip_uint32)
+{
+    check_round_trip<uint32_t>();
+}
+
+BOOST_AUTO_TEST_CASE(test_round_trip_uint16)
+{
+    check_round_trip<uint16_t>();
+}
+
+BOOST_AUTO_TEST_CASE(test_index_save_rewrites_bin_labels)
+{
+    const std::string prefix = "bin_labels_tests_index";
+    const uint32_t dim = 8;
+    std::mt19937 gen(2);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+    std::vector<float> data(300 * dim);
+    for (auto &v : data)
+        v = dis(gen);
+
+    // an index given binary labels as by build_memory_index, then saved again
+    // over fewer points to the same prefix
+    build_filtered_index(prefix, data, dim, 300);
+    BOOST_TEST(diskann::convert_label_files_to_bin<uint32_t>(prefix));
+    build_filtered_index(prefix, data, dim, 200);
+    BOOST_TEST(diskann::MappedBinLabels<uint32_t>(prefix + "_labels.bin").num_points == 200u);
+    {
+        diskann::Index<float> index(diskann::Metric::L2, dim, 200, nullptr, nullptr, 0, false, false, false, false, 0,
+                                    false, true);
+        BOOST_CHECK_NO_THROW(index.load(prefix.c_str(), 1, 32));
+    }
+
+    // labels for a different number of points are rejected
+    std::ofstream(prefix + "_labels.txt", std::ios::app) << "1\n";
+    BOOST_TEST(diskann::convert_label_files_to_bin<uint32_t>(prefix));
+    {
+        diskann::Index<float> index(diskann::Metric::L2, dim, 200, nullptr, nullptr, 0, false, false, false, false, 0,
+                                    false, true);
+        BOOST_CHECK_THROW(index.load(prefix.c_str(), 1, 32), diskann::ANNException);
+    }
+
+    for (const char *suffix : {"", ".data", ".tags", ".del", "_base.bin", "_labels_to_medoids.txt", "_labels_map.txt",
+                               "_raw_labels.txt", "_universal_label.txt"})
+        std::remove((prefix + suffix).c_str());
+    remove_label_files(prefix);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
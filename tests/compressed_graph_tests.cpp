@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "compressed_graph.h"
+
+BOOST_AUTO_TEST_SUITE(CompressedGraph_tests)
+
+BOOST_AUTO_TEST_CASE(test_adjacency_round_trip)
+{
+    std::mt19937 rng(7);
+    // dense ids take the 8 byte fast path, sparse ids the varint path
+    for (uint32_t range : {64u, 4096u, 0xffffffffu})
+    {
+        std::uniform_int_distribution<uint32_t> dist(0, range - 1);
+        for (uint32_t num_nbrs : {0u, 1u, 7u, 8u, 9u, 64u})
+        {
+            std::vector<uint32_t> nbrs(num_nbrs);
+            for (auto &nbr : nbrs)
+                nbr = dist(rng);
+
+            std::vector<uint8_t> record;
+            diskann::encode_adjacency(nbrs.data(), num_nbrs, record);
+
+            std::vector<uint32_t> decoded(64);
+            uint64_t num_decoded = 0;
+            BOOST_REQUIRE(diskann::decode_adjacency(record.data(), record.size(), decoded.data(), 64, num_decoded));
+            BOOST_REQUIRE_EQUAL(num_decoded, num_nbrs);
+            decoded.resize(num_decoded);
+            std::sort(nbrs.begin(), nbrs.end());
+            BOOST_TEST(decoded == nbrs, boost::test_tools::per_element());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_malformed_records_are_rejected)
+{
+    std::vector<uint32_t> nbrs = {3, 70000, 70001, 5000000};
+    std::vector<uint8_t> record;
+    diskann::encode_adjacency(nbrs.data(), (uint32_t)nbrs.size(), record);
+
+    std::vector<uint32_t> decoded(4);
+    uint64_t num_decoded = 0;
+    // truncated record
+    BOOST_TEST(!diskann::decode_adjacency(record.data(), record.size() - 1, decoded.data(), 4, num_decoded));
+    // more neighbors than the caller has room for
+    BOOST_TEST(!diskann::decode_adjacency(record.data(), record.size(), decoded.data(), 3, num_decoded));
+    BOOST_TEST(diskann::decode_adjacency(record.data(), record.size(), decoded.data(), 4, num_decoded));
+}
+
+BOOST_AUTO_TEST_CASE(test_sector_records)
+{
+    // two records of 3 and 5 bytes after a header for 2 nodes
+    std::vector<char> sector(4096, 0);
+    uint16_t header[] = {2, 8, 11, 16};
+    std::memcpy(sector.data(), header, sizeof(header));
+
+    const uint8_t *record;
+    size_t record_len;
+    BOOST_REQUIRE(diskann::get_compressed_record(sector.data(), sector.size(), 1, record, record_len));
+    BOOST_TEST((const char *)record - sector.data() == 11);
+    BOOST_TEST(record_len == 5u);
+    BOOST_TEST(!diskann::get_compressed_record(sector.data(), sector.size(), 2, record, record_len));
+
+    BOOST_TEST(!diskann::is_compressed_graph_header(sector.data()));
+    diskann::write_compressed_graph_header(sector.data());
+    BOOST_TEST(diskann::is_compressed_graph_header(sector.data()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
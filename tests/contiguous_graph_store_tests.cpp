@@ -0,0 +1,297 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ann_exception.h"
+#include "contiguous_graph_store.h"
+#include "in_mem_graph_store.h"
+#include "index_factory.h"
+
+#include "test_utils.h"
+
+namespace
+{
+const uint32_t DIM = 32, NUM_BUILD = 2000, NUM_INSERTS = 1000, NUM_DELETES = 600, NUM_QUERIES = 50, K = 10, L = 64;
+
+typedef diskann::Index<float, uint32_t, uint32_t> TestIndex;
+
+// a dynamic index with tags and concurrent consolidation on the given graph
+// store; point i of the point set gets tag i + 1
+std::unique_ptr<TestIndex> create_dynamic_index(const diskann::GraphStoreStrategy strategy,
+                                                 const std::shared_ptr<diskann::IndexWriteParameters> &write_params)
+{
+    auto config = diskann::IndexConfigBuilder()
+                      .with_metric(diskann::Metric::L2)
+                      .with_dimension(DIM)
+                      .with_max_points(NUM_BUILD + NUM_INSERTS)
+                      .with_data_load_store_strategy(diskann::DataStoreStrategy::MEMORY)
+                      .with_graph_load_store_strategy(strategy)
+                      .with_data_type("float")
+                      .with_tag_type("uint32")
+                      .with_label_type("uint32")
+                      .is_dynamic_index(true)
+                      .is_enable_tags(true)
+                      .is_concurrent_consolidate(true)
+                      .with_index_write_params(write_params)
+                      .with_index_search_params(std::make_shared<diskann::IndexSearchParams>(L, 4))
+                      .build();
+    auto index = diskann::IndexFactory(config).create_instance();
+    return std::unique_ptr<TestIndex>(dynamic_cast<TestIndex *>(index.release()));
+}
+
+// the tags returned for the queries, which are the first NUM_QUERIES points
+std::vector<uint32_t> search_tags(TestIndex &index, const test_utils::PointSet &points)
+{
+    std::vector<uint32_t> tags(NUM_QUERIES * K);
+    std::vector<float> dists(K);
+    std::vector<float *> res_vectors;
+    for (uint32_t q = 0; q < NUM_QUERIES; q++)
+        index.search_with_tags(points.point(q), K, L, tags.data() + q * K, dists.data(), res_vectors);
+    return tags;
+}
+
+// recall@K of the tags of search_tags among the first num_points points,
+// leaving out the points before first_live
+double recall(const std::vector<uint32_t> &tags, const test_utils::PointSet &points, const uint32_t first_live,
+              const uint32_t num_points)
+{
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = first_live; i < num_points; i++)
+        candidates.push_back(i);
+    size_t hits = 0;
+    for (uint32_t q = 0; q < NUM_QUERIES; q++)
+    {
+        std::vector<uint32_t> truth_tags;
+        for (uint32_t id : points.exact_knn(points.point(q), K, candidates))
+            truth_tags.push_back(id + 1);
+        hits += test_utils::count_hits(truth_tags, tags.data() + q * K, K);
+    }
+    return (double)hits / (NUM_QUERIES * K);
+}
+
+// Builds by single threaded inserts, inserts into while searching, deletes
+// from, consolidates, saves and loads a dynamic index on the given graph
+// store. Returns the results of the single threaded build and of the loaded
+// index.
+void exercise_dynamic_index(const diskann::GraphStoreStrategy strategy, const test_utils::PointSet &points,
+                            const std::string &prefix, std::vector<uint32_t> &built, std::vector<uint32_t> &loaded)
+{
+    auto single_thread = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(L, 24).with_alpha(1.2f).with_num_threads(1).build());
+    auto index = create_dynamic_index(strategy, single_thread);
+    index->set_start_points_at_random(1.0f, 5);
+    for (uint32_t i = 0; i < NUM_BUILD; i++)
+        BOOST_REQUIRE(index->insert_point(points.point(i), i + 1) == 0);
+    built = search_tags(*index, points);
+    BOOST_TEST(recall(built, points, 0, NUM_BUILD) >= 0.95);
+
+    // inserts on four threads while two threads search; searches must only
+    // return points that are already inserted
+    std::atomic<uint32_t> num_inserted(NUM_BUILD), num_failed_inserts(0), num_bad_results(0);
+    std::atomic<bool> inserting(true);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (uint32_t i = NUM_BUILD + t; i < NUM_BUILD + NUM_INSERTS; i += 4)
+            {
+                if (index->insert_point(points.point(i), i + 1) != 0)
+                    num_failed_inserts++;
+                num_inserted++;
+            }
+        });
+    }
+    for (uint32_t t = 0; t < 2; t++)
+    {
+        threads.emplace_back([&, t]() {
+            std::vector<uint32_t> result(K);
+            std::vector<float> dists(K);
+            std::vector<float *> res_vectors;
+            for (uint32_t q = t; inserting; q = (q + 2) % NUM_QUERIES)
+            {
+                const size_t num_results =
+                    index->search_with_tags(points.point(q), K, L, result.data(), dists.data(), res_vectors);
+                for (size_t j = 0; j < num_results; j++)
+                    if (result[j] == 0 || result[j] > NUM_BUILD + NUM_INSERTS)
+                        num_bad_results++;
+            }
+        });
+    }
+    for (uint32_t t = 0; t < 4; t++)
+        threads[t].join();
+    inserting = false;
+    for (uint32_t t = 4; t < threads.size(); t++)
+        threads[t].join();
+    BOOST_TEST(num_failed_inserts.load() == 0u);
+    BOOST_TEST(num_bad_results.load() == 0u);
+    BOOST_TEST(recall(search_tags(*index, points), points, 0, NUM_BUILD + NUM_INSERTS) >= 0.9);
+
+    // deletes the first NUM_DELETES points, which hold the queries, and repairs
+    // the graph on four threads
+    std::vector<uint32_t> deleted, failed_tags;
+    for (uint32_t i = 0; i < NUM_DELETES; i++)
+        deleted.push_back(i + 1);
+    index->lazy_delete(deleted, failed_tags);
+    BOOST_TEST(failed_tags.empty());
+    auto four_threads = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(L, 24).with_alpha(1.2f).with_num_threads(4).build());
+    auto report = index->consolidate_deletes(*four_threads);
+    BOOST_TEST(report._status == diskann::consolidation_report::status_code::SUCCESS);
+    BOOST_TEST(report._active_points == NUM_BUILD + NUM_INSERTS - NUM_DELETES);
+    std::vector<uint32_t> consolidated = search_tags(*index, points);
+    BOOST_TEST(recall(consolidated, points, NUM_DELETES, NUM_BUILD + NUM_INSERTS) >= 0.9);
+
+    index->save(prefix.c_str(), true);
+    index.reset();
+    auto reloaded = create_dynamic_index(strategy, single_thread);
+    reloaded->load(prefix.c_str(), 4, L);
+    BOOST_TEST(reloaded->get_num_points() == NUM_BUILD + NUM_INSERTS - NUM_DELETES);
+    loaded = search_tags(*reloaded, points);
+    BOOST_TEST(loaded == consolidated, boost::test_tools::per_element());
+
+    for (const std::string suffix : {"", ".data", ".tags", ".del"})
+        std::remove((prefix + suffix).c_str());
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ContiguousGraphStore_tests)
+
+BOOST_AUTO_TEST_CASE(test_neighbour_updates)
+{
+    diskann::ContiguousGraphStore store(4, 3);
+    BOOST_TEST(store.get_slots_per_node() == 3);
+    BOOST_TEST(store.get_neighbours(0).empty());
+
+    std::vector<uint32_t> nbrs = {1, 2};
+    store.set_neighbours(0, nbrs);
+    store.add_neighbour(0, 3);
+    std::vector<uint32_t> got(store.get_neighbours(0).begin(), store.get_neighbours(0).end());
+    std::vector<uint32_t> expected = {1, 2, 3};
+    BOOST_TEST(got == expected, boost::test_tools::per_element());
+    BOOST_TEST(store.get_max_observed_degree() == 3);
+    BOOST_CHECK_THROW(store.add_neighbour(0, 1), diskann::ANNException);
+
+    store.swap_neighbours(0, 1);
+    BOOST_TEST(store.get_neighbours(0).empty());
+    store.get_neighbours_snapshot(1, got);
+    BOOST_TEST(got == expected, boost::test_tools::per_element());
+
+    // growing the graph keeps the existing lists
+    store.resize_graph(100);
+    BOOST_TEST(store.get_total_points() == 100);
+    store.get_neighbours_snapshot(1, got);
+    BOOST_TEST(got == expected, boost::test_tools::per_element());
+    BOOST_TEST(store.get_neighbours(99).empty());
+
+    store.clear_neighbours(1);
+    BOOST_TEST(store.get_neighbours(1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_store_load_matches_in_mem_graph_store)
+{
+    const size_t num_points = 50;
+    diskann::InMemGraphStore in_mem(num_points, 8);
+    diskann::ContiguousGraphStore contiguous(num_points, 8);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        std::vector<uint32_t> nbrs;
+        for (uint32_t j = 1; j <= 1 + i % 8; j++)
+            nbrs.push_back((i + j * 7) % num_points);
+        in_mem.set_neighbours(i, nbrs);
+        contiguous.set_neighbours(i, nbrs);
+    }
+
+    const std::string in_mem_file = "contiguous_graph_store_test_in_mem";
+    const std::string contiguous_file = "contiguous_graph_store_test_contiguous";
+    in_mem.store(in_mem_file, num_points, 0, 5);
+    contiguous.store(contiguous_file, num_points, 0, 5);
+
+    // loading a graph with larger lists than the reserved slots grows the rows
+    diskann::ContiguousGraphStore loaded(num_points, 2);
+    auto res = loaded.load(in_mem_file, num_points);
+    BOOST_TEST(std::get<0>(res) == num_points);
+    BOOST_TEST(std::get<1>(res) == 5);
+    BOOST_TEST(loaded.get_slots_per_node() >= 8);
+    BOOST_TEST(loaded.get_max_range_of_graph() == 8);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        auto expected = in_mem.get_neighbours(i);
+        auto got = loaded.get_neighbours(i);
+        BOOST_TEST(std::vector<uint32_t>(got.begin(), got.end()) ==
+                       std::vector<uint32_t>(expected.begin(), expected.end()),
+                   boost::test_tools::per_element());
+    }
+
+    diskann::InMemGraphStore reloaded(num_points, 8);
+    reloaded.load(contiguous_file, num_points);
+    for (uint32_t i = 0; i < num_points; i++)
+        BOOST_TEST(reloaded.get_neighbours(i).size() == in_mem.get_neighbours(i).size());
+
+    std::remove(in_mem_file.c_str());
+    std::remove(contiguous_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_snapshots_during_writes)
+{
+    // the writer switches node 0 between two lists, a snapshot must always be
+    // one of them
+    diskann::ContiguousGraphStore store(1, 16);
+    std::vector<uint32_t> a(16, 1), b(4, 2);
+    store.set_neighbours(0, a);
+
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        for (uint32_t iter = 0; !stop; iter++)
+            store.set_neighbours(0, iter % 2 ? a : b);
+    });
+
+    bool consistent = true;
+    std::vector<uint32_t> snapshot;
+    for (uint32_t iter = 0; iter < 100000; iter++)
+    {
+        store.get_neighbours_snapshot(0, snapshot);
+        consistent = consistent && (snapshot == a || snapshot == b);
+    }
+    stop = true;
+    writer.join();
+    BOOST_TEST(consistent);
+}
+
+BOOST_AUTO_TEST_CASE(test_dynamic_index_matches_in_mem_graph_store)
+{
+    test_utils::PointSet points(NUM_BUILD + NUM_INSERTS, DIM);
+    points.fill_random(31);
+
+    std::vector<uint32_t> memory_built, memory_loaded, contiguous_built, contiguous_loaded;
+    BOOST_TEST_CONTEXT("memory graph store")
+    {
+        exercise_dynamic_index(diskann::GraphStoreStrategy::MEMORY, points, "contiguous_graph_store_test_memory",
+                               memory_built, memory_loaded);
+    }
+    BOOST_TEST_CONTEXT("contiguous graph store")
+    {
+        exercise_dynamic_index(diskann::GraphStoreStrategy::CONTIGUOUS, points,
+                               "contiguous_graph_store_test_contiguous_index", contiguous_built, contiguous_loaded);
+    }
+
+    // the single threaded inserts make the same graph on both stores; after
+    // the concurrent inserts both find nearly the same neighbors
+    BOOST_TEST(contiguous_built == memory_built, boost::test_tools::per_element());
+    size_t num_shared = 0;
+    for (uint32_t q = 0; q < NUM_QUERIES; q++)
+        num_shared += test_utils::count_hits(
+            std::vector<uint32_t>(memory_loaded.begin() + q * K, memory_loaded.begin() + (q + 1) * K),
+            contiguous_loaded.data() + q * K, K);
+    BOOST_TEST((double)num_shared / (NUM_QUERIES * K) >= 0.9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
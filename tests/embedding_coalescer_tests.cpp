@@ -0,0 +1,177 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "embedding_coalescer.h"
+
+BOOST_AUTO_TEST_SUITE(EmbeddingCoalescer_tests)
+
+BOOST_AUTO_TEST_CASE(test_concurrent_requests_share_batches)
+{
+    const uint32_t num_threads = 8, num_rounds = 50;
+    std::atomic<uint64_t> server_ids(0);
+    // the embedding of id is {id, -id}
+    diskann::EmbeddingCoalescer coalescer(
+        [&](const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim) {
+            server_ids += node_ids.size();
+            dim = 2;
+            embeddings.resize(node_ids.size() * 2);
+            for (size_t i = 0; i < node_ids.size(); i++)
+            {
+                embeddings[2 * i] = (float)node_ids[i];
+                embeddings[2 * i + 1] = -(float)node_ids[i];
+            }
+            return true;
+        },
+        2000, 64);
+
+    std::atomic<uint32_t> num_failures(0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (uint32_t round = 0; round < num_rounds; round++)
+            {
+                // ids overlap across threads and repeat within a request
+                std::vector<uint32_t> ids = {round, round + 1, t * 1000 + round, round};
+                std::vector<float> embeddings;
+                uint32_t dim = 0;
+                if (!coalescer.fetch(ids, embeddings, dim) || dim != 2 || embeddings.size() != ids.size() * 2)
+                {
+                    num_failures++;
+                    continue;
+                }
+                for (size_t i = 0; i < ids.size(); i++)
+                    if (embeddings[2 * i] != (float)ids[i] || embeddings[2 * i + 1] != -(float)ids[i])
+                        num_failures++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    BOOST_TEST(num_failures.load() == 0u);
+    BOOST_TEST(coalescer.get_num_requests() == (uint64_t)num_threads * num_rounds);
+    BOOST_TEST(coalescer.get_num_fetched_ids() == server_ids.load());
+    BOOST_TEST(coalescer.get_num_batches() <= coalescer.get_num_requests());
+}
+
+BOOST_AUTO_TEST_CASE(test_overlapping_ids_are_fetched_once)
+{
+    const uint32_t num_threads = 8, num_rounds = 5;
+    std::mutex counts_mutex;
+    std::map<uint32_t, uint32_t> server_counts;
+    diskann::EmbeddingCoalescer coalescer(
+        [&](const std::vector<uint32_t> &node_ids, std::vector<float> &embeddings, uint32_t &dim) {
+            {
+                std::lock_guard<std::mutex> guard(counts_mutex);
+                for (auto id : node_ids)
+                    server_counts[id]++;
+            }
+            dim = 1;
+            embeddings.assign(node_ids.begin(), node_ids.end());
+            return true;
+        },
+        200000, 1024);
+
+    // in each round all threads are released together, well within the
+    // window, and request the ids of the round shared by all of them, the ids
+    // shared with their neighbor thread and one id of their own
+    std::atomic<uint32_t> arrived(0);
+    std::atomic<uint32_t> num_failures(0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (uint32_t round = 0; round < num_rounds; round++)
+            {
+                arrived++;
+                while (arrived.load() < (round + 1) * num_threads)
+                    std::this_thread::yield();
+
+                const uint32_t base = round * 1000;
+                std::vector<uint32_t> ids = {base, base + 1, base + 2, base + 100 + t,
+                                             base + 100 + (t + 1) % num_threads, base + 500 + t};
+                std::vector<float> embeddings;
+                uint32_t dim = 0;
+                if (!coalescer.fetch(ids, embeddings, dim) || embeddings.size() != ids.size())
+                {
+                    num_failures++;
+                    continue;
+                }
+                for (size_t i = 0; i < ids.size(); i++)
+                    if (embeddings[i] != (float)ids[i])
+                        num_failures++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    BOOST_TEST(num_failures.load() == 0u);
+
+    // one batch per round, in which every id requested reached the server once
+    BOOST_TEST(coalescer.get_num_batches() == (uint64_t)num_rounds);
+    BOOST_TEST(server_counts.size() == (size_t)num_rounds * (3 + 2 * num_threads));
+    bool fetched_once = true;
+    for (const auto &count : server_counts)
+        fetched_once = fetched_once && count.second == 1;
+    BOOST_TEST(fetched_once);
+}
+
+BOOST_AUTO_TEST_CASE(test_failed_batch_fails_all_requests)
+{
+    diskann::EmbeddingCoalescer coalescer(
+        [](const std::vector<uint32_t> &, std::vector<float> &, uint32_t &) { return false; }, 1000, 16);
+    std::vector<float> embeddings;
+    uint32_t dim = 0;
+    BOOST_TEST(!coalescer.fetch({1, 2, 3}, embeddings, dim));
+}
+
+BOOST_AUTO_TEST_CASE(test_throwing_fetch_releases_the_batch)
+{
+    const uint32_t num_threads = 8;
+    diskann::EmbeddingCoalescer coalescer(
+        [](const std::vector<uint32_t> &, std::vector<float> &, uint32_t &) -> bool {
+            throw std::runtime_error("embedding callback failed");
+        },
+        200000, 1024);
+
+    // all threads join the batch of the first one, whose fetch throws
+    std::atomic<uint32_t> arrived(0), num_thrown(0), num_failed(0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            arrived++;
+            while (arrived.load() < num_threads)
+                std::this_thread::yield();
+            std::vector<float> embeddings;
+            uint32_t dim = 0;
+            try
+            {
+                if (!coalescer.fetch({t, t + 1}, embeddings, dim))
+                    num_failed++;
+            }
+            catch (const std::runtime_error &)
+            {
+                num_thrown++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    // the leader gets the exception, the members of its batch get false
+    BOOST_TEST(num_thrown.load() == 1u);
+    BOOST_TEST(num_failed.load() == num_threads - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,245 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "embedding_provider.h"
+#include "graph_reorder.h"
+#include "pq_flash_index.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace
+{
+const uint32_t DIM = 32, NUM_POINTS = 2000, K = 10, L = 64;
+
+// A disk index over random points with PQ codes much smaller than the
+// vectors, so that recompute search differs from a PQ only search.
+struct RecomputeIndexData : test_utils::RandomDiskIndex
+{
+    RecomputeIndexData() : RandomDiskIndex("diskann_embedding_provider_test", NUM_POINTS, DIM, 3)
+    {
+        build();
+    }
+};
+
+// Writes the graph of the disk index at prefix as uncompressed partition
+// files, a sector of consecutive nodes per partition.
+void write_partition_files(const std::string &prefix)
+{
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t medoid;
+    diskann::load_disk_index_graph<float>(prefix + "_disk.index", graph, medoid);
+    std::vector<char> sector0(diskann::defaults::SECTOR_LEN);
+    std::ifstream(prefix + "_disk.index", std::ios::binary).read(sector0.data(), sector0.size());
+    const uint64_t *meta = (const uint64_t *)(sector0.data() + 8);
+    const uint64_t graph_node_len = meta[3] - meta[1] * sizeof(float);
+    const uint64_t C = diskann::defaults::SECTOR_LEN / graph_node_len, nd = graph.size();
+    const uint64_t num_partitions = DIV_ROUND_UP(nd, C);
+
+    std::ofstream partition_out(prefix + "_partition.bin", std::ios::binary);
+    partition_out.write((char *)&C, sizeof(uint64_t));
+    partition_out.write((char *)&num_partitions, sizeof(uint64_t));
+    partition_out.write((char *)&nd, sizeof(uint64_t));
+    std::vector<uint32_t> id2partition(nd);
+    for (uint64_t p = 0; p < num_partitions; p++)
+    {
+        uint32_t psize = (uint32_t)(std::min)(C, nd - p * C);
+        partition_out.write((char *)&psize, sizeof(uint32_t));
+        for (uint32_t j = 0; j < psize; j++)
+        {
+            uint32_t id = (uint32_t)(p * C + j);
+            partition_out.write((char *)&id, sizeof(uint32_t));
+            id2partition[id] = (uint32_t)p;
+        }
+    }
+    partition_out.write((char *)id2partition.data(), nd * sizeof(uint32_t));
+
+    std::ofstream graph_out(prefix + "_disk_graph.index", std::ios::binary);
+    graph_out.write(sector0.data(), sector0.size());
+    for (uint64_t p = 0; p < num_partitions; p++)
+    {
+        std::vector<char> sector(diskann::defaults::SECTOR_LEN, 0);
+        for (uint64_t id = p * C; id < (std::min)((p + 1) * C, nd); id++)
+        {
+            uint32_t *node = (uint32_t *)(sector.data() + (id - p * C) * graph_node_len);
+            node[0] = (uint32_t)graph[id].size();
+            std::copy(graph[id].begin(), graph[id].end(), node + 1);
+        }
+        graph_out.write(sector.data(), sector.size());
+    }
+}
+
+std::vector<float> make_query(const RecomputeIndexData &index_data, const uint32_t q)
+{
+    std::mt19937 gen(q);
+    std::normal_distribution<float> dis(0.0f, 0.3f);
+    std::vector<float> query(index_data.point(q * 13), index_data.point(q * 13) + DIM);
+    for (auto &v : query)
+        v += dis(gen);
+    return query;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(EmbeddingProvider_tests)
+
+BOOST_AUTO_TEST_CASE(test_callback_provider)
+{
+    // the embedding of id is {id, 2 * id, 3 * id}; node 13 fails
+    diskann::CallbackEmbeddingProvider provider(3, [](const uint32_t *node_ids, size_t num_ids, float *embeddings) {
+        for (size_t i = 0; i < num_ids; i++)
+        {
+            if (node_ids[i] == 13)
+                return false;
+            for (uint32_t j = 0; j < 3; j++)
+                embeddings[i * 3 + j] = (float)(node_ids[i] * (j + 1));
+        }
+        return true;
+    });
+
+    std::vector<float> embeddings;
+    uint32_t dim = 0;
+    BOOST_TEST(provider.get_embeddings({4, 0, 7}, embeddings, dim));
+    BOOST_TEST(dim == 3u);
+    std::vector<float> expected = {4, 8, 12, 0, 0, 0, 7, 14, 21};
+    BOOST_TEST(embeddings == expected);
+
+    BOOST_TEST(!provider.get_embeddings({1, 13}, embeddings, dim));
+}
+
+BOOST_AUTO_TEST_CASE(test_bin_file_provider)
+{
+    const std::string file = (std::filesystem::temp_directory_path() / "diskann_embedding_provider_test.bin").string();
+    std::vector<float> data(5 * 4);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (float)i;
+    diskann::save_bin<float>(file, data.data(), 5, 4);
+
+    diskann::BinFileEmbeddingProvider provider(file);
+    std::vector<float> embeddings;
+    uint32_t dim = 0;
+    BOOST_TEST(provider.get_embeddings({3, 0, 3}, embeddings, dim));
+    BOOST_TEST(dim == 4u);
+    std::vector<float> expected = {12, 13, 14, 15, 0, 1, 2, 3, 12, 13, 14, 15};
+    BOOST_TEST(embeddings == expected);
+
+    // a node past the end of the file fails
+    BOOST_TEST(!provider.get_embeddings({1, 5}, embeddings, dim));
+    std::filesystem::remove(file);
+}
+
+#ifndef _WINDOWS
+BOOST_AUTO_TEST_CASE(test_recompute_search_with_providers)
+{
+    RecomputeIndexData index_data;
+    std::shared_ptr<AlignedFileReader> reader(new LinuxAlignedFileReader());
+    std::shared_ptr<AlignedFileReader> graph_reader(new LinuxAlignedFileReader());
+    diskann::PQFlashIndex<float> index(reader, graph_reader, diskann::Metric::L2);
+    BOOST_TEST(index.load(1, index_data.prefix.c_str(), 0, nullptr, "") == 0);
+
+    // the same search with embeddings from the base file and from a callback
+    // over the base data, with and without a recompute budget
+    auto search = [&](const float *query, const uint32_t recompute_budget, std::vector<uint64_t> &ids,
+                      std::vector<float> &dists, diskann::QueryStats &stats) {
+        ids.assign(K, 0);
+        dists.assign(K, 0);
+        index.cached_beam_search(query, K, L, ids.data(), dists.data(), 4, false, &stats, false, false, true, false, 0,
+                                 false, false, recompute_budget);
+    };
+    auto from_file = std::make_shared<diskann::BinFileEmbeddingProvider>(index_data.dir + "/base.bin");
+    auto from_callback = std::make_shared<diskann::CallbackEmbeddingProvider>(
+        DIM, [&](const uint32_t *node_ids, size_t num_ids, float *embeddings) {
+            for (size_t i = 0; i < num_ids; i++)
+                std::copy(index_data.point(node_ids[i]), index_data.point(node_ids[i]) + DIM, embeddings + i * DIM);
+            return true;
+        });
+
+    const uint32_t num_queries = 50;
+    for (const uint32_t recompute_budget : {0u, 48u})
+    {
+        size_t hits = 0;
+        bool same_results = true, exact_distances = true, recomputed = true;
+        for (uint32_t q = 0; q < num_queries; q++)
+        {
+            std::vector<float> query = make_query(index_data, q);
+            std::vector<uint64_t> file_ids, callback_ids;
+            std::vector<float> file_dists, callback_dists;
+            diskann::QueryStats file_stats, callback_stats;
+            index.set_embedding_provider(from_file);
+            search(query.data(), recompute_budget, file_ids, file_dists, file_stats);
+            index.set_embedding_provider(from_callback);
+            search(query.data(), recompute_budget, callback_ids, callback_dists, callback_stats);
+
+            same_results = same_results && file_ids == callback_ids && file_dists == callback_dists;
+            recomputed = recomputed && file_stats.n_recomputed > 0;
+            if (recompute_budget > 0)
+                recomputed = recomputed && file_stats.n_recomputed <= recompute_budget;
+
+            // the results carry the full precision distances
+            for (uint32_t k = 0; k < K; k++)
+            {
+                float exact = index_data.distance((uint32_t)file_ids[k], query.data());
+                exact_distances = exact_distances && std::abs(file_dists[k] - exact) <= 1e-3f * (1 + exact);
+            }
+
+            hits += test_utils::count_hits(index_data.exact_knn(query.data(), K), file_ids.data(), file_ids.size());
+        }
+        double recall = (double)hits / (num_queries * K);
+        BOOST_TEST_MESSAGE("recompute budget " << recompute_budget << ": recall@" << K << " " << recall);
+        BOOST_TEST(same_results);
+        BOOST_TEST(recomputed);
+        BOOST_TEST(recall >= 0.8);
+        if (recompute_budget == 0)
+            BOOST_TEST(exact_distances);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_budgeted_partition_search_ranks_exact_distances)
+{
+    RecomputeIndexData index_data;
+    write_partition_files(index_data.prefix);
+    std::shared_ptr<AlignedFileReader> reader(new LinuxAlignedFileReader());
+    std::shared_ptr<AlignedFileReader> graph_reader(new LinuxAlignedFileReader());
+    diskann::PQFlashIndex<float> index(reader, graph_reader, diskann::Metric::L2);
+    const std::string &prefix = index_data.prefix;
+    BOOST_TEST(index.load(1, prefix.c_str(), 0, nullptr, prefix.c_str()) == 0);
+    index.set_embedding_provider(std::make_shared<diskann::BinFileEmbeddingProvider>(index_data.dir + "/base.bin"));
+
+    // a budget far below what the search would recompute, so that many
+    // expanded nodes only have PQ distances; none of them may be returned
+    bool exact_distances = true;
+    size_t num_results = 0;
+    for (uint32_t q = 0; q < 50; q++)
+    {
+        std::vector<float> query = make_query(index_data, q);
+        std::vector<uint64_t> ids(K);
+        std::vector<float> dists(K);
+        diskann::QueryStats stats;
+        index.cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4, false, &stats, false, false, true,
+                                 false, 0, false, false, 16);
+        for (uint32_t k = 0; k < K && ids[k] < NUM_POINTS; k++)
+        {
+            float exact = index_data.distance((uint32_t)ids[k], query.data());
+            exact_distances = exact_distances && std::abs(dists[k] - exact) <= 1e-3f * (1 + exact);
+            num_results++;
+        }
+    }
+    BOOST_TEST(exact_distances);
+    BOOST_TEST(num_results > 0u);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,224 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef _WINDOWS
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "embedding_shm_channel.h"
+
+namespace
+{
+// A client that takes a ticket on the channel by hand and stops at some step
+// of the sequence protocol, as a client process that crashed.
+struct CrashingClient
+{
+    char *base = nullptr;
+    size_t size = 0;
+
+    CrashingClient(const std::string &name)
+    {
+        int fd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+        size = (size_t)lseek(fd, 0, SEEK_END);
+        base = (char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    ~CrashingClient()
+    {
+        munmap(base, size);
+    }
+
+    std::atomic<uint64_t> &sequence_of(uint64_t ticket)
+    {
+        uint32_t num_slots = *(uint32_t *)(base + 20);
+        uint64_t slot_size = *(uint64_t *)(base + 24);
+        return *(std::atomic<uint64_t> *)(base + 128 + (ticket % num_slots) * slot_size);
+    }
+
+    // crashes right after taking a ticket
+    void take_ticket()
+    {
+        ((std::atomic<uint64_t> *)(base + 64))->fetch_add(1);
+    }
+
+    // crashes after publishing a request, without reading the response
+    void send_request(uint32_t id)
+    {
+        uint64_t ticket = ((std::atomic<uint64_t> *)(base + 64))->fetch_add(1);
+        std::atomic<uint64_t> &sequence = sequence_of(ticket);
+        while (sequence.load() < ticket)
+            std::this_thread::yield();
+        uint64_t expected = ticket;
+        if (!sequence.compare_exchange_strong(expected, ticket + 1))
+            return;
+        char *slot = (char *)&sequence;
+        *(uint32_t *)(slot + 8) = 1;
+        *(uint32_t *)(slot + 64) = id;
+        sequence.store(ticket + 2);
+    }
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(EmbeddingShmChannel_tests)
+
+BOOST_AUTO_TEST_CASE(test_concurrent_fetches_get_their_embeddings)
+{
+    const uint32_t dim = 8, max_batch = 16, num_slots = 4;
+    const std::string name = "diskann_shm_test_" + std::to_string(getpid());
+    diskann::EmbeddingShmServer server(name, dim, max_batch, num_slots);
+
+    // embedding j of node id is id * 100 + j; node 999 fails
+    std::atomic<bool> stop(false);
+    std::thread server_thread([&]() {
+        server.serve(
+            [&](const uint32_t *ids, uint32_t num_ids, float *embeddings) {
+                for (uint32_t i = 0; i < num_ids; i++)
+                {
+                    if (ids[i] == 999)
+                        return false;
+                    for (uint32_t j = 0; j < dim; j++)
+                        embeddings[i * dim + j] = (float)(ids[i] * 100 + j);
+                }
+                return true;
+            },
+            stop);
+    });
+
+    // batches larger than max_batch from more threads than slots
+    std::atomic<uint32_t> num_failures(0);
+    std::vector<std::thread> clients;
+    for (uint32_t t = 0; t < 8; t++)
+    {
+        clients.emplace_back([&, t]() {
+            for (uint32_t round = 0; round < 20; round++)
+            {
+                std::vector<uint32_t> ids;
+                for (uint32_t i = 0; i < 3 * max_batch + t; i++)
+                    ids.push_back(t * 1000 + round * 50 + i % 50);
+                std::vector<float> embeddings;
+                uint32_t fetched_dim = 0;
+                if (!diskann::fetch_embeddings_shm(name, ids, embeddings, fetched_dim) || fetched_dim != dim ||
+                    embeddings.size() != ids.size() * dim)
+                {
+                    num_failures++;
+                    continue;
+                }
+                for (size_t i = 0; i < ids.size(); i++)
+                    for (uint32_t j = 0; j < dim; j++)
+                        if (embeddings[i * dim + j] != (float)(ids[i] * 100 + j))
+                            num_failures++;
+            }
+        });
+    }
+    for (auto &client : clients)
+        client.join();
+    BOOST_TEST(num_failures.load() == 0u);
+
+    // a server side failure is reported and does not block the channel
+    std::vector<float> embeddings;
+    uint32_t fetched_dim = 0;
+    BOOST_TEST(!diskann::fetch_embeddings_shm(name, {1, 999, 2}, embeddings, fetched_dim));
+    BOOST_TEST(diskann::fetch_embeddings_shm(name, {7}, embeddings, fetched_dim));
+    BOOST_TEST(embeddings[dim - 1] == (float)(700 + dim - 1));
+
+    stop = true;
+    server_thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(test_abandoned_requests_do_not_block_the_channel)
+{
+    const uint32_t dim = 4, max_batch = 8, num_slots = 4;
+    const std::string name = "diskann_shm_abandon_test_" + std::to_string(getpid());
+    diskann::EmbeddingShmServer server(name, dim, max_batch, num_slots, 50000);
+
+    // node 888 takes longer than the client waits for it
+    std::atomic<bool> stop(false);
+    std::thread server_thread([&]() {
+        server.serve(
+            [&](const uint32_t *ids, uint32_t num_ids, float *embeddings) {
+                for (uint32_t i = 0; i < num_ids; i++)
+                {
+                    if (ids[i] == 888)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    for (uint32_t j = 0; j < dim; j++)
+                        embeddings[i * dim + j] = (float)(ids[i] * 10 + j);
+                }
+                return true;
+            },
+            stop);
+    });
+
+    // clients keep fetching while others crash or time out
+    std::atomic<uint32_t> num_failures(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> clients;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        clients.emplace_back([&, t]() {
+            for (uint32_t round = 0; !done.load() || round < 50; round++)
+            {
+                std::vector<uint32_t> ids;
+                for (uint32_t i = 0; i < 2 * max_batch + t; i++)
+                    ids.push_back(t * 100 + i);
+                std::vector<float> embeddings;
+                uint32_t fetched_dim = 0;
+                if (!diskann::fetch_embeddings_shm(name, ids, embeddings, fetched_dim) ||
+                    embeddings.size() != ids.size() * dim)
+                {
+                    num_failures++;
+                    continue;
+                }
+                for (size_t i = 0; i < ids.size(); i++)
+                    for (uint32_t j = 0; j < dim; j++)
+                        if (embeddings[i * dim + j] != (float)(ids[i] * 10 + j))
+                            num_failures++;
+            }
+        });
+    }
+
+    // a client that times out waiting for the response gives up its slot
+    diskann::EmbeddingShmClient timing_out(name);
+    std::vector<float> embeddings;
+    BOOST_TEST(!timing_out.fetch({888}, embeddings, 50000));
+    BOOST_TEST(timing_out.is_broken());
+
+    CrashingClient crashing(name);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        crashing.take_ticket();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        crashing.send_request(5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    done = true;
+    for (auto &client : clients)
+        client.join();
+    BOOST_TEST(num_failures.load() == 0u);
+
+    uint32_t fetched_dim = 0;
+    BOOST_TEST(diskann::fetch_embeddings_shm(name, {7}, embeddings, fetched_dim));
+    BOOST_TEST(embeddings[dim - 1] == (float)(70 + dim - 1));
+
+    stop = true;
+    server_thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(test_missing_channel_fails)
+{
+    std::vector<float> embeddings;
+    uint32_t dim = 0;
+    BOOST_TEST(!diskann::fetch_embeddings_shm("diskann_shm_test_missing", {1}, embeddings, dim));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
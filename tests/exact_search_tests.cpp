@@ -0,0 +1,217 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <omp.h>
+
+#include "exact_search.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+namespace
+{
+// blocks of BLOCK_SIZE points that end in partial base tiles
+const uint32_t DIM = 24, NUM_POINTS = 5000, BLOCK_SIZE = 1500, NUM_THREADS = 4;
+
+// Random base points in a base file and random queries, searched with
+// exact_search and with a naive scan of every point.
+struct ExactSearchData : test_utils::ScratchDir
+{
+    test_utils::PointSet base{NUM_POINTS, DIM}, queries;
+    const std::string base_file;
+
+    explicit ExactSearchData(const uint32_t num_queries)
+        : ScratchDir("diskann_exact_search_test"), queries(num_queries, DIM), base_file(dir + "/base.bin")
+    {
+        base.fill_random(21);
+        queries.fill_random(22);
+        diskann::save_bin<float>(base_file, base.data.data(), NUM_POINTS, DIM);
+    }
+
+    // distance between query q and point id as exact_search defines it
+    float naive_distance(const diskann::Metric metric, const uint32_t q, const uint32_t id) const
+    {
+        const float *x = base.point(id), *y = queries.point(q);
+        double dot = 0, x_norm = 0, y_norm = 0;
+        for (uint32_t d = 0; d < DIM; d++)
+        {
+            dot += (double)x[d] * y[d];
+            x_norm += (double)x[d] * x[d];
+            y_norm += (double)y[d] * y[d];
+        }
+        if (metric == diskann::Metric::INNER_PRODUCT)
+            return (float)-dot;
+        if (metric == diskann::Metric::COSINE)
+            return (float)(2 - 2 * dot / std::sqrt(x_norm * y_norm));
+        return (float)(x_norm - 2 * dot + y_norm);
+    }
+
+    // (distance, id) of the eligible points for query q, nearest first
+    std::vector<std::pair<float, uint32_t>> naive_search(const diskann::Metric metric, const uint32_t q,
+                                                         const std::vector<uint64_t> &eligible) const
+    {
+        std::vector<std::pair<float, uint32_t>> all;
+        for (uint32_t id = 0; id < NUM_POINTS; id++)
+            if (eligible.empty() || ((eligible[id >> 6] >> (id & 63)) & 1))
+                all.emplace_back(naive_distance(metric, q, id), id);
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+
+    void search(const diskann::Metric metric, const std::vector<uint64_t> &eligible, const size_t k,
+                std::vector<uint32_t> &ids, std::vector<float> &dists, std::vector<uint32_t> &sizes,
+                const float radius = 0, std::vector<std::vector<std::pair<uint32_t, float>>> *range = nullptr) const
+    {
+        std::vector<float> query_data = queries.data, query_l2sq(queries.num_points());
+        diskann::compute_l2sq(query_l2sq.data(), query_data.data(), queries.num_points(), DIM);
+        if (metric == diskann::Metric::COSINE)
+            diskann::normalize_points(query_data.data(), query_l2sq.data(), queries.num_points(), DIM);
+
+        const int num_threads = omp_get_max_threads();
+        omp_set_num_threads(NUM_THREADS);
+        diskann::exact_search<float>(base_file, BLOCK_SIZE, DIM, queries.num_points(), query_data.data(),
+                                     query_l2sq.data(), metric, eligible, k, ids, dists, sizes, radius, range);
+        omp_set_num_threads(num_threads);
+    }
+
+    // checks that exact_search returns the k nearest eligible points of every
+    // query, in order and with their distances
+    bool matches_naive_knn(const diskann::Metric metric, const size_t k, const std::vector<uint64_t> &eligible) const
+    {
+        std::vector<uint32_t> ids, sizes;
+        std::vector<float> dists;
+        search(metric, eligible, k, ids, dists, sizes);
+        if (sizes.size() != queries.num_points() || ids.size() != queries.num_points() * k)
+            return false;
+
+        for (uint32_t q = 0; q < queries.num_points(); q++)
+        {
+            auto truth = naive_search(metric, q, eligible);
+            if (sizes[q] != (std::min)(k, truth.size()))
+                return false;
+            for (uint32_t j = 0; j < sizes[q]; j++)
+            {
+                // the same distances in the same order; the ids agree
+                // unless two points are tied within the float error
+                const float tol = 1e-3f * (1 + std::abs(truth[j].first));
+                const uint32_t id = ids[q * k + j];
+                const bool eligible_id = eligible.empty() || ((eligible[id >> 6] >> (id & 63)) & 1);
+                if (!eligible_id || std::abs(dists[q * k + j] - truth[j].first) > tol ||
+                    std::abs(naive_distance(metric, q, id) - truth[j].first) > tol)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // checks that exact_search returns the eligible points closer than radius
+    // for every query, leaving out only points within the float error of it
+    bool matches_naive_range(const diskann::Metric metric, const float radius,
+                             const std::vector<uint64_t> &eligible, size_t &num_results) const
+    {
+        std::vector<uint32_t> ids, sizes;
+        std::vector<float> dists;
+        std::vector<std::vector<std::pair<uint32_t, float>>> range;
+        search(metric, eligible, 0, ids, dists, sizes, radius, &range);
+        if (range.size() != queries.num_points())
+            return false;
+
+        num_results = 0;
+        const float tol = 1e-3f * (1 + std::abs(radius));
+        for (uint32_t q = 0; q < queries.num_points(); q++)
+        {
+            std::vector<bool> found(NUM_POINTS, false);
+            for (const auto &result : range[q])
+            {
+                if (found[result.first] || std::abs(naive_distance(metric, q, result.first) - result.second) > tol ||
+                    result.second >= radius + tol)
+                    return false;
+                found[result.first] = true;
+            }
+            for (const auto &truth : naive_search(metric, q, eligible))
+                if (truth.first < radius - tol && !found[truth.second])
+                    return false;
+            num_results += range[q].size();
+        }
+        return true;
+    }
+};
+
+std::vector<uint64_t> every_nth_point(const uint32_t n)
+{
+    std::vector<uint64_t> eligible(DIV_ROUND_UP(NUM_POINTS, 64), 0);
+    for (uint32_t id = 0; id < NUM_POINTS; id += n)
+        eligible[id >> 6] |= (uint64_t)1 << (id & 63);
+    return eligible;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ExactSearch_tests)
+
+BOOST_AUTO_TEST_CASE(test_knn_matches_brute_force)
+{
+    // fewer query tiles than threads splits the base tiles into stripes whose
+    // results are merged, more query tiles than threads uses a single stripe
+    for (uint32_t num_queries : {20u, 300u})
+    {
+        ExactSearchData data(num_queries);
+        for (auto metric : {diskann::Metric::L2, diskann::Metric::INNER_PRODUCT, diskann::Metric::COSINE})
+        {
+            BOOST_TEST_CONTEXT("queries " << num_queries << " metric " << (int)metric)
+            {
+                BOOST_TEST(data.matches_naive_knn(metric, 10, {}));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_filter_and_short_lists)
+{
+    ExactSearchData data(20);
+    for (auto metric : {diskann::Metric::L2, diskann::Metric::INNER_PRODUCT, diskann::Metric::COSINE})
+    {
+        BOOST_TEST_CONTEXT("metric " << (int)metric)
+        {
+            // only the points set in the bitset are returned
+            BOOST_TEST(data.matches_naive_knn(metric, 10, every_nth_point(3)));
+            // k larger than the number of eligible points returns all of them
+            BOOST_TEST(data.matches_naive_knn(metric, 80, every_nth_point(100)));
+        }
+    }
+
+    // a bitset shorter than the base is rejected
+    std::vector<uint32_t> ids, sizes;
+    std::vector<float> dists;
+    BOOST_CHECK_THROW(data.search(diskann::Metric::L2, std::vector<uint64_t>(2, ~(uint64_t)0), 10, ids, dists, sizes),
+                      diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_CASE(test_range_matches_brute_force)
+{
+    // radii that keep a few dozen points per query; for MIPS the radius is the
+    // negated inner product threshold
+    ExactSearchData data(20);
+    const std::vector<std::pair<diskann::Metric, float>> radii = {
+        {diskann::Metric::L2, 28.0f}, {diskann::Metric::INNER_PRODUCT, -10.0f}, {diskann::Metric::COSINE, 1.4f}};
+    for (const auto &metric_radius : radii)
+    {
+        BOOST_TEST_CONTEXT("metric " << (int)metric_radius.first)
+        {
+            size_t num_results = 0, num_filtered_results = 0;
+            BOOST_TEST(data.matches_naive_range(metric_radius.first, metric_radius.second, {}, num_results));
+            BOOST_TEST(data.matches_naive_range(metric_radius.first, metric_radius.second, every_nth_point(3),
+                                                num_filtered_results));
+            BOOST_TEST(num_results > 0u);
+            BOOST_TEST(num_filtered_results < num_results);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "disk_utils.h"
+#include "embedding_provider.h"
+#include "pq_flash_index.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace
+{
+const uint32_t DIM = 32, NUM_POINTS = 2000, RARE_EVERY = 100, K = 10, L = 32;
+
+#ifndef _WINDOWS
+// A filtered disk index in which every point has label 1 and one point in
+// RARE_EVERY also has label 2, so that label 2 matches fewer than L points
+// and is searched by scanning its points.
+struct RareLabelIndex : test_utils::RandomDiskIndex
+{
+    std::vector<uint32_t> rare_points;
+    std::shared_ptr<AlignedFileReader> reader{new LinuxAlignedFileReader()};
+    std::shared_ptr<AlignedFileReader> graph_reader{new LinuxAlignedFileReader()};
+    std::unique_ptr<diskann::PQFlashIndex<float>> index;
+    uint32_t rare_label;
+
+    RareLabelIndex() : RandomDiskIndex("diskann_filtered_disk_search_test", NUM_POINTS, DIM, 8)
+    {
+        std::ofstream labels(dir + "/labels.txt");
+        for (uint32_t i = 0; i < NUM_POINTS; i++)
+        {
+            labels << (i % RARE_EVERY == 0 ? "1,2" : "1") << std::endl;
+            if (i % RARE_EVERY == 0)
+                rare_points.push_back(i);
+        }
+        labels.close();
+        build(0, 0, dir + "/labels.txt");
+
+        index = std::make_unique<diskann::PQFlashIndex<float>>(reader, graph_reader, diskann::Metric::L2);
+        BOOST_REQUIRE(index->load(1, prefix.c_str(), 0, nullptr, "") == 0);
+        rare_label = index->get_converted_label("2");
+    }
+
+    std::vector<float> make_query(const uint32_t q) const
+    {
+        std::mt19937 gen(q);
+        std::normal_distribution<float> dis(0.0f, 0.3f);
+        std::vector<float> query(point(q * 37), point(q * 37) + DIM);
+        for (auto &v : query)
+            v += dis(gen);
+        return query;
+    }
+};
+#endif
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FilteredDiskSearch_tests)
+
+#ifndef _WINDOWS
+BOOST_AUTO_TEST_CASE(test_rare_label_scans_matching_points)
+{
+    RareLabelIndex rare;
+    bool exact_results = true, bounded_ios = true, scanned = true;
+    for (uint32_t q = 0; q < 20; q++)
+    {
+        std::vector<float> query = rare.make_query(q);
+        std::vector<uint64_t> ids(K);
+        std::vector<float> dists(K);
+        diskann::QueryStats stats;
+        rare.index->cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4, true, rare.rare_label, false,
+                                       &stats);
+
+        // the reranked scan returns the filtered top K at full precision
+        std::vector<uint32_t> exact = rare.exact_knn(query.data(), K, rare.rare_points);
+        exact_results = exact_results && std::vector<uint64_t>(exact.begin(), exact.end()) == ids;
+        bounded_ios = bounded_ios && stats.n_ios <= rare.rare_points.size();
+        scanned = scanned && stats.n_hops == 0;
+    }
+    BOOST_TEST(exact_results);
+    BOOST_TEST(bounded_ios);
+    BOOST_TEST(scanned);
+
+    // a selectivity of 0 searches the graph for the same filter
+    rare.index->set_prefilter_selectivity(0);
+    std::vector<float> query = rare.make_query(0);
+    std::vector<uint64_t> ids(K);
+    std::vector<float> dists(K);
+    diskann::QueryStats stats;
+    rare.index->cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4, true, rare.rare_label, false,
+                                   &stats);
+    BOOST_TEST(stats.n_hops > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_budgeted_rerank_returns_exact_distances)
+{
+    RareLabelIndex rare;
+    rare.index->set_embedding_provider(std::make_shared<diskann::BinFileEmbeddingProvider>(rare.dir + "/base.bin"));
+
+    // a budget below the number of matching points, so that the scan leaves
+    // some of them with PQ distances; none of them may be returned
+    const uint32_t recompute_budget = 5;
+    bool exact_distances = true, budgeted_results = true;
+    for (uint32_t q = 0; q < 20; q++)
+    {
+        std::vector<float> query = rare.make_query(q);
+        std::vector<uint64_t> ids(K);
+        std::vector<float> dists(K);
+        diskann::QueryStats stats;
+        rare.index->cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4, true, rare.rare_label, false,
+                                       &stats, false, false, true, false, 0, false, false, recompute_budget);
+        uint32_t num_results = 0;
+        for (uint32_t k = 0; k < K && ids[k] != std::numeric_limits<uint64_t>::max(); k++)
+        {
+            float exact = rare.distance((uint32_t)ids[k], query.data());
+            exact_distances = exact_distances && std::abs(dists[k] - exact) <= 1e-3f * (1 + exact);
+            num_results++;
+        }
+        budgeted_results = budgeted_results && num_results == recompute_budget;
+    }
+    BOOST_TEST(exact_distances);
+    BOOST_TEST(budgeted_results);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(test_extra_label_lines_are_rejected)
+{
+    // one label line more than there are points; the extra line is not dense
+    // enough to create dummy points
+    test_utils::RandomDiskIndex extra("diskann_extra_label_lines_test", 100, DIM, 9);
+    diskann::save_bin<float>(extra.dir + "/base.bin", extra.data.data(), extra.num_points(), DIM);
+    std::ofstream labels(extra.dir + "/labels.txt");
+    for (uint32_t i = 0; i <= extra.num_points(); i++)
+        labels << (i == 0 ? "1,2,3" : "1") << std::endl;
+    labels.close();
+
+    BOOST_CHECK_THROW(diskann::build_disk_index<float>((extra.dir + "/base.bin").c_str(), extra.prefix.c_str(),
+                                                       "32 64 0.01 1 4 0 0", diskann::Metric::L2, false, "", true,
+                                                       extra.dir + "/labels.txt", "", 2),
+                      diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,265 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "fresh_pq_flash_index.h"
+#include "graph_reorder.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+namespace
+{
+const uint32_t DIM = 32, NUM_DISK_POINTS = 2000, NUM_POINTS = 3000, K = 10;
+
+// A disk index over the first NUM_DISK_POINTS of NUM_POINTS random points,
+// whose tags are their ids; the other points are inserted by the tests.
+struct FreshIndexData : test_utils::RandomDiskIndex
+{
+    std::set<uint32_t> active;
+
+    FreshIndexData() : RandomDiskIndex("diskann_fresh_pq_flash_index_test", NUM_POINTS, DIM, 5)
+    {
+        build(NUM_DISK_POINTS);
+        for (uint32_t i = 0; i < NUM_DISK_POINTS; i++)
+            active.insert(i);
+    }
+
+    std::unique_ptr<diskann::FreshPQFlashIndex<float>> open_index() const
+    {
+        auto params = diskann::IndexWriteParametersBuilder(64, 32).with_alpha(1.2f).with_num_threads(4).build();
+        return std::make_unique<diskann::FreshPQFlashIndex<float>>(diskann::Metric::L2, prefix, 4, params, 1000);
+    }
+
+    // recall@K over active points for queries near random points, and whether
+    // a search returned a tag that is not active
+    double recall(diskann::FreshPQFlashIndex<float> &index, bool &returned_inactive) const
+    {
+        const uint32_t num_queries = 100;
+        std::vector<uint32_t> active_tags(active.begin(), active.end());
+        std::mt19937 gen(9);
+        std::normal_distribution<float> dis(0.0f, 0.1f);
+        size_t hits = 0;
+        returned_inactive = false;
+        for (uint32_t q = 0; q < num_queries; q++)
+        {
+            const uint32_t near = (uint32_t)(gen() % NUM_POINTS);
+            std::vector<float> query(point(near), point(near) + DIM);
+            for (auto &v : query)
+                v += dis(gen);
+
+            std::vector<uint32_t> tags(K);
+            std::vector<float> dists(K);
+            size_t n = index.search(query.data(), K, 64, 4, tags.data(), dists.data());
+            for (size_t i = 0; i < n; i++)
+                returned_inactive = returned_inactive || active.find(tags[i]) == active.end();
+            hits += test_utils::count_hits(exact_knn(query.data(), K, active_tags), tags.data(), n);
+        }
+        return (double)hits / (num_queries * K);
+    }
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FreshPQFlashIndex_tests)
+
+BOOST_AUTO_TEST_CASE(test_insert_delete_merge_search)
+{
+    FreshIndexData fresh;
+    auto index = fresh.open_index();
+    bool returned_inactive;
+    BOOST_TEST(fresh.recall(*index, returned_inactive) >= 0.9);
+
+    for (uint32_t tag = NUM_DISK_POINTS; tag < NUM_DISK_POINTS + 600; tag++)
+    {
+        BOOST_TEST(index->insert(fresh.point(tag), tag) == 0);
+        fresh.active.insert(tag);
+    }
+    // deletes of disk points and of delta points
+    for (uint32_t tag = 0; tag < 2 * NUM_DISK_POINTS; tag += 7)
+    {
+        if (fresh.active.find(tag) == fresh.active.end())
+            continue;
+        BOOST_TEST(index->lazy_delete(tag) == 0);
+        fresh.active.erase(tag);
+    }
+    BOOST_TEST(index->lazy_delete(NUM_POINTS + 1) == -1);
+
+    double delta_recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(delta_recall >= 0.9);
+
+    index->merge(fresh.dir + "/b");
+    BOOST_TEST(index->get_num_disk_points() == fresh.active.size());
+    BOOST_TEST(index->get_num_delta_points() == 0u);
+    double merged_recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(merged_recall >= 0.9);
+
+    // a second round on the merged index, which has a tags file
+    for (uint32_t tag = NUM_DISK_POINTS + 600; tag < NUM_POINTS; tag++)
+    {
+        BOOST_TEST(index->insert(fresh.point(tag), tag) == 0);
+        fresh.active.insert(tag);
+    }
+    for (uint32_t tag = 1; tag < NUM_POINTS; tag += 11)
+    {
+        if (fresh.active.erase(tag) > 0)
+            BOOST_TEST(index->lazy_delete(tag) == 0);
+    }
+    index->merge(fresh.dir + "/c");
+    BOOST_TEST(index->get_num_disk_points() == fresh.active.size());
+    merged_recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(merged_recall >= 0.9);
+}
+
+BOOST_AUTO_TEST_CASE(test_duplicate_insert)
+{
+    FreshIndexData fresh;
+    auto index = fresh.open_index();
+
+    // a live disk tag is rejected, and accepted again once deleted
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS), 5) == -1);
+    BOOST_TEST(index->lazy_delete(5) == 0);
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS), 5) == 0);
+
+    // a live delta tag is rejected, before and after a merge
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS + 1), NUM_DISK_POINTS + 1) == 0);
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS + 2), NUM_DISK_POINTS + 1) == -1);
+    index->merge(fresh.dir + "/b");
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS + 2), NUM_DISK_POINTS + 1) == -1);
+    BOOST_TEST(index->insert(fresh.point(NUM_DISK_POINTS + 2), 5) == -1);
+    BOOST_TEST(index->get_num_disk_points() == (size_t)NUM_DISK_POINTS + 1);
+
+    // the re-inserted point replaced the deleted one
+    std::vector<uint32_t> tags(1);
+    std::vector<float> dists(1);
+    index->search(fresh.point(NUM_DISK_POINTS), 1, 32, 4, tags.data(), dists.data());
+    BOOST_TEST(tags[0] == 5u);
+}
+
+BOOST_AUTO_TEST_CASE(test_updates_during_merge)
+{
+    FreshIndexData fresh;
+    auto index = fresh.open_index();
+    for (uint32_t tag = NUM_DISK_POINTS; tag < NUM_DISK_POINTS + 400; tag++)
+    {
+        BOOST_TEST(index->insert(fresh.point(tag), tag) == 0);
+        fresh.active.insert(tag);
+    }
+
+    // points of the merging delta are deleted, some of them possibly before
+    // the merge reads their vectors, and re-inserted
+    auto merged = index->merge_async(fresh.dir + "/b");
+    for (uint32_t tag = NUM_DISK_POINTS; tag < NUM_DISK_POINTS + 400; tag += 2)
+    {
+        BOOST_TEST(index->lazy_delete(tag) == 0);
+        fresh.active.erase(tag);
+    }
+    for (uint32_t tag = NUM_DISK_POINTS; tag < NUM_DISK_POINTS + 100; tag += 2)
+    {
+        BOOST_TEST(index->insert(fresh.point(tag), tag) == 0);
+        fresh.active.insert(tag);
+    }
+    merged.get();
+
+    bool returned_inactive;
+    double recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(recall >= 0.9);
+
+    // the next merge picks up the deletes and inserts made meanwhile
+    index->merge(fresh.dir + "/c");
+    BOOST_TEST(index->get_num_disk_points() == fresh.active.size());
+    BOOST_TEST(index->get_num_delta_points() == 0u);
+    recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(recall >= 0.9);
+}
+
+BOOST_AUTO_TEST_CASE(test_merge_without_medoid_neighborhood)
+{
+    FreshIndexData fresh;
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t medoid;
+    diskann::load_disk_index_graph<float>(fresh.prefix + "_disk.index", graph, medoid);
+
+    // the medoid and all its neighbors are deleted and nothing is inserted,
+    // so the merge has no candidate entry point around the old one
+    auto index = fresh.open_index();
+    std::vector<uint32_t> deletes = graph[medoid];
+    deletes.push_back(medoid);
+    for (auto tag : deletes)
+    {
+        BOOST_TEST(index->lazy_delete(tag) == 0);
+        fresh.active.erase(tag);
+    }
+    index->merge(fresh.dir + "/b");
+    BOOST_TEST(index->get_num_disk_points() == fresh.active.size());
+
+    std::vector<std::vector<uint32_t>> merged;
+    uint32_t merged_medoid;
+    diskann::load_disk_index_graph<float>(fresh.dir + "/b_disk.index", merged, merged_medoid);
+    BOOST_TEST(merged_medoid < merged.size());
+    bool returned_inactive;
+    double recall = fresh.recall(*index, returned_inactive);
+    BOOST_TEST(!returned_inactive);
+    BOOST_TEST(recall >= 0.9);
+}
+
+BOOST_AUTO_TEST_CASE(test_merged_delta_points_have_reverse_edges)
+{
+    FreshIndexData fresh;
+    auto index = fresh.open_index();
+    const uint32_t num_inserts = 50;
+    for (uint32_t tag = NUM_DISK_POINTS; tag < NUM_DISK_POINTS + num_inserts; tag++)
+        BOOST_TEST(index->insert(fresh.point(tag), tag) == 0);
+    index->merge(fresh.dir + "/b");
+
+    // the delta points follow the disk points in the merged index, and an
+    // edge between two of them is matched by a reverse edge unless the
+    // neighborhood it would go in overflowed and was pruned, which is rare
+    // with few delta points
+    std::vector<std::vector<uint32_t>> merged;
+    uint32_t medoid;
+    diskann::load_disk_index_graph<float>(fresh.dir + "/b_disk.index", merged, medoid);
+    BOOST_REQUIRE(merged.size() == (size_t)NUM_DISK_POINTS + num_inserts);
+    size_t delta_edges = 0, reversed = 0;
+    for (uint32_t a = NUM_DISK_POINTS; a < merged.size(); a++)
+    {
+        for (uint32_t b : merged[a])
+        {
+            if (b < NUM_DISK_POINTS)
+                continue;
+            delta_edges++;
+            reversed += std::find(merged[b].begin(), merged[b].end(), a) != merged[b].end();
+        }
+    }
+    BOOST_TEST_MESSAGE(reversed << " of " << delta_edges << " edges between delta points reversed");
+    BOOST_TEST(delta_edges > 0u);
+    BOOST_TEST(reversed >= 0.8 * delta_edges);
+}
+
+BOOST_AUTO_TEST_CASE(test_labeled_disk_index_is_rejected)
+{
+    test_utils::RandomDiskIndex labeled("diskann_fresh_labeled_index_test", 500, DIM, 6);
+    std::ofstream labels(labeled.dir + "/labels.txt");
+    for (uint32_t i = 0; i < labeled.num_points(); i++)
+        labels << (i % 2 == 0 ? "1" : "1,2") << std::endl;
+    labels.close();
+    labeled.build(0, 0, labeled.dir + "/labels.txt");
+
+    auto params = diskann::IndexWriteParametersBuilder(64, 32).with_num_threads(4).build();
+    BOOST_CHECK_THROW(diskann::FreshPQFlashIndex<float>(diskann::Metric::L2, labeled.prefix, 4, params, 1000),
+                      diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
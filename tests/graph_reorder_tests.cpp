@@ -0,0 +1,315 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "compressed_graph.h"
+#include "defaults.h"
+#include "disk_utils.h"
+#include "embedding_provider.h"
+#include "graph_reorder.h"
+#include "pq_flash_index.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace
+{
+// writes a memory index graph file in the format of InMemGraphStore::save_graph
+void write_graph(const std::string &file, const std::vector<std::vector<uint32_t>> &graph, uint32_t start)
+{
+    std::ofstream out(file, std::ios::binary);
+    size_t index_size = 24, num_frozen = 0;
+    uint32_t max_degree = 0;
+    for (auto &nbrs : graph)
+    {
+        index_size += sizeof(uint32_t) * (nbrs.size() + 1);
+        max_degree = std::max(max_degree, (uint32_t)nbrs.size());
+    }
+    out.write((char *)&index_size, sizeof(uint64_t));
+    out.write((char *)&max_degree, sizeof(uint32_t));
+    out.write((char *)&start, sizeof(uint32_t));
+    out.write((char *)&num_frozen, sizeof(size_t));
+    for (auto &nbrs : graph)
+    {
+        uint32_t k = (uint32_t)nbrs.size();
+        out.write((char *)&k, sizeof(uint32_t));
+        out.write((char *)nbrs.data(), k * sizeof(uint32_t));
+    }
+}
+
+// Writes graph partition files for a disk index as graph_partition does, with
+// partitions of consecutive nodes in a scrambled order.
+void write_partition_files(const std::string &prefix, const std::vector<std::vector<uint32_t>> &graph,
+                           const bool compressed)
+{
+    std::vector<char> sector0(diskann::defaults::SECTOR_LEN, 0);
+    std::ifstream disk_index(prefix + "_disk.index", std::ios::binary);
+    disk_index.read(sector0.data(), diskann::defaults::SECTOR_LEN);
+    const uint64_t *meta = (const uint64_t *)(sector0.data() + 8);
+    const uint64_t graph_node_len = meta[3] - meta[1] * sizeof(float);
+    const uint64_t C = diskann::defaults::SECTOR_LEN / graph_node_len, nd = graph.size();
+    if (compressed)
+        diskann::write_compressed_graph_header(sector0.data());
+
+    std::vector<std::vector<uint32_t>> partitions;
+    std::vector<uint32_t> id2partition(nd);
+    for (uint64_t i = 0; i < nd; i++)
+    {
+        if (i % C == 0)
+            partitions.emplace_back();
+        uint32_t id = (uint32_t)((i * 37) % nd);
+        partitions.back().push_back(id);
+        id2partition[id] = (uint32_t)(partitions.size() - 1);
+    }
+
+    std::ofstream partition_out(prefix + "_partition.bin", std::ios::binary);
+    uint64_t num_partitions = partitions.size();
+    partition_out.write((char *)&C, sizeof(uint64_t));
+    partition_out.write((char *)&num_partitions, sizeof(uint64_t));
+    partition_out.write((char *)&nd, sizeof(uint64_t));
+    for (auto &partition : partitions)
+    {
+        uint32_t psize = (uint32_t)partition.size();
+        partition_out.write((char *)&psize, sizeof(uint32_t));
+        partition_out.write((char *)partition.data(), psize * sizeof(uint32_t));
+    }
+    partition_out.write((char *)id2partition.data(), nd * sizeof(uint32_t));
+
+    std::ofstream graph_out(prefix + "_disk_graph.index", std::ios::binary);
+    graph_out.write(sector0.data(), diskann::defaults::SECTOR_LEN);
+    for (auto &partition : partitions)
+    {
+        std::vector<char> sector(diskann::defaults::SECTOR_LEN, 0);
+        if (compressed)
+        {
+            std::vector<uint8_t> records;
+            std::vector<uint16_t> offsets = {(uint16_t)(sizeof(uint16_t) * (partition.size() + 2))};
+            for (uint32_t id : partition)
+            {
+                diskann::encode_adjacency(graph[id].data(), (uint32_t)graph[id].size(), records);
+                offsets.push_back((uint16_t)(offsets[0] + records.size()));
+            }
+            uint16_t num_nodes = (uint16_t)partition.size();
+            std::memcpy(sector.data(), &num_nodes, sizeof(uint16_t));
+            std::memcpy(sector.data() + sizeof(uint16_t), offsets.data(), offsets.size() * sizeof(uint16_t));
+            std::memcpy(sector.data() + offsets[0], records.data(), records.size());
+        }
+        else
+        {
+            for (size_t j = 0; j < partition.size(); j++)
+            {
+                uint32_t *node = (uint32_t *)(sector.data() + j * graph_node_len);
+                node[0] = (uint32_t)graph[partition[j]].size();
+                std::copy(graph[partition[j]].begin(), graph[partition[j]].end(), node + 1);
+            }
+        }
+        graph_out.write(sector.data(), diskann::defaults::SECTOR_LEN);
+    }
+}
+
+// Reads back the graph stored in the partition files of prefix, with the
+// neighbors of every node sorted; returns an empty graph if the partition
+// lists and the id to partition map disagree.
+std::vector<std::vector<uint32_t>> read_partition_files(const std::string &prefix, const uint64_t graph_node_len)
+{
+    std::ifstream partition_in(prefix + "_partition.bin", std::ios::binary);
+    uint64_t C, num_partitions, nd;
+    partition_in.read((char *)&C, sizeof(uint64_t));
+    partition_in.read((char *)&num_partitions, sizeof(uint64_t));
+    partition_in.read((char *)&nd, sizeof(uint64_t));
+    std::vector<std::vector<uint32_t>> partitions(num_partitions);
+    for (auto &partition : partitions)
+    {
+        uint32_t psize;
+        partition_in.read((char *)&psize, sizeof(uint32_t));
+        partition.resize(psize);
+        partition_in.read((char *)partition.data(), psize * sizeof(uint32_t));
+    }
+    std::vector<uint32_t> id2partition(nd);
+    partition_in.read((char *)id2partition.data(), nd * sizeof(uint32_t));
+
+    std::ifstream graph_in(prefix + "_disk_graph.index", std::ios::binary);
+    std::vector<char> sector(diskann::defaults::SECTOR_LEN);
+    graph_in.read(sector.data(), diskann::defaults::SECTOR_LEN);
+    const bool compressed = diskann::is_compressed_graph_header(sector.data());
+    std::vector<std::vector<uint32_t>> graph(nd);
+    for (uint64_t p = 0; p < num_partitions; p++)
+    {
+        graph_in.read(sector.data(), diskann::defaults::SECTOR_LEN);
+        for (uint32_t j = 0; j < partitions[p].size(); j++)
+        {
+            uint32_t id = partitions[p][j];
+            if (id >= nd || id2partition[id] != p)
+                return {};
+            if (compressed)
+            {
+                const uint8_t *record;
+                size_t record_len;
+                uint64_t num_nbrs;
+                std::vector<uint32_t> nbrs(graph_node_len / sizeof(uint32_t));
+                if (!diskann::get_compressed_record(sector.data(), sector.size(), j, record, record_len) ||
+                    !diskann::decode_adjacency(record, record_len, nbrs.data(), nbrs.size(), num_nbrs))
+                    return {};
+                graph[id].assign(nbrs.begin(), nbrs.begin() + num_nbrs);
+            }
+            else
+            {
+                const uint32_t *node = (const uint32_t *)(sector.data() + j * graph_node_len);
+                graph[id].assign(node + 1, node + 1 + node[0]);
+            }
+            std::sort(graph[id].begin(), graph[id].end());
+        }
+    }
+    return graph;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(GraphReorder_tests)
+
+BOOST_AUTO_TEST_CASE(test_bfs_order)
+{
+    // a path 3 - 0 - 2 and an isolated point 1
+    std::vector<std::vector<uint32_t>> graph = {{3, 2}, {}, {0}, {0}};
+
+    std::vector<uint32_t> order = diskann::compute_bfs_order(graph, 3, false);
+    std::vector<uint32_t> expected = {3, 0, 2, 1};
+    BOOST_TEST(order == expected, boost::test_tools::per_element());
+
+    order = diskann::compute_bfs_order(graph, 3, true);
+    std::reverse(expected.begin(), expected.end());
+    BOOST_TEST(order == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(test_reorder_memory_index)
+{
+    const uint32_t num_points = 50, dim = 3;
+    std::vector<std::vector<uint32_t>> graph(num_points);
+    std::vector<float> data(num_points * dim);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        graph[i] = {(i + 7) % num_points, (i * 3 + 1) % num_points};
+        for (uint32_t d = 0; d < dim; d++)
+            data[i * dim + d] = (float)(i * dim + d);
+    }
+
+    std::string dir = (std::filesystem::temp_directory_path() / "diskann_graph_reorder_test").string();
+    std::filesystem::create_directories(dir);
+    write_graph(dir + "/index", graph, 5);
+    diskann::save_bin<float>(dir + "/index.data", data.data(), num_points, dim);
+
+    std::vector<uint32_t> new_to_old = diskann::compute_bfs_order(graph, 5, false);
+    diskann::reorder_memory_index<float>(dir + "/index", dir + "/reordered", new_to_old);
+
+    std::vector<std::vector<uint32_t>> reordered;
+    uint32_t start;
+    diskann::load_memory_index_graph(dir + "/reordered", reordered, start);
+    BOOST_REQUIRE_EQUAL(reordered.size(), num_points);
+    BOOST_TEST(start == 0u);
+
+    float *reordered_data = nullptr;
+    uint32_t *id_map = nullptr;
+    size_t npts, ndims;
+    diskann::load_bin<float>(dir + "/reordered.data", reordered_data, npts, ndims);
+    diskann::load_bin<uint32_t>(dir + "/reordered_id_map.bin", id_map, npts, ndims);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        // same edges and vectors under the new ids
+        BOOST_REQUIRE_EQUAL(id_map[i], new_to_old[i]);
+        BOOST_REQUIRE_EQUAL(reordered[i].size(), graph[id_map[i]].size());
+        for (size_t k = 0; k < reordered[i].size(); k++)
+            BOOST_TEST(id_map[reordered[i][k]] == graph[id_map[i]][k]);
+        for (uint32_t d = 0; d < dim; d++)
+            BOOST_TEST(reordered_data[i * dim + d] == data[id_map[i] * dim + d]);
+    }
+    delete[] reordered_data;
+    delete[] id_map;
+    std::filesystem::remove_all(dir);
+}
+
+#ifndef _WINDOWS
+BOOST_AUTO_TEST_CASE(test_reorder_disk_index_with_partitions)
+{
+    const uint32_t num_points = 1000, dim = 16, K = 10, num_queries = 30;
+    test_utils::RandomDiskIndex disk("diskann_graph_reorder_disk_test", num_points, dim, 1);
+    disk.build();
+    const std::string &dir = disk.dir;
+    const std::vector<float> &data = disk.data;
+
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t medoid;
+    diskann::load_disk_index_graph<float>(disk.prefix + "_disk.index", graph, medoid);
+    std::vector<uint32_t> new_to_old = diskann::compute_bfs_order(graph, medoid, false);
+    std::vector<uint32_t> old_to_new(num_points);
+    for (uint32_t i = 0; i < num_points; i++)
+        old_to_new[new_to_old[i]] = i;
+    diskann::reorder_disk_index<float>(disk.prefix, dir + "/b", new_to_old);
+
+    // the reordered index answers with the ids the points had before
+    auto provider = std::make_shared<diskann::BinFileEmbeddingProvider>(dir + "/base.bin");
+    auto search = [&](const std::string &prefix, std::vector<std::vector<uint64_t>> &ids) {
+        std::shared_ptr<AlignedFileReader> reader(new LinuxAlignedFileReader());
+        std::shared_ptr<AlignedFileReader> graph_reader(new LinuxAlignedFileReader());
+        diskann::PQFlashIndex<float> index(reader, graph_reader, diskann::Metric::L2);
+        BOOST_REQUIRE(index.load(1, prefix.c_str(), 0, nullptr, "") == 0);
+        index.set_embedding_provider(provider);
+        ids.assign(num_queries, std::vector<uint64_t>(K));
+        std::vector<float> dists(K);
+        for (uint32_t q = 0; q < num_queries; q++)
+            index.cached_beam_search(data.data() + (size_t)q * 31 * dim, K, 32, ids[q].data(), dists.data(), 4,
+                                     false, nullptr, false, false, true);
+    };
+    std::vector<std::vector<uint64_t>> original_ids, reordered_ids;
+    search(disk.prefix, original_ids);
+    search(dir + "/b", reordered_ids);
+    BOOST_TEST((original_ids == reordered_ids));
+    size_t hits = 0;
+    for (uint32_t q = 0; q < num_queries; q++)
+        hits += reordered_ids[q][0] == q * 31;
+    BOOST_TEST(hits == (size_t)num_queries);
+
+    // the rewritten partition files hold the same graph under the new ids, in
+    // both graph formats
+    std::ifstream disk_index(disk.prefix + "_disk.index", std::ios::binary);
+    std::vector<uint64_t> meta(5);
+    disk_index.seekg(8);
+    disk_index.read((char *)meta.data(), meta.size() * sizeof(uint64_t));
+    const uint64_t graph_node_len = meta[3] - meta[1] * sizeof(float);
+    std::vector<std::vector<uint32_t>> expected(num_points);
+    for (uint32_t i = 0; i < num_points; i++)
+    {
+        for (uint32_t nbr : graph[new_to_old[i]])
+            expected[i].push_back(old_to_new[nbr]);
+        std::sort(expected[i].begin(), expected[i].end());
+    }
+    for (const bool compressed : {false, true})
+    {
+        write_partition_files(disk.prefix, graph, compressed);
+        diskann::reorder_partition_files(disk.prefix, dir + "/b", new_to_old);
+        BOOST_TEST((read_partition_files(dir + "/b", graph_node_len) == expected));
+
+        std::vector<char> sector0(diskann::defaults::SECTOR_LEN);
+        std::ifstream graph_in(dir + "/b_disk_graph.index", std::ios::binary);
+        graph_in.read(sector0.data(), sector0.size());
+        BOOST_TEST(((const uint64_t *)(sector0.data() + 8))[2] == (uint64_t)old_to_new[medoid]);
+        BOOST_TEST(diskann::is_compressed_graph_header(sector0.data()) == compressed);
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
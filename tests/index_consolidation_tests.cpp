@@ -0,0 +1,130 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "index.h"
+#include "utils.h"
+
+namespace
+{
+const uint32_t DIM = 32, NUM_BUILD_POINTS = 4000, NUM_DELETES = 1500, NUM_INSERTS = 800, NUM_INSERT_THREADS = 4;
+
+std::vector<float> random_points(const size_t num_points, const uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+    std::vector<float> data(num_points * DIM);
+    for (auto &v : data)
+        v = dis(gen);
+    return data;
+}
+
+// inserts NUM_BUILD_POINTS random points with tags 1.. and lazily deletes
+// NUM_DELETES of them
+std::vector<float> insert_and_delete(diskann::Index<float, uint32_t> &index)
+{
+    index.set_start_points_at_random(1.0f);
+    std::vector<float> data = random_points(NUM_BUILD_POINTS, 1);
+    std::vector<uint32_t> tags(NUM_BUILD_POINTS);
+#pragma omp parallel for num_threads(4) schedule(dynamic, 64)
+    for (int64_t i = 0; i < (int64_t)NUM_BUILD_POINTS; i++)
+    {
+        tags[i] = (uint32_t)i + 1;
+        index.insert_point(data.data() + (size_t)i * DIM, tags[i]);
+    }
+
+    std::mt19937 gen(2);
+    std::shuffle(tags.begin(), tags.end(), gen);
+    std::vector<uint32_t> failed_tags;
+    index.lazy_delete(std::vector<uint32_t>(tags.begin(), tags.begin() + NUM_DELETES), failed_tags);
+    BOOST_TEST(failed_tags.empty());
+    return data;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(IndexConsolidation_tests)
+
+BOOST_AUTO_TEST_CASE(test_throttled_consolidation_with_concurrent_inserts)
+{
+    // a small degree, so that inserts often prune the neighborhoods that the
+    // consolidation is repairing
+    auto write_params = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(32, 16).with_alpha(1.2f).with_num_threads(4).build());
+    auto search_params = std::make_shared<diskann::IndexSearchParams>(32, 8);
+    diskann::Index<float, uint32_t> index(diskann::Metric::L2, DIM, NUM_BUILD_POINTS + NUM_INSERTS, write_params,
+                                          search_params, 1, true, true, true);
+
+    insert_and_delete(index);
+
+    // the repair is throttled to take more than half a second, and points are
+    // inserted while it runs
+    index.start_background_consolidation(*write_params, 1, 10, NUM_BUILD_POINTS);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::vector<float> inserts = random_points(NUM_INSERTS, 3);
+    std::vector<std::thread> inserters;
+    for (uint32_t t = 0; t < NUM_INSERT_THREADS; t++)
+    {
+        inserters.emplace_back([&, t]() {
+            for (uint32_t i = t; i < NUM_INSERTS; i += NUM_INSERT_THREADS)
+                index.insert_point(inserts.data() + (size_t)i * DIM, NUM_BUILD_POINTS + 1 + i);
+        });
+    }
+    for (auto &inserter : inserters)
+        inserter.join();
+
+    // wait for the deleted slots to be released
+    const size_t num_live = NUM_BUILD_POINTS - NUM_DELETES + NUM_INSERTS;
+    for (uint32_t wait_ms = 0; wait_ms < 60000 && index.get_num_points() != num_live; wait_ms += 10)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    index.stop_background_consolidation();
+    BOOST_TEST(index.get_num_points() == num_live);
+
+    // no edge may point at a released slot
+    BOOST_TEST(index.count_dangling_edges() == 0u);
+
+    // and the inserted points are still found
+    size_t found = 0;
+    std::vector<uint32_t> result_tags(1);
+    std::vector<float> result_dists(1);
+    std::vector<float *> result_vectors;
+    for (uint32_t i = 0; i < NUM_INSERTS; i += 8)
+    {
+        index.search_with_tags(inserts.data() + (size_t)i * DIM, 1, 32, result_tags.data(), result_dists.data(),
+                               result_vectors);
+        found += result_tags[0] == NUM_BUILD_POINTS + 1 + i;
+    }
+    BOOST_TEST(found >= (size_t)(0.9 * NUM_INSERTS / 8));
+}
+
+BOOST_AUTO_TEST_CASE(test_stop_finishes_throttled_round_unthrottled)
+{
+    auto write_params = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(32, 16).with_alpha(1.2f).with_num_threads(4).build());
+    auto search_params = std::make_shared<diskann::IndexSearchParams>(32, 8);
+    diskann::Index<float, uint32_t> index(diskann::Metric::L2, DIM, NUM_BUILD_POINTS, write_params, search_params, 1,
+                                          true, true, true);
+    insert_and_delete(index);
+
+    // throttled to take minutes, the round is running when the stop comes
+    index.start_background_consolidation(*write_params, 1, 10, 20);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto stop_start = std::chrono::steady_clock::now();
+    index.stop_background_consolidation();
+    double stop_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stop_start).count();
+    BOOST_TEST_MESSAGE("stopped in " << stop_seconds << " seconds");
+    BOOST_TEST(stop_seconds < 10.0);
+
+    // the round was finished, not abandoned
+    BOOST_TEST(index.get_num_points() == (size_t)(NUM_BUILD_POINTS - NUM_DELETES));
+    BOOST_TEST(index.count_dangling_edges() == 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
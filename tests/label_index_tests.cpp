@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "label_index.h"
+
+namespace
+{
+typedef diskann::LabelPredicate<uint32_t> Predicate;
+
+struct LabelLists
+{
+    std::vector<uint32_t> offsets, counts, labels;
+
+    bool has(uint32_t point, uint32_t label) const
+    {
+        auto begin = labels.begin() + offsets[point];
+        return std::find(begin, begin + counts[point], label) != begin + counts[point];
+    }
+};
+
+LabelLists random_labels(size_t num_points, uint32_t num_labels, std::mt19937 &gen)
+{
+    // label l is on about one point in l + 1, so that some labels get bitsets
+    // and others lists
+    LabelLists lists;
+    for (size_t i = 0; i < num_points; i++)
+    {
+        lists.offsets.push_back((uint32_t)lists.labels.size());
+        for (uint32_t l = 0; l < num_labels; l++)
+        {
+            if (gen() % (l + 1) == 0)
+                lists.labels.push_back(l);
+        }
+        lists.counts.push_back((uint32_t)lists.labels.size() - lists.offsets.back());
+    }
+    return lists;
+}
+
+bool evaluate(const Predicate &predicate, const LabelLists &lists, uint32_t point, const uint32_t *universal)
+{
+    switch (predicate.op())
+    {
+    case Predicate::Op::LABEL:
+        return lists.has(point, predicate.get_label()) || (universal != nullptr && lists.has(point, *universal));
+    case Predicate::Op::NOT:
+        return !evaluate(predicate.operands()[0], lists, point, universal);
+    case Predicate::Op::ALL_OF:
+        for (const auto &operand : predicate.operands())
+            if (!evaluate(operand, lists, point, universal))
+                return false;
+        return true;
+    default:
+        for (const auto &operand : predicate.operands())
+            if (evaluate(operand, lists, point, universal))
+                return true;
+        return false;
+    }
+}
+
+void check_predicates(uint32_t num_labels, bool expect_point_bitsets)
+{
+    const size_t num_points = 2000;
+    std::mt19937 gen(num_labels);
+    LabelLists lists = random_labels(num_points, num_labels, gen);
+    diskann::LabelIndex<uint32_t> index;
+    index.build(num_points, lists.offsets.data(), lists.counts.data(), lists.labels.data());
+    BOOST_TEST(index.get_num_labels() == num_labels);
+    BOOST_TEST(index.uses_point_bitsets() == expect_point_bitsets);
+
+    const uint32_t universal = num_labels - 1, unknown = num_labels + 5;
+    std::vector<Predicate> predicates = {
+        Predicate::label(0),
+        Predicate::label(unknown),
+        Predicate::all_of(std::vector<uint32_t>{0, 1, 2}),
+        Predicate::any_of(std::vector<uint32_t>{3, 70, unknown}),
+        Predicate::all_of(std::vector<uint32_t>{1, unknown}),
+        Predicate::all_of(std::vector<uint32_t>{}),
+        Predicate::any_of(std::vector<uint32_t>{}),
+        Predicate::negate(Predicate::label(1)),
+        Predicate::all_of({Predicate::label(1), Predicate::any_of(std::vector<uint32_t>{2, 9}),
+                           Predicate::negate(Predicate::any_of(std::vector<uint32_t>{4, 5}))}),
+        Predicate::all_of(std::vector<uint32_t>{0, 70}),
+        Predicate::any_of(std::vector<uint32_t>{70, 90}),
+    };
+
+    for (const auto &predicate : predicates)
+    {
+        auto filter = index.compile(predicate);
+        auto universal_filter = index.compile(predicate, &universal);
+        bool all_match = true;
+        for (uint32_t i = 0; i < num_points; i++)
+        {
+            all_match = all_match && index.matches(filter, i) == evaluate(predicate, lists, i, nullptr);
+            all_match = all_match && index.matches(universal_filter, i) == evaluate(predicate, lists, i, &universal);
+        }
+        BOOST_TEST(all_match);
+
+        // enumeration, where possible, finds exactly the matching points
+        std::vector<uint32_t> expected, points;
+        for (uint32_t i = 0; i < num_points; i++)
+        {
+            if (evaluate(predicate, lists, i, &universal))
+                expected.push_back(i);
+        }
+        BOOST_TEST(index.estimate_matches(universal_filter) >= expected.size());
+        if (index.get_matching_points(universal_filter, points))
+            BOOST_TEST(points == expected, boost::test_tools::per_element());
+    }
+
+    // rare labels can always be enumerated, other filters with point bitsets
+    std::vector<uint32_t> points;
+    BOOST_TEST(index.get_matching_points(index.compile(predicates.back()), points));
+    BOOST_TEST(index.get_matching_points(index.compile(Predicate::label(unknown)), points));
+    BOOST_TEST(index.get_matching_points(index.compile(Predicate::negate(Predicate::label(70))), points) ==
+               expect_point_bitsets);
+
+    for (uint32_t l : {0u, 1u, 63u, unknown})
+    {
+        size_t count = 0;
+        bool has_label_matches = true;
+        for (uint32_t i = 0; i < num_points; i++)
+        {
+            count += lists.has(i, l);
+            has_label_matches = has_label_matches && index.has_label(i, l) == lists.has(i, l);
+        }
+        BOOST_TEST(index.get_label_count(l) == count);
+        BOOST_TEST(has_label_matches);
+    }
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LabelIndex_tests)
+
+BOOST_AUTO_TEST_CASE(test_predicates_with_point_bitsets)
+{
+    check_predicates(100, true);
+}
+
+BOOST_AUTO_TEST_CASE(test_predicates_with_label_bitmaps)
+{
+    check_predicates(diskann::LabelIndex<uint32_t>::MAX_POINT_BITSET_LABELS + 100, false);
+}
+
+BOOST_AUTO_TEST_CASE(test_positive_labels)
+{
+    auto predicate = Predicate::all_of({Predicate::label(1), Predicate::any_of(std::vector<uint32_t>{2, 3}),
+                                        Predicate::negate(Predicate::label(4))});
+    std::vector<uint32_t> labels;
+    predicate.get_positive_labels(labels);
+    std::vector<uint32_t> expected = {1, 2, 3};
+    BOOST_TEST(labels == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "disk_utils.h"
+#include "index.h"
+#include "index_factory.h"
+#include "pq.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+namespace
+{
+const uint32_t NUM_POINTS = 3000, DIM = 16, NUM_SHARDS = 3, MAX_DEGREE = 24, NUM_PQ_CHUNKS = 8;
+
+// reads a memory index graph file in the format written by merge_shards
+std::vector<std::vector<uint32_t>> read_graph(const std::string &file, uint32_t &start)
+{
+    std::ifstream in(file, std::ios::binary);
+    size_t index_size, num_frozen;
+    uint32_t max_degree;
+    in.read((char *)&index_size, sizeof(uint64_t));
+    in.read((char *)&max_degree, sizeof(uint32_t));
+    in.read((char *)&start, sizeof(uint32_t));
+    in.read((char *)&num_frozen, sizeof(size_t));
+    std::vector<std::vector<uint32_t>> graph;
+    uint32_t k;
+    while (in.read((char *)&k, sizeof(uint32_t)))
+    {
+        std::vector<uint32_t> nbrs(k);
+        in.read((char *)nbrs.data(), k * sizeof(uint32_t));
+        graph.push_back(std::move(nbrs));
+    }
+    return graph;
+}
+
+// best-first search of the graph on exact distances with a list of size L
+std::vector<uint32_t> greedy_search(const std::vector<std::vector<uint32_t>> &graph, const test_utils::PointSet &points,
+                                    const uint32_t start, const float *query, const uint32_t K, const uint32_t L)
+{
+    std::vector<std::pair<float, uint32_t>> best = {{points.distance(start, query), start}};
+    std::vector<bool> visited(graph.size(), false), expanded(graph.size(), false);
+    visited[start] = true;
+    while (true)
+    {
+        auto next = std::find_if(best.begin(), best.end(), [&](const auto &c) { return !expanded[c.second]; });
+        if (next == best.end())
+            break;
+        uint32_t node = next->second;
+        expanded[node] = true;
+        for (uint32_t nbr : graph[node])
+        {
+            if (visited[nbr])
+                continue;
+            visited[nbr] = true;
+            best.emplace_back(points.distance(nbr, query), nbr);
+        }
+        std::sort(best.begin(), best.end());
+        best.resize((std::min)(best.size(), (size_t)L));
+    }
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < K && i < best.size(); i++)
+        result.push_back(best[i].second);
+    return result;
+}
+
+// Builds NUM_SHARDS shard indexes in which every point is in two shards, as
+// with partition_with_ram_budget(k_base = 2), and the PQ files of the data.
+struct ShardedData : test_utils::ScratchDir, test_utils::PointSet
+{
+    ShardedData() : ScratchDir("diskann_merge_shards_test"), PointSet(NUM_POINTS, DIM)
+    {
+        // points around a few cluster centers, so that neighborhoods matter
+        std::mt19937 gen(7);
+        std::normal_distribution<float> dis(0.0f, 1.0f);
+        std::vector<float> centers(16 * DIM);
+        for (auto &v : centers)
+            v = 4.0f * dis(gen);
+        for (uint32_t i = 0; i < NUM_POINTS; i++)
+            for (uint32_t d = 0; d < DIM; d++)
+                data[(size_t)i * DIM + d] = centers[(i % 16) * DIM + d] + dis(gen);
+        diskann::save_bin<float>(dir + "/base.bin", data.data(), NUM_POINTS, DIM);
+
+        for (uint32_t shard = 0; shard < NUM_SHARDS; shard++)
+        {
+            std::vector<uint32_t> ids;
+            std::vector<float> shard_data;
+            for (uint32_t i = 0; i < NUM_POINTS; i++)
+            {
+                if (i % NUM_SHARDS == shard)
+                    continue;
+                ids.push_back(i);
+                shard_data.insert(shard_data.end(), data.begin() + (size_t)i * DIM,
+                                  data.begin() + (size_t)(i + 1) * DIM);
+            }
+            std::string shard_prefix = dir + "/shard" + std::to_string(shard);
+            diskann::save_bin<uint32_t>(shard_prefix + "_ids.bin", ids.data(), ids.size(), 1);
+            diskann::save_bin<float>(shard_prefix + ".bin", shard_data.data(), ids.size(), DIM);
+
+            auto params = std::make_shared<diskann::IndexWriteParameters>(
+                diskann::IndexWriteParametersBuilder(64, MAX_DEGREE).with_num_threads(1).build());
+            diskann::Index<float> index(diskann::Metric::L2, DIM, ids.size(), params, nullptr);
+            index.build((shard_prefix + ".bin").c_str(), ids.size());
+            index.save((shard_prefix + "_mem.index").c_str());
+        }
+
+        diskann::generate_pq_pivots(data.data(), NUM_POINTS, DIM, NUM_PQ_CENTROIDS, NUM_PQ_CHUNKS, 10,
+                                    dir + "/pq_pivots.bin");
+        diskann::generate_pq_data_from_pivots<float>(dir + "/base.bin", NUM_PQ_CENTROIDS, NUM_PQ_CHUNKS,
+                                                     dir + "/pq_pivots.bin", dir + "/pq_compressed.bin");
+    }
+
+    std::vector<std::vector<uint32_t>> merge(const bool prune, uint32_t &start) const
+    {
+        std::string output = dir + (prune ? "/merged_pruned.index" : "/merged_truncated.index");
+        diskann::merge_shards(dir + "/shard", "_mem.index", dir + "/shard", "_ids.bin", NUM_SHARDS, MAX_DEGREE, output,
+                              dir + "/medoids.bin", false, "", prune ? dir + "/pq_pivots.bin" : "",
+                              prune ? dir + "/pq_compressed.bin" : "");
+        return read_graph(output, start);
+    }
+
+    // recall@10 of a search with L = 32 for queries near the base points
+    double recall(const std::vector<std::vector<uint32_t>> &graph, const uint32_t start) const
+    {
+        const uint32_t num_queries = 100, K = 10;
+        std::mt19937 gen(11);
+        std::normal_distribution<float> dis(0.0f, 0.5f);
+        size_t hits = 0;
+        for (uint32_t q = 0; q < num_queries; q++)
+        {
+            std::vector<float> query(data.begin() + (size_t)(q * 29) * DIM, data.begin() + (size_t)(q * 29 + 1) * DIM);
+            for (auto &v : query)
+                v += dis(gen);
+
+            std::vector<uint32_t> found = greedy_search(graph, *this, start, query.data(), K, 32);
+            hits += test_utils::count_hits(exact_knn(query.data(), K), found.data(), found.size());
+        }
+        return (double)hits / (num_queries * K);
+    }
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MergeShards_tests)
+
+BOOST_AUTO_TEST_CASE(test_prune_on_merge)
+{
+    ShardedData sharded;
+    uint32_t start;
+    std::vector<std::vector<uint32_t>> graph = sharded.merge(true, start);
+    BOOST_TEST(graph.size() == (size_t)NUM_POINTS);
+    BOOST_TEST(start < NUM_POINTS);
+
+    // the union of two shard neighborhoods is pruned back to at most
+    // MAX_DEGREE distinct neighbors, with no self loops
+    bool degrees_bounded = true, valid_neighbors = true;
+    for (uint32_t i = 0; i < graph.size(); i++)
+    {
+        degrees_bounded = degrees_bounded && !graph[i].empty() && graph[i].size() <= MAX_DEGREE;
+        std::vector<uint32_t> nbrs = graph[i];
+        std::sort(nbrs.begin(), nbrs.end());
+        valid_neighbors = valid_neighbors && std::adjacent_find(nbrs.begin(), nbrs.end()) == nbrs.end();
+        valid_neighbors = valid_neighbors && std::find(nbrs.begin(), nbrs.end(), i) == nbrs.end();
+        valid_neighbors = valid_neighbors && nbrs.back() < NUM_POINTS;
+    }
+    BOOST_TEST(degrees_bounded);
+    BOOST_TEST(valid_neighbors);
+
+    // pruning keeps the graph navigable: the recall is high, and not lower
+    // than with the truncation of the shuffled union
+    double pruned_recall = sharded.recall(graph, start);
+    uint32_t truncated_start;
+    std::vector<std::vector<uint32_t>> truncated = sharded.merge(false, truncated_start);
+    double truncated_recall = sharded.recall(truncated, truncated_start);
+    BOOST_TEST_MESSAGE("recall@10 pruned " << pruned_recall << ", truncated " << truncated_recall);
+    BOOST_TEST(pruned_recall >= 0.9);
+    BOOST_TEST(pruned_recall >= truncated_recall - 0.02);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
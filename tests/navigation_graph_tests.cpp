@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pq_flash_index.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace
+{
+const uint32_t DIM = 32, NUM_POINTS = 3000, NUM_NAV_POINTS = 300, K = 10, L = 32;
+
+#ifndef _WINDOWS
+// A loaded disk index with the readers it refers to.
+struct LoadedIndex
+{
+    std::shared_ptr<AlignedFileReader> reader{new LinuxAlignedFileReader()};
+    std::shared_ptr<AlignedFileReader> graph_reader{new LinuxAlignedFileReader()};
+    diskann::PQFlashIndex<float> index{reader, graph_reader, diskann::Metric::L2};
+
+    LoadedIndex(const std::string &prefix)
+    {
+        BOOST_REQUIRE(index.load(1, prefix.c_str(), 0, nullptr, "") == 0);
+    }
+};
+
+// recall@K and mean hops of searches for queries near the base points
+double recall(diskann::PQFlashIndex<float> &index, const test_utils::PointSet &points, double &mean_hops)
+{
+    const uint32_t num_queries = 100;
+    std::mt19937 gen(4);
+    std::normal_distribution<float> dis(0.0f, 0.3f);
+    size_t hits = 0, hops = 0;
+    for (uint32_t q = 0; q < num_queries; q++)
+    {
+        std::vector<float> query(points.point(q * 29), points.point(q * 29) + DIM);
+        for (auto &v : query)
+            v += dis(gen);
+
+        std::vector<uint64_t> ids(K);
+        std::vector<float> dists(K);
+        diskann::QueryStats stats;
+        index.cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4, false, &stats);
+        hops += stats.n_hops;
+        hits += test_utils::count_hits(points.exact_knn(query.data(), K), ids.data(), K);
+    }
+    mean_hops = (double)hops / num_queries;
+    return (double)hits / (num_queries * K);
+}
+#endif
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(NavigationGraph_tests)
+
+#ifndef _WINDOWS
+BOOST_AUTO_TEST_CASE(test_navigation_graph_start_points)
+{
+    test_utils::RandomDiskIndex disk("diskann_navigation_graph_test", NUM_POINTS, DIM, 6);
+    disk.build(0, NUM_NAV_POINTS);
+    const std::string nav_graph = disk.prefix + "_disk.index_nav_graph";
+    BOOST_REQUIRE(std::filesystem::exists(nav_graph));
+    BOOST_REQUIRE(std::filesystem::exists(nav_graph + "_ids.bin"));
+
+    // the same index searched from the nav graph start points and from the
+    // medoid, by hiding the nav graph
+    double nav_hops, medoid_hops;
+    auto index = std::make_unique<LoadedIndex>(disk.prefix);
+    double nav_recall = recall(index->index, disk, nav_hops);
+    std::filesystem::rename(nav_graph, nav_graph + ".hidden");
+    index = std::make_unique<LoadedIndex>(disk.prefix);
+    double medoid_recall = recall(index->index, disk, medoid_hops);
+    std::filesystem::rename(nav_graph + ".hidden", nav_graph);
+
+    BOOST_TEST_MESSAGE("recall@" << K << " nav graph " << nav_recall << " (" << nav_hops << " hops), medoid "
+                                 << medoid_recall << " (" << medoid_hops << " hops)");
+    BOOST_TEST(nav_recall >= 0.9);
+    BOOST_TEST(nav_recall >= medoid_recall - 0.01);
+    BOOST_TEST(nav_hops < medoid_hops);
+
+    // a nav graph over points that are not in the index is rejected
+    std::vector<uint32_t> nav_ids(NUM_NAV_POINTS, 0);
+    nav_ids.back() = NUM_POINTS;
+    diskann::save_bin<uint32_t>(nav_graph + "_ids.bin", nav_ids.data(), nav_ids.size(), 1);
+    BOOST_CHECK_THROW(LoadedIndex(disk.prefix), diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_CASE(test_rebuild_removes_navigation_graph)
+{
+    test_utils::RandomDiskIndex disk("diskann_navigation_graph_rebuild_test", NUM_POINTS, DIM, 7);
+    disk.build(0, NUM_NAV_POINTS);
+    const std::string nav_graph = disk.prefix + "_disk.index_nav_graph";
+    BOOST_REQUIRE(std::filesystem::exists(nav_graph));
+
+    // a smaller index at the same prefix without a nav graph, so that the old
+    // one would start searches from points that are not in the index
+    const uint32_t num_rebuilt = NUM_POINTS / 4;
+    disk.build(num_rebuilt, 0);
+    BOOST_TEST(!std::filesystem::exists(nav_graph));
+    BOOST_TEST(!std::filesystem::exists(nav_graph + "_ids.bin"));
+
+    LoadedIndex index(disk.prefix);
+    std::vector<uint64_t> ids(K);
+    std::vector<float> dists(K);
+    index.index.cached_beam_search(disk.point(0), K, L, ids.data(), dists.data(), 4);
+    BOOST_TEST(ids[0] == 0u);
+    BOOST_TEST(*std::max_element(ids.begin(), ids.end()) < num_rebuilt);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "neighbor.h"
+
+namespace
+{
+// The set a queue of the given capacity holds: the best capacity distinct
+// neighbors inserted, in order, with their expanded flags.
+struct ReferenceQueue
+{
+    size_t capacity;
+    std::vector<diskann::Neighbor> data;
+
+    void insert(const diskann::Neighbor &nbr)
+    {
+        auto pos = std::upper_bound(data.begin(), data.end(), nbr);
+        if (pos != data.begin() && !(*(pos - 1) < nbr))
+            return;
+        data.insert(pos, diskann::Neighbor(nbr.id, nbr.distance));
+        if (data.size() > capacity)
+            data.pop_back();
+    }
+
+    bool has_unexpanded_node() const
+    {
+        return std::any_of(data.begin(), data.end(), [](const diskann::Neighbor &n) { return !n.expanded; });
+    }
+
+    diskann::Neighbor closest_unexpanded()
+    {
+        auto it = std::find_if(data.begin(), data.end(), [](const diskann::Neighbor &n) { return !n.expanded; });
+        it->expanded = true;
+        return *it;
+    }
+};
+
+void check_queue(const size_t capacity)
+{
+    std::mt19937 gen((uint32_t)capacity);
+    diskann::NeighborPriorityQueue queue(capacity);
+    ReferenceQueue reference{capacity, {}};
+
+    // neighbors of the expanded nodes, each id always at the same distance,
+    // some seen again and most worse than the set
+    const size_t num_expansions = 8 * capacity / 32, degree = 32;
+    bool all_match = true;
+    for (size_t e = 0; e < num_expansions; e++)
+    {
+        for (size_t j = 0; j < degree; j++)
+        {
+            unsigned id = (unsigned)(gen() % (16 * capacity));
+            diskann::Neighbor nbr(id, (float)((id * 2654435761u) % 100003));
+            queue.insert(nbr);
+            reference.insert(nbr);
+        }
+        all_match = all_match && queue.has_unexpanded_node() == reference.has_unexpanded_node();
+        if (reference.has_unexpanded_node())
+            all_match = all_match && queue.closest_unexpanded().id == reference.closest_unexpanded().id;
+    }
+    BOOST_TEST(all_match);
+
+    BOOST_TEST(queue.size() == reference.data.size());
+    for (size_t i = 0; i < reference.data.size(); i++)
+    {
+        all_match = all_match && queue[i].id == reference.data[i].id;
+        all_match = all_match && queue[i].expanded == reference.data[i].expanded;
+    }
+    BOOST_TEST(all_match);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(NeighborPriorityQueue_tests)
+
+BOOST_AUTO_TEST_CASE(test_small_queue)
+{
+    check_queue(64);
+}
+
+BOOST_AUTO_TEST_CASE(test_batched_queue)
+{
+    check_queue(diskann::NeighborPriorityQueue::MIN_BATCHED_CAPACITY);
+    check_queue(4 * diskann::NeighborPriorityQueue::MIN_BATCHED_CAPACITY + 7);
+}
+
+BOOST_AUTO_TEST_CASE(test_batched_queue_reserve)
+{
+    // a queue switched to batching by reserve() and back
+    const size_t batched_capacity = diskann::NeighborPriorityQueue::MIN_BATCHED_CAPACITY;
+    diskann::NeighborPriorityQueue queue(16);
+    queue.reserve(batched_capacity);
+    for (unsigned i = 0; i < 1000; i++)
+        queue.insert(diskann::Neighbor(i, (float)(1000 - i)));
+    BOOST_TEST(queue.size() == batched_capacity);
+    BOOST_TEST(queue[0].id == 999u);
+    BOOST_TEST(queue.closest_unexpanded().id == 999u);
+
+    queue.clear();
+    queue.reserve(16);
+    for (unsigned i = 0; i < 1000; i++)
+        queue.insert(diskann::Neighbor(i, (float)i));
+    BOOST_TEST(queue.size() == 16u);
+    BOOST_TEST(queue[15].id == 15u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,252 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "index_factory.h"
+#include "utils.h"
+
+namespace
+{
+const size_t num_points = 500, dim = 16, num_queries = 20, K = 10;
+const uint32_t L = 40;
+
+std::unique_ptr<diskann::AbstractIndex> create_index(diskann::Metric metric, size_t max_points)
+{
+    auto write_params = diskann::IndexWriteParametersBuilder(L, 16).with_num_threads(1).build();
+    auto config = diskann::IndexConfigBuilder()
+                      .with_metric(metric)
+                      .with_dimension(dim)
+                      .with_max_points(max_points)
+                      .with_data_load_store_strategy(diskann::DataStoreStrategy::MEMORY)
+                      .with_graph_load_store_strategy(diskann::GraphStoreStrategy::MEMORY)
+                      .with_data_type("float")
+                      .with_label_type("uint")
+                      .with_tag_type("uint32")
+                      .is_dynamic_index(false)
+                      .is_enable_tags(false)
+                      .with_index_write_params(write_params)
+                      .build();
+    return diskann::IndexFactory(config).create_instance();
+}
+
+std::vector<uint32_t> search_all(diskann::AbstractIndex &index, const std::vector<float> &queries)
+{
+    std::vector<uint32_t> results(num_queries * K);
+    for (size_t q = 0; q < num_queries; q++)
+        index.search(queries.data() + q * dim, K, L, results.data() + q * K);
+    return results;
+}
+
+void random_vectors(std::vector<float> &data, std::vector<float> &queries)
+{
+    std::mt19937 gen(11);
+    std::normal_distribution<float> dist;
+    data.resize(num_points * dim);
+    queries.resize(num_queries * dim);
+    for (auto &v : data)
+        v = dist(gen);
+    for (auto &v : queries)
+        v = dist(gen);
+}
+
+typedef diskann::Index<float, uint32_t, uint32_t> TestIndex;
+
+std::unique_ptr<TestIndex> create_test_index(bool enable_tags, bool filtered)
+{
+    auto write_params = std::make_shared<diskann::IndexWriteParameters>(
+        diskann::IndexWriteParametersBuilder(L, 16).with_filter_list_size(L).with_num_threads(1).build());
+    return std::make_unique<TestIndex>(diskann::Metric::L2, dim, num_points, write_params, nullptr, 0, false,
+                                       enable_tags, false, false, 0, false, filtered);
+}
+
+// the filtered results of the queries for label, with their distances
+std::vector<uint32_t> filtered_search_all(TestIndex &index, const std::vector<float> &queries, uint32_t label,
+                                          std::vector<float> &dists)
+{
+    std::vector<uint32_t> results(num_queries * K);
+    dists.resize(num_queries * K);
+    for (size_t q = 0; q < num_queries; q++)
+        index.search_with_filters(queries.data() + q * dim, label, K, L, results.data() + q * K,
+                                  dists.data() + q * K);
+    return results;
+}
+
+// the tags of the results of the queries, with the vectors returned for them
+std::vector<uint32_t> tag_search_all(TestIndex &index, const std::vector<float> &queries,
+                                     std::vector<float> &vectors)
+{
+    std::vector<uint32_t> tags(num_queries * K);
+    std::vector<float> dists(K);
+    vectors.assign(num_queries * K * dim, 0);
+    for (size_t q = 0; q < num_queries; q++)
+    {
+        std::vector<float *> res_vectors;
+        for (size_t k = 0; k < K; k++)
+            res_vectors.push_back(vectors.data() + (q * K + k) * dim);
+        index.search_with_tags(queries.data() + q * dim, K, L, tags.data() + q * K, dists.data(), res_vectors);
+    }
+    return tags;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PackedIndex_tests)
+
+BOOST_AUTO_TEST_CASE(test_packed_search_matches_graph_search)
+{
+    std::vector<float> data, queries;
+    random_vectors(data, queries);
+    const std::string data_file = "packed_index_tests.bin";
+    const std::string index_prefix = "packed_index_tests_index";
+    diskann::save_bin<float>(data_file, data.data(), num_points, dim);
+
+    // FAST_L2 also reads the norm stored after each packed vector, and ranks
+    // by squared L2 like the graph search
+    for (auto metric : {diskann::Metric::L2, diskann::Metric::FAST_L2, diskann::Metric::INNER_PRODUCT,
+                        diskann::Metric::COSINE})
+    {
+        auto index = create_index(metric, num_points);
+        diskann::IndexFilterParams filter_params = diskann::IndexFilterParamsBuilder().build();
+        index->build(data_file, num_points, filter_params);
+        std::vector<uint32_t> expected = search_all(*index, queries);
+
+        // the packed layout visits the same graph with the same distances
+        index->optimize_index_layout();
+        std::vector<uint32_t> packed = search_all(*index, queries);
+        BOOST_TEST(packed == expected, boost::test_tools::per_element());
+
+        // saved in the packed layout, the index is mapped back on load
+        index->save(index_prefix.c_str());
+        BOOST_TEST(file_exists(index_prefix + ".packed"));
+        BOOST_TEST(!file_exists(index_prefix + ".data"));
+        auto loaded = create_index(metric, 0);
+        loaded->load(index_prefix.c_str(), 1, L);
+        std::vector<uint32_t> mapped = search_all(*loaded, queries);
+        BOOST_TEST(mapped == expected, boost::test_tools::per_element());
+        loaded.reset();
+
+        std::remove((index_prefix + ".packed").c_str());
+        std::remove((index_prefix + ".tags").c_str());
+        std::remove((index_prefix + ".del").c_str());
+    }
+    std::remove(data_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_packed_filtered_and_tag_search)
+{
+    std::vector<float> data, queries;
+    random_vectors(data, queries);
+    const std::string data_file = "packed_index_filter_tests.bin";
+    const std::string label_file = "packed_index_filter_tests_labels.txt";
+    const std::string index_prefix = "packed_index_filter_tests_index";
+    diskann::save_bin<float>(data_file, data.data(), num_points, dim);
+
+    // every point has label 1, one in five also label 2
+    std::ofstream labels(label_file);
+    for (size_t i = 0; i < num_points; i++)
+        labels << (i % 5 == 0 ? "1,2" : "1") << std::endl;
+    labels.close();
+
+    auto filtered = create_test_index(false, true);
+    filtered->build_filtered_index(data_file.c_str(), label_file, num_points);
+    const uint32_t rare_label = 2;
+    std::vector<float> expected_dists, packed_dists;
+    std::vector<uint32_t> expected = filtered_search_all(*filtered, queries, rare_label, expected_dists);
+    filtered->optimize_index_layout();
+    std::vector<uint32_t> packed = filtered_search_all(*filtered, queries, rare_label, packed_dists);
+    BOOST_TEST(packed == expected, boost::test_tools::per_element());
+    BOOST_TEST(packed_dists == expected_dists, boost::test_tools::per_element());
+    bool only_label = true;
+    for (auto id : packed)
+        only_label = only_label && id % 5 == 0;
+    BOOST_TEST(only_label);
+    filtered.reset();
+
+    // tags i + 100, and the vectors of the results copied from the layout
+    std::vector<uint32_t> tags(num_points);
+    for (uint32_t i = 0; i < num_points; i++)
+        tags[i] = i + 100;
+    auto tagged = create_test_index(true, false);
+    tagged->build(data_file.c_str(), num_points, tags);
+    std::vector<float> expected_vectors, packed_vectors, loaded_vectors;
+    std::vector<uint32_t> expected_tags = tag_search_all(*tagged, queries, expected_vectors);
+    tagged->optimize_index_layout();
+    std::vector<uint32_t> packed_tags = tag_search_all(*tagged, queries, packed_vectors);
+    BOOST_TEST(packed_tags == expected_tags, boost::test_tools::per_element());
+    BOOST_TEST(packed_vectors == expected_vectors, boost::test_tools::per_element());
+    bool tag_vectors = true;
+    for (size_t j = 0; j < packed_tags.size(); j++)
+    {
+        auto packed_vector = packed_vectors.begin() + j * dim;
+        auto point = data.begin() + (packed_tags[j] - 100) * dim;
+        tag_vectors = tag_vectors && std::equal(packed_vector, packed_vector + dim, point);
+    }
+    BOOST_TEST(tag_vectors);
+
+    tagged->save(index_prefix.c_str());
+    tagged = create_test_index(true, false);
+    tagged->load(index_prefix.c_str(), 1, L);
+    std::vector<uint32_t> loaded_tags = tag_search_all(*tagged, queries, loaded_vectors);
+    BOOST_TEST(loaded_tags == expected_tags, boost::test_tools::per_element());
+    BOOST_TEST(loaded_vectors == expected_vectors, boost::test_tools::per_element());
+    tagged.reset();
+
+    for (const std::string suffix : {".packed", ".tags", ".del"})
+        std::remove((index_prefix + suffix).c_str());
+    std::remove(data_file.c_str());
+    std::remove(label_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_packed_file_version_is_checked)
+{
+    std::vector<float> data, queries;
+    random_vectors(data, queries);
+    const std::string data_file = "packed_index_version_tests.bin";
+    const std::string index_prefix = "packed_index_version_tests_index";
+    const std::string packed_file = index_prefix + ".packed";
+    diskann::save_bin<float>(data_file, data.data(), num_points, dim);
+
+    auto index = create_index(diskann::Metric::L2, num_points);
+    diskann::IndexFilterParams filter_params = diskann::IndexFilterParamsBuilder().build();
+    index->build(data_file, num_points, filter_params);
+    index->optimize_index_layout();
+    index->save(index_prefix.c_str());
+    index.reset();
+
+    // overwrites the header word at position word with value
+    auto patch_header = [&](size_t word, uint64_t value) {
+        std::fstream file(packed_file, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(word * sizeof(uint64_t));
+        file.write((char *)&value, sizeof(uint64_t));
+    };
+    uint64_t magic, version;
+    {
+        std::ifstream file(packed_file, std::ios::binary);
+        file.read((char *)&magic, sizeof(uint64_t));
+        file.read((char *)&version, sizeof(uint64_t));
+    }
+
+    patch_header(1, version + 1);
+    BOOST_CHECK_THROW(create_index(diskann::Metric::L2, 0)->load(index_prefix.c_str(), 1, L), diskann::ANNException);
+    patch_header(1, version);
+    patch_header(0, magic ^ 1);
+    BOOST_CHECK_THROW(create_index(diskann::Metric::L2, 0)->load(index_prefix.c_str(), 1, L), diskann::ANNException);
+    patch_header(0, magic);
+    auto loaded = create_index(diskann::Metric::L2, 0);
+    loaded->load(index_prefix.c_str(), 1, L);
+    BOOST_TEST(search_all(*loaded, queries).size() == num_queries * K);
+    loaded.reset();
+
+    for (const std::string suffix : {".packed", ".tags", ".del"})
+        std::remove((index_prefix + suffix).c_str());
+    std::remove(data_file.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,193 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "disk_utils.h"
+#include "index.h"
+#include "pq_flash_index.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace
+{
+// Builds that only record how many shards and threads are in use while they
+// sleep, shards with an even id sleeping longer than the others.
+struct RecordedBuilds
+{
+    const uint32_t num_parts;
+    std::vector<std::atomic<bool>> prepared;
+    std::vector<std::atomic<uint32_t>> built;
+    std::atomic<uint32_t> shards_in_use{0}, threads_in_use{0}, max_shards{0}, max_threads{0};
+    std::atomic<bool> built_unprepared{false};
+
+    explicit RecordedBuilds(const uint32_t num_parts) : num_parts(num_parts), prepared(num_parts), built(num_parts)
+    {
+    }
+
+    void prepare(const int p)
+    {
+        prepared[p] = true;
+    }
+
+    void build(const int p, const uint32_t threads)
+    {
+        built_unprepared = built_unprepared || !prepared[p];
+        record_max(max_shards, ++shards_in_use);
+        record_max(max_threads, threads_in_use += threads);
+        std::this_thread::sleep_for(std::chrono::milliseconds(p % 2 == 0 ? 150 : 30));
+        threads_in_use -= threads;
+        shards_in_use--;
+        built[p]++;
+    }
+
+    static void record_max(std::atomic<uint32_t> &max, const uint32_t value)
+    {
+        uint32_t cur = max.load();
+        while (value > cur && !max.compare_exchange_weak(cur, value))
+            ;
+    }
+
+    void run(const std::vector<double> &shard_ram, const double ram_budget, const uint32_t total_threads)
+    {
+        diskann::build_shards_in_groups(
+            shard_ram, ram_budget, total_threads, [this](int p) { prepare(p); },
+            [this](int p, uint32_t threads) { build(p, threads); });
+    }
+
+    bool all_built_once() const
+    {
+        for (const auto &count : built)
+            if (count != 1)
+                return false;
+        return true;
+    }
+};
+
+#ifndef _WINDOWS
+const uint32_t DIM = 16, NUM_POINTS = 3000, R = 32, K = 10, L = 48, COVER_L = 200;
+#endif
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ShardBuild_tests)
+
+BOOST_AUTO_TEST_CASE(test_concurrent_shards_share_the_threads)
+{
+    // two shards fit in the budget at a time, so that when the short shard of
+    // a pair finishes the next one starts next to the long one with only the
+    // threads it freed
+    const uint32_t num_parts = 6, total_threads = 4;
+    RecordedBuilds builds(num_parts);
+    builds.run(std::vector<double>(num_parts, 1.0), 2.5, total_threads);
+
+    BOOST_TEST(builds.all_built_once());
+    BOOST_TEST(!builds.built_unprepared.load());
+    BOOST_TEST(builds.max_shards.load() == 2u);
+    BOOST_TEST(builds.max_threads.load() <= total_threads);
+}
+
+BOOST_AUTO_TEST_CASE(test_shards_over_the_budget_are_built_alone)
+{
+    const uint32_t num_parts = 4, total_threads = 4;
+    RecordedBuilds builds(num_parts);
+    builds.run({1.0, 3.0, 1.0, 1.0}, 2.0, total_threads);
+
+    BOOST_TEST(builds.all_built_once());
+    BOOST_TEST(builds.max_shards.load() == 2u);
+    BOOST_TEST(builds.max_threads.load() <= total_threads);
+
+    // more shards fitting in the budget than there are threads
+    RecordedBuilds one_thread(num_parts);
+    one_thread.run(std::vector<double>(num_parts, 1.0), 10.0, 1);
+    BOOST_TEST(one_thread.all_built_once());
+    BOOST_TEST(one_thread.max_shards.load() == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(test_failed_shard_build_throws)
+{
+    const uint32_t num_parts = 4;
+    std::atomic<uint32_t> num_built(0);
+    BOOST_CHECK_THROW(diskann::build_shards_in_groups(
+                          std::vector<double>(num_parts, 1.0), 2.0, 2, [](int) {},
+                          [&](int p, uint32_t) {
+                              if (p == 1)
+                                  throw std::runtime_error("shard build failed");
+                              std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                              num_built++;
+                          }),
+                      std::runtime_error);
+    // the shard built next to the failed one finished before the exception
+    BOOST_TEST(num_built.load() >= 1u);
+}
+
+#ifndef _WINDOWS
+BOOST_AUTO_TEST_CASE(test_multi_shard_build_covers_every_point)
+{
+    test_utils::ScratchDir scratch("diskann_shard_build_test");
+    test_utils::PointSet points(NUM_POINTS, DIM);
+    points.fill_random(11);
+    const std::string base_file = scratch.dir + "/base.bin", prefix = scratch.dir + "/disk";
+    diskann::save_bin<float>(base_file, points.data.data(), NUM_POINTS, DIM);
+
+    // an indexing budget below the full index, so that it is built in shards
+    const double full_index_gb = diskann::estimate_ram_usage(NUM_POINTS, DIM, sizeof(float), R) / (1 << 30);
+    const std::string params = std::to_string(R) + " " + std::to_string(L) + " 0.01 " +
+                               std::to_string(full_index_gb * 0.8) + " 4 0 0";
+    BOOST_REQUIRE(diskann::build_disk_index<float>(base_file.c_str(), prefix.c_str(), params.c_str(),
+                                                   diskann::Metric::L2) == 0);
+    BOOST_REQUIRE(std::filesystem::exists(prefix + "_mem.index_tempFiles_subshard-1_ids_uint32.bin"));
+
+    std::shared_ptr<AlignedFileReader> reader(new LinuxAlignedFileReader());
+    std::shared_ptr<AlignedFileReader> graph_reader(new LinuxAlignedFileReader());
+    diskann::PQFlashIndex<float> index(reader, graph_reader, diskann::Metric::L2);
+    BOOST_REQUIRE(index.load(1, prefix.c_str(), 0, nullptr, "") == 0);
+
+    // every point is reached by a search for itself, with a list wide enough
+    // for the outliers of the random points
+    uint32_t num_found = 0;
+    std::vector<uint64_t> ids(K);
+    std::vector<float> dists(K);
+    for (uint32_t i = 0; i < NUM_POINTS; i++)
+    {
+        index.cached_beam_search(points.point(i), K, COVER_L, ids.data(), dists.data(), 4);
+        num_found += std::count(ids.begin(), ids.end(), (uint64_t)i) > 0 ? 1 : 0;
+    }
+    BOOST_TEST(num_found == NUM_POINTS);
+
+    // recall@K of queries near the base points
+    const uint32_t num_queries = 100;
+    std::mt19937 gen(12);
+    std::normal_distribution<float> dis(0.0f, 0.3f);
+    size_t hits = 0;
+    for (uint32_t q = 0; q < num_queries; q++)
+    {
+        std::vector<float> query(points.point(q * 29), points.point(q * 29) + DIM);
+        for (auto &v : query)
+            v += dis(gen);
+        index.cached_beam_search(query.data(), K, L, ids.data(), dists.data(), 4);
+        hits += test_utils::count_hits(points.exact_knn(query.data(), K), ids.data(), K);
+    }
+    const double recall = (double)hits / (num_queries * K);
+    BOOST_TEST_MESSAGE("recall@" << K << " of the merged index " << recall);
+    BOOST_TEST(recall >= 0.9);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
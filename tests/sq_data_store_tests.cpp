@@ -0,0 +1,202 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstdio>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+
+#include "index_factory.h"
+#include "scratch.h"
+#include "sq_data_store.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+BOOST_AUTO_TEST_SUITE(SQDataStore_tests)
+
+BOOST_AUTO_TEST_CASE(test_asymmetric_distance_matches_dequantized)
+{
+    const size_t num_points = 100, dim = 70;
+    std::mt19937 gen(42);
+    std::normal_distribution<float> dist;
+    std::vector<float> data(num_points * dim), query(dim), decoded(dim);
+    for (auto &v : data)
+        v = dist(gen);
+    for (auto &v : query)
+        v = dist(gen);
+
+    for (uint32_t num_bits : {8u, 4u})
+    {
+        std::unique_ptr<diskann::Distance<float>> distance_fn(
+            diskann::get_distance_function<float>(diskann::Metric::L2));
+        diskann::SQDataStore<float> store((diskann::location_t)num_points, dim, num_bits, std::move(distance_fn));
+        store.populate_data(data.data(), (diskann::location_t)num_points);
+
+        for (diskann::location_t i = 0; i < num_points; i++)
+        {
+            store.get_vector(i, decoded.data());
+            float expected = 0;
+            for (size_t j = 0; j < dim; j++)
+                expected += (query[j] - decoded[j]) * (query[j] - decoded[j]);
+            BOOST_TEST(store.get_distance(query.data(), i) == expected, boost::test_tools::tolerance(1e-3f));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_distances_use_the_prepared_query)
+{
+    const size_t num_points = 100, dim = 70;
+    std::mt19937 gen(5);
+    std::normal_distribution<float> dist;
+    std::vector<float> data(num_points * dim), query(dim), other_query(dim);
+    for (auto &v : data)
+        v = dist(gen);
+    for (auto &v : query)
+        v = dist(gen);
+    for (auto &v : other_query)
+        v = dist(gen);
+    std::vector<diskann::location_t> locations(num_points);
+    for (diskann::location_t i = 0; i < num_points; i++)
+        locations[i] = i;
+
+    for (auto metric : {diskann::Metric::L2, diskann::Metric::INNER_PRODUCT, diskann::Metric::COSINE})
+    {
+        for (uint32_t num_bits : {8u, 4u})
+        {
+            std::unique_ptr<diskann::Distance<float>> distance_fn(diskann::get_distance_function<float>(metric));
+            diskann::SQDataStore<float> store((diskann::location_t)num_points, dim, num_bits, std::move(distance_fn));
+            store.populate_data(data.data(), (diskann::location_t)num_points);
+            diskann::InMemQueryScratch<float> scratch(10, 10, 8, 8, dim, store.get_aligned_dim(),
+                                                      store.get_alignment_factor());
+
+            // without a prepared query the batch call refuses the scratch
+            std::vector<float> distances(num_points);
+            BOOST_CHECK_THROW(store.get_distance(query.data(), locations, distances, &scratch),
+                              diskann::ANNException);
+
+            // the batch distances come from the query prepared in the
+            // scratch, whatever query pointer is passed with it
+            store.preprocess_query(query.data(), &scratch);
+            store.get_distance(other_query.data(), locations, distances, &scratch);
+            bool same = true;
+            for (diskann::location_t i = 0; i < num_points; i++)
+                same = same && distances[i] == store.get_distance(query.data(), i);
+            BOOST_TEST_CONTEXT("metric " << (int)metric << " bits " << num_bits)
+            {
+                BOOST_TEST(same);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_index_search_on_sq_store)
+{
+    const uint32_t num_points = 1000, dim = 32, num_queries = 50, K = 10, L = 40;
+    test_utils::PointSet points(num_points, dim), queries(num_queries, dim);
+    points.fill_random(13);
+    queries.fill_random(14);
+    const std::string data_file = "sq_data_store_tests_index.bin";
+    diskann::save_bin<float>(data_file, points.data.data(), num_points, dim);
+
+    auto write_params = diskann::IndexWriteParametersBuilder(L, 32).with_num_threads(1).build();
+    auto config = diskann::IndexConfigBuilder()
+                      .with_metric(diskann::Metric::L2)
+                      .with_dimension(dim)
+                      .with_max_points(num_points)
+                      .with_data_load_store_strategy(diskann::DataStoreStrategy::MEMORY)
+                      .with_graph_load_store_strategy(diskann::GraphStoreStrategy::MEMORY)
+                      .with_data_type("float")
+                      .with_label_type("uint")
+                      .with_tag_type("uint32")
+                      .is_dynamic_index(false)
+                      .is_enable_tags(false)
+                      .with_num_sq_bits(8)
+                      .with_index_write_params(write_params)
+                      .build();
+    auto index = diskann::IndexFactory(config).create_instance();
+    diskann::IndexFilterParams filter_params = diskann::IndexFilterParamsBuilder().build();
+    index->build(data_file, num_points, filter_params);
+
+    // build and search both compute their distances from prepared queries
+    size_t hits = 0;
+    std::vector<uint32_t> ids(K);
+    for (uint32_t q = 0; q < num_queries; q++)
+    {
+        index->search(queries.point(q), K, L, ids.data());
+        hits += test_utils::count_hits(points.exact_knn(queries.point(q), K), ids.data(), K);
+    }
+    const double recall = (double)hits / (num_queries * K);
+    BOOST_TEST_MESSAGE("recall@" << K << " on the 8-bit store " << recall);
+    BOOST_TEST(recall >= 0.9);
+    std::remove(data_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_save_load)
+{
+    const size_t num_points = 50, dim = 33;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> data(num_points * dim);
+    for (auto &v : data)
+        v = dist(gen);
+
+    const std::string filename = "sq_data_store_tests.data";
+    std::unique_ptr<diskann::Distance<float>> distance_fn(
+        diskann::get_distance_function<float>(diskann::Metric::INNER_PRODUCT));
+    diskann::SQDataStore<float> store((diskann::location_t)num_points, dim, 4, std::move(distance_fn));
+    store.populate_data(data.data(), (diskann::location_t)num_points);
+    store.save(filename, (diskann::location_t)num_points);
+
+    BOOST_TEST(diskann::SQDataStore<float>::get_num_bits_from_file(filename) == 4u);
+
+    std::unique_ptr<diskann::Distance<float>> loaded_distance_fn(
+        diskann::get_distance_function<float>(diskann::Metric::INNER_PRODUCT));
+    diskann::SQDataStore<float> loaded(1, dim, 4, std::move(loaded_distance_fn));
+    BOOST_TEST(loaded.load(filename) == num_points);
+    for (diskann::location_t i = 1; i < num_points; i++)
+    {
+        BOOST_TEST(loaded.get_distance((diskann::location_t)0, i) == store.get_distance((diskann::location_t)0, i));
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "_sq_params.bin").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_stale_params_rejected)
+{
+    const size_t num_points = 64, dim = 16;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> data(num_points * dim);
+    for (auto &v : data)
+        v = dist(gen);
+
+    const std::string filename_8 = "sq_data_store_tests_8.data", filename_4 = "sq_data_store_tests_4.data";
+    diskann::SQDataStore<float> store_8((diskann::location_t)num_points, dim, 8,
+                                        std::unique_ptr<diskann::Distance<float>>(
+                                            diskann::get_distance_function<float>(diskann::Metric::L2)));
+    store_8.populate_data(data.data(), (diskann::location_t)num_points);
+    store_8.save(filename_8, (diskann::location_t)num_points);
+    diskann::SQDataStore<float> store_4((diskann::location_t)num_points, dim, 4,
+                                        std::unique_ptr<diskann::Distance<float>>(
+                                            diskann::get_distance_function<float>(diskann::Metric::L2)));
+    store_4.populate_data(data.data(), (diskann::location_t)num_points);
+    store_4.save(filename_4, (diskann::location_t)num_points);
+    BOOST_TEST(diskann::SQDataStore<float>::get_num_bits_from_file(filename_8) == 8u);
+
+    // parameters of the 4-bit store left next to the 8-bit codes
+    std::remove((filename_8 + "_sq_params.bin").c_str());
+    std::rename((filename_4 + "_sq_params.bin").c_str(), (filename_8 + "_sq_params.bin").c_str());
+    BOOST_CHECK_THROW(diskann::SQDataStore<float>::get_num_bits_from_file(filename_8), diskann::ANNException);
+    diskann::SQDataStore<float> loaded(1, dim, 8,
+                                       std::unique_ptr<diskann::Distance<float>>(
+                                           diskann::get_distance_function<float>(diskann::Metric::L2)));
+    BOOST_CHECK_THROW(loaded.load(filename_8), diskann::ANNException);
+
+    std::remove(filename_8.c_str());
+    std::remove(filename_4.c_str());
+    std::remove((filename_8 + "_sq_params.bin").c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
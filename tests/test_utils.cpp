@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <filesystem>
+#include <random>
+
+#include "disk_utils.h"
+#include "utils.h"
+
+#include "test_utils.h"
+
+namespace test_utils
+{
+float squared_l2(const float *a, const float *b, const uint32_t dim)
+{
+    float dist = 0;
+    for (uint32_t d = 0; d < dim; d++)
+        dist += (a[d] - b[d]) * (a[d] - b[d]);
+    return dist;
+}
+
+ScratchDir::ScratchDir(const std::string &name)
+    : dir((std::filesystem::temp_directory_path() / name).string())
+{
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+}
+
+ScratchDir::~ScratchDir()
+{
+    std::filesystem::remove_all(dir);
+}
+
+PointSet::PointSet(const uint32_t num_points, const uint32_t dim) : dim(dim), data((size_t)num_points * dim)
+{
+}
+
+void PointSet::fill_random(const uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+    for (auto &v : data)
+        v = dis(gen);
+}
+
+std::vector<uint32_t> PointSet::exact_knn(const float *query, const uint32_t K,
+                                          const std::vector<uint32_t> &candidates) const
+{
+    std::vector<std::pair<float, uint32_t>> exact;
+    if (candidates.empty())
+    {
+        for (uint32_t i = 0; i < num_points(); i++)
+            exact.emplace_back(distance(i, query), i);
+    }
+    else
+    {
+        for (uint32_t id : candidates)
+            exact.emplace_back(distance(id, query), id);
+    }
+    const size_t num_nearest = (std::min)(exact.size(), (size_t)K);
+    std::partial_sort(exact.begin(), exact.begin() + num_nearest, exact.end());
+
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < num_nearest; i++)
+        ids.push_back(exact[i].second);
+    return ids;
+}
+
+RandomDiskIndex::RandomDiskIndex(const std::string &name, const uint32_t num_points, const uint32_t dim,
+                                 const uint32_t seed)
+    : ScratchDir(name), PointSet(num_points, dim), prefix(dir + "/disk")
+{
+    fill_random(seed);
+}
+
+void RandomDiskIndex::build(const uint32_t num_index_points, const uint32_t nav_graph_points,
+                            const std::string &label_file)
+{
+    const uint32_t num_built = num_index_points == 0 ? num_points() : num_index_points;
+    diskann::save_bin<float>(dir + "/base.bin", data.data(), num_built, dim);
+    diskann::build_disk_index<float>((dir + "/base.bin").c_str(), prefix.c_str(), "32 64 0.01 1 4 0 0",
+                                     diskann::Metric::L2, false, "", !label_file.empty(), label_file, "", 0, 64,
+                                     nav_graph_points);
+}
+} // namespace test_utils
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace test_utils
+{
+float squared_l2(const float *a, const float *b, const uint32_t dim);
+
+// A scratch directory under the system temp directory, emptied on creation
+// and removed with the object.
+struct ScratchDir
+{
+    std::string dir;
+
+    explicit ScratchDir(const std::string &name);
+    ~ScratchDir();
+};
+
+// Row-major points with exact distance helpers.
+struct PointSet
+{
+    uint32_t dim;
+    std::vector<float> data;
+
+    PointSet(const uint32_t num_points, const uint32_t dim);
+
+    // fills the points with standard normal values
+    void fill_random(const uint32_t seed);
+
+    uint32_t num_points() const
+    {
+        return (uint32_t)(data.size() / dim);
+    }
+
+    const float *point(const uint32_t id) const
+    {
+        return data.data() + (size_t)id * dim;
+    }
+
+    float distance(const uint32_t id, const float *query) const
+    {
+        return squared_l2(point(id), query, dim);
+    }
+
+    // ids of the K points nearest to query among candidates, or among all
+    // points if candidates is empty, nearest first
+    std::vector<uint32_t> exact_knn(const float *query, const uint32_t K,
+                                    const std::vector<uint32_t> &candidates = {}) const;
+};
+
+// A disk index over random points, built at <dir>/disk from <dir>/base.bin
+// with R = 32, L = 64 and full precision vectors on disk.
+struct RandomDiskIndex : ScratchDir, PointSet
+{
+    std::string prefix;
+
+    RandomDiskIndex(const std::string &name, const uint32_t num_points, const uint32_t dim, const uint32_t seed);
+
+    // builds the index over the first num_index_points points, all of them if
+    // 0, replacing any index already at the prefix
+    void build(const uint32_t num_index_points = 0, const uint32_t nav_graph_points = 0,
+               const std::string &label_file = "");
+};
+
+// how many of the ids are in truth
+template <typename IdT> size_t count_hits(const std::vector<uint32_t> &truth, const IdT *ids, const size_t num_ids)
+{
+    size_t hits = 0;
+    for (uint32_t id : truth)
+        hits += std::count(ids, ids + num_ids, (IdT)id);
+    return hits;
+}
+} // namespace test_utils